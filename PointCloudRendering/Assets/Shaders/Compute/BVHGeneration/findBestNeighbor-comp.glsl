@@ -44,7 +44,7 @@ void main()
 
 	const uint lowerIndex = max(int(index - radius), 0), upperIndex = min(index + radius, arraySize - 1);
 	uint currentIndex = lowerIndex;
-	float distance, minDistance = INT_MAX;
+	float distance, minDistance = uintBitsToFloat(0x7F7FFFFF);			// FLT_MAX, large scenes exceed INT_MAX surface area
 
 	while (currentIndex < index)
 	{
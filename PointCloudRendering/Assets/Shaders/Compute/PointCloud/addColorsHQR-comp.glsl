@@ -13,51 +13,34 @@ layout (std430, binding = 0) buffer DepthBuffer		{ uint			depthBuffer[]; };
 layout (std430, binding = 1) buffer Color01Buffer	{ uint64_t		colorBuffer01[]; };
 layout (std430, binding = 2) buffer Color02Buffer	{ uint64_t		colorBuffer02[]; };
 layout (std430, binding = 3) buffer PointBuffer		{ PointModel	points[]; };
+layout (std430, binding = 4) buffer DistanceBuffer	{ float			distances[]; };
 
 uniform mat4	cameraMatrix;
 uniform float	distanceThreshold;
 uniform uint	maxClassId;
+uniform float	maxDistance;
 uniform uint	numPoints;
 uniform uvec2	windowSize;
 
 uniform vec2		minMaxHeight, minMaxColor;
 uniform sampler2D	paletteTexture;
 
-subroutine vec3 colorType(uint index);
-subroutine uniform colorType colorUniform;
-
-subroutine(colorType)
-vec3 rgbColor(uint index)
-{
-	//vec2 returnIds = unpackHalf2x16(points[index].returnData);
-	//float pointReturnFactor = returnIds.x / returnIds.y;
-
-	//return vec3(pointReturnFactor) * 255.0f;
-	return unpackUnorm4x8(points[index].rgb).rgb * 255.0f;
-}
-
-subroutine(colorType)
-vec3 rgbNormalizedColor(uint index)
+// Color mode is resolved at compile time (see ShaderList permutations): RGB by default
+vec3 getColor(uint index)
 {
+#if defined(RGB_NORMALIZED_COLOR)
 	return vec3((points[index].rgb - minMaxColor.x) / (minMaxColor.y - minMaxColor.x)) * 255.0f;
-}
-
-subroutine(colorType)
-vec3 normalColor(uint index)
-{
+#elif defined(NORMAL_COLOR)
 	return texture(paletteTexture, vec2(.5f, abs(dot(vec3(.0f, 1.0f, .0f), points[index].normal)))).rgb * 255.0f;
-}
-
-subroutine(colorType)
-vec3 heightColor(uint index)
-{
+#elif defined(HEIGHT_COLOR)
 	return texture(paletteTexture, vec2(.5f, (points[index].point.z - minMaxHeight.x) / (minMaxHeight.y - minMaxHeight.x))).rgb * 255.0f;
-}
-
-subroutine(colorType)
-vec3 classColor(uint index)
-{
+#elif defined(CLASS_COLOR)
 	return texture(paletteTexture, vec2(.5f, unpackUnorm4x8(points[index].returnClassData).z * 256.0f / maxClassId)).rgb * 255.0f;
+#elif defined(DISTANCE_COLOR)
+	return texture(paletteTexture, vec2(.5f, clamp(distances[index] / maxDistance, -1.0f, 1.0f) * .5f + .5f)).rgb * 255.0f;
+#else
+	return unpackUnorm4x8(points[index].rgb).rgb * 255.0f;
+#endif
 }
 
 
@@ -78,10 +61,10 @@ void main()
 	int pointIndex			= int(windowPosition.y * windowSize.x + windowPosition.x);
 	float depth				= projectedPoint.w;
 	float depthInBuffer		= uintBitsToFloat(depthBuffer[pointIndex]);
-	uvec3 rgbColor			= uvec3(colorUniform(index));
 
 	if (depth < depthInBuffer * distanceThreshold)			// Same surface
 	{
+		uvec3 rgbColor = uvec3(getColor(index));
 		uint64_t rg = (uint64_t(rgbColor.r) << 32) | rgbColor.g;
 		uint64_t ba = (uint64_t(rgbColor.b) << 32) | 1;
 
@@ -13,11 +13,19 @@ layout (local_size_variable) in;
 
 layout (std430, binding = 0) buffer DepthBuffer { uint			depthBuffer[]; };
 layout (std430, binding = 1) buffer PointBuffer { PointModel	points[]; };
+
+#ifdef VISIBILITY_CHECK
 layout (std430, binding = 2) buffer VisibilityBuffer { uint8_t	visibility[]; };
+#endif
+
+#ifdef GROUND_CHECK
 layout (std430, binding = 3) buffer GroundBuffer { uint8_t		ground[]; };
+#endif
+
+#ifdef INLIER_CHECK
+layout (std430, binding = 4) buffer InlierBuffer { uint8_t		inlier[]; };
+#endif
 
-uniform uint	calculatedGround;
-uniform uint	calculatedVisibility;
 uniform mat4	cameraMatrix;
 uniform ivec2	classRange;
 uniform float	maxReturns;
@@ -25,34 +33,22 @@ uniform uint	numPoints;
 uniform float	returnFactor;
 uniform uvec2	windowSize;
 
-subroutine bool visibilityType(uint index);
-subroutine uniform visibilityType visibilityUniform;
-
-subroutine bool groundType(uint index);
-subroutine uniform groundType groundUniform;
-
-subroutine(visibilityType)
-bool visibilityCheck(uint index)
+// Filters are resolved at compile time (see ShaderList permutations), so that no indirect call is made per point
+bool isFiltered(uint index)
 {
-	return calculatedVisibility == 1 && visibility[index] == uint8_t(0);
-}
+#ifdef VISIBILITY_CHECK
+	if (visibility[index] == uint8_t(0)) return true;
+#endif
 
-subroutine(visibilityType)
-bool noVisibilityCheck(uint index)
-{
-	return false;
-}
+#ifdef GROUND_CHECK
+	if (ground[index] != uint8_t(1)) return true;
+#endif
 
-subroutine(groundType)
-bool groundCheck(uint index)
-{
-	return calculatedGround == 1 && ground[index] == uint8_t(1);
-}
+#ifdef INLIER_CHECK
+	if (inlier[index] != uint8_t(1)) return true;
+#endif
 
-subroutine(groundType)
-bool noGroundCheck(uint index)
-{
-	return true;
+	return false;
 }
 
 
@@ -69,7 +65,7 @@ void main()
 	float pointReturnFactor = returnClassId.x / returnClassId.y;
 
 	if (projectedPoint.w <= 0.0 || projectedPoint.x < -1.0 || projectedPoint.x > 1.0 || projectedPoint.y < -1.0 || projectedPoint.y > 1.0 
-		|| pointReturnFactor < returnFactor || returnClassId.z * 256.0f < classRange.x || returnClassId.z * 256.0f > classRange.y || visibilityUniform(index) || !groundUniform(index))
+		|| pointReturnFactor < returnFactor || returnClassId.z * 256.0f < classRange.x || returnClassId.z * 256.0f > classRange.y || isFiltered(index))
 	{
 		return;
 	}
@@ -53,16 +53,13 @@ void CSF::setPointCloud(std::vector<csf::Point> points) {
     point_cloud.resize(points.size());
 
     int pointCount = static_cast<int>(points.size());
-    #ifdef CSF_USE_OPENMP
-    #pragma omp parallel for
-    #endif
-    for (int i = 0; i < pointCount; i++) {
+    csf::parallelFor(pointCount, [&](int i) {
         csf::Point las;
         las.x          = points[i].x;
         las.y          = -points[i].z;
         las.z          = points[i].y;
         point_cloud[i] = las;
-    }
+    });
 }
 
 void CSF::setPointCloud(double *points, int rows) {
@@ -80,31 +77,25 @@ void CSF::setPointCloud(double *points, int rows) {
 void CSF::setPointCloud(csf::PointCloud& pc) {
     point_cloud.resize(pc.size());
     int pointCount = static_cast<int>(pc.size());
-    #ifdef CSF_USE_OPENMP
-    #pragma omp parallel for
-    #endif
-    for (int i = 0; i < pointCount; i++) {
+    csf::parallelFor(pointCount, [&](int i) {
         csf::Point las;
         las.x          = pc[i].x;
         las.y          = -pc[i].z;
         las.z          = pc[i].y;
         point_cloud[i] = las;
-    }
+    });
 }
 
 void CSF::setPointCloud(std::vector<std::vector<float> > points) {
     point_cloud.resize(points.size());
     int pointCount = static_cast<int>(points.size());
-    #ifdef CSF_USE_OPENMP
-    #pragma omp parallel for
-    #endif
-    for (int i = 0; i < pointCount; i++) {
+    csf::parallelFor(pointCount, [&](int i) {
         csf::Point las;
         las.x          = points[i][0];
         las.y          = -points[i][2];
         las.z          = points[i][1];
         point_cloud[i] = las;
-    }
+    });
 }
 
 void CSF::readPointsFromFile(std::string filename) {
@@ -114,6 +105,8 @@ void CSF::readPointsFromFile(std::string filename) {
 
 
 Cloth CSF::do_cloth() {
+    csf::ScopedStage stage("Cloth simulation");
+
     // Terrain
     std::cout << "[" << this->index << "] Configuring terrain..." << std::endl;
     csf::Point bbMin, bbMax;
@@ -153,7 +146,10 @@ Cloth CSF::do_cloth() {
     );
 
     std::cout << "[" << this->index << "] Rasterizing..." << std::endl;
-    Rasterization::RasterTerrian(cloth, point_cloud, cloth.getHeightvals());
+    {
+        csf::ScopedStage rasterStage("Cloth rasterization");
+        Rasterization::RasterTerrian(cloth, point_cloud, cloth.getHeightvals());
+    }
 
     double time_step2 = params.time_step * params.time_step;
     double gravity    = 0.2;
@@ -163,6 +159,8 @@ Cloth CSF::do_cloth() {
 
     // boost::progress_display pd(params.interations);
     for (int i = 0; i < params.interations; i++) {
+        csf::ScopedStage iterationStage("Cloth iteration");
+
         double maxDiff = cloth.timeStep();
         cloth.terrCollision();
 		//params.class_threshold / 100
@@ -175,6 +173,7 @@ Cloth CSF::do_cloth() {
 
     if (params.bSloopSmooth) {
         std::cout << "[" << this->index << "]  - post handle..." << std::endl;
+        csf::ScopedStage smoothStage("Slope smoothing");
         cloth.movableFilter();
     }
 
@@ -190,8 +189,11 @@ void CSF::do_filtering(std::vector<int>& groundIndexes,
                       std::vector<int>& offGroundIndexes,
                       bool exportCloth) {
     auto cloth = do_cloth();
-    if (exportCloth)
+    if (exportCloth) {
+        csf::ScopedStage exportStage("Cloth export");
         cloth.saveToFile();
+    }
+    csf::ScopedStage classificationStage("Point classification");
     c2cdist c2c(params.class_threshold);
     c2c.calCloud2CloudDist(cloth, point_cloud, groundIndexes, offGroundIndexes);
 }
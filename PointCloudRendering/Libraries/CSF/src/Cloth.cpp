@@ -19,6 +19,42 @@
 #include <fstream>
 
 
+namespace {
+csf::ParallelFor parallelForImplementation;
+csf::StageBegin  stageBeginCallback;
+csf::StageEnd    stageEndCallback;
+}
+
+void csf::setParallelFor(const ParallelFor& parallelFor) {
+    parallelForImplementation = parallelFor;
+}
+
+void csf::parallelFor(int count, const std::function<void (int)>& body) {
+    if (parallelForImplementation) {
+        parallelForImplementation(count, body);
+        return;
+    }
+
+    for (int i = 0; i < count; i++)
+        body(i);
+}
+
+void csf::setStageCallbacks(const StageBegin& begin, const StageEnd& end) {
+    stageBeginCallback = begin;
+    stageEndCallback   = end;
+}
+
+csf::ScopedStage::ScopedStage(const char *name) : handle(NULL) {
+    if (stageBeginCallback)
+        handle = stageBeginCallback(name);
+}
+
+csf::ScopedStage::~ScopedStage() {
+    if (stageEndCallback)
+        stageEndCallback(handle);
+}
+
+
 Cloth::Cloth(const Vec3& _origin_pos,
              int         _num_particles_width,
              int         _num_particles_height,
@@ -96,16 +132,11 @@ Cloth::Cloth(const Vec3& _origin_pos,
 
 double Cloth::timeStep() {
     int particleCount = static_cast<int>(particles.size());
-    #ifdef CSF_USE_OPENMP
-    #pragma omp parallel for
-    #endif
-    for (int i = 0; i < particleCount; i++) {
+    csf::parallelFor(particleCount, [this](int i) {
         particles[i].timeStep();
-    }
+    });
 
-    #ifdef CSF_USE_OPENMP
-    #pragma omp parallel for
-    #endif
+    // constraints also move the neighbours of every particle, so they are kept serial
     for (int j = 0; j < particleCount; j++) {
         particles[j].satisfyConstraintSelf(constraint_iterations);
     }
@@ -132,18 +163,15 @@ void Cloth::addForce(const Vec3 direction) {
 
 void Cloth::terrCollision() {
     int particleCount = static_cast<int>(particles.size());
-    
-    #ifdef CSF_USE_OPENMP
-    #pragma omp parallel for
-    #endif
-    for (int i = 0; i < particleCount; i++) {
+
+    csf::parallelFor(particleCount, [this](int i) {
         Vec3 v = particles[i].getPos();
 
         if (v.f[1] < heightvals[i]) {
             particles[i].offsetPos(Vec3(0, heightvals[i] - v.f[1], 0));
             particles[i].makeUnmovable();
         }
-    }
+    });
 }
 
 void Cloth::movableFilter() {
@@ -46,9 +46,7 @@
 #include <math.h>
 #include <vector>
 #include <iostream>
-#ifdef CSF_USE_OPENMP
-#include <omp.h>
-#endif
+#include <functional>
 #include <sstream>
 #include <list>
 #include <cmath>
@@ -61,6 +59,32 @@
 // post processing is only for connected component which is large than 50
 #define MAX_PARTICLE_FOR_POSTPROCESSIN    50
 
+namespace csf {
+// Runs body(i) for every i in [0, count). Parallel loops of the filter go through it,
+// so that the host application can run them on its own scheduler. Serial by default.
+typedef std::function<void (int count, const std::function<void (int)>& body)> ParallelFor;
+
+void setParallelFor(const ParallelFor& parallelFor);
+void parallelFor(int count, const std::function<void (int)>& body);
+
+// Notified when a stage of the filter starts and finishes, so that the host application
+// can measure it. The handle returned by the first callback is given to the second one.
+typedef std::function<void *(const char *name)> StageBegin;
+typedef std::function<void (void *handle)>      StageEnd;
+
+void setStageCallbacks(const StageBegin& begin, const StageEnd& end);
+
+// Stage which lasts until the end of its scope
+class ScopedStage {
+public:
+    explicit ScopedStage(const char *name);
+    ~ScopedStage();
+
+private:
+    void *handle;
+};
+}
+
 struct XY {
     XY(int x1, int y1) {
         x = x1; y = y1;
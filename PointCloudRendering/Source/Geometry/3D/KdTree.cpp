@@ -0,0 +1,400 @@
+#include "stdafx.h"
+#include "KdTree.h"
+
+#include "Utilities/ThreadPool.h"
+
+// [Static members initialization]
+
+const unsigned KdTree::NOT_FOUND = UINT_MAX;
+const unsigned KdTree::LEAF_SIZE = 8;
+const unsigned KdTree::PARALLEL_THRESHOLD = 1 << 16;
+
+/// [Public methods]
+
+KdTree::KdTree()
+{
+}
+
+KdTree::~KdTree()
+{
+}
+
+void KdTree::build(const void* points, const size_t numPoints, const size_t stride)
+{
+	this->clear();
+
+	if (!numPoints) return;
+
+	const uint8_t* data = static_cast<const uint8_t*>(points);
+
+	_points.resize(numPoints);
+	_splitAxis.resize(numPoints, 0);
+
+	std::for_each(std::execution::par_unseq, _points.begin(), _points.end(), [&](IndexedPoint& point)
+		{
+			const size_t index = &point - _points.data();
+			point._point = *reinterpret_cast<const vec3*>(data + index * stride);
+			point._index = unsigned(index);
+		});
+
+	_aabb = std::transform_reduce(std::execution::par_unseq, _points.begin(), _points.end(), AABB(),
+		[](AABB aabb1, const AABB& aabb2) -> AABB { aabb1.update(aabb2); return aabb1; },
+		[](const IndexedPoint& point) -> AABB { return AABB(point._point, point._point); });
+
+	// Spawn as many top-level tasks as pool threads, the remaining levels are built serially by each task
+	const unsigned parallelDepth = unsigned(std::ceil(std::log2((std::max)(ThreadPool::getInstance()->getNumThreads(), 1u))));
+	this->build(0, unsigned(numPoints), _aabb, parallelDepth);
+}
+
+void KdTree::clear()
+{
+	_aabb = AABB();
+	std::vector<IndexedPoint>().swap(_points);
+	std::vector<uint8_t>().swap(_splitAxis);
+}
+
+bool KdTree::read(std::istream& stream, const void* points, const size_t numPoints, const size_t stride)
+{
+	size_t numIndexedPoints = 0;
+
+	this->clear();
+
+	stream.read((char*)&numIndexedPoints, sizeof(size_t));
+	if (!stream.good() || numIndexedPoints != numPoints || !numPoints) return false;
+
+	std::vector<unsigned> indices(numPoints);
+	_splitAxis.resize(numPoints);
+
+	stream.read((char*)indices.data(), numPoints * sizeof(unsigned));
+	stream.read((char*)_splitAxis.data(), numPoints * sizeof(uint8_t));
+
+	if (!stream.good() || std::any_of(std::execution::par_unseq, indices.begin(), indices.end(), [numPoints](unsigned index) { return index >= numPoints; }))
+	{
+		this->clear();
+		return false;
+	}
+
+	const uint8_t* data = static_cast<const uint8_t*>(points);
+	_points.resize(numPoints);
+
+	std::for_each(std::execution::par_unseq, _points.begin(), _points.end(), [&](IndexedPoint& point)
+		{
+			point._index = indices[&point - _points.data()];
+			point._point = *reinterpret_cast<const vec3*>(data + size_t(point._index) * stride);
+		});
+
+	_aabb = std::transform_reduce(std::execution::par_unseq, _points.begin(), _points.end(), AABB(),
+		[](AABB aabb1, const AABB& aabb2) -> AABB { aabb1.update(aabb2); return aabb1; },
+		[](const IndexedPoint& point) -> AABB { return AABB(point._point, point._point); });
+
+	return true;
+}
+
+bool KdTree::write(std::ostream& stream) const
+{
+	const size_t numPoints = _points.size();
+	std::vector<unsigned> indices(numPoints);
+
+	std::transform(std::execution::par_unseq, _points.begin(), _points.end(), indices.begin(), [](const IndexedPoint& point) { return point._index; });
+
+	stream.write((char*)&numPoints, sizeof(size_t));
+	stream.write((char*)indices.data(), numPoints * sizeof(unsigned));
+	stream.write((char*)_splitAxis.data(), numPoints * sizeof(uint8_t));
+
+	return stream.good();
+}
+
+void KdTree::aabbSearch(const AABB& aabb, std::vector<unsigned>& indices) const
+{
+	indices.clear();
+
+	if (_points.empty()) return;
+
+	this->aabbSearch(aabb, 0, unsigned(_points.size()), indices);
+}
+
+void KdTree::aabbSearch(const std::vector<AABB>& aabbs, std::vector<std::vector<unsigned>>& indices) const
+{
+	indices.resize(aabbs.size());
+
+	ThreadPool::getInstance()->parallelFor(0, aabbs.size(), [&](const size_t aabbIdx)
+		{
+			this->aabbSearch(aabbs[aabbIdx], indices[aabbIdx]);
+		});
+}
+
+void KdTree::knnSearch(const vec3& point, const unsigned k, std::vector<unsigned>& neighbours, std::vector<float>* sqrDistances) const
+{
+	std::vector<Candidate> heap;
+	heap.reserve(k);
+
+	neighbours.clear();
+	if (sqrDistances) sqrDistances->clear();
+
+	if (_points.empty() || !k) return;
+
+	this->knnSearch(point, k, NOT_FOUND, 0, unsigned(_points.size()), heap);
+	std::sort_heap(heap.begin(), heap.end());
+
+	for (const Candidate& candidate : heap)
+	{
+		neighbours.push_back(candidate._index);
+		if (sqrDistances) sqrDistances->push_back(candidate._distance);
+	}
+}
+
+void KdTree::knnSearch(const std::vector<vec3>& points, const unsigned k, std::vector<unsigned>& neighbours, std::vector<float>* sqrDistances) const
+{
+	neighbours.clear();
+	neighbours.resize(points.size() * k, NOT_FOUND);
+	if (sqrDistances)
+	{
+		sqrDistances->clear();
+		sqrDistances->resize(points.size() * k, FLT_MAX);
+	}
+
+	if (_points.empty() || !k) return;
+
+	ThreadPool::getInstance()->parallelFor(0, points.size(), [&](const size_t pointIdx)
+		{
+			thread_local std::vector<Candidate> heap;
+			const vec3& point = points[pointIdx];
+			const size_t baseIndex = pointIdx * k;
+
+			heap.clear();
+			this->knnSearch(point, k, NOT_FOUND, 0, unsigned(_points.size()), heap);
+			std::sort_heap(heap.begin(), heap.end());
+
+			for (unsigned neighbourIdx = 0; neighbourIdx < heap.size(); ++neighbourIdx)
+			{
+				neighbours[baseIndex + neighbourIdx] = heap[neighbourIdx]._index;
+				if (sqrDistances) (*sqrDistances)[baseIndex + neighbourIdx] = heap[neighbourIdx]._distance;
+			}
+		});
+}
+
+void KdTree::knnSearchAll(const unsigned k, std::vector<unsigned>& neighbours, std::vector<float>* sqrDistances) const
+{
+	neighbours.clear();
+	neighbours.resize(_points.size() * k, NOT_FOUND);
+	if (sqrDistances)
+	{
+		sqrDistances->clear();
+		sqrDistances->resize(_points.size() * k, FLT_MAX);
+	}
+
+	if (_points.empty() || !k) return;
+
+	ThreadPool::getInstance()->parallelFor(0, _points.size(), [&](const size_t pointIdx)
+		{
+			thread_local std::vector<Candidate> heap;
+			const IndexedPoint& point = _points[pointIdx];
+			const size_t baseIndex = size_t(point._index) * k;
+
+			heap.clear();
+			this->knnSearch(point._point, k, point._index, 0, unsigned(_points.size()), heap);
+			std::sort_heap(heap.begin(), heap.end());
+
+			for (unsigned neighbourIdx = 0; neighbourIdx < heap.size(); ++neighbourIdx)
+			{
+				neighbours[baseIndex + neighbourIdx] = heap[neighbourIdx]._index;
+				if (sqrDistances) (*sqrDistances)[baseIndex + neighbourIdx] = heap[neighbourIdx]._distance;
+			}
+		});
+}
+
+void KdTree::knnSearchAll(const unsigned k, const NeighbourhoodCallback& callback) const
+{
+	if (_points.empty() || !k) return;
+
+	ThreadPool::getInstance()->parallelFor(0, _points.size(), [&](const size_t pointIdx)
+		{
+			thread_local std::vector<Candidate> heap;
+			thread_local std::vector<unsigned> neighbours;
+			thread_local std::vector<float> sqrDistances;
+			const IndexedPoint& point = _points[pointIdx];
+
+			heap.clear();
+			this->knnSearch(point._point, k, point._index, 0, unsigned(_points.size()), heap);
+			std::sort_heap(heap.begin(), heap.end());
+
+			neighbours.resize(heap.size());
+			sqrDistances.resize(heap.size());
+
+			for (unsigned neighbourIdx = 0; neighbourIdx < heap.size(); ++neighbourIdx)
+			{
+				neighbours[neighbourIdx] = heap[neighbourIdx]._index;
+				sqrDistances[neighbourIdx] = heap[neighbourIdx]._distance;
+			}
+
+			callback(point._index, neighbours.data(), sqrDistances.data(), unsigned(heap.size()));
+		});
+}
+
+void KdTree::radiusSearch(const vec3& point, const float radius, std::vector<unsigned>& neighbours, std::vector<float>* sqrDistances) const
+{
+	std::vector<Candidate> candidates;
+
+	neighbours.clear();
+	if (sqrDistances) sqrDistances->clear();
+
+	if (_points.empty()) return;
+
+	this->radiusSearch(point, radius * radius, 0, unsigned(_points.size()), candidates);
+	std::sort(candidates.begin(), candidates.end());
+
+	neighbours.reserve(candidates.size());
+	for (const Candidate& candidate : candidates)
+	{
+		neighbours.push_back(candidate._index);
+		if (sqrDistances) sqrDistances->push_back(candidate._distance);
+	}
+}
+
+void KdTree::radiusSearch(const std::vector<vec3>& points, const float radius, std::vector<std::vector<unsigned>>& neighbours) const
+{
+	neighbours.resize(points.size());
+
+	ThreadPool::getInstance()->parallelFor(0, points.size(), [&](const size_t pointIdx)
+		{
+			this->radiusSearch(points[pointIdx], radius, neighbours[pointIdx]);
+		});
+}
+
+/// [Protected methods]
+
+void KdTree::aabbSearch(const AABB& aabb, const unsigned begin, const unsigned end, std::vector<unsigned>& indices) const
+{
+	const vec3 min = aabb.min(), max = aabb.max();
+	auto isInside = [&](const vec3& point) -> bool
+	{
+		return glm::all(glm::greaterThanEqual(point, min)) && glm::all(glm::lessThanEqual(point, max));
+	};
+
+	if (end - begin <= LEAF_SIZE)
+	{
+		for (unsigned pointIdx = begin; pointIdx < end; ++pointIdx)
+			if (isInside(_points[pointIdx]._point)) indices.push_back(_points[pointIdx]._index);
+
+		return;
+	}
+
+	const unsigned mid = begin + (end - begin) / 2;
+	const unsigned axis = _splitAxis[mid];
+	const float split = _points[mid]._point[axis];
+
+	if (isInside(_points[mid]._point)) indices.push_back(_points[mid]._index);
+	if (min[axis] <= split) this->aabbSearch(aabb, begin, mid, indices);
+	if (max[axis] >= split) this->aabbSearch(aabb, mid + 1, end, indices);
+}
+
+void KdTree::build(const unsigned begin, const unsigned end, const AABB& aabb, const unsigned parallelDepth)
+{
+	if (end - begin <= LEAF_SIZE) return;
+
+	// Split along the largest extent of the node boundaries
+	const vec3 size = aabb.size();
+	const unsigned axis = size.x >= size.y && size.x >= size.z ? 0 : (size.y >= size.z ? 1 : 2);
+	const unsigned mid = begin + (end - begin) / 2;
+	auto compare = [axis](const IndexedPoint& point1, const IndexedPoint& point2) { return point1._point[axis] < point2._point[axis]; };
+
+	if (end - begin >= PARALLEL_THRESHOLD)
+		std::nth_element(std::execution::par_unseq, _points.begin() + begin, _points.begin() + mid, _points.begin() + end, compare);
+	else
+		std::nth_element(_points.begin() + begin, _points.begin() + mid, _points.begin() + end, compare);
+
+	_splitAxis[mid] = uint8_t(axis);
+
+	vec3 leftMax = aabb.max(), rightMin = aabb.min();
+	leftMax[axis] = rightMin[axis] = _points[mid]._point[axis];
+
+	const AABB leftAABB(aabb.min(), leftMax), rightAABB(rightMin, aabb.max());
+
+	if (parallelDepth > 0 && end - begin >= PARALLEL_THRESHOLD)
+	{
+		ThreadPool::TaskGroup leftTask;
+		leftTask.run([&]() { this->build(begin, mid, leftAABB, parallelDepth - 1); });
+		this->build(mid + 1, end, rightAABB, parallelDepth - 1);
+		leftTask.wait();
+	}
+	else
+	{
+		this->build(begin, mid, leftAABB, 0);
+		this->build(mid + 1, end, rightAABB, 0);
+	}
+}
+
+void KdTree::knnSearch(const vec3& point, const unsigned k, const unsigned exclude, const unsigned begin, const unsigned end, std::vector<Candidate>& heap) const
+{
+	auto insert = [&](const IndexedPoint& candidate)
+	{
+		if (candidate._index == exclude) return;
+
+		const vec3 diff = candidate._point - point;
+		const float distance = glm::dot(diff, diff);
+
+		if (heap.size() < k)
+		{
+			heap.push_back(Candidate{ distance, candidate._index });
+			std::push_heap(heap.begin(), heap.end());
+		}
+		else if (distance < heap.front()._distance)
+		{
+			std::pop_heap(heap.begin(), heap.end());
+			heap.back() = Candidate{ distance, candidate._index };
+			std::push_heap(heap.begin(), heap.end());
+		}
+	};
+
+	if (end - begin <= LEAF_SIZE)
+	{
+		for (unsigned pointIdx = begin; pointIdx < end; ++pointIdx) insert(_points[pointIdx]);
+
+		return;
+	}
+
+	const unsigned mid = begin + (end - begin) / 2;
+	const unsigned axis = _splitAxis[mid];
+	const float diff = point[axis] - _points[mid]._point[axis];
+
+	insert(_points[mid]);
+
+	// Visit first the side containing the query point; the other one only if the splitting plane is closer than the worst candidate
+	if (diff < .0f)
+	{
+		this->knnSearch(point, k, exclude, begin, mid, heap);
+		if (heap.size() < k || diff * diff < heap.front()._distance) this->knnSearch(point, k, exclude, mid + 1, end, heap);
+	}
+	else
+	{
+		this->knnSearch(point, k, exclude, mid + 1, end, heap);
+		if (heap.size() < k || diff * diff < heap.front()._distance) this->knnSearch(point, k, exclude, begin, mid, heap);
+	}
+}
+
+void KdTree::radiusSearch(const vec3& point, const float sqrRadius, const unsigned begin, const unsigned end, std::vector<Candidate>& candidates) const
+{
+	auto insert = [&](const IndexedPoint& candidate)
+	{
+		const vec3 diff = candidate._point - point;
+		const float distance = glm::dot(diff, diff);
+
+		if (distance <= sqrRadius) candidates.push_back(Candidate{ distance, candidate._index });
+	};
+
+	if (end - begin <= LEAF_SIZE)
+	{
+		for (unsigned pointIdx = begin; pointIdx < end; ++pointIdx) insert(_points[pointIdx]);
+
+		return;
+	}
+
+	const unsigned mid = begin + (end - begin) / 2;
+	const unsigned axis = _splitAxis[mid];
+	const float diff = point[axis] - _points[mid]._point[axis];
+
+	insert(_points[mid]);
+
+	if (diff <= .0f || diff * diff <= sqrRadius) this->radiusSearch(point, sqrRadius, begin, mid, candidates);
+	if (diff >= .0f || diff * diff <= sqrRadius) this->radiusSearch(point, sqrRadius, mid + 1, end, candidates);
+}
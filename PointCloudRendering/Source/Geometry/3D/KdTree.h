@@ -0,0 +1,178 @@
+#pragma once
+
+#include "Geometry/3D/AABB.h"
+
+/**
+*	@file KdTree.h
+*	@authors Alfonso Lpez Ruiz (alr00048@red.ujaen.es)
+*	@date 19/10/2026
+*/
+
+/**
+*	@brief Implicit, balanced kd-tree over a set of 3D points. Nodes are not stored explicitly: the median of every range is the node and
+*	both halves are its children, so the whole index is a permutation of the input points plus one split axis per node.
+*/
+class KdTree
+{
+public:
+	const static unsigned NOT_FOUND;												//!< Padding value for kNN queries with fewer than k results
+
+	/**
+	*	@brief Receives the neighbourhood of an indexed point: its original index, neighbour indices, squared distances and number of neighbours.
+	*/
+	typedef std::function<void(const unsigned, const unsigned*, const float*, const unsigned)> NeighbourhoodCallback;
+
+protected:
+	const static unsigned LEAF_SIZE;												//!< Maximum number of points scanned linearly instead of splitting
+	const static unsigned PARALLEL_THRESHOLD;										//!< Minimum number of points of a range to be built in a separate task
+
+protected:
+	struct IndexedPoint
+	{
+		vec3		_point;															//!< Point position, stored in tree order to keep the traversal cache-friendly
+		unsigned	_index;															//!< Index of the point in the original array
+	};
+
+	struct Candidate
+	{
+		float		_distance;														//!< Squared distance to the query point
+		unsigned	_index;															//!< Index of the point in the original array
+
+		/**
+		*	@brief Max-heap ordering for kNN searches.
+		*/
+		bool operator<(const Candidate& candidate) const { return _distance < candidate._distance; }
+	};
+
+protected:
+	AABB						_aabb;												//!< Boundaries of the indexed points
+	std::vector<IndexedPoint>	_points;											//!< Points sorted as an implicit kd-tree
+	std::vector<uint8_t>		_splitAxis;											//!< Split axis of every inner node (median of a range)
+
+protected:
+	/**
+	*	@brief Recursively collects the points within the given box.
+	*/
+	void aabbSearch(const AABB& aabb, const unsigned begin, const unsigned end, std::vector<unsigned>& indices) const;
+
+	/**
+	*	@brief Recursively builds the range [begin, end) of the tree. Large ranges are split into parallel tasks until parallelDepth is exhausted.
+	*/
+	void build(const unsigned begin, const unsigned end, const AABB& aabb, const unsigned parallelDepth);
+
+	/**
+	*	@brief Recursively searches the k nearest neighbours, keeping a max-heap with the best candidates.
+	*	@param exclude Index of a point which is never reported, e.g. the query point itself.
+	*/
+	void knnSearch(const vec3& point, const unsigned k, const unsigned exclude, const unsigned begin, const unsigned end, std::vector<Candidate>& heap) const;
+
+	/**
+	*	@brief Recursively collects the points within a sphere.
+	*/
+	void radiusSearch(const vec3& point, const float sqrRadius, const unsigned begin, const unsigned end, std::vector<Candidate>& candidates) const;
+
+public:
+	/**
+	*	@brief Default constructor. The tree is empty until it is built.
+	*/
+	KdTree();
+
+	/**
+	*	@brief Destructor.
+	*/
+	virtual ~KdTree();
+
+	/**
+	*	@brief Builds the tree from a strided array of positions, e.g. an array of structs whose first attribute is a vec3.
+	*	@param points Pointer to the first position.
+	*	@param numPoints Number of positions.
+	*	@param stride Distance in bytes between two consecutive positions.
+	*/
+	void build(const void* points, const size_t numPoints, const size_t stride = sizeof(vec3));
+
+	/**
+	*	@brief Removes the indexed points.
+	*/
+	void clear();
+
+	/**
+	*	@return Bytes held by the tree.
+	*/
+	size_t getMemorySize() const { return _points.capacity() * sizeof(IndexedPoint) + _splitAxis.capacity(); }
+
+	/**
+	*	@return True if the tree has been built and can be queried.
+	*/
+	bool isBuilt() const { return !_points.empty(); }
+
+	/**
+	*	@brief Rebuilds the tree from a binary stream, written with write(). Only the permutation and split axes are stored, so positions
+	*	are gathered again from the same points that were used to build the tree.
+	*	@return False if the stream does not contain a valid tree for the given points.
+	*/
+	bool read(std::istream& stream, const void* points, const size_t numPoints, const size_t stride = sizeof(vec3));
+
+	/**
+	*	@brief Writes the permutation and split axes of the tree to a binary stream.
+	*/
+	bool write(std::ostream& stream) const;
+
+	// ------------ Queries ------------
+
+	/**
+	*	@brief Retrieves the indices of the points within a box.
+	*/
+	void aabbSearch(const AABB& aabb, std::vector<unsigned>& indices) const;
+
+	/**
+	*	@brief Retrieves the indices of the points within a set of boxes. Queries are solved in parallel.
+	*/
+	void aabbSearch(const std::vector<AABB>& aabbs, std::vector<std::vector<unsigned>>& indices) const;
+
+	/**
+	*	@brief Retrieves the k nearest neighbours of a point, sorted by distance.
+	*	@param sqrDistances Optional output with the squared distance to each neighbour.
+	*/
+	void knnSearch(const vec3& point, const unsigned k, std::vector<unsigned>& neighbours, std::vector<float>* sqrDistances = nullptr) const;
+
+	/**
+	*	@brief Retrieves the k nearest neighbours of a set of points. Queries are solved in parallel and results are stored in k-sized
+	*	consecutive blocks, padded with NOT_FOUND if there are not enough points.
+	*/
+	void knnSearch(const std::vector<vec3>& points, const unsigned k, std::vector<unsigned>& neighbours, std::vector<float>* sqrDistances = nullptr) const;
+
+	/**
+	*	@brief Retrieves the k nearest neighbours of every indexed point, excluding the point itself. Results are stored in k-sized blocks
+	*	following the original order of points. Points are traversed in tree order so that consecutive queries visit the same nodes.
+	*/
+	void knnSearchAll(const unsigned k, std::vector<unsigned>& neighbours, std::vector<float>* sqrDistances = nullptr) const;
+
+	/**
+	*	@brief Same as above, but neighbourhoods are handed to a callback instead of being stored, so memory does not grow with k x points.
+	*	The callback is invoked concurrently from several threads.
+	*/
+	void knnSearchAll(const unsigned k, const NeighbourhoodCallback& callback) const;
+
+	/**
+	*	@brief Retrieves the indices of the points within a sphere, sorted by distance.
+	*/
+	void radiusSearch(const vec3& point, const float radius, std::vector<unsigned>& neighbours, std::vector<float>* sqrDistances = nullptr) const;
+
+	/**
+	*	@brief Retrieves the neighbours of a set of points within the same radius. Queries are solved in parallel.
+	*/
+	void radiusSearch(const std::vector<vec3>& points, const float radius, std::vector<std::vector<unsigned>>& neighbours) const;
+
+	// ------------ Getters ------------
+
+	/**
+	*	@return Boundaries of the indexed points.
+	*/
+	AABB getAABB() const { return _aabb; }
+
+	/**
+	*	@return Number of indexed points.
+	*/
+	size_t getNumPoints() const { return _points.size(); }
+};
+
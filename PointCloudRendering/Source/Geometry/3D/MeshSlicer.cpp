@@ -0,0 +1,248 @@
+#include "stdafx.h"
+#include "MeshSlicer.h"
+
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include "Utilities/ThreadPool.h"
+
+/// [Public methods]
+
+MeshSlicer::PlaneFamily::PlaneFamily(const vec3& origin, const vec3& normal, const float spacing, const unsigned numPlanes) :
+	_normal(glm::normalize(normal)), _spacing(spacing), _numPlanes(numPlanes)
+{
+	_offset = glm::dot(origin, _normal);
+}
+
+MeshSlicer::PlaneFamily::PlaneFamily(const AABB& aabb, const vec3& normal, const float spacing) :
+	_normal(glm::normalize(normal)), _spacing(spacing)
+{
+	// Support of the box along the normal: its center and the projection of its half size
+	const float center = glm::dot(aabb.center(), _normal), radius = glm::dot(glm::abs(aabb.extent()), glm::abs(_normal));
+
+	_offset = center - radius + spacing / 2.0f;
+	_numPlanes = unsigned(glm::floor(2.0f * radius / spacing + .5f));
+}
+
+bool MeshSlicer::exportOBJ(const std::vector<PolylineSet>& sections, const std::string& filenamePrefix)
+{
+	std::vector<uint8_t> success(sections.size(), true);
+
+	ThreadPool::getInstance()->parallelFor(0, sections.size(), [&](const size_t planeIdx)
+		{
+			const PolylineSet& polylines = sections[planeIdx];
+			if (polylines.empty()) return;
+
+			std::ofstream file(filenamePrefix + "_" + std::to_string(planeIdx) + ".obj");
+			if (!file.is_open())
+			{
+				success[planeIdx] = false;
+				return;
+			}
+
+			unsigned firstVertex = 1;
+			file << std::setprecision(std::numeric_limits<float>::max_digits10);				// Coordinates are read back without any loss
+
+			for (const Polyline& polyline : polylines)
+			{
+				for (const vec3& point : polyline._points)
+					file << "v " << point.x << " " << point.y << " " << point.z << "\n";
+
+				file << "l";
+				for (unsigned pointIdx = 0; pointIdx < polyline._points.size(); ++pointIdx) file << " " << firstVertex + pointIdx;
+				if (polyline._closed) file << " " << firstVertex;
+				file << "\n";
+
+				firstVertex += unsigned(polyline._points.size());
+			}
+
+			success[planeIdx] = file.good();
+		}, 1);
+
+	const bool allWritten = std::all_of(success.begin(), success.end(), [](const uint8_t written) { return written; });
+	if (!allWritten) std::cout << "Some sections could not be written into " << filenamePrefix << "!" << std::endl;
+
+	return allWritten;
+}
+
+void MeshSlicer::slice(const std::vector<vec3>& vertices, const std::vector<unsigned>& indices, const PlaneFamily& planes, std::vector<PolylineSet>& sections)
+{
+	const size_t numFaces = indices.size() / 3;
+	std::vector<float> height(vertices.size());
+	std::vector<int> firstPlane(numFaces), lastPlane(numFaces);
+
+	sections.clear();
+	sections.resize(planes._numPlanes);
+
+	std::for_each(std::execution::par_unseq, vertices.begin(), vertices.end(), [&](const vec3& vertex)
+		{
+			height[&vertex - vertices.data()] = planes.getHeight(vertex);
+		});
+
+	// A face crosses plane k if some vertex is below it (height < k) and another is not, hence k in (minHeight, maxHeight]
+	std::for_each(std::execution::par_unseq, firstPlane.begin(), firstPlane.end(), [&](int& first)
+		{
+			const size_t faceIdx = &first - firstPlane.data();
+			const float h1 = height[indices[faceIdx * 3 + 0]], h2 = height[indices[faceIdx * 3 + 1]], h3 = height[indices[faceIdx * 3 + 2]];
+			const float minHeight = (std::min)((std::min)(h1, h2), h3), maxHeight = (std::max)((std::max)(h1, h2), h3);
+
+			first = int(glm::clamp(glm::floor(minHeight) + 1.0f, .0f, float(planes._numPlanes)));
+			lastPlane[faceIdx] = int((std::min)(glm::floor(maxHeight), float(planes._numPlanes) - 1.0f));
+		});
+
+	std::vector<unsigned> planeOffset, planeFaces;
+	groupByBin(firstPlane, lastPlane, planes._numPlanes, planeOffset, planeFaces);
+
+	ThreadPool::getInstance()->parallelFor(0, sections.size(), [&](const size_t planeIdx)
+		{
+			PolylineSet& polylines = sections[planeIdx];
+			const float planeHeight = float(planeIdx);
+			std::vector<Segment> segments;
+			segments.reserve(planeOffset[planeIdx + 1] - planeOffset[planeIdx]);
+
+			for (unsigned faceIdx = planeOffset[planeIdx]; faceIdx < planeOffset[planeIdx + 1]; ++faceIdx)
+			{
+				const unsigned* face = &indices[planeFaces[faceIdx] * 3];
+				Segment segment;
+				unsigned numEndpoints = 0;
+
+				for (unsigned edgeIdx = 0; edgeIdx < 3; ++edgeIdx)
+				{
+					// Both faces of an edge compute the crossing point from its lowest vertex index, so their endpoints are identical
+					const unsigned vertex1 = (std::min)(face[edgeIdx], face[(edgeIdx + 1) % 3]), vertex2 = (std::max)(face[edgeIdx], face[(edgeIdx + 1) % 3]);
+					const float h1 = height[vertex1], h2 = height[vertex2];
+
+					if ((h1 < planeHeight) == (h2 < planeHeight) || numEndpoints == 2) continue;
+
+					segment._edge[numEndpoints] = getEdgeKey(vertex1, vertex2);
+					segment._point[numEndpoints++] = glm::mix(vertices[vertex1], vertices[vertex2], (planeHeight - h1) / (h2 - h1));
+				}
+
+				if (numEndpoints == 2) segments.push_back(segment);
+			}
+
+			chainSegments(segments, polylines);
+		}, 1);
+}
+
+void MeshSlicer::slice(const void* points, const size_t numPoints, const size_t stride, const PlaneFamily& planes, const float halfThickness, std::vector<std::vector<unsigned>>& slabs)
+{
+	const char* data = static_cast<const char*>(points);
+	const float relativeThickness = halfThickness / planes._spacing;
+	std::vector<int> slab(numPoints);
+
+	// Points outside every slab are given a negative bin, which is skipped
+	std::for_each(std::execution::par_unseq, slab.begin(), slab.end(), [&](int& pointSlab)
+		{
+			const size_t pointIdx = &pointSlab - slab.data();
+			const float height = planes.getHeight(*reinterpret_cast<const vec3*>(data + pointIdx * stride)), planeIdx = glm::round(height);
+
+			pointSlab = std::abs(height - planeIdx) <= relativeThickness && planeIdx >= .0f && planeIdx < float(planes._numPlanes) ? int(planeIdx) : -1;
+		});
+
+	std::vector<unsigned> slabOffset, slabPoints;
+	groupByBin(slab, slab, planes._numPlanes, slabOffset, slabPoints);
+
+	slabs.resize(planes._numPlanes);
+	for (unsigned slabIdx = 0; slabIdx < planes._numPlanes; ++slabIdx)
+		slabs[slabIdx].assign(slabPoints.begin() + slabOffset[slabIdx], slabPoints.begin() + slabOffset[slabIdx + 1]);
+}
+
+/// [Protected methods]
+
+void MeshSlicer::chainSegments(const std::vector<Segment>& segments, PolylineSet& polylines)
+{
+	// Endpoints sharing a mesh edge are linked, a manifold edge is crossed by two segments at most
+	std::vector<std::pair<uint64_t, unsigned>> endpoints(segments.size() * 2);
+	std::vector<unsigned> link(segments.size() * 2, UINT_MAX);
+	std::vector<uint8_t> visited(segments.size(), false);
+
+	for (unsigned segmentIdx = 0; segmentIdx < segments.size(); ++segmentIdx)
+	{
+		endpoints[segmentIdx * 2 + 0] = std::make_pair(segments[segmentIdx]._edge[0], segmentIdx * 2 + 0);
+		endpoints[segmentIdx * 2 + 1] = std::make_pair(segments[segmentIdx]._edge[1], segmentIdx * 2 + 1);
+	}
+
+	std::sort(endpoints.begin(), endpoints.end());
+
+	for (size_t endpointIdx = 0; endpointIdx + 1 < endpoints.size(); ++endpointIdx)
+	{
+		if (endpoints[endpointIdx].first != endpoints[endpointIdx + 1].first) continue;
+
+		link[endpoints[endpointIdx].second] = endpoints[endpointIdx + 1].second;
+		link[endpoints[endpointIdx + 1].second] = endpoints[endpointIdx].second;
+		++endpointIdx;
+	}
+
+	auto walk = [&](const unsigned firstSegment, const unsigned firstEndpoint)
+		{
+			Polyline polyline{ { segments[firstSegment]._point[firstEndpoint] }, false };
+			unsigned segmentIdx = firstSegment, endpointIdx = 1 - firstEndpoint;
+
+			while (true)
+			{
+				visited[segmentIdx] = true;
+				polyline._points.push_back(segments[segmentIdx]._point[endpointIdx]);
+
+				const unsigned next = link[segmentIdx * 2 + endpointIdx];
+				if (next == UINT_MAX) break;
+
+				if (next / 2 == firstSegment)
+				{
+					polyline._points.pop_back();											// Same point as the first one
+					polyline._closed = true;
+					break;
+				}
+
+				segmentIdx = next / 2;
+				endpointIdx = 1 - next % 2;
+			}
+
+			polylines.push_back(std::move(polyline));
+		};
+
+	// Open chains are walked from their loose ends, then the remaining segments form loops
+	for (unsigned endpointIdx = 0; endpointIdx < link.size(); ++endpointIdx)
+		if (link[endpointIdx] == UINT_MAX && !visited[endpointIdx / 2]) walk(endpointIdx / 2, endpointIdx % 2);
+
+	for (unsigned segmentIdx = 0; segmentIdx < segments.size(); ++segmentIdx)
+		if (!visited[segmentIdx]) walk(segmentIdx, 0);
+}
+
+uint64_t MeshSlicer::getEdgeKey(const unsigned vertex1, const unsigned vertex2)
+{
+	return (uint64_t((std::min)(vertex1, vertex2)) << 32) | (std::max)(vertex1, vertex2);
+}
+
+void MeshSlicer::groupByBin(const std::vector<int>& first, const std::vector<int>& last, const unsigned numBins, std::vector<unsigned>& binOffset, std::vector<unsigned>& binItems)
+{
+	std::vector<unsigned> binSize(numBins + 1, 0);
+
+	std::for_each(std::execution::par_unseq, first.begin(), first.end(), [&](const int& firstBin)
+		{
+			const int lastBin = last[&firstBin - first.data()];
+			for (int binIdx = (std::max)(firstBin, 0); binIdx <= lastBin; ++binIdx) std::atomic_ref<unsigned>(binSize[binIdx]).fetch_add(1, std::memory_order_relaxed);
+		});
+
+	binOffset.resize(numBins + 1);
+	std::exclusive_scan(binSize.begin(), binSize.end(), binOffset.begin(), 0u);
+
+	std::vector<unsigned> binCursor(binOffset.begin(), binOffset.end() - 1);
+	binItems.resize(binOffset[numBins]);
+
+	std::for_each(std::execution::par_unseq, first.begin(), first.end(), [&](const int& firstBin)
+		{
+			const unsigned itemIdx = unsigned(&firstBin - first.data());
+			const int lastBin = last[itemIdx];
+
+			for (int binIdx = (std::max)(firstBin, 0); binIdx <= lastBin; ++binIdx)
+				binItems[std::atomic_ref<unsigned>(binCursor[binIdx]).fetch_add(1, std::memory_order_relaxed)] = itemIdx;
+		});
+
+	// Concurrent insertions do not preserve the item order
+	ThreadPool::getInstance()->parallelFor(0, numBins, [&](const size_t binIdx)
+		{
+			std::sort(binItems.begin() + binOffset[binIdx], binItems.begin() + binOffset[binIdx + 1]);
+		});
+}
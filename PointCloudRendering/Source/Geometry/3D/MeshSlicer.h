@@ -0,0 +1,99 @@
+#pragma once
+
+#include "Geometry/3D/AABB.h"
+
+/**
+*	@file MeshSlicer.h
+*	@authors Alfonso Lpez Ruiz (alr00048@red.ujaen.es)
+*	@date 19/10/2026
+*/
+
+/**
+*	@brief Cross-sections of triangle meshes and point clouds along a family of parallel planes. Faces are binned by the range of planes
+*	they span, every plane is intersected in a separate task and its segments are chained into polylines through the mesh edges they
+*	cross, so that sections of closed meshes are closed polylines.
+*/
+class MeshSlicer
+{
+public:
+	struct PlaneFamily
+	{
+		vec3		_normal;													//!< Normal shared by every plane, i.e. slicing axis
+		float		_offset;													//!< Signed distance from the origin of coordinates to the first plane
+		float		_spacing;													//!< Distance between consecutive planes
+		unsigned	_numPlanes;													//!< Number of planes
+
+		/**
+		*	@brief Planes starting at the given point, spaced along the normal.
+		*/
+		PlaneFamily(const vec3& origin, const vec3& normal, const float spacing, const unsigned numPlanes);
+
+		/**
+		*	@brief Planes spaced along the normal across a bounding box, starting half a spacing after its first corner.
+		*/
+		PlaneFamily(const AABB& aabb, const vec3& normal, const float spacing);
+
+		/**
+		*	@return Position of a point along the normal, measured in planes from the first one.
+		*/
+		float getHeight(const vec3& point) const { return (glm::dot(point, _normal) - _offset) / _spacing; }
+	};
+
+	struct Polyline
+	{
+		std::vector<vec3>	_points;											//!< Vertices in order
+		bool				_closed;											//!< The last vertex is connected to the first one
+	};
+
+	typedef std::vector<Polyline> PolylineSet;
+
+protected:
+	struct Segment
+	{
+		uint64_t	_edge[2];													//!< Mesh edge crossed by each endpoint, as both vertex indices
+		vec3		_point[2];													//!< Endpoints
+	};
+
+protected:
+	/**
+	*	@brief Chains the segments of a plane into polylines by matching the mesh edges of their endpoints. Chains with loose ends (holes or
+	*	borders of the mesh) are open polylines, the rest are closed.
+	*/
+	static void chainSegments(const std::vector<Segment>& segments, PolylineSet& polylines);
+
+	/**
+	*	@return Key of the edge between two vertices, regardless of their order.
+	*/
+	static uint64_t getEdgeKey(const unsigned vertex1, const unsigned vertex2);
+
+	/**
+	*	@brief Groups the items into bins, where every item is appended to the bins of [first[i], last[i]]. Items keep their order inside each bin and negative bins are ignored.
+	*	@param binOffset First item of every bin in binItems, with one extra value at the end.
+	*/
+	static void groupByBin(const std::vector<int>& first, const std::vector<int>& last, const unsigned numBins, std::vector<unsigned>& binOffset, std::vector<unsigned>& binItems);
+
+public:
+	/**
+	*	@brief Writes the polylines of every plane into a separate OBJ file, named after the given prefix and the plane index. Planes
+	*	without any polyline are skipped.
+	*	@return False if any file could not be written.
+	*/
+	static bool exportOBJ(const std::vector<PolylineSet>& sections, const std::string& filenamePrefix);
+
+	/**
+	*	@brief Computes the sections of an indexed triangle mesh. Vertices lying on a plane are considered to be above it, so that every
+	*	crossed face contributes a single segment.
+	*	@param indices Three vertices per triangle.
+	*	@param sections Polylines of every plane.
+	*/
+	static void slice(const std::vector<vec3>& vertices, const std::vector<unsigned>& indices, const PlaneFamily& planes, std::vector<PolylineSet>& sections);
+
+	/**
+	*	@brief Gathers the points lying within a slab around every plane.
+	*	@param points First point, followed by the rest every stride bytes.
+	*	@param halfThickness Maximum distance from a point to the plane of its slab.
+	*	@param slabs Indices of the points of every slab, in increasing order.
+	*/
+	static void slice(const void* points, const size_t numPoints, const size_t stride, const PlaneFamily& planes, const float halfThickness, std::vector<std::vector<unsigned>>& slabs);
+};
+
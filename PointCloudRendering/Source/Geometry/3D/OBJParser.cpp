@@ -0,0 +1,353 @@
+#include "stdafx.h"
+#include "OBJParser.h"
+
+#include <atomic>
+#include <charconv>
+#include <cstring>
+#include "Utilities/MappedFile.h"
+#include "Utilities/ThreadPool.h"
+
+// [Static members initialization]
+
+const size_t OBJParser::CHUNK_SIZE = 1 << 23;
+const unsigned OBJParser::NUM_SHARDS = 64;
+
+/// [Public methods]
+
+bool OBJParser::load(const std::string& filename, MeshData& mesh)
+{
+	MappedFile file;
+
+	if (!file.open(filename))
+	{
+		std::cout << "The file could not be opened!" << std::endl;
+
+		return false;
+	}
+
+	// Chunks are extended up to the next line break, so that no line is split between two tasks
+	const char* fileBegin = file.getData(), *fileEnd = fileBegin + file.getSize();
+	std::vector<Chunk> chunks((file.getSize() + CHUNK_SIZE - 1) / CHUNK_SIZE);
+
+	for (size_t chunkIdx = 0; chunkIdx < chunks.size(); ++chunkIdx)
+	{
+		Chunk& chunk = chunks[chunkIdx];
+		chunk._begin = chunkIdx ? chunks[chunkIdx - 1]._end : fileBegin;
+		chunk._end = (std::max)(chunk._begin, fileBegin + (std::min)((chunkIdx + 1) * CHUNK_SIZE, file.getSize()));
+
+		if (chunk._end < fileEnd)
+		{
+			const char* lineBreak = static_cast<const char*>(std::memchr(chunk._end, '\n', fileEnd - chunk._end));
+			chunk._end = lineBreak ? lineBreak + 1 : fileEnd;
+		}
+
+		chunk._numPositions = chunk._numTextCoords = chunk._numNormals = chunk._numInvalidFaces = 0;
+	}
+
+	std::for_each(std::execution::par_unseq, chunks.begin(), chunks.end(), countAttributes);
+
+	unsigned numPositions = 0, numTextCoords = 0, numNormals = 0;
+
+	for (Chunk& chunk : chunks)
+	{
+		chunk._firstPosition = numPositions;
+		chunk._firstTextCoord = numTextCoords;
+		chunk._firstNormal = numNormals;
+
+		numPositions += chunk._numPositions;
+		numTextCoords += chunk._numTextCoords;
+		numNormals += chunk._numNormals;
+	}
+
+	std::vector<vec3> position(numPositions), normal(numNormals);
+	std::vector<vec2> textCoord(numTextCoords);
+
+	ThreadPool::getInstance()->parallelFor(0, chunks.size(), [&](const size_t chunkIdx)
+		{
+			parseChunk(chunks[chunkIdx], position, textCoord, normal);
+		}, 1);
+
+	// Unique vertices: every shard merges its tuples following the file order, without sharing data with other shards
+	std::vector<std::vector<Corner>> shardVertex(NUM_SHARDS);
+
+	ThreadPool::getInstance()->parallelFor(0, NUM_SHARDS, [&](const size_t shard)
+		{
+			std::unordered_map<Corner, unsigned, CornerHash> vertexMap;
+
+			for (Chunk& chunk : chunks)
+			{
+				for (const unsigned cornerIdx : chunk._shardCorner[shard])
+				{
+					const Corner& corner = chunk._corner[cornerIdx];
+					const auto vertex = vertexMap.try_emplace(corner, unsigned(shardVertex[shard].size()));
+
+					if (vertex.second) shardVertex[shard].push_back(corner);
+					chunk._vertex[cornerIdx] = vertex.first->second;
+				}
+			}
+		}, 1);
+
+	std::vector<unsigned> shardOffset(NUM_SHARDS + 1, 0);
+	for (unsigned shard = 0; shard < NUM_SHARDS; ++shard) shardOffset[shard + 1] = shardOffset[shard] + unsigned(shardVertex[shard].size());
+
+	const unsigned numVertices = shardOffset.back();
+	std::vector<uint8_t> missingNormal(numVertices, 0);
+	std::atomic<bool> anyMissingNormal(false);
+
+	mesh._position.resize(numVertices);
+	mesh._normal.assign(numVertices, vec3(.0f));
+	mesh._textCoord.assign(numVertices, vec2(.0f));
+
+	ThreadPool::getInstance()->parallelFor(0, NUM_SHARDS, [&](const size_t shard)
+		{
+			for (size_t localIdx = 0; localIdx < shardVertex[shard].size(); ++localIdx)
+			{
+				const Corner& corner = shardVertex[shard][localIdx];
+				const size_t vertexIdx = shardOffset[shard] + localIdx;
+
+				mesh._position[vertexIdx] = position[corner._position];
+				if (corner._textCoord >= 0) mesh._textCoord[vertexIdx] = textCoord[corner._textCoord];
+
+				if (corner._normal >= 0)
+				{
+					mesh._normal[vertexIdx] = normal[corner._normal];
+				}
+				else
+				{
+					missingNormal[vertexIdx] = 1;
+					anyMissingNormal.store(true, std::memory_order_relaxed);
+				}
+			}
+		}, 1);
+
+	// Triangles
+	std::vector<size_t> cornerOffset(chunks.size() + 1, 0);
+	unsigned numInvalidFaces = 0;
+
+	for (size_t chunkIdx = 0; chunkIdx < chunks.size(); ++chunkIdx)
+	{
+		cornerOffset[chunkIdx + 1] = cornerOffset[chunkIdx] + chunks[chunkIdx]._corner.size();
+		numInvalidFaces += chunks[chunkIdx]._numInvalidFaces;
+	}
+
+	mesh._index.resize(cornerOffset.back());
+
+	std::for_each(std::execution::par_unseq, chunks.begin(), chunks.end(), [&](const Chunk& chunk)
+		{
+			const size_t offset = cornerOffset[&chunk - chunks.data()];
+
+			for (size_t cornerIdx = 0; cornerIdx < chunk._corner.size(); ++cornerIdx)
+			{
+				mesh._index[offset + cornerIdx] = shardOffset[getShard(chunk._corner[cornerIdx])] + chunk._vertex[cornerIdx];
+			}
+		});
+
+	// Vertices with no normal in the file are given the area-weighted normal of their triangles
+	if (anyMissingNormal.load())
+	{
+		for (size_t triangleIdx = 0; triangleIdx < mesh._index.size(); triangleIdx += 3)
+		{
+			const unsigned* index = &mesh._index[triangleIdx];
+			const vec3 faceNormal = glm::cross(mesh._position[index[1]] - mesh._position[index[0]], mesh._position[index[2]] - mesh._position[index[0]]);
+
+			for (int i = 0; i < 3; ++i)
+			{
+				if (missingNormal[index[i]]) mesh._normal[index[i]] += faceNormal;
+			}
+		}
+
+		std::for_each(std::execution::par_unseq, mesh._normal.begin(), mesh._normal.end(), [&](vec3& vertexNormal)
+			{
+				const float length = glm::length(vertexNormal);
+
+				if (missingNormal[&vertexNormal - mesh._normal.data()] && length > .0f) vertexNormal /= length;
+			});
+	}
+
+	if (numInvalidFaces > 0)
+	{
+		std::cout << numInvalidFaces << " faces could not be read!" << std::endl;
+	}
+
+	return true;
+}
+
+/// [Protected methods]
+
+size_t OBJParser::CornerHash::operator()(const Corner& corner) const
+{
+	uint64_t hash = uint64_t(uint32_t(corner._position)) * 0x9E3779B97F4A7C15ull + uint64_t(uint32_t(corner._textCoord)) * 0xC2B2AE3D27D4EB4Full + uint32_t(corner._normal);
+
+	// SplitMix64 finalizer, so that both the table buckets and the shards receive well-distributed bits
+	hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+	hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBull;
+
+	return size_t(hash ^ (hash >> 31));
+}
+
+void OBJParser::countAttributes(Chunk& chunk)
+{
+	for (const char* line = chunk._begin; line < chunk._end; )
+	{
+		const char* lineEnd = static_cast<const char*>(std::memchr(line, '\n', chunk._end - line));
+		if (!lineEnd) lineEnd = chunk._end;
+
+		switch (getStatement(line, lineEnd))
+		{
+		case POSITION: ++chunk._numPositions; break;
+		case TEXT_COORD: ++chunk._numTextCoords; break;
+		case NORMAL: ++chunk._numNormals; break;
+		default: break;
+		}
+
+		line = lineEnd + 1;
+	}
+}
+
+unsigned OBJParser::getShard(const Corner& corner)
+{
+	// Upper bits, since the hash table of the shard relies on the lower ones
+	return unsigned((uint64_t(CornerHash()(corner)) >> 32) % NUM_SHARDS);
+}
+
+OBJParser::Statement OBJParser::getStatement(const char*& begin, const char* end)
+{
+	while (begin < end && (*begin == ' ' || *begin == '\t')) ++begin;
+
+	auto isKeyword = [&](const char* keyword, const size_t length) -> bool
+	{
+		return size_t(end - begin) > length && std::strncmp(begin, keyword, length) == 0 && (begin[length] == ' ' || begin[length] == '\t');
+	};
+
+	if (isKeyword("v", 1)) { begin += 1; return POSITION; }
+	if (isKeyword("vt", 2)) { begin += 2; return TEXT_COORD; }
+	if (isKeyword("vn", 2)) { begin += 2; return NORMAL; }
+	if (isKeyword("f", 1)) { begin += 1; return FACE; }
+
+	return OTHER;
+}
+
+bool OBJParser::parseFace(const char* begin, const char* end, const uvec3& numDeclared, const uvec3& numElements, std::vector<Corner>& corners)
+{
+	const size_t firstCorner = corners.size();
+	unsigned numCorners = 0;
+	Corner first, previous;
+
+	while (true)
+	{
+		while (begin < end && (*begin == ' ' || *begin == '\t' || *begin == '\r')) ++begin;
+		if (begin >= end || *begin == '#') break;
+
+		// v, v/t, v//n or v/t/n
+		int index[3] = { 0, 0, 0 };
+
+		for (int attribute = 0; attribute < 3; ++attribute)
+		{
+			if (begin < end && *begin != '/')
+			{
+				if (*begin == '+') ++begin;
+
+				const auto result = std::from_chars(begin, end, index[attribute]);
+				if (result.ec != std::errc())
+				{
+					corners.resize(firstCorner);
+					return false;
+				}
+
+				begin = result.ptr;
+			}
+
+			if (attribute == 2 || begin >= end || *begin != '/') break;
+			++begin;
+		}
+
+		const Corner corner = { resolveIndex(index[0], numDeclared.x, numElements.x), resolveIndex(index[1], numDeclared.y, numElements.y), resolveIndex(index[2], numDeclared.z, numElements.z) };
+
+		if (corner._position < 0 || (begin < end && *begin != ' ' && *begin != '\t' && *begin != '\r'))
+		{
+			corners.resize(firstCorner);
+			return false;
+		}
+
+		if (!numCorners)
+		{
+			first = corner;
+		}
+		else if (numCorners >= 2)
+		{
+			corners.push_back(first);
+			corners.push_back(previous);
+			corners.push_back(corner);
+		}
+
+		previous = corner;
+		++numCorners;
+	}
+
+	return numCorners >= 3;
+}
+
+const char* OBJParser::parseFloat(const char* begin, const char* end, float& value)
+{
+	while (begin < end && (*begin == ' ' || *begin == '\t')) ++begin;
+	if (begin < end && *begin == '+') ++begin;
+
+	const auto result = std::from_chars(begin, end, value);
+
+	return result.ec == std::errc() ? result.ptr : nullptr;
+}
+
+void OBJParser::parseChunk(Chunk& chunk, std::vector<vec3>& position, std::vector<vec2>& textCoord, std::vector<vec3>& normal)
+{
+	const uvec3 numElements(position.size(), textCoord.size(), normal.size());
+	uvec3 numDeclared(chunk._firstPosition, chunk._firstTextCoord, chunk._firstNormal);
+
+	for (const char* line = chunk._begin; line < chunk._end; )
+	{
+		const char* lineEnd = static_cast<const char*>(std::memchr(line, '\n', chunk._end - line));
+		if (!lineEnd) lineEnd = chunk._end;
+
+		const Statement statement = getStatement(line, lineEnd);
+		const unsigned numComponents = statement == TEXT_COORD ? 2 : 3;
+		vec3 value(.0f);
+
+		// Missing components are left as zero, and extra ones such as vertex colors are ignored
+		if (statement == POSITION || statement == TEXT_COORD || statement == NORMAL)
+		{
+			for (unsigned component = 0; component < numComponents && line; ++component)
+			{
+				line = parseFloat(line, lineEnd, value[component]);
+			}
+		}
+
+		switch (statement)
+		{
+		case POSITION: position[numDeclared.x++] = value; break;
+		case TEXT_COORD: textCoord[numDeclared.y++] = vec2(value); break;
+		case NORMAL: normal[numDeclared.z++] = value; break;
+		case FACE:
+			if (!parseFace(line, lineEnd, numDeclared, numElements, chunk._corner)) ++chunk._numInvalidFaces;
+			break;
+		default: break;
+		}
+
+		line = lineEnd + 1;
+	}
+
+	chunk._vertex.resize(chunk._corner.size());
+	chunk._shardCorner.resize(NUM_SHARDS);
+
+	for (unsigned cornerIdx = 0; cornerIdx < chunk._corner.size(); ++cornerIdx)
+	{
+		chunk._shardCorner[getShard(chunk._corner[cornerIdx])].push_back(cornerIdx);
+	}
+}
+
+int OBJParser::resolveIndex(const int index, const unsigned numDeclared, const unsigned numElements)
+{
+	if (!index) return -1;
+
+	const int64_t resolved = index > 0 ? int64_t(index) - 1 : int64_t(numDeclared) + index;
+
+	return (resolved >= 0 && resolved < int64_t(numElements)) ? int(resolved) : -1;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+/**
+*	@file OBJParser.h
+*	@authors Alfonso Lpez Ruiz (alr00048@red.ujaen.es)
+*	@date 19/10/2026
+*/
+
+/**
+*	@brief Multithreaded reader of Wavefront OBJ meshes. The file is memory-mapped and split at line boundaries into chunks which are
+*	parsed in parallel. Polygons are triangulated as fans, negative (relative) indices and missing attributes are supported, and
+*	position/texture/normal tuples are merged into unique vertices using a hash table partitioned into independent shards.
+*/
+class OBJParser
+{
+public:
+	struct MeshData
+	{
+		std::vector<vec3>		_position;										//!< Position of every vertex
+		std::vector<vec3>		_normal;										//!< Normal of every vertex, computed from faces if the file has none
+		std::vector<vec2>		_textCoord;										//!< Texture coordinates of every vertex, zero if the file has none
+		std::vector<unsigned>	_index;											//!< Three vertices per triangle
+	};
+
+protected:
+	const static size_t		CHUNK_SIZE;											//!< Bytes of the file parsed by every task
+	const static unsigned	NUM_SHARDS;											//!< Partitions of the vertex hash table, merged by independent tasks
+
+protected:
+	enum Statement
+	{
+		POSITION, TEXT_COORD, NORMAL, FACE, OTHER
+	};
+
+	struct Corner
+	{
+		int			_position, _textCoord, _normal;								//!< Zero-based indices, -1 if the attribute is missing
+
+		/**
+		*	@return True if both corners refer to the same attributes.
+		*/
+		bool operator==(const Corner& corner) const { return _position == corner._position && _textCoord == corner._textCoord && _normal == corner._normal; }
+	};
+
+	struct CornerHash
+	{
+		/**
+		*	@return Hash of the attribute indices of a corner.
+		*/
+		size_t operator()(const Corner& corner) const;
+	};
+
+	struct Chunk
+	{
+		const char*				_begin, *_end;									//!< Range of whole lines of the file
+		unsigned				_numPositions, _numTextCoords, _numNormals;		//!< Attributes declared in the chunk
+		unsigned				_firstPosition, _firstTextCoord, _firstNormal;	//!< Attributes declared in previous chunks
+		unsigned				_numInvalidFaces;								//!< Faces which could not be read
+
+		std::vector<Corner>		_corner;										//!< Three corners per triangle
+		std::vector<unsigned>	_vertex;										//!< Vertex of every corner, relative to the shard of its tuple
+		std::vector<std::vector<unsigned>> _shardCorner;						//!< Corners of the chunk belonging to every shard
+	};
+
+protected:
+	/**
+	*	@brief Counts the attributes declared in a chunk, so that every chunk knows where its attributes start.
+	*/
+	static void countAttributes(Chunk& chunk);
+
+	/**
+	*	@return Shard of the vertex hash table where a corner is merged.
+	*/
+	static unsigned getShard(const Corner& corner);
+
+	/**
+	*	@brief Identifies the statement of a line and moves begin past its keyword.
+	*/
+	static Statement getStatement(const char*& begin, const char* end);
+
+	/**
+	*	@brief Reads the corners of a face and triangulates it as a fan.
+	*	@param numDeclared Positions, texture coordinates and normals declared before the face, needed by relative indices.
+	*	@param numElements Positions, texture coordinates and normals of the whole file.
+	*	@return False if the face has less than three corners or any of them has no valid position.
+	*/
+	static bool parseFace(const char* begin, const char* end, const uvec3& numDeclared, const uvec3& numElements, std::vector<Corner>& corners);
+
+	/**
+	*	@return Pointer past the parsed number, or nullptr if there is no number at the beginning of [begin, end).
+	*/
+	static const char* parseFloat(const char* begin, const char* end, float& value);
+
+	/**
+	*	@brief Parses the attributes and faces of a chunk. Attributes are written into their final position of the mesh arrays.
+	*/
+	static void parseChunk(Chunk& chunk, std::vector<vec3>& position, std::vector<vec2>& textCoord, std::vector<vec3>& normal);
+
+	/**
+	*	@return Zero-based index from an OBJ index, which is one-based or negative if relative to the last declared element. Missing and
+	*	out-of-range indices return -1.
+	*/
+	static int resolveIndex(const int index, const unsigned numDeclared, const unsigned numElements);
+
+public:
+	/**
+	*	@brief Reads a triangle mesh from an OBJ file. Materials, groups and free-form geometry are ignored.
+	*	@return False if the file could not be opened.
+	*/
+	static bool load(const std::string& filename, MeshData& mesh);
+};
+
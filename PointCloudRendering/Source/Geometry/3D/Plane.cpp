@@ -46,8 +46,7 @@ float Plane::distance(const vec3& point) const
 
 vec3 Plane::normal() const
 {
-	const vec4 coefficients = interceptFormCoeff();
-	return glm::normalize(vec3(coefficients.x, coefficients.y, coefficients.z));				// A, B and C
+	return glm::normalize(glm::cross(_u, _v));
 }
 
 vec3 Plane::getPoint(const float lambda, const float mu) const
@@ -71,10 +70,8 @@ Plane& Plane::operator=(const Plane& plane)
 
 vec4 Plane::computeInterceptFormCoeff() const
 {
-	const float a = BasicOperations::determinant2x2(_v.z, _v.y, _u.z, _v.y);
-	const float b = BasicOperations::determinant2x2(_v.x, _v.z, _u.x, _u.z);
-	const float c = BasicOperations::determinant2x2(_v.y, _v.x, _u.y, _u.x);
-	const float d = -(a * _a.x + b * _b.y + c * _a.z);									// Any point from the plane is actually valid
+	const vec3 normal = glm::cross(_u, _v);											// A, B and C
+	const float d = -glm::dot(normal, _a);											// Any point from the plane is actually valid
 
-	return vec4(a, b, c, d);
+	return vec4(normal, d);
 }
@@ -0,0 +1,382 @@
+#include "stdafx.h"
+#include "SparseVoxelGrid.h"
+
+#include <atomic>
+#include <bit>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+// [Static members initialization]
+
+const unsigned SparseVoxelGrid::BRICK_SIZE = 4;
+
+/// [Public methods]
+
+SparseVoxelGrid::SparseVoxelGrid(const AABB& aabb, const float voxelSize) :
+	_origin(aabb.min()), _voxelSize(voxelSize)
+{
+	// One more brick than needed, so that points lying on the maximum corner are still inside the grid
+	_numBricks = uvec3(glm::max((aabb.max() - aabb.min()) / (voxelSize * BRICK_SIZE), vec3(.0f))) + uvec3(1);
+}
+
+SparseVoxelGrid::~SparseVoxelGrid()
+{
+}
+
+void SparseVoxelGrid::clear()
+{
+	std::vector<uint64_t>().swap(_brickKey);
+	std::vector<uint64_t>().swap(_brickMask);
+}
+
+bool SparseVoxelGrid::compare(const SparseVoxelGrid& grid, size_t& shared, size_t& onlyThis, size_t& onlyOther) const
+{
+	if (_numBricks != grid._numBricks || _origin != grid._origin || _voxelSize != grid._voxelSize) return false;
+
+	size_t brickIdx = 0, otherBrickIdx = 0;
+	shared = onlyThis = onlyOther = 0;
+
+	while (brickIdx < _brickKey.size() || otherBrickIdx < grid._brickKey.size())
+	{
+		const uint64_t key = brickIdx < _brickKey.size() ? _brickKey[brickIdx] : UINT64_MAX;
+		const uint64_t otherKey = otherBrickIdx < grid._brickKey.size() ? grid._brickKey[otherBrickIdx] : UINT64_MAX;
+		const uint64_t mask = key <= otherKey ? _brickMask[brickIdx] : 0;
+		const uint64_t otherMask = otherKey <= key ? grid._brickMask[otherBrickIdx] : 0;
+
+		shared += std::popcount(mask & otherMask);
+		onlyThis += std::popcount(mask & ~otherMask);
+		onlyOther += std::popcount(otherMask & ~mask);
+
+		if (key <= otherKey) ++brickIdx;
+		if (otherKey <= key) ++otherBrickIdx;
+	}
+
+	return true;
+}
+
+AABB SparseVoxelGrid::getAABB(const uvec3& voxel) const
+{
+	const vec3 min = _origin + vec3(voxel) * _voxelSize;
+
+	return AABB(min, min + vec3(_voxelSize));
+}
+
+size_t SparseVoxelGrid::getNumOccupiedVoxels() const
+{
+	return std::transform_reduce(std::execution::par_unseq, _brickMask.begin(), _brickMask.end(), size_t(0), std::plus<size_t>(), [](const uint64_t mask) -> size_t
+		{
+			return std::popcount(mask);
+		});
+}
+
+void SparseVoxelGrid::getOccupiedVoxels(std::vector<uvec3>& voxels) const
+{
+	voxels.clear();
+	voxels.reserve(this->getNumOccupiedVoxels());
+
+	for (size_t brickIdx = 0; brickIdx < _brickKey.size(); ++brickIdx)
+	{
+		const uint64_t key = _brickKey[brickIdx];
+		const uvec3 brick = uvec3(key % _numBricks.x, (key / _numBricks.x) % _numBricks.y, key / (uint64_t(_numBricks.x) * _numBricks.y));
+
+		for (uint64_t mask = _brickMask[brickIdx]; mask; mask &= mask - 1)
+		{
+			const unsigned bit = std::countr_zero(mask);
+
+			voxels.push_back(brick * BRICK_SIZE + uvec3(bit % BRICK_SIZE, (bit / BRICK_SIZE) % BRICK_SIZE, bit / (BRICK_SIZE * BRICK_SIZE)));
+		}
+	}
+}
+
+void SparseVoxelGrid::insertPoints(const void* points, const size_t numPoints, const size_t stride)
+{
+	if (!numPoints) return;
+
+	const uint8_t* data = static_cast<const uint8_t*>(points);
+	const uvec3 numVoxels = this->getNumVoxels();
+	std::vector<uint64_t> pointKey(numPoints, UINT64_MAX);						// Points outside the grid keep an invalid key
+	std::vector<uint8_t> pointBit(numPoints);
+	std::vector<unsigned> pointIndex(numPoints);
+	std::iota(pointIndex.begin(), pointIndex.end(), 0);
+
+	std::for_each(std::execution::par_unseq, pointIndex.begin(), pointIndex.end(), [&](const unsigned pointIdx)
+		{
+			const vec3 position = (*reinterpret_cast<const vec3*>(data + size_t(pointIdx) * stride) - _origin) / _voxelSize;
+
+			if (glm::any(glm::lessThan(position, vec3(.0f))) || glm::any(glm::greaterThanEqual(position, vec3(numVoxels)))) return;
+
+			const uvec3 voxel = uvec3(position), brick = voxel / BRICK_SIZE, local = voxel % BRICK_SIZE;
+
+			pointKey[pointIdx] = (uint64_t(brick.z) * _numBricks.y + brick.y) * _numBricks.x + brick.x;
+			pointBit[pointIdx] = uint8_t(local.x + (local.y + local.z * BRICK_SIZE) * BRICK_SIZE);
+		});
+
+	std::vector<uint64_t> keys(pointKey);
+	keys.erase(std::remove(keys.begin(), keys.end(), UINT64_MAX), keys.end());
+	this->insertBricks(keys);
+
+	std::for_each(std::execution::par_unseq, pointIndex.begin(), pointIndex.end(), [&](const unsigned pointIdx)
+		{
+			if (pointKey[pointIdx] == UINT64_MAX) return;
+
+			std::atomic_ref<uint64_t>(_brickMask[this->searchBrick(pointKey[pointIdx])]).fetch_or(uint64_t(1) << pointBit[pointIdx], std::memory_order_relaxed);
+		});
+}
+
+void SparseVoxelGrid::voxelize(const std::vector<vec3>& vertices)
+{
+	const unsigned numTriangles = unsigned(vertices.size() / 3);
+	if (!numTriangles) return;
+
+	std::vector<unsigned> triangleIndex(numTriangles);
+	std::iota(triangleIndex.begin(), triangleIndex.end(), 0);
+
+	// Triangles are moved to voxel units, with the grid origin at (0, 0, 0) to keep precision on georeferenced models
+	auto prepareTriangle = [&](const unsigned triangleIdx, vec3* triangle, SeparatingAxes& axes, uvec3& minBrick, uvec3& maxBrick) -> bool
+	{
+		for (int i = 0; i < 3; ++i) triangle[i] = (vertices[triangleIdx * 3 + i] - _origin) / _voxelSize;
+
+		if (!this->getBrickRange(triangle[0], triangle[1], triangle[2], minBrick, maxBrick)) return false;
+
+		getSeparatingAxes(triangle[0], triangle[1], triangle[2], axes);
+
+		return true;
+	};
+
+	// Candidate bricks of every triangle are counted first, so that they can be written afterwards without synchronization
+	std::vector<size_t> brickOffset(size_t(numTriangles) + 1, 0);
+
+	std::for_each(std::execution::par_unseq, triangleIndex.begin(), triangleIndex.end(), [&](const unsigned triangleIdx)
+		{
+			vec3 triangle[3];
+			SeparatingAxes axes;
+			uvec3 minBrick, maxBrick;
+
+			if (!prepareTriangle(triangleIdx, triangle, axes, minBrick, maxBrick)) return;
+
+			size_t numBricks = 0;
+			this->overlappingBricks(axes, minBrick, maxBrick, [&](const uint64_t) { ++numBricks; });
+			brickOffset[triangleIdx + 1] = numBricks;
+		});
+
+	std::inclusive_scan(std::execution::par, brickOffset.begin(), brickOffset.end(), brickOffset.begin());
+
+	std::vector<uint64_t> triangleBrick(brickOffset.back());
+
+	std::for_each(std::execution::par_unseq, triangleIndex.begin(), triangleIndex.end(), [&](const unsigned triangleIdx)
+		{
+			vec3 triangle[3];
+			SeparatingAxes axes;
+			uvec3 minBrick, maxBrick;
+
+			if (!prepareTriangle(triangleIdx, triangle, axes, minBrick, maxBrick)) return;
+
+			size_t brickIdx = brickOffset[triangleIdx];
+			this->overlappingBricks(axes, minBrick, maxBrick, [&](const uint64_t key) { triangleBrick[brickIdx++] = key; });
+		});
+
+	std::vector<uint64_t> keys(triangleBrick);
+	this->insertBricks(keys);
+
+	// Voxels of every candidate brick are tested in batches, and the resulting mask is merged with a single atomic operation
+	std::for_each(std::execution::par_unseq, triangleIndex.begin(), triangleIndex.end(), [&](const unsigned triangleIdx)
+		{
+			vec3 triangle[3];
+			SeparatingAxes axes;
+			uvec3 minBrick, maxBrick;
+
+			if (brickOffset[triangleIdx] == brickOffset[triangleIdx + 1] || !prepareTriangle(triangleIdx, triangle, axes, minBrick, maxBrick)) return;
+
+			float centerX[BATCH_SIZE], centerY[BATCH_SIZE], centerZ[BATCH_SIZE];
+
+			for (size_t brickIdx = brickOffset[triangleIdx]; brickIdx < brickOffset[triangleIdx + 1]; ++brickIdx)
+			{
+				const uint64_t key = triangleBrick[brickIdx];
+				const vec3 brickOrigin = vec3(key % _numBricks.x, (key / _numBricks.x) % _numBricks.y, key / (uint64_t(_numBricks.x) * _numBricks.y)) * float(BRICK_SIZE);
+				uint64_t mask = 0;
+
+				for (unsigned firstBit = 0; firstBit < BRICK_SIZE * BRICK_SIZE * BRICK_SIZE; firstBit += BATCH_SIZE)
+				{
+					for (unsigned lane = 0; lane < BATCH_SIZE; ++lane)
+					{
+						const unsigned bit = firstBit + lane;
+
+						centerX[lane] = brickOrigin.x + bit % BRICK_SIZE + .5f;
+						centerY[lane] = brickOrigin.y + (bit / BRICK_SIZE) % BRICK_SIZE + .5f;
+						centerZ[lane] = brickOrigin.z + bit / (BRICK_SIZE * BRICK_SIZE) + .5f;
+					}
+
+					mask |= uint64_t(intersect(axes, .5f, centerX, centerY, centerZ)) << firstBit;
+				}
+
+				if (mask) std::atomic_ref<uint64_t>(_brickMask[this->searchBrick(key)]).fetch_or(mask, std::memory_order_relaxed);
+			}
+		});
+}
+
+bool SparseVoxelGrid::isOccupied(const uvec3& voxel) const
+{
+	if (glm::any(glm::greaterThanEqual(voxel, this->getNumVoxels()))) return false;
+
+	const uvec3 brick = voxel / BRICK_SIZE, local = voxel % BRICK_SIZE;
+	const size_t brickIdx = this->searchBrick((uint64_t(brick.z) * _numBricks.y + brick.y) * _numBricks.x + brick.x);
+
+	return brickIdx < _brickKey.size() && (_brickMask[brickIdx] >> (local.x + (local.y + local.z * BRICK_SIZE) * BRICK_SIZE)) & 1;
+}
+
+/// [Protected methods]
+
+void SparseVoxelGrid::getSeparatingAxes(const vec3& v0, const vec3& v1, const vec3& v2, SeparatingAxes& axes)
+{
+	const vec3 edge[3] = { v1 - v0, v2 - v1, v0 - v2 };
+	unsigned axisIdx = 0;
+
+	for (int boxAxis = 0; boxAxis < 3; ++boxAxis)
+	{
+		vec3 normal(.0f);
+		normal[boxAxis] = 1.0f;
+
+		for (int edgeIdx = 0; edgeIdx < 3; ++edgeIdx) axes._axis[axisIdx++] = glm::cross(normal, edge[edgeIdx]);
+	}
+
+	for (int boxAxis = 0; boxAxis < 3; ++boxAxis)
+	{
+		axes._axis[axisIdx] = vec3(.0f);
+		axes._axis[axisIdx++][boxAxis] = 1.0f;
+	}
+
+	axes._axis[axisIdx] = glm::cross(edge[0], edge[1]);
+
+	for (axisIdx = 0; axisIdx < NUM_AXES; ++axisIdx)
+	{
+		const vec3& axis = axes._axis[axisIdx];
+		const float p0 = glm::dot(axis, v0), p1 = glm::dot(axis, v1), p2 = glm::dot(axis, v2);
+
+		axes._min[axisIdx] = (std::min)(p0, (std::min)(p1, p2));
+		axes._max[axisIdx] = (std::max)(p0, (std::max)(p1, p2));
+		axes._extent[axisIdx] = std::abs(axis.x) + std::abs(axis.y) + std::abs(axis.z);
+	}
+}
+
+bool SparseVoxelGrid::getBrickRange(const vec3& v0, const vec3& v1, const vec3& v2, uvec3& minBrick, uvec3& maxBrick) const
+{
+	const vec3 min = glm::min(v0, glm::min(v1, v2)) / float(BRICK_SIZE), max = glm::max(v0, glm::max(v1, v2)) / float(BRICK_SIZE);
+
+	if (glm::any(glm::lessThan(max, vec3(.0f))) || glm::any(glm::greaterThanEqual(min, vec3(_numBricks)))) return false;
+
+	minBrick = uvec3(glm::max(min, vec3(.0f)));
+	maxBrick = glm::min(uvec3(max), _numBricks - uvec3(1));
+
+	return true;
+}
+
+void SparseVoxelGrid::insertBricks(std::vector<uint64_t>& keys)
+{
+	std::sort(std::execution::par_unseq, keys.begin(), keys.end());
+	keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+	std::vector<uint64_t> brickKey, brickMask;
+	brickKey.reserve(_brickKey.size() + keys.size());
+	std::set_union(_brickKey.begin(), _brickKey.end(), keys.begin(), keys.end(), std::back_inserter(brickKey));
+
+	// Both arrays are sorted, so current masks are moved to their new position with a single sweep
+	brickMask.resize(brickKey.size(), 0);
+
+	for (size_t brickIdx = 0, currentIdx = 0; currentIdx < _brickKey.size(); ++brickIdx)
+	{
+		if (brickKey[brickIdx] == _brickKey[currentIdx]) brickMask[brickIdx] = _brickMask[currentIdx++];
+	}
+
+	_brickKey.swap(brickKey);
+	_brickMask.swap(brickMask);
+}
+
+unsigned SparseVoxelGrid::intersect(const SeparatingAxes& axes, const float halfSize, const float* centerX, const float* centerY, const float* centerZ)
+{
+	// Triangle and box are separated if their projections do not overlap on any axis; the box projection is its center +- radius
+#ifdef __AVX2__
+	const __m256 x = _mm256_loadu_ps(centerX), y = _mm256_loadu_ps(centerY), z = _mm256_loadu_ps(centerZ);
+	__m256 separated = _mm256_setzero_ps();
+
+	for (unsigned axisIdx = 0; axisIdx < NUM_AXES; ++axisIdx)
+	{
+		const vec3& axis = axes._axis[axisIdx];
+		const __m256 projection = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(axis.x)), _mm256_mul_ps(y, _mm256_set1_ps(axis.y))), _mm256_mul_ps(z, _mm256_set1_ps(axis.z)));
+		const __m256 radius = _mm256_set1_ps(axes._extent[axisIdx] * halfSize);
+
+		separated = _mm256_or_ps(separated, _mm256_cmp_ps(_mm256_sub_ps(_mm256_set1_ps(axes._min[axisIdx]), projection), radius, _CMP_GT_OQ));
+		separated = _mm256_or_ps(separated, _mm256_cmp_ps(_mm256_sub_ps(projection, _mm256_set1_ps(axes._max[axisIdx])), radius, _CMP_GT_OQ));
+
+		if (_mm256_movemask_ps(separated) == 0xFF) return 0;
+	}
+
+	return unsigned(~_mm256_movemask_ps(separated)) & 0xFF;
+#else
+	unsigned mask = 0;
+
+	for (unsigned lane = 0; lane < BATCH_SIZE; ++lane)
+	{
+		bool separated = false;
+
+		for (unsigned axisIdx = 0; axisIdx < NUM_AXES && !separated; ++axisIdx)
+		{
+			const vec3& axis = axes._axis[axisIdx];
+			const float projection = axis.x * centerX[lane] + axis.y * centerY[lane] + axis.z * centerZ[lane];
+			const float radius = axes._extent[axisIdx] * halfSize;
+
+			separated = axes._min[axisIdx] - projection > radius || projection - axes._max[axisIdx] > radius;
+		}
+
+		mask |= unsigned(!separated) << lane;
+	}
+
+	return mask;
+#endif
+}
+
+void SparseVoxelGrid::overlappingBricks(const SeparatingAxes& axes, const uvec3& minBrick, const uvec3& maxBrick, const std::function<void(const uint64_t)>& callback) const
+{
+	const float halfSize = BRICK_SIZE * .5f;
+	float centerX[BATCH_SIZE] = {}, centerY[BATCH_SIZE] = {}, centerZ[BATCH_SIZE] = {};
+	uint64_t key[BATCH_SIZE];
+	unsigned batchSize = 0;
+
+	auto testBatch = [&]()
+	{
+		const unsigned mask = intersect(axes, halfSize, centerX, centerY, centerZ);
+
+		for (unsigned lane = 0; lane < batchSize; ++lane)
+		{
+			if (mask & (1u << lane)) callback(key[lane]);
+		}
+
+		batchSize = 0;
+	};
+
+	for (unsigned z = minBrick.z; z <= maxBrick.z; ++z)
+	{
+		for (unsigned y = minBrick.y; y <= maxBrick.y; ++y)
+		{
+			for (unsigned x = minBrick.x; x <= maxBrick.x; ++x)
+			{
+				centerX[batchSize] = x * float(BRICK_SIZE) + halfSize;
+				centerY[batchSize] = y * float(BRICK_SIZE) + halfSize;
+				centerZ[batchSize] = z * float(BRICK_SIZE) + halfSize;
+				key[batchSize] = (uint64_t(z) * _numBricks.y + y) * _numBricks.x + x;
+
+				if (++batchSize == BATCH_SIZE) testBatch();
+			}
+		}
+	}
+
+	if (batchSize) testBatch();
+}
+
+size_t SparseVoxelGrid::searchBrick(const uint64_t key) const
+{
+	const auto brick = std::lower_bound(_brickKey.begin(), _brickKey.end(), key);
+
+	return (brick != _brickKey.end() && *brick == key) ? brick - _brickKey.begin() : _brickKey.size();
+}
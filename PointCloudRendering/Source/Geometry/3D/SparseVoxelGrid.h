@@ -0,0 +1,147 @@
+#pragma once
+
+#include "Geometry/3D/AABB.h"
+
+/**
+*	@file SparseVoxelGrid.h
+*	@authors Alfonso Lpez Ruiz (alr00048@red.ujaen.es)
+*	@date 19/10/2026
+*/
+
+/**
+*	@brief Binary occupancy grid over a box where only non-empty bricks of 4x4x4 voxels are stored, each one as a 64-bit mask. Meshes are
+*	voxelized in parallel across triangles with a batched triangle-box SAT test, whereas point clouds mark the voxel of every point.
+*	Grids with the same domain and voxel size can be compared voxel by voxel, e.g. a BIM model against its scanned point cloud.
+*/
+class SparseVoxelGrid
+{
+public:
+	constexpr static unsigned BATCH_SIZE = 8;									//!< Boxes tested at once against a triangle, one per AVX lane
+	const static unsigned BRICK_SIZE;											//!< Voxels per brick and axis
+
+protected:
+	constexpr static unsigned NUM_AXES = 13;									//!< Potential separating axes of a triangle and a box
+
+protected:
+	struct SeparatingAxes
+	{
+		vec3		_axis[NUM_AXES];											//!< 9 edge cross products, 3 box normals and the triangle normal
+		float		_min[NUM_AXES], _max[NUM_AXES];								//!< Projection of the triangle onto each axis
+		float		_extent[NUM_AXES];											//!< Projection of a box with unit half-size onto each axis
+	};
+
+protected:
+	std::vector<uint64_t>	_brickKey;											//!< Linear index of every non-empty brick, sorted
+	std::vector<uint64_t>	_brickMask;											//!< Occupancy of the voxels of every brick
+	uvec3					_numBricks;											//!< Bricks per axis
+	vec3					_origin;											//!< Minimum corner of the grid
+	float					_voxelSize;											//!< Length of a voxel side
+
+protected:
+	/**
+	*	@brief Computes the potential separating axes of a triangle given in voxel units, as in Intersections3D::intersect(Triangle3D&, AABB&).
+	*/
+	static void getSeparatingAxes(const vec3& v0, const vec3& v1, const vec3& v2, SeparatingAxes& axes);
+
+	/**
+	*	@return Range of bricks overlapped by the boundaries of a triangle given in voxel units. False if it lies outside the grid.
+	*/
+	bool getBrickRange(const vec3& v0, const vec3& v1, const vec3& v2, uvec3& minBrick, uvec3& maxBrick) const;
+
+	/**
+	*	@brief Inserts new bricks with no occupied voxels, keeping the current ones.
+	*	@param keys Linear indices of bricks, which may be repeated or already present.
+	*/
+	void insertBricks(std::vector<uint64_t>& keys);
+
+	/**
+	*	@brief Tests a triangle against BATCH_SIZE boxes of the same size at once.
+	*	@param halfSize Half of the box side, in voxel units.
+	*	@param center Centers of the boxes, one array per axis.
+	*	@return Mask of boxes which overlap the triangle.
+	*/
+	static unsigned intersect(const SeparatingAxes& axes, const float halfSize, const float* centerX, const float* centerY, const float* centerZ);
+
+	/**
+	*	@brief Visits the bricks of a range which overlap a triangle.
+	*/
+	void overlappingBricks(const SeparatingAxes& axes, const uvec3& minBrick, const uvec3& maxBrick, const std::function<void(const uint64_t)>& callback) const;
+
+	/**
+	*	@return Position of a brick in the sorted arrays, or _brickKey.size() if it is empty.
+	*/
+	size_t searchBrick(const uint64_t key) const;
+
+public:
+	/**
+	*	@brief Constructor of an empty grid.
+	*	@param aabb Domain of the grid, which is enlarged up to a whole number of bricks.
+	*	@param voxelSize Length of a voxel side.
+	*/
+	SparseVoxelGrid(const AABB& aabb, const float voxelSize);
+
+	/**
+	*	@brief Destructor.
+	*/
+	virtual ~SparseVoxelGrid();
+
+	/**
+	*	@brief Removes every occupied voxel.
+	*/
+	void clear();
+
+	/**
+	*	@brief Counts voxels occupied by both grids or only by one of them.
+	*	@return False if both grids do not share the same domain and voxel size.
+	*/
+	bool compare(const SparseVoxelGrid& grid, size_t& shared, size_t& onlyThis, size_t& onlyOther) const;
+
+	/**
+	*	@brief Marks the voxels which contain a point, given as a strided array of positions (see KdTree::build).
+	*/
+	void insertPoints(const void* points, const size_t numPoints, const size_t stride = sizeof(vec3));
+
+	/**
+	*	@brief Marks the voxels overlapped by a triangle soup, where every three consecutive vertices are a triangle. Candidate bricks of
+	*	each triangle are found first, then their voxels are tested in batches and written with a single atomic operation per brick.
+	*/
+	void voxelize(const std::vector<vec3>& vertices);
+
+	// ------------ Queries ------------
+
+	/**
+	*	@return Boundaries of a voxel.
+	*/
+	AABB getAABB(const uvec3& voxel) const;
+
+	/**
+	*	@return Number of stored bricks.
+	*/
+	size_t getNumBricks() const { return _brickKey.size(); }
+
+	/**
+	*	@return Number of occupied voxels.
+	*/
+	size_t getNumOccupiedVoxels() const;
+
+	/**
+	*	@return Voxels per axis.
+	*/
+	uvec3 getNumVoxels() const { return _numBricks * BRICK_SIZE; }
+
+	/**
+	*	@brief Retrieves the indices of the occupied voxels, brick by brick.
+	*/
+	void getOccupiedVoxels(std::vector<uvec3>& voxels) const;
+
+	/**
+	*	@return Length of a voxel side.
+	*/
+	float getVoxelSize() const { return _voxelSize; }
+
+	/**
+	*	@return True if the voxel is occupied.
+	*/
+	bool isOccupied(const uvec3& voxel) const;
+};
+
@@ -0,0 +1,244 @@
+#include "stdafx.h"
+#include "TerrainMesher.h"
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include "Utilities/ThreadPool.h"
+
+// [Static members initialization]
+
+const unsigned TerrainMesher::TILE_SIZE = 256;
+
+/// [Public methods]
+
+bool TerrainMesher::build(std::vector<float>& heights, const uvec2& size, const vec3& origin, const vec2& cellSize, const float maxError, TriangleMesh& mesh)
+{
+	if (!size.x || !size.y || heights.size() != size_t(size.x) * size.y || !fillHoles(heights, size)) return false;
+
+	const uvec2 numTiles = (size - uvec2(1) + uvec2(TILE_SIZE - 1)) / TILE_SIZE + uvec2(size.x == 1, size.y == 1);
+	std::vector<uvec4> triangles;
+	std::vector<float> errors;
+	std::vector<unsigned> corners;
+
+	getTileTriangles(triangles);
+	computeErrors(heights, size, numTiles, triangles, errors);
+	extractTriangles(errors, size, numTiles, maxError, corners);
+
+	if (corners.empty()) return false;
+
+	// Vertices are the distinct grid cells referenced by triangles
+	std::vector<unsigned> cells(corners);
+	std::sort(std::execution::par_unseq, cells.begin(), cells.end());
+	cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+
+	std::vector<vec3> position(cells.size()), normal(cells.size());
+	std::vector<vec2> textCoord(cells.size());
+	std::vector<unsigned> index(corners.size());
+
+	std::for_each(std::execution::par_unseq, cells.begin(), cells.end(), [&](const unsigned& cell)
+		{
+			const size_t vertexIdx = &cell - cells.data();
+			const unsigned x = cell % size.x, y = cell / size.x;
+
+			// Central differences, one-sided at the borders of the grid
+			const unsigned x0 = x ? x - 1 : x, x1 = (std::min)(x + 1, size.x - 1), y0 = y ? y - 1 : y, y1 = (std::min)(y + 1, size.y - 1);
+			const float dx = x1 > x0 ? (heights[y * size.x + x1] - heights[y * size.x + x0]) / ((x1 - x0) * cellSize.x) : .0f;
+			const float dy = y1 > y0 ? (heights[y1 * size.x + x] - heights[y0 * size.x + x]) / ((y1 - y0) * cellSize.y) : .0f;
+
+			position[vertexIdx] = vec3(origin.x + x * cellSize.x, origin.y + y * cellSize.y, heights[cell]);
+			normal[vertexIdx] = glm::normalize(vec3(-dx, -dy, 1.0f));
+			textCoord[vertexIdx] = vec2(x, y) / vec2((std::max)(size.x - 1, 1u), (std::max)(size.y - 1, 1u));
+		});
+
+	std::transform(std::execution::par_unseq, corners.begin(), corners.end(), index.begin(), [&](const unsigned cell)
+		{
+			return unsigned(std::lower_bound(cells.begin(), cells.end(), cell) - cells.begin());
+		});
+
+	mesh.setGeometry(position, std::move(normal), std::move(textCoord), index);
+	mesh.computeTangents();
+
+	return true;
+}
+
+/// [Protected methods]
+
+void TerrainMesher::computeErrors(const std::vector<float>& heights, const uvec2& size, const uvec2& numTiles, const std::vector<uvec4>& triangles, std::vector<float>& errors)
+{
+	const unsigned width = numTiles.x * TILE_SIZE + 1, numTriangles = unsigned(triangles.size()), numParentTriangles = numTriangles - TILE_SIZE * TILE_SIZE;
+	const int maxLevel = int(std::bit_width(numTriangles + 1)) - 2;
+	const size_t totalTiles = size_t(numTiles.x) * numTiles.y;
+
+	errors.assign(size_t(width) * (numTiles.y * TILE_SIZE + 1), .0f);
+
+	// Triangle i has (i + 2) as identifier in the binary tree, so levels are contiguous ranges. Every level is completed for every tile
+	// before the next one, hence errors of border vertices already gather both tiles when their parents read them
+	for (int level = maxLevel; level >= 0; --level)
+	{
+		const unsigned firstTriangle = (2u << level) - 2, lastTriangle = (std::min)((4u << level) - 2, numTriangles);
+
+		ThreadPool::getInstance()->parallelFor(0, totalTiles, [&](const size_t tileIdx)
+			{
+				const unsigned tileX = unsigned(tileIdx % numTiles.x) * TILE_SIZE, tileY = unsigned(tileIdx / numTiles.x) * TILE_SIZE;
+
+				for (unsigned triangleIdx = firstTriangle; triangleIdx < lastTriangle; ++triangleIdx)
+				{
+					const uvec4& triangle = triangles[triangleIdx];
+					const unsigned mx = (triangle.x + triangle.z) >> 1, my = (triangle.y + triangle.w) >> 1;
+					const float interpolatedHeight = (getHeight(heights, size, tileX + triangle.x, tileY + triangle.y) + getHeight(heights, size, tileX + triangle.z, tileY + triangle.w)) / 2.0f;
+					float error = std::abs(interpolatedHeight - getHeight(heights, size, tileX + mx, tileY + my));
+
+					if (triangleIdx < numParentTriangles)
+					{
+						const unsigned cx = mx + my - triangle.y, cy = my + triangle.x - mx;
+						const size_t leftChild = size_t(tileY + ((triangle.y + cy) >> 1)) * width + tileX + ((triangle.x + cx) >> 1);
+						const size_t rightChild = size_t(tileY + ((triangle.w + cy) >> 1)) * width + tileX + ((triangle.z + cx) >> 1);
+
+						error = (std::max)(error, (std::max)(errors[leftChild], errors[rightChild]));
+					}
+
+					float& middleError = errors[size_t(tileY + my) * width + tileX + mx];
+
+					if (mx == 0 || my == 0 || mx == TILE_SIZE || my == TILE_SIZE)
+					{
+						std::atomic_ref<float> sharedError(middleError);
+						float currentError = sharedError.load(std::memory_order_relaxed);
+
+						while (currentError < error && !sharedError.compare_exchange_weak(currentError, error, std::memory_order_relaxed));
+					}
+					else
+					{
+						middleError = (std::max)(middleError, error);
+					}
+				}
+			}, 1);
+	}
+}
+
+void TerrainMesher::extractTriangles(const std::vector<float>& errors, const uvec2& size, const uvec2& numTiles, const float maxError, std::vector<unsigned>& corners)
+{
+	const unsigned width = numTiles.x * TILE_SIZE + 1;
+	std::vector<std::vector<unsigned>> tileCorners(numTiles.x * numTiles.y);
+
+	ThreadPool::getInstance()->parallelFor(0, tileCorners.size(), [&](const size_t tileIdx)
+		{
+			std::vector<unsigned>& localCorners = tileCorners[tileIdx];
+			const ivec2 tile = ivec2(tileIdx % numTiles.x, tileIdx / numTiles.x) * int(TILE_SIZE);
+			const int tileSize = int(TILE_SIZE);
+
+			// Vertices a, b, c of every pending triangle, where ab is the hypotenuse
+			std::vector<std::array<ivec2, 3>> stack = { { tile, tile + ivec2(tileSize), tile + ivec2(tileSize, 0) }, { tile + ivec2(tileSize), tile, tile + ivec2(0, tileSize) } };
+
+			while (!stack.empty())
+			{
+				const std::array<ivec2, 3> triangle = stack.back();
+				const ivec2 a = triangle[0], b = triangle[1], c = triangle[2], m = (a + b) / 2;
+				stack.pop_back();
+
+				if (std::abs(a.x - c.x) + std::abs(a.y - c.y) > 1 && errors[size_t(m.y) * width + m.x] > maxError)
+				{
+					stack.push_back({ c, a, m });
+					stack.push_back({ b, c, m });
+					continue;
+				}
+
+				// Padded vertices are clamped to the grid, which collapses the triangles lying beyond it
+				const ivec2 maxCell = ivec2(size) - ivec2(1);
+				const ivec2 ca = glm::min(a, maxCell), cb = glm::min(b, maxCell), cc = glm::min(c, maxCell);
+				if ((cb.x - ca.x) * (cc.y - ca.y) - (cb.y - ca.y) * (cc.x - ca.x) == 0) continue;
+
+				localCorners.insert(localCorners.end(), { unsigned(ca.y * size.x + ca.x), unsigned(cc.y * size.x + cc.x), unsigned(cb.y * size.x + cb.x) });
+			}
+		}, 1);
+
+	size_t numCorners = 0;
+	for (const std::vector<unsigned>& localCorners : tileCorners) numCorners += localCorners.size();
+
+	corners.clear();
+	corners.reserve(numCorners);
+	for (const std::vector<unsigned>& localCorners : tileCorners) corners.insert(corners.end(), localCorners.begin(), localCorners.end());
+}
+
+bool TerrainMesher::fillHoles(std::vector<float>& heights, const uvec2& size)
+{
+	if (std::none_of(std::execution::par_unseq, heights.begin(), heights.end(), [](const float height) { return !std::isnan(height); })) return false;
+
+	std::vector<float> rowHeight(heights), columnHeight(heights);
+
+	// Linear interpolation between the valid cells of a line, which are extended towards its ends
+	auto interpolateLine = [](float* line, const unsigned length, const unsigned stride)
+		{
+			int previous = -1;
+
+			for (unsigned idx = 0; idx <= length; ++idx)
+			{
+				if (idx < length && std::isnan(line[idx * stride])) continue;
+
+				const float previousHeight = previous >= 0 ? line[previous * stride] : (idx < length ? line[idx * stride] : NAN);
+				const float nextHeight = idx < length ? line[idx * stride] : previousHeight;
+
+				for (unsigned holeIdx = previous + 1; holeIdx < idx; ++holeIdx)
+					line[holeIdx * stride] = glm::mix(previousHeight, nextHeight, previous >= 0 && idx < length ? float(int(holeIdx) - previous) / (int(idx) - previous) : .0f);
+
+				previous = int(idx);
+			}
+		};
+
+	ThreadPool::getInstance()->parallelFor(0, size.y, [&](const size_t row) { interpolateLine(&rowHeight[row * size.x], size.x, 1); });
+	ThreadPool::getInstance()->parallelFor(0, size.x, [&](const size_t column) { interpolateLine(&columnHeight[column], size.y, size.x); });
+
+	// Lines without any valid cell remain empty, so the other direction is used alone
+	std::for_each(std::execution::par_unseq, heights.begin(), heights.end(), [&](float& height)
+		{
+			if (!std::isnan(height)) return;
+
+			const size_t cellIdx = &height - heights.data();
+			const float fromRow = rowHeight[cellIdx], fromColumn = columnHeight[cellIdx];
+
+			height = std::isnan(fromRow) ? fromColumn : (std::isnan(fromColumn) ? fromRow : (fromRow + fromColumn) / 2.0f);
+		});
+
+	return true;
+}
+
+void TerrainMesher::getTileTriangles(std::vector<uvec4>& triangles)
+{
+	triangles.resize(TILE_SIZE * TILE_SIZE * 2 - 2);
+
+	std::for_each(std::execution::par_unseq, triangles.begin(), triangles.end(), [&](uvec4& triangle)
+		{
+			unsigned id = unsigned(&triangle - triangles.data()) + 2;
+			unsigned ax = 0, ay = 0, bx = 0, by = 0, cx = 0, cy = 0;
+
+			if (id & 1)
+			{
+				bx = by = cx = TILE_SIZE;
+			}
+			else
+			{
+				ax = ay = cy = TILE_SIZE;
+			}
+
+			// Every bit below the root one selects the left or right child
+			while ((id >>= 1) > 1)
+			{
+				const unsigned mx = (ax + bx) >> 1, my = (ay + by) >> 1;
+
+				if (id & 1)
+				{
+					bx = ax; by = ay;
+					ax = cx; ay = cy;
+				}
+				else
+				{
+					ax = bx; ay = by;
+					bx = cx; by = cy;
+				}
+
+				cx = mx; cy = my;
+			}
+
+			triangle = uvec4(ax, ay, bx, by);
+		});
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Geometry/3D/TriangleMesh.h"
+
+/**
+*	@file TerrainMesher.h
+*	@authors Alfonso Lpez Ruiz (alr00048@red.ujaen.es)
+*	@date 19/10/2026
+*/
+
+/**
+*	@brief Builds adaptive triangle meshes from height grids using right-triangulated irregular networks (RTIN). Triangles are recursively
+*	bisected until the height interpolated along their longest edge is within a maximum vertical error. The grid is split into square
+*	tiles of TILE_SIZE cells whose errors are computed level by level, sharing the vertices of their borders, so that neighbouring tiles
+*	bisect their common edges alike and the mesh has no cracks.
+*/
+class TerrainMesher
+{
+protected:
+	const static unsigned TILE_SIZE;											//!< Cells per side of a tile, a power of two
+
+protected:
+	/**
+	*	@brief Computes the error of every vertex of the padded grid, i.e. the maximum vertical error of the triangles which are bisected there.
+	*	@param numTiles Tiles per axis, the grid is padded to cover them.
+	*/
+	static void computeErrors(const std::vector<float>& heights, const uvec2& size, const uvec2& numTiles, const std::vector<uvec4>& triangles, std::vector<float>& errors);
+
+	/**
+	*	@brief Collects the triangles of every tile whose error does not exceed maxError, clamping their vertices to the grid.
+	*	@param corners Grid index of the three vertices of every triangle, counter-clockwise from above.
+	*/
+	static void extractTriangles(const std::vector<float>& errors, const uvec2& size, const uvec2& numTiles, const float maxError, std::vector<unsigned>& corners);
+
+	/**
+	*	@brief Fills cells with no height (NaN) with the average of their interpolation along the row and the column.
+	*	@return False if no cell has a height.
+	*/
+	static bool fillHoles(std::vector<float>& heights, const uvec2& size);
+
+	/**
+	*	@return Height of a cell, clamping the coordinates to the grid as the padded tiles extend beyond it.
+	*/
+	static float getHeight(const std::vector<float>& heights, const uvec2& size, const unsigned x, const unsigned y) { return heights[(std::min)(y, size.y - 1) * size.x + (std::min)(x, size.x - 1)]; }
+
+	/**
+	*	@brief Computes the first two vertices of every triangle of a tile, indexed as a binary tree where the children of triangle i
+	*	are 2i + 2 and 2i + 3. The third vertex can be derived from them.
+	*/
+	static void getTileTriangles(std::vector<uvec4>& triangles);
+
+public:
+	/**
+	*	@brief Builds a terrain mesh from a grid of heights.
+	*	@param heights Height of every cell, row by row. Cells with NaN height are filled by interpolation.
+	*	@param origin Center of the first cell, where its vertex lies.
+	*	@param maxError Maximum vertical distance from the grid to the mesh.
+	*	@return False if the grid has no valid height.
+	*/
+	static bool build(std::vector<float>& heights, const uvec2& size, const vec3& origin, const vec2& cellSize, const float maxError, TriangleMesh& mesh);
+};
+
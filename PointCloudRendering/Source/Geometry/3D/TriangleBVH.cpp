@@ -0,0 +1,1017 @@
+#include "stdafx.h"
+#include "TriangleBVH.h"
+
+#include "Geometry/General/BasicOperations.h"
+#include "Utilities/ChronoUtilities.h"
+#include "Utilities/ThreadPool.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+// [Static members initialization]
+
+const unsigned TriangleBVH::NOT_FOUND = UINT_MAX;
+const unsigned TriangleBVH::COHERENT_BLOCK_SIZE = 1024;
+const unsigned TriangleBVH::MAX_DEPTH = 60;
+const unsigned TriangleBVH::MAX_LEAF_SIZE = 8;
+const unsigned TriangleBVH::NUM_BINS = 16;
+const unsigned TriangleBVH::PARALLEL_THRESHOLD = 1 << 14;
+const unsigned TriangleBVH::STACK_SIZE = 64;
+const float TriangleBVH::TRAVERSAL_COST = 1.0f;
+
+/// [Public methods]
+
+TriangleBVH::TriangleBVH()
+{
+}
+
+TriangleBVH::~TriangleBVH()
+{
+}
+
+void TriangleBVH::benchmark(const unsigned resolution, const unsigned numIterations) const
+{
+	if (_nodes.empty() || !resolution || !numIterations) return;
+
+	// Pinhole camera looking at the root node from outside, with a 60 degrees field of view
+	const vec3 center = (_nodes[0]._min + _nodes[0]._max) * 0.5f;
+	const float radius = (std::max)(glm::length(_nodes[0]._max - _nodes[0]._min) * 0.5f, 1e-3f);
+	const vec3 eye = center + glm::normalize(vec3(1.0f, 0.8f, 0.6f)) * radius * 2.5f;
+	const vec3 forward = glm::normalize(center - eye), right = glm::normalize(glm::cross(forward, vec3(.0f, .0f, 1.0f))), up = glm::cross(right, forward);
+	const float fovTangent = std::tan(glm::radians(30.0f));
+
+	// Rays are generated in tiles of 4x2 pixels, i.e. one tile per packet
+	const unsigned width = (resolution + 3) / 4 * 4, height = (resolution + 1) / 2 * 2;
+	std::vector<Ray3D> coherentRays;
+	coherentRays.reserve(size_t(width) * height);
+
+	for (unsigned y = 0; y < height; y += 2)
+	{
+		for (unsigned x = 0; x < width; x += 4)
+		{
+			for (unsigned tileY = y; tileY < y + 2; ++tileY)
+			{
+				for (unsigned tileX = x; tileX < x + 4; ++tileX)
+				{
+					const vec2 ndc = (vec2(tileX, tileY) + 0.5f) / vec2(width, height) * 2.0f - 1.0f;
+					coherentRays.push_back(Ray3D(eye, eye + forward + (right * ndc.x + up * ndc.y) * fovTangent));
+				}
+			}
+		}
+	}
+
+	std::vector<Ray3D> divergentRays(coherentRays);
+	std::shuffle(divergentRays.begin(), divergentRays.end(), std::mt19937(0));
+
+	auto measure = [&](const std::vector<Ray3D>& rays, const bool packets) -> double
+	{
+		std::vector<Hit> hits(rays.size());
+
+		ChronoUtilities::initChrono();
+
+		for (unsigned iteration = 0; iteration < numIterations; ++iteration)
+		{
+			if (packets)
+			{
+				this->intersect(rays, hits);
+			}
+			else
+			{
+				std::for_each(std::execution::par_unseq, rays.begin(), rays.end(), [&](const Ray3D& ray)
+					{
+						this->closestHit(ray.getOrigin(), ray.getDirection(), hits[&ray - rays.data()]);
+					});
+			}
+		}
+
+		return double(rays.size()) * numIterations / (std::max)(ChronoUtilities::getDuration(ChronoUtilities::MICROSECONDS), 1ll);
+	};
+
+#ifdef __AVX2__
+	const std::string instructionSet = "AVX2";
+#else
+	const std::string instructionSet = "scalar";
+#endif
+
+	std::cout << "Ray throughput over " << this->getNumTriangles() << " triangles (" << coherentRays.size() << " rays, " << instructionSet << " packets):" << std::endl;
+	std::cout << "\t- Single rays: " << measure(coherentRays, false) << " million rays per second" << std::endl;
+	std::cout << "\t- Coherent packets: " << measure(coherentRays, true) << " million rays per second" << std::endl;
+	std::cout << "\t- Divergent packets: " << measure(divergentRays, true) << " million rays per second" << std::endl;
+}
+
+void TriangleBVH::build(const std::vector<vec3>& vertices)
+{
+	this->clear();
+
+	const unsigned numTriangles = unsigned(vertices.size() / 3);
+	if (!numTriangles) return;
+
+	BuildData buildData;
+	buildData._min.resize(numTriangles);
+	buildData._max.resize(numTriangles);
+	buildData._centroid.resize(numTriangles);
+
+	_triangleIndex.resize(numTriangles);
+	std::iota(_triangleIndex.begin(), _triangleIndex.end(), 0);
+
+	std::for_each(std::execution::par_unseq, _triangleIndex.begin(), _triangleIndex.end(), [&](const unsigned index)
+		{
+			const vec3& v0 = vertices[index * 3 + 0], & v1 = vertices[index * 3 + 1], & v2 = vertices[index * 3 + 2];
+
+			buildData._min[index]		= glm::min(v0, glm::min(v1, v2));
+			buildData._max[index]		= glm::max(v0, glm::max(v1, v2));
+			buildData._centroid[index]	= (buildData._min[index] + buildData._max[index]) * 0.5f;
+		});
+
+	// A binary tree with a triangle per leaf at most is the worst case
+	std::atomic<unsigned> nodeCounter(1);
+	_nodes.resize(2 * size_t(numTriangles) - 1);
+
+	// Spawn as many top-level tasks as pool threads, the remaining levels are built serially by each task
+	const unsigned parallelDepth = unsigned(std::ceil(std::log2((std::max)(ThreadPool::getInstance()->getNumThreads(), 1u))));
+	this->build(0, 0, numTriangles, buildData, nodeCounter, 0, parallelDepth);
+
+	_nodes.resize(nodeCounter.load());
+	_nodes.shrink_to_fit();
+
+	// Triangles are stored in leaf order so that each leaf reads a contiguous block
+	_triangles.resize(numTriangles);
+
+	std::for_each(std::execution::par_unseq, _triangles.begin(), _triangles.end(), [&](Triangle& triangle)
+		{
+			const unsigned index = _triangleIndex[&triangle - _triangles.data()];
+			const vec3& v0 = vertices[index * 3 + 0];
+
+			triangle._v0	= v0;
+			triangle._edge1 = vertices[index * 3 + 1] - v0;
+			triangle._edge2 = vertices[index * 3 + 2] - v0;
+		});
+
+	this->buildPseudoNormals(vertices);
+}
+
+void TriangleBVH::clear()
+{
+	std::vector<Node>().swap(_nodes);
+	std::vector<PseudoNormals>().swap(_pseudoNormals);
+	std::vector<Triangle>().swap(_triangles);
+	std::vector<unsigned>().swap(_triangleIndex);
+}
+
+void TriangleBVH::allHits(const vec3& origin, const vec3& direction, std::vector<Hit>& hits) const
+{
+	const vec3 rayDirection = glm::normalize(direction);
+
+	hits.clear();
+	this->traverseAll(origin, rayDirection, [&](const unsigned triangleIdx, const float distance)
+		{
+			hits.push_back(Hit{ distance, origin + rayDirection * distance, _triangleIndex[triangleIdx] });
+		});
+
+	std::sort(hits.begin(), hits.end(), [](const Hit& hit1, const Hit& hit2) { return hit1._distance < hit2._distance; });
+}
+
+bool TriangleBVH::closestHit(const vec3& origin, const vec3& direction, Hit& hit, const float maxDistance) const
+{
+	hit._triangle = NOT_FOUND;
+	hit._distance = maxDistance;
+
+	if (_nodes.empty()) return false;
+
+	const vec3 rayDirection = glm::normalize(direction), inverseDirection = getInverseDirection(rayDirection);
+	unsigned nodeStack[STACK_SIZE];
+	float distanceStack[STACK_SIZE];
+	unsigned stackSize = 0, nodeIdx = 0;
+	float distance;
+
+	if (!intersect(_nodes[0], origin, inverseDirection, hit._distance, distance)) return false;
+
+	while (true)
+	{
+		const Node& node = _nodes[nodeIdx];
+
+		if (node._count)
+		{
+			for (unsigned triangleIdx = node._offset; triangleIdx < node._offset + node._count; ++triangleIdx)
+			{
+				if (intersect(_triangles[triangleIdx], origin, rayDirection, distance) && distance < hit._distance)
+				{
+					hit._distance = distance;
+					hit._triangle = triangleIdx;
+				}
+			}
+		}
+		else
+		{
+			float leftDistance, rightDistance;
+			const bool hitLeft = intersect(_nodes[node._offset], origin, inverseDirection, hit._distance, leftDistance);
+			const bool hitRight = intersect(_nodes[node._offset + 1], origin, inverseDirection, hit._distance, rightDistance);
+
+			if (hitLeft && hitRight)											// Nearest child first, the other one may be culled later
+			{
+				const bool leftFirst = leftDistance <= rightDistance;
+
+				nodeStack[stackSize] = node._offset + (leftFirst ? 1 : 0);
+				distanceStack[stackSize++] = leftFirst ? rightDistance : leftDistance;
+				nodeIdx = node._offset + (leftFirst ? 0 : 1);
+				continue;
+			}
+			else if (hitLeft || hitRight)
+			{
+				nodeIdx = node._offset + (hitLeft ? 0 : 1);
+				continue;
+			}
+		}
+
+		// Pop nodes until one of them is closer than the current hit
+		do
+		{
+			if (!stackSize)
+			{
+				if (hit._triangle == NOT_FOUND) return false;
+
+				hit._point = origin + rayDirection * hit._distance;
+				hit._triangle = _triangleIndex[hit._triangle];
+
+				return true;
+			}
+
+			--stackSize;
+		} while (distanceStack[stackSize] > hit._distance);
+
+		nodeIdx = nodeStack[stackSize];
+	}
+}
+
+bool TriangleBVH::closestPoint(const vec3& point, Hit& hit, const float maxDistance) const
+{
+	hit._triangle = NOT_FOUND;
+	hit._distance = maxDistance;
+
+	if (_nodes.empty()) return false;
+
+	float sqrDistance = maxDistance < FLT_MAX ? maxDistance * maxDistance : FLT_MAX;
+	const unsigned triangleIdx = this->closestTriangle(point, NOT_FOUND, sqrDistance, hit._point);
+	if (triangleIdx == NOT_FOUND) return false;
+
+	hit._distance = std::sqrt(sqrDistance);
+	hit._triangle = _triangleIndex[triangleIdx];
+
+	return true;
+}
+
+unsigned TriangleBVH::countHits(const vec3& origin, const vec3& direction) const
+{
+	unsigned numHits = 0;
+	this->traverseAll(origin, glm::normalize(direction), [&](const unsigned, const float) { ++numHits; });
+
+	return numHits;
+}
+
+void TriangleBVH::intersect(const std::vector<Ray3D>& rays, std::vector<Hit>& hits, const float maxDistance) const
+{
+	hits.assign(rays.size(), Hit{ maxDistance, vec3(.0f), NOT_FOUND });
+
+	const unsigned numPackets = unsigned((rays.size() + PACKET_SIZE - 1) / PACKET_SIZE);
+	std::vector<unsigned> packetIndex(numPackets);
+	std::iota(packetIndex.begin(), packetIndex.end(), 0);
+
+	std::for_each(std::execution::par_unseq, packetIndex.begin(), packetIndex.end(), [&](const unsigned packetIdx)
+		{
+			const size_t firstRay = size_t(packetIdx) * PACKET_SIZE, numRays = (std::min)(rays.size() - firstRay, size_t(PACKET_SIZE));
+			RayPacket packet;
+			bool coherent = true;
+
+			packet._activeMask = (1u << numRays) - 1;
+
+			for (unsigned lane = 0; lane < PACKET_SIZE; ++lane)
+			{
+				const Ray3D& ray = rays[firstRay + (std::min)(size_t(lane), numRays - 1)];			// Empty lanes repeat the last ray
+				const vec3 origin = ray.getOrigin(), direction = glm::normalize(ray.getDirection()), inverseDirection = getInverseDirection(direction);
+
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					const unsigned octant = std::signbit(direction[axis]) ? 1 : 0;
+
+					packet._origin[axis][lane] = origin[axis];
+					packet._direction[axis][lane] = direction[axis];
+					packet._inverseDirection[axis][lane] = inverseDirection[axis];
+
+					if (!lane) packet._octant[axis] = octant;
+					else coherent &= packet._octant[axis] == octant;
+				}
+
+				packet._distance[lane] = maxDistance;
+				packet._triangle[lane] = NOT_FOUND;
+			}
+
+			if (!coherent)
+			{
+				for (size_t rayIdx = firstRay; rayIdx < firstRay + numRays; ++rayIdx)
+				{
+					this->closestHit(rays[rayIdx].getOrigin(), rays[rayIdx].getDirection(), hits[rayIdx], maxDistance);
+				}
+
+				return;
+			}
+
+			this->closestHit(packet);
+
+			for (unsigned lane = 0; lane < numRays; ++lane)
+			{
+				if (packet._triangle[lane] == NOT_FOUND) continue;
+
+				Hit& hit = hits[firstRay + lane];
+				hit._distance = packet._distance[lane];
+				hit._point = vec3(packet._origin[0][lane], packet._origin[1][lane], packet._origin[2][lane]) +
+							 vec3(packet._direction[0][lane], packet._direction[1][lane], packet._direction[2][lane]) * hit._distance;
+				hit._triangle = _triangleIndex[packet._triangle[lane]];
+			}
+		});
+}
+
+void TriangleBVH::signedDistance(const void* points, const size_t numPoints, const size_t stride, std::vector<float>& distances, const float maxDistance) const
+{
+	distances.assign(numPoints, maxDistance);
+
+	if (_nodes.empty() || !numPoints) return;
+
+	const char* data = static_cast<const char*>(points);
+	const vec3 parityDirection = glm::normalize(vec3(0.5773f, 0.5917f, 0.5633f));		// Skewed, so that it rarely runs along the edges of axis-aligned meshes
+	const float maxSqrDistance = maxDistance < FLT_MAX ? maxDistance * maxDistance : FLT_MAX;
+	const size_t numBlocks = (numPoints + COHERENT_BLOCK_SIZE - 1) / COHERENT_BLOCK_SIZE;
+
+	ThreadPool::getInstance()->parallelFor(0, numBlocks, [&](const size_t blockIdx)
+		{
+			const size_t firstPoint = blockIdx * COHERENT_BLOCK_SIZE, lastPoint = (std::min)(firstPoint + COHERENT_BLOCK_SIZE, numPoints);
+			unsigned previousTriangle = NOT_FOUND;
+
+			for (size_t pointIdx = firstPoint; pointIdx < lastPoint; ++pointIdx)
+			{
+				const vec3& point = *reinterpret_cast<const vec3*>(data + pointIdx * stride);
+				unsigned triangleIdx = NOT_FOUND;
+				float sqrDistance = maxSqrDistance;
+				vec3 closest;
+
+				// The nearest triangle of the previous point is usually near this one too, so the traversal starts with a tight bound
+				if (previousTriangle != NOT_FOUND)
+				{
+					const vec3 candidate = closestPoint(_triangles[previousTriangle], point);
+					const float candidateDistance = glm::dot(point - candidate, point - candidate);
+
+					if (candidateDistance < sqrDistance)
+					{
+						triangleIdx = previousTriangle;
+						sqrDistance = candidateDistance;
+						closest = candidate;
+					}
+				}
+
+				triangleIdx = this->closestTriangle(point, triangleIdx, sqrDistance, closest);
+				previousTriangle = triangleIdx;
+
+				// Out of range, hence the parity of the triangles crossed by a ray gives the side
+				if (triangleIdx == NOT_FOUND)
+				{
+					if (this->countHits(point, parityDirection) % 2) distances[pointIdx] = -maxDistance;
+					continue;
+				}
+
+				Feature feature;
+				closest = closestPoint(_triangles[triangleIdx], point, feature);
+
+				const bool inside = glm::dot(point - closest, _pseudoNormals[triangleIdx]._normal[feature]) < .0f;
+
+				distances[pointIdx] = inside ? -std::sqrt(sqrDistance) : std::sqrt(sqrDistance);
+			}
+		}, 1);
+}
+
+/// [Protected methods]
+
+void TriangleBVH::build(const unsigned nodeIdx, const unsigned begin, const unsigned end, const BuildData& buildData, std::atomic<unsigned>& nodeCounter, const unsigned depth, const unsigned parallelDepth)
+{
+	Node& node = _nodes[nodeIdx];
+	vec3 centroidMin(FLT_MAX), centroidMax(-FLT_MAX);
+
+	node._min = vec3(FLT_MAX);
+	node._max = vec3(-FLT_MAX);
+
+	for (unsigned idx = begin; idx < end; ++idx)
+	{
+		const unsigned triangleIdx = _triangleIndex[idx];
+
+		node._min = glm::min(node._min, buildData._min[triangleIdx]);
+		node._max = glm::max(node._max, buildData._max[triangleIdx]);
+		centroidMin = glm::min(centroidMin, buildData._centroid[triangleIdx]);
+		centroidMax = glm::max(centroidMax, buildData._centroid[triangleIdx]);
+	}
+
+	const unsigned count = end - begin;
+
+	if (count == 1 || depth >= MAX_DEPTH)
+	{
+		node._offset = begin;
+		node._count = count;
+		return;
+	}
+
+	// Binned SAH: evaluate NUM_BINS - 1 candidate planes on every axis
+	struct Bin { vec3 _min = vec3(FLT_MAX), _max = vec3(-FLT_MAX); unsigned _count = 0; };
+
+	const float nodeArea = (std::max)(halfArea(node._min, node._max), FLT_MIN);
+	const vec3 centroidExtent = centroidMax - centroidMin;
+	float bestCost = FLT_MAX;
+	int bestAxis = -1;
+	unsigned bestBin = 0;
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		if (centroidExtent[axis] <= .0f) continue;
+
+		std::vector<Bin> bins(NUM_BINS);
+		const float scale = NUM_BINS / centroidExtent[axis];
+
+		for (unsigned idx = begin; idx < end; ++idx)
+		{
+			const unsigned triangleIdx = _triangleIndex[idx];
+			Bin& bin = bins[(std::min)(unsigned((buildData._centroid[triangleIdx][axis] - centroidMin[axis]) * scale), NUM_BINS - 1)];
+
+			bin._min = glm::min(bin._min, buildData._min[triangleIdx]);
+			bin._max = glm::max(bin._max, buildData._max[triangleIdx]);
+			++bin._count;
+		}
+
+		// Right sweep accumulates the cost of the right side of every plane, left sweep completes it
+		std::vector<float> rightCost(NUM_BINS);
+		Bin accumulated;
+
+		for (unsigned binIdx = NUM_BINS - 1; binIdx > 0; --binIdx)
+		{
+			accumulated._min = glm::min(accumulated._min, bins[binIdx]._min);
+			accumulated._max = glm::max(accumulated._max, bins[binIdx]._max);
+			accumulated._count += bins[binIdx]._count;
+			rightCost[binIdx] = accumulated._count ? halfArea(accumulated._min, accumulated._max) * accumulated._count : .0f;
+		}
+
+		accumulated = Bin();
+
+		for (unsigned binIdx = 0; binIdx < NUM_BINS - 1; ++binIdx)
+		{
+			accumulated._min = glm::min(accumulated._min, bins[binIdx]._min);
+			accumulated._max = glm::max(accumulated._max, bins[binIdx]._max);
+			accumulated._count += bins[binIdx]._count;
+
+			if (!accumulated._count || accumulated._count == count) continue;
+
+			const float cost = TRAVERSAL_COST + (halfArea(accumulated._min, accumulated._max) * accumulated._count + rightCost[binIdx + 1]) / nodeArea;
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestBin = binIdx;
+			}
+		}
+	}
+
+	if (count <= MAX_LEAF_SIZE && (bestAxis < 0 || bestCost >= float(count)))
+	{
+		node._offset = begin;
+		node._count = count;
+		return;
+	}
+
+	unsigned middle = begin + count / 2;											// Every centroid is the same: split by index
+
+	if (bestAxis >= 0)
+	{
+		const float scale = NUM_BINS / centroidExtent[bestAxis];
+
+		middle = unsigned(std::partition(_triangleIndex.begin() + begin, _triangleIndex.begin() + end, [&](const unsigned triangleIdx)
+			{
+				return (std::min)(unsigned((buildData._centroid[triangleIdx][bestAxis] - centroidMin[bestAxis]) * scale), NUM_BINS - 1) <= bestBin;
+			}) - _triangleIndex.begin());
+	}
+
+	const unsigned children = nodeCounter.fetch_add(2);
+	node._offset = children;
+	node._count = 0;
+
+	if (parallelDepth && count >= PARALLEL_THRESHOLD)
+	{
+		ThreadPool::TaskGroup left;
+		left.run([&]()
+			{
+				this->build(children, begin, middle, buildData, nodeCounter, depth + 1, parallelDepth - 1);
+			});
+		this->build(children + 1, middle, end, buildData, nodeCounter, depth + 1, parallelDepth - 1);
+		left.wait();
+	}
+	else
+	{
+		this->build(children, begin, middle, buildData, nodeCounter, depth + 1, 0);
+		this->build(children + 1, middle, end, buildData, nodeCounter, depth + 1, 0);
+	}
+}
+
+void TriangleBVH::buildPseudoNormals(const std::vector<vec3>& vertices)
+{
+	const unsigned numTriangles = unsigned(_triangleIndex.size()), numVertices = numTriangles * 3;
+
+	// Equal positions become consecutive once sorted, so each run of them is given the same identifier
+	std::vector<unsigned> vertexOrder(numVertices), vertexId(numVertices);
+	std::iota(vertexOrder.begin(), vertexOrder.end(), 0);
+
+	std::sort(std::execution::par_unseq, vertexOrder.begin(), vertexOrder.end(), [&](const unsigned vertex1, const unsigned vertex2)
+		{
+			const vec3& position1 = vertices[vertex1], & position2 = vertices[vertex2];
+
+			if (position1.x != position2.x) return position1.x < position2.x;
+			if (position1.y != position2.y) return position1.y < position2.y;
+			return position1.z < position2.z;
+		});
+
+	unsigned lastVertexId = 0;
+
+	for (unsigned orderIdx = 0; orderIdx < numVertices; ++orderIdx)
+	{
+		if (orderIdx && vertices[vertexOrder[orderIdx]] != vertices[vertexOrder[orderIdx - 1]]) ++lastVertexId;
+		vertexId[vertexOrder[orderIdx]] = lastVertexId;
+	}
+
+	// Vertex normals add the face normals weighted by the angle of each face at the vertex; degenerate faces have no normal
+	std::vector<vec3> faceNormal(numTriangles, vec3(.0f)), vertexNormal(lastVertexId + 1, vec3(.0f));
+
+	for (unsigned triangleIdx = 0; triangleIdx < numTriangles; ++triangleIdx)
+	{
+		const vec3* corner = &vertices[triangleIdx * 3];
+		const vec3 normal = glm::cross(corner[1] - corner[0], corner[2] - corner[0]);
+
+		if (glm::dot(normal, normal) <= .0f) continue;
+
+		faceNormal[triangleIdx] = glm::normalize(normal);
+
+		for (unsigned cornerIdx = 0; cornerIdx < 3; ++cornerIdx)
+		{
+			const vec3 edge1 = glm::normalize(corner[(cornerIdx + 1) % 3] - corner[cornerIdx]), edge2 = glm::normalize(corner[(cornerIdx + 2) % 3] - corner[cornerIdx]);
+			const float angle = std::acos(glm::clamp(glm::dot(edge1, edge2), -1.0f, 1.0f));
+
+			vertexNormal[vertexId[triangleIdx * 3 + cornerIdx]] += faceNormal[triangleIdx] * angle;
+		}
+	}
+
+	// Edge normals add the normals of the faces sharing the edge, i.e. every face is weighted by pi. Edge i goes from corner i to the next one
+	std::vector<std::pair<uint64_t, unsigned>> edges(numVertices);
+	std::vector<vec3> edgeNormal(numVertices, vec3(.0f));
+
+	for (unsigned triangleIdx = 0; triangleIdx < numTriangles; ++triangleIdx)
+	{
+		for (unsigned cornerIdx = 0; cornerIdx < 3; ++cornerIdx)
+		{
+			const unsigned edgeIdx = triangleIdx * 3 + cornerIdx, vertex1 = vertexId[edgeIdx], vertex2 = vertexId[triangleIdx * 3 + (cornerIdx + 1) % 3];
+			edges[edgeIdx] = std::make_pair((uint64_t((std::min)(vertex1, vertex2)) << 32) | (std::max)(vertex1, vertex2), edgeIdx);
+		}
+	}
+
+	std::sort(std::execution::par_unseq, edges.begin(), edges.end());
+
+	for (size_t firstEdge = 0, lastEdge; firstEdge < edges.size(); firstEdge = lastEdge)
+	{
+		vec3 normal(.0f);
+
+		for (lastEdge = firstEdge; lastEdge < edges.size() && edges[lastEdge].first == edges[firstEdge].first; ++lastEdge)
+		{
+			normal += faceNormal[edges[lastEdge].second / 3];
+		}
+
+		for (size_t edgeIdx = firstEdge; edgeIdx < lastEdge; ++edgeIdx) edgeNormal[edges[edgeIdx].second] = normal;
+	}
+
+	// Stored along with the sorted triangles
+	_pseudoNormals.resize(numTriangles);
+
+	std::for_each(std::execution::par_unseq, _pseudoNormals.begin(), _pseudoNormals.end(), [&](PseudoNormals& normals)
+		{
+			const unsigned index = _triangleIndex[&normals - _pseudoNormals.data()];
+
+			for (unsigned cornerIdx = 0; cornerIdx < 3; ++cornerIdx)
+			{
+				normals._normal[VERTEX_A + cornerIdx]	= vertexNormal[vertexId[index * 3 + cornerIdx]];
+				normals._normal[EDGE_AB + cornerIdx]	= edgeNormal[index * 3 + cornerIdx];
+			}
+
+			normals._normal[FACE] = faceNormal[index];
+		});
+}
+
+vec3 TriangleBVH::closestPoint(const Triangle& triangle, const vec3& point, Feature& feature)
+{
+	const vec3& a = triangle._v0, &ab = triangle._edge1, &ac = triangle._edge2;
+
+	// Vertex region of A
+	const vec3 ap = point - a;
+	const float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+	if (d1 <= .0f && d2 <= .0f)
+	{
+		feature = VERTEX_A;
+		return a;
+	}
+
+	// Vertex region of B
+	const vec3 bp = ap - ab;
+	const float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+	if (d3 >= .0f && d4 <= d3)
+	{
+		feature = VERTEX_B;
+		return a + ab;
+	}
+
+	// Edge region of AB
+	const float vc = d1 * d4 - d3 * d2;
+	if (vc <= .0f && d1 >= .0f && d3 <= .0f)
+	{
+		feature = EDGE_AB;
+		return a + ab * (d1 / (d1 - d3));
+	}
+
+	// Vertex region of C
+	const vec3 cp = ap - ac;
+	const float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+	if (d6 >= .0f && d5 <= d6)
+	{
+		feature = VERTEX_C;
+		return a + ac;
+	}
+
+	// Edge region of AC
+	const float vb = d5 * d2 - d1 * d6;
+	if (vb <= .0f && d2 >= .0f && d6 <= .0f)
+	{
+		feature = EDGE_CA;
+		return a + ac * (d2 / (d2 - d6));
+	}
+
+	// Edge region of BC
+	const float va = d3 * d6 - d5 * d4;
+	if (va <= .0f && (d4 - d3) >= .0f && (d5 - d6) >= .0f)
+	{
+		feature = EDGE_BC;
+		return a + ab + (ac - ab) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+	}
+
+	// Face region, degenerate triangles have no area and are solved by the regions above unless every vertex collapses into A
+	const float sum = va + vb + vc;
+	if (sum <= .0f)
+	{
+		feature = VERTEX_A;
+		return a;
+	}
+
+	feature = FACE;
+	return a + ab * (vb / sum) + ac * (vc / sum);
+}
+
+unsigned TriangleBVH::closestTriangle(const vec3& point, unsigned triangleIdx, float& sqrDistance, vec3& closest) const
+{
+	unsigned nodeStack[STACK_SIZE];
+	float distanceStack[STACK_SIZE];
+	unsigned stackSize = 0, nodeIdx = 0;
+
+	if (TriangleBVH::sqrDistance(_nodes[0], point) > sqrDistance) return triangleIdx;
+
+	while (true)
+	{
+		const Node& node = _nodes[nodeIdx];
+
+		if (node._count)
+		{
+			for (unsigned leafTriangleIdx = node._offset; leafTriangleIdx < node._offset + node._count; ++leafTriangleIdx)
+			{
+				const vec3 candidate = closestPoint(_triangles[leafTriangleIdx], point);
+				const float candidateDistance = glm::dot(point - candidate, point - candidate);
+
+				if (candidateDistance < sqrDistance)
+				{
+					triangleIdx = leafTriangleIdx;
+					sqrDistance = candidateDistance;
+					closest = candidate;
+				}
+			}
+		}
+		else
+		{
+			const float leftDistance = TriangleBVH::sqrDistance(_nodes[node._offset], point), rightDistance = TriangleBVH::sqrDistance(_nodes[node._offset + 1], point);
+			const bool visitLeft = leftDistance < sqrDistance, visitRight = rightDistance < sqrDistance;
+
+			if (visitLeft && visitRight)										// Nearest child first, the other one may be culled later
+			{
+				const bool leftFirst = leftDistance <= rightDistance;
+
+				nodeStack[stackSize] = node._offset + (leftFirst ? 1 : 0);
+				distanceStack[stackSize++] = leftFirst ? rightDistance : leftDistance;
+				nodeIdx = node._offset + (leftFirst ? 0 : 1);
+				continue;
+			}
+			else if (visitLeft || visitRight)
+			{
+				nodeIdx = node._offset + (visitLeft ? 0 : 1);
+				continue;
+			}
+		}
+
+		// Pop nodes until one of them is closer than the current candidate
+		do
+		{
+			if (!stackSize) return triangleIdx;
+
+			--stackSize;
+		} while (distanceStack[stackSize] >= sqrDistance);
+
+		nodeIdx = nodeStack[stackSize];
+	}
+}
+
+vec3 TriangleBVH::getInverseDirection(const vec3& direction)
+{
+	vec3 inverseDirection;
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		inverseDirection[axis] = 1.0f / (std::abs(direction[axis]) > 1e-8f ? direction[axis] : std::copysign(1e-8f, direction[axis]));
+	}
+
+	return inverseDirection;
+}
+
+void TriangleBVH::closestHit(RayPacket& packet) const
+{
+	if (_nodes.empty()) return;
+
+	float distance[PACKET_SIZE], leftDistance[PACKET_SIZE], rightDistance[PACKET_SIZE];
+	unsigned nodeStack[STACK_SIZE], maskStack[STACK_SIZE];
+	unsigned stackSize = 0, nodeIdx = 0;
+	unsigned mask = intersect(_nodes[0], packet, distance);
+
+	// Nearest entry distance among the rays of a mask
+	auto nearestDistance = [](const float* distance, const unsigned mask) -> float
+	{
+		float nearest = FLT_MAX;
+
+		for (unsigned lane = 0; lane < PACKET_SIZE; ++lane)
+		{
+			if (mask & (1u << lane)) nearest = (std::min)(nearest, distance[lane]);
+		}
+
+		return nearest;
+	};
+
+	if (!mask) return;
+
+	while (true)
+	{
+		const Node& node = _nodes[nodeIdx];
+
+		if (node._count)
+		{
+			for (unsigned triangleIdx = node._offset; triangleIdx < node._offset + node._count; ++triangleIdx)
+			{
+				intersect(_triangles[triangleIdx], triangleIdx, mask, packet);
+			}
+		}
+		else
+		{
+			const unsigned leftMask = intersect(_nodes[node._offset], packet, leftDistance) & mask;
+			const unsigned rightMask = intersect(_nodes[node._offset + 1], packet, rightDistance) & mask;
+
+			if (leftMask && rightMask)											// Nearest child first, the other one may be culled later
+			{
+				const bool leftFirst = nearestDistance(leftDistance, leftMask) <= nearestDistance(rightDistance, rightMask);
+
+				nodeStack[stackSize] = node._offset + (leftFirst ? 1 : 0);
+				maskStack[stackSize++] = leftFirst ? rightMask : leftMask;
+				nodeIdx = node._offset + (leftFirst ? 0 : 1);
+				mask = leftFirst ? leftMask : rightMask;
+				continue;
+			}
+			else if (leftMask || rightMask)
+			{
+				nodeIdx = node._offset + (leftMask ? 0 : 1);
+				mask = leftMask | rightMask;
+				continue;
+			}
+		}
+
+		// Pop nodes until one of them is reached by some ray before its current hit
+		do
+		{
+			if (!stackSize) return;
+
+			--stackSize;
+			mask = intersect(_nodes[nodeStack[stackSize]], packet, distance) & maskStack[stackSize];
+		} while (!mask);
+
+		nodeIdx = nodeStack[stackSize];
+	}
+}
+
+float TriangleBVH::halfArea(const vec3& min, const vec3& max)
+{
+	const vec3 size = max - min;
+
+	return size.x * size.y + size.y * size.z + size.z * size.x;
+}
+
+bool TriangleBVH::intersect(const Node& node, const vec3& origin, const vec3& inverseDirection, const float maxDistance, float& distance)
+{
+	const vec3 t0 = (node._min - origin) * inverseDirection, t1 = (node._max - origin) * inverseDirection;
+	const vec3 tMin = glm::min(t0, t1), tMax = glm::max(t0, t1);
+
+	distance = (std::max)((std::max)(tMin.x, tMin.y), (std::max)(tMin.z, .0f));
+
+	return distance <= (std::min)((std::min)(tMax.x, tMax.y), (std::min)(tMax.z, maxDistance));
+}
+
+bool TriangleBVH::intersect(const Triangle& triangle, const vec3& origin, const vec3& direction, float& distance)
+{
+	const vec3 h = glm::cross(direction, triangle._edge2);
+	const float a = glm::dot(triangle._edge1, h);
+
+	if (BasicOperations::equal(a, 0.0f))												// Parallel ray case
+	{
+		return false;
+	}
+
+	const float f = 1.0f / a;
+	const vec3 s = origin - triangle._v0;
+	const float u = f * glm::dot(s, h);
+
+	if (u < 0.0f || u > 1.0f)
+	{
+		return false;
+	}
+
+	const vec3 q = glm::cross(s, triangle._edge1);
+	const float v = f * glm::dot(direction, q);
+
+	if (v < 0.0f || (u + v) > 1.0f)
+	{
+		return false;
+	}
+
+	distance = f * glm::dot(triangle._edge2, q);
+
+	return distance > glm::epsilon<float>();
+}
+
+unsigned TriangleBVH::intersect(const Node& node, const RayPacket& packet, float* distance)
+{
+	float nearPlane[3], farPlane[3];
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		nearPlane[axis] = packet._octant[axis] ? node._max[axis] : node._min[axis];
+		farPlane[axis] = packet._octant[axis] ? node._min[axis] : node._max[axis];
+	}
+
+#ifdef __AVX2__
+	__m256 tMin = _mm256_setzero_ps(), tMax = _mm256_load_ps(packet._distance);
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		const __m256 origin = _mm256_load_ps(packet._origin[axis]), inverseDirection = _mm256_load_ps(packet._inverseDirection[axis]);
+
+		tMin = _mm256_max_ps(tMin, _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(nearPlane[axis]), origin), inverseDirection));
+		tMax = _mm256_min_ps(tMax, _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(farPlane[axis]), origin), inverseDirection));
+	}
+
+	_mm256_storeu_ps(distance, tMin);
+
+	return unsigned(_mm256_movemask_ps(_mm256_cmp_ps(tMin, tMax, _CMP_LE_OQ))) & packet._activeMask;
+#else
+	unsigned mask = 0;
+
+	for (unsigned lane = 0; lane < PACKET_SIZE; ++lane)
+	{
+		float tMin = .0f, tMax = packet._distance[lane];
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			tMin = (std::max)(tMin, (nearPlane[axis] - packet._origin[axis][lane]) * packet._inverseDirection[axis][lane]);
+			tMax = (std::min)(tMax, (farPlane[axis] - packet._origin[axis][lane]) * packet._inverseDirection[axis][lane]);
+		}
+
+		distance[lane] = tMin;
+		mask |= unsigned(tMin <= tMax) << lane;
+	}
+
+	return mask & packet._activeMask;
+#endif
+}
+
+void TriangleBVH::intersect(const Triangle& triangle, const unsigned triangleIdx, const unsigned mask, RayPacket& packet)
+{
+#ifdef __AVX2__
+	const __m256 edge1X = _mm256_set1_ps(triangle._edge1.x), edge1Y = _mm256_set1_ps(triangle._edge1.y), edge1Z = _mm256_set1_ps(triangle._edge1.z);
+	const __m256 edge2X = _mm256_set1_ps(triangle._edge2.x), edge2Y = _mm256_set1_ps(triangle._edge2.y), edge2Z = _mm256_set1_ps(triangle._edge2.z);
+	const __m256 directionX = _mm256_load_ps(packet._direction[0]), directionY = _mm256_load_ps(packet._direction[1]), directionZ = _mm256_load_ps(packet._direction[2]);
+	const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f), epsilon = _mm256_set1_ps(glm::epsilon<float>());
+
+	// h = direction x edge2, a = dot(edge1, h)
+	const __m256 hX = _mm256_sub_ps(_mm256_mul_ps(directionY, edge2Z), _mm256_mul_ps(directionZ, edge2Y));
+	const __m256 hY = _mm256_sub_ps(_mm256_mul_ps(directionZ, edge2X), _mm256_mul_ps(directionX, edge2Z));
+	const __m256 hZ = _mm256_sub_ps(_mm256_mul_ps(directionX, edge2Y), _mm256_mul_ps(directionY, edge2X));
+	const __m256 a = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(edge1X, hX), _mm256_mul_ps(edge1Y, hY)), _mm256_mul_ps(edge1Z, hZ));
+	const __m256 f = _mm256_div_ps(one, a);
+
+	// s = origin - v0, u = f * dot(s, h)
+	const __m256 sX = _mm256_sub_ps(_mm256_load_ps(packet._origin[0]), _mm256_set1_ps(triangle._v0.x));
+	const __m256 sY = _mm256_sub_ps(_mm256_load_ps(packet._origin[1]), _mm256_set1_ps(triangle._v0.y));
+	const __m256 sZ = _mm256_sub_ps(_mm256_load_ps(packet._origin[2]), _mm256_set1_ps(triangle._v0.z));
+	const __m256 u = _mm256_mul_ps(f, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(sX, hX), _mm256_mul_ps(sY, hY)), _mm256_mul_ps(sZ, hZ)));
+
+	// q = s x edge1, v = f * dot(direction, q), t = f * dot(edge2, q)
+	const __m256 qX = _mm256_sub_ps(_mm256_mul_ps(sY, edge1Z), _mm256_mul_ps(sZ, edge1Y));
+	const __m256 qY = _mm256_sub_ps(_mm256_mul_ps(sZ, edge1X), _mm256_mul_ps(sX, edge1Z));
+	const __m256 qZ = _mm256_sub_ps(_mm256_mul_ps(sX, edge1Y), _mm256_mul_ps(sY, edge1X));
+	const __m256 v = _mm256_mul_ps(f, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(directionX, qX), _mm256_mul_ps(directionY, qY)), _mm256_mul_ps(directionZ, qZ)));
+	const __m256 t = _mm256_mul_ps(f, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(edge2X, qX), _mm256_mul_ps(edge2Y, qY)), _mm256_mul_ps(edge2Z, qZ)));
+
+	__m256 valid = _mm256_cmp_ps(_mm256_andnot_ps(_mm256_set1_ps(-.0f), a), epsilon, _CMP_GE_OQ);		// Parallel ray case
+	valid = _mm256_and_ps(valid, _mm256_cmp_ps(u, zero, _CMP_GE_OQ));
+	valid = _mm256_and_ps(valid, _mm256_cmp_ps(v, zero, _CMP_GE_OQ));
+	valid = _mm256_and_ps(valid, _mm256_cmp_ps(_mm256_add_ps(u, v), one, _CMP_LE_OQ));
+	valid = _mm256_and_ps(valid, _mm256_cmp_ps(t, epsilon, _CMP_GT_OQ));
+	valid = _mm256_and_ps(valid, _mm256_cmp_ps(t, _mm256_load_ps(packet._distance), _CMP_LT_OQ));
+
+	const unsigned hitMask = unsigned(_mm256_movemask_ps(valid)) & mask;
+	if (!hitMask) return;
+
+	float distance[PACKET_SIZE];
+	_mm256_storeu_ps(distance, t);
+
+	for (unsigned lane = 0; lane < PACKET_SIZE; ++lane)
+	{
+		if (hitMask & (1u << lane))
+		{
+			packet._distance[lane] = distance[lane];
+			packet._triangle[lane] = triangleIdx;
+		}
+	}
+#else
+	float distance;
+
+	for (unsigned lane = 0; lane < PACKET_SIZE; ++lane)
+	{
+		if (!(mask & (1u << lane))) continue;
+
+		const vec3 origin(packet._origin[0][lane], packet._origin[1][lane], packet._origin[2][lane]);
+		const vec3 direction(packet._direction[0][lane], packet._direction[1][lane], packet._direction[2][lane]);
+
+		if (intersect(triangle, origin, direction, distance) && distance < packet._distance[lane])
+		{
+			packet._distance[lane] = distance;
+			packet._triangle[lane] = triangleIdx;
+		}
+	}
+#endif
+}
+
+float TriangleBVH::sqrDistance(const Node& node, const vec3& point)
+{
+	const vec3 offset = glm::max(glm::max(node._min - point, point - node._max), vec3(.0f));
+
+	return glm::dot(offset, offset);
+}
+
+void TriangleBVH::traverseAll(const vec3& origin, const vec3& direction, const std::function<void(const unsigned, const float)>& callback) const
+{
+	if (_nodes.empty()) return;
+
+	const vec3 inverseDirection = getInverseDirection(direction);
+	unsigned nodeStack[STACK_SIZE];
+	unsigned stackSize = 0;
+	float distance;
+
+	nodeStack[stackSize++] = 0;
+
+	while (stackSize)
+	{
+		const Node& node = _nodes[nodeStack[--stackSize]];
+
+		if (!intersect(node, origin, inverseDirection, FLT_MAX, distance)) continue;
+
+		if (node._count)
+		{
+			for (unsigned triangleIdx = node._offset; triangleIdx < node._offset + node._count; ++triangleIdx)
+			{
+				if (intersect(_triangles[triangleIdx], origin, direction, distance)) callback(triangleIdx, distance);
+			}
+		}
+		else
+		{
+			nodeStack[stackSize++] = node._offset + 1;
+			nodeStack[stackSize++] = node._offset;
+		}
+	}
+}
@@ -0,0 +1,258 @@
+#pragma once
+
+#include <atomic>
+
+#include "Geometry/3D/AABB.h"
+#include "Geometry/3D/Ray3D.h"
+
+/**
+*	@file TriangleBVH.h
+*	@authors Alfonso Lpez Ruiz (alr00048@red.ujaen.es)
+*	@date 19/10/2026
+*/
+
+/**
+*	@brief Bounding volume hierarchy over a set of triangles, built with binned SAH. Nodes are stored in a flat array where
+*	both children of a node are consecutive, so the traversal only needs the index of the first one. Batches of rays are traversed in
+*	packets of PACKET_SIZE rays, using AVX2 when available. Nearest-triangle queries from points share the same hierarchy.
+*/
+class TriangleBVH
+{
+public:
+	const static unsigned NOT_FOUND;											//!< Triangle index of an empty hit
+	constexpr static unsigned PACKET_SIZE = 8;									//!< Rays traversed together, one per AVX2 lane
+
+	struct Hit
+	{
+		float		_distance;													//!< Distance from the ray origin or query point
+		vec3		_point;														//!< Intersection point, or closest point of the triangle
+		unsigned	_triangle;													//!< Index of the triangle in the input array
+	};
+
+	struct Node
+	{
+		vec3		_min;														//!< Minimum corner of the node boundaries
+		unsigned	_offset;													//!< First triangle of a leaf, or first child of an inner node
+		vec3		_max;														//!< Maximum corner of the node boundaries
+		unsigned	_count;														//!< Number of triangles of a leaf, zero for inner nodes
+	};
+
+protected:
+	const static unsigned	COHERENT_BLOCK_SIZE;								//!< Consecutive points solved by the same task, each one bounding the search of the next
+	const static unsigned	MAX_DEPTH;											//!< Deeper ranges are turned into leaves, so the traversal stack cannot overflow
+	const static unsigned	MAX_LEAF_SIZE;										//!< Ranges of this size can become leaves if splitting them is not worth it
+	const static unsigned	NUM_BINS;											//!< Number of bins per axis when evaluating the SAH
+	const static unsigned	PARALLEL_THRESHOLD;									//!< Minimum number of triangles of a range to be built in a separate task
+	const static unsigned	STACK_SIZE;											//!< Size of the traversal stack
+	const static float		TRAVERSAL_COST;										//!< Cost of visiting a node relative to a ray-triangle test
+
+protected:
+	enum Feature
+	{
+		VERTEX_A, VERTEX_B, VERTEX_C, EDGE_AB, EDGE_BC, EDGE_CA, FACE
+	};
+
+	struct Triangle
+	{
+		vec3		_v0, _edge1, _edge2;										//!< First vertex and both edges from it, as needed by the Mller-Trumbore test
+	};
+
+	struct PseudoNormals
+	{
+		vec3		_normal[FACE + 1];											//!< Angle-weighted normal of every feature of a triangle, indexed by Feature
+	};
+
+	struct BuildData
+	{
+		std::vector<vec3>	_min, _max, _centroid;								//!< Boundaries and centroid of every triangle
+	};
+
+	struct alignas(32) RayPacket
+	{
+		float		_origin[3][PACKET_SIZE];									//!< Ray origins, one array per axis
+		float		_direction[3][PACKET_SIZE];									//!< Normalized ray directions
+		float		_inverseDirection[3][PACKET_SIZE];							//!< Inverse directions for the slab test
+		float		_distance[PACKET_SIZE];										//!< Distance to the closest hit so far
+		unsigned	_triangle[PACKET_SIZE];										//!< Sorted index of the closest triangle so far
+		unsigned	_octant[3];													//!< Direction sign shared by every ray, 1 if negative
+		unsigned	_activeMask;												//!< Lanes with a ray, the last packet may be incomplete
+	};
+
+protected:
+	std::vector<Node>			_nodes;											//!< Hierarchy, the root is the first node
+	std::vector<PseudoNormals>	_pseudoNormals;									//!< Normals of the features of every sorted triangle, giving the sign of distances
+	std::vector<Triangle>		_triangles;										//!< Triangles sorted by leaf
+	std::vector<unsigned>		_triangleIndex;									//!< Index of every sorted triangle in the input array
+
+protected:
+	/**
+	*	@brief Recursively builds the node for the range [begin, end) of triangles. Children are allocated in pairs from nodeCounter.
+	*/
+	void build(const unsigned nodeIdx, const unsigned begin, const unsigned end, const BuildData& buildData, std::atomic<unsigned>& nodeCounter, const unsigned depth, const unsigned parallelDepth);
+
+	/**
+	*	@brief Computes the angle-weighted pseudo-normals of Brentzen and Aans for the vertices, edges and faces of every triangle. Vertices
+	*	are welded by position, so triangles sharing a corner in the soup share its pseudo-normal.
+	*/
+	void buildPseudoNormals(const std::vector<vec3>& vertices);
+
+	/**
+	*	@return Point of a triangle closest to the given point, classifying it into the Voronoi regions of the triangle as described by Ericson.
+	*/
+	static vec3 closestPoint(const Triangle& triangle, const vec3& point) { Feature feature; return closestPoint(triangle, point, feature); }
+
+	/**
+	*	@brief Variant of closestPoint() which also retrieves the feature of the triangle where the closest point lies.
+	*/
+	static vec3 closestPoint(const Triangle& triangle, const vec3& point, Feature& feature);
+
+	/**
+	*	@brief Searches the triangle nearest to a point, skipping nodes which are further than the current candidate.
+	*	@param triangleIdx Sorted index of the current candidate, or NOT_FOUND.
+	*	@param sqrDistance Squared distance to the current candidate, or to the search limit if there is none. Updated if a nearer triangle is found.
+	*	@param closest Closest point of the current candidate, updated along with sqrDistance.
+	*	@return Sorted index of the nearest triangle.
+	*/
+	unsigned closestTriangle(const vec3& point, unsigned triangleIdx, float& sqrDistance, vec3& closest) const;
+
+	/**
+	*	@return Inverse direction of a ray, avoiding infinite values for axis-aligned directions.
+	*/
+	static vec3 getInverseDirection(const vec3& direction);
+
+	/**
+	*	@return Half of the surface area of a box, enough to compare SAH costs.
+	*/
+	static float halfArea(const vec3& min, const vec3& max);
+
+	/**
+	*	@brief Slab test between a ray and a node.
+	*	@param distance Entry distance of the ray, if any.
+	*/
+	static bool intersect(const Node& node, const vec3& origin, const vec3& inverseDirection, const float maxDistance, float& distance);
+
+	/**
+	*	@brief Mller-Trumbore test between a ray and a triangle. Hits behind the origin are discarded, as in Intersections3D.
+	*/
+	static bool intersect(const Triangle& triangle, const vec3& origin, const vec3& direction, float& distance);
+
+	/**
+	*	@brief Slab test between a packet and a node. Every ray shares the same direction octant, so the near and far planes of each axis
+	*	are the same for the whole packet, as in the ray classification of EisemannRay.
+	*	@param distance Entry distance of every ray.
+	*	@return Mask of the rays which reach the node before their closest hit.
+	*/
+	static unsigned intersect(const Node& node, const RayPacket& packet, float* distance);
+
+	/**
+	*	@brief Mller-Trumbore test between the rays of a packet in mask and a triangle. Closer hits replace the current ones.
+	*/
+	static void intersect(const Triangle& triangle, const unsigned triangleIdx, const unsigned mask, RayPacket& packet);
+
+	/**
+	*	@return Squared distance from a point to the boundaries of a node, zero if the point is inside.
+	*/
+	static float sqrDistance(const Node& node, const vec3& point);
+
+	/**
+	*	@brief Retrieves the nearest triangle of every ray of a coherent packet, traversing the hierarchy once for the whole packet.
+	*/
+	void closestHit(RayPacket& packet) const;
+
+	/**
+	*	@brief Visits every triangle intersected by a ray, in no particular order.
+	*/
+	void traverseAll(const vec3& origin, const vec3& direction, const std::function<void(const unsigned, const float)>& callback) const;
+
+public:
+	/**
+	*	@brief Default constructor. The hierarchy is empty until it is built.
+	*/
+	TriangleBVH();
+
+	/**
+	*	@brief Destructor.
+	*/
+	virtual ~TriangleBVH();
+
+	/**
+	*	@brief Builds the hierarchy from a triangle soup, where every three consecutive vertices are a triangle.
+	*/
+	void build(const std::vector<vec3>& vertices);
+
+	/**
+	*	@brief Removes the hierarchy.
+	*/
+	void clear();
+
+	/**
+	*	@return True if the hierarchy has been built and can be queried.
+	*/
+	bool isBuilt() const { return !_nodes.empty(); }
+
+	// ------------ Queries ------------
+
+	/**
+	*	@brief Retrieves every triangle intersected by a ray, sorted by distance.
+	*/
+	void allHits(const vec3& origin, const vec3& direction, std::vector<Hit>& hits) const;
+
+	/**
+	*	@brief Retrieves the triangle nearest to the ray origin.
+	*	@param maxDistance Intersections further than this distance are ignored.
+	*	@return False if the ray does not hit any triangle.
+	*/
+	bool closestHit(const vec3& origin, const vec3& direction, Hit& hit, const float maxDistance = FLT_MAX) const;
+
+	/**
+	*	@brief Retrieves the triangle nearest to a point.
+	*	@param maxDistance Triangles further than this distance are ignored.
+	*	@return False if there is no triangle within maxDistance.
+	*/
+	bool closestPoint(const vec3& point, Hit& hit, const float maxDistance = FLT_MAX) const;
+
+	/**
+	*	@return Number of triangles intersected by a ray.
+	*/
+	unsigned countHits(const vec3& origin, const vec3& direction) const;
+
+	/**
+	*	@brief Retrieves the nearest triangle of a batch of rays. Consecutive rays are grouped in packets of PACKET_SIZE, so neighbouring rays
+	*	(e.g. pixels of a tile) should be consecutive. Packets whose directions lie in the same octant traverse the hierarchy together,
+	*	whereas divergent packets are solved ray by ray.
+	*	@param hits One hit per ray, with NOT_FOUND as triangle if the ray misses the mesh.
+	*	@param maxDistance Intersections further than this distance are ignored.
+	*/
+	void intersect(const std::vector<Ray3D>& rays, std::vector<Hit>& hits, const float maxDistance = FLT_MAX) const;
+
+	/**
+	*	@brief Computes the signed distance from a batch of points to a closed mesh with consistent winding. The sign is given by the
+	*	angle-weighted pseudo-normal of the face, edge or vertex where the closest point lies, which is correct near sharp features too.
+	*	Consecutive points are solved by the same task and the triangle found for a point bounds the search of the next one, hence spatially
+	*	coherent inputs (e.g. scans) are much faster than shuffled ones.
+	*	@param points First point, followed by the rest every stride bytes.
+	*	@param maxDistance Points without any triangle within this distance are given -maxDistance or maxDistance, depending on the parity
+	*	of the number of triangles hit by a ray from them.
+	*/
+	void signedDistance(const void* points, const size_t numPoints, const size_t stride, std::vector<float>& distances, const float maxDistance = FLT_MAX) const;
+
+	/**
+	*	@brief Measures and prints the throughput of batched queries in rays per second. Primary rays of a pinhole camera looking at the
+	*	hierarchy are traced in tile order (coherent packets), shuffled (divergent packets) and one by one.
+	*	@param resolution Width and height of the virtual image.
+	*/
+	void benchmark(const unsigned resolution = 1024, const unsigned numIterations = 5) const;
+
+	// ------------ Getters ------------
+
+	/**
+	*	@return Flat array of nodes.
+	*/
+	const std::vector<Node>& getNodes() const { return _nodes; }
+
+	/**
+	*	@return Number of indexed triangles.
+	*/
+	size_t getNumTriangles() const { return _triangles.size(); }
+};
+
@@ -2,6 +2,7 @@
 #include "TriangleMesh.h"
 
 #include "Geometry/3D/Intersections3D.h"
+#include "Geometry/3D/OBJParser.h"
 #include "Utilities/ChronoUtilities.h"
 
 /// [Public methods]
@@ -27,17 +28,27 @@ TriangleMesh::~TriangleMesh()
 {
 }
 
-void TriangleMesh::classify(Plane& plane)
+void TriangleMesh::classify(const Plane& plane, MeshSlicer::PolylineSet& section) const
 {
-	Face::FacePlaneRelation relation;				// Data for each iteration
-	Segment3D segment;
-	vec3 point;
+	std::vector<MeshSlicer::PolylineSet> sections;
+	this->slice(MeshSlicer::PlaneFamily(plane.getPoint(.0f, .0f), plane.normal(), 1.0f, 1), sections);
 
-	for (int i = 0; i < _face.size(); ++i)
+	section = std::move(sections.front());
+}
+
+bool TriangleMesh::closestHit(Ray3D& ray, vec3& point, unsigned& faceIndex)
+{
+	TriangleBVH::Hit hit;
+
+	if (!this->getBVH()->closestHit(ray.getOrigin(), ray.getDirection(), hit))
 	{
-		Triangle3D triangle = _face[i]._triangle;
-		Intersections3D::intersect(triangle, plane, relation, segment, point);
+		return false;
 	}
+
+	point = hit._point;
+	faceIndex = hit._triangle;
+
+	return true;
 }
 
 void TriangleMesh::computeTangents()
@@ -82,6 +93,21 @@ void TriangleMesh::computeTangents()
 	delete[] tan1;
 }
 
+const TriangleBVH* TriangleMesh::getBVH()
+{
+	std::lock_guard<std::mutex> lock(_bvhMutex);
+
+	if (!_bvh.isBuilt() && !_face.empty())
+	{
+		std::vector<vec3> vertices;
+		this->getTriangleSoup(vertices);
+
+		_bvh.build(vertices);
+	}
+
+	return &_bvh;
+}
+
 vec3 TriangleMesh::getVertex(int i) const
 {
 	return (i < _position.size()) ? _position[i] : vec3();
@@ -99,43 +125,24 @@ TriangleMesh& TriangleMesh::operator=(const TriangleMesh& mesh)
 
 bool TriangleMesh::pointInMesh(const vec3& point)
 {
-	Ray3D ray_01(point, point + vec3(0.0f, 1.0f, 0.0f));
-	Ray3D ray_02(point, point + vec3(1.0f, 0.0f, 0.0f));
-	Ray3D ray_03(point, point + vec3(0.0f, 0.0f, 1.0f));
-	std::vector<Triangle3D> triangle;
-	std::vector<vec3> points;
+	const TriangleBVH* bvh = this->getBVH();
 
 	int oddIntersections = 0;
-	rayTraversalExh(ray_01, points, triangle);
-	if (triangle.size() % 2 == 1) ++oddIntersections;
-	triangle.clear();
-	points.clear();
-
-	rayTraversalExh(ray_02, points, triangle);
-	if (triangle.size() % 2 == 1) ++oddIntersections;
+	if (bvh->countHits(point, vec3(0.0f, 1.0f, 0.0f)) % 2 == 1) ++oddIntersections;
+	if (bvh->countHits(point, vec3(1.0f, 0.0f, 0.0f)) % 2 == 1) ++oddIntersections;
 
 	if (oddIntersections == 1)					// Odd number of intersections, throw a third one to break the question
 	{
-		triangle.clear();
-		points.clear();
-
-		rayTraversalExh(ray_03, points, triangle);
-		if (!(triangle.size() % 2 == 1))
-		{
-			return false;
-		}
-	}
-	else if (oddIntersections == 0)				// No intersections
-	{
-		return false;
+		return bvh->countHits(point, vec3(0.0f, 0.0f, 1.0f)) % 2 == 1;
 	}
 
-	return true;
+	return oddIntersections == 2;
 }
 
 Triangle3D* TriangleMesh::pushBackFace(const unsigned i1, const unsigned i2, const unsigned i3)
 {
 	_face.push_back(Face(i1, i2, i3, this));
+	_bvh.clear();
 
 	return &_face[_face.size() - 1]._triangle;
 }
@@ -148,27 +155,80 @@ size_t TriangleMesh::pushBackVertex(const vec3& position, const vec3& normal, co
 	_tangent.push_back(tangent);
 
 	this->_aabb.update(position);
+	_bvh.clear();
 
 	return _position.size() - 1;
 }
 
 bool TriangleMesh::rayTraversalExh(Ray3D& ray, std::vector<vec3>& point, std::vector<Triangle3D>& triangle)
 {
-	for (int i = 0; i < _face.size(); ++i)
+	std::vector<TriangleBVH::Hit> hits;
+	this->getBVH()->allHits(ray.getOrigin(), ray.getDirection(), hits);
+
+	for (const TriangleBVH::Hit& hit : hits)
 	{
-		Triangle3D tri(_position[_face[i].getVertexIndex(0)], _position[_face[i].getVertexIndex(1)], _position[_face[i].getVertexIndex(2)]);
-		vec3 intersection;
+		const Face& face = _face[hit._triangle];
 
-		if (Intersections3D::intersect(tri, ray, intersection))
-		{
-			triangle.push_back(tri);
-			point.push_back(intersection);
-		}
+		triangle.push_back(Triangle3D(_position[face._index[0]], _position[face._index[1]], _position[face._index[2]]));
+		point.push_back(hit._point);
 	}
 
 	return point.size() > 0;
 }
 
+void TriangleMesh::setGeometry(const std::vector<vec3>& position, std::vector<vec3>&& normal, std::vector<vec2>&& textCoord, const std::vector<unsigned>& index)
+{
+	_position.resize(position.size());
+	std::transform(std::execution::par_unseq, position.begin(), position.end(), _position.begin(), [](const vec3& point) { return vec4(point, 1.0f); });
+
+	_normal = std::move(normal);
+	_textCoord = std::move(textCoord);
+	_tangent.clear();
+
+	_aabb = AABB();
+	for (const vec3& point : position) _aabb.update(point);
+
+	// Faces are built in parallel once every vertex is available, since they keep a copy of their triangle
+	_face.clear();
+	_face.resize(index.size() / 3, Face(this));
+
+	std::for_each(std::execution::par_unseq, _face.begin(), _face.end(), [&](Face& face)
+		{
+			const size_t faceIdx = &face - _face.data();
+
+			face.setIndexes(index[faceIdx * 3 + 0], index[faceIdx * 3 + 1], index[faceIdx * 3 + 2]);
+		});
+
+	_bvh.clear();
+}
+
+void TriangleMesh::signedDistance(const void* points, const size_t numPoints, const size_t stride, std::vector<float>& distances, const float maxDistance)
+{
+	this->getBVH()->signedDistance(points, numPoints, stride, distances, maxDistance);
+}
+
+void TriangleMesh::slice(const MeshSlicer::PlaneFamily& planes, std::vector<MeshSlicer::PolylineSet>& sections) const
+{
+	std::vector<vec3> vertices(_position.size());
+	std::vector<unsigned> indices(_face.size() * 3);
+
+	std::transform(std::execution::par_unseq, _position.begin(), _position.end(), vertices.begin(), [](const vec4& position) { return vec3(position); });
+	std::for_each(std::execution::par_unseq, _face.begin(), _face.end(), [&](const Face& face)
+		{
+			std::copy(face._index, face._index + 3, &indices[(&face - _face.data()) * 3]);
+		});
+
+	MeshSlicer::slice(vertices, indices, planes, sections);
+}
+
+void TriangleMesh::voxelize(SparseVoxelGrid& grid) const
+{
+	std::vector<vec3> vertices;
+	this->getTriangleSoup(vertices);
+
+	grid.voxelize(vertices);
+}
+
 /// [Protected methods]
 
 void TriangleMesh::copyAttributes(const TriangleMesh& mesh)
@@ -180,6 +240,7 @@ void TriangleMesh::copyAttributes(const TriangleMesh& mesh)
 	this->_face			= mesh._face;
 
 	this->_aabb			= mesh._aabb;
+	this->_bvh.clear();													// Rebuilt on demand for this mesh
 
 	for (int i = 0; i < _face.size(); ++i)
 	{
@@ -187,83 +248,29 @@ void TriangleMesh::copyAttributes(const TriangleMesh& mesh)
 	}
 }
 
-bool TriangleMesh::loadOBJ(const std::string& filename)
+void TriangleMesh::getTriangleSoup(std::vector<vec3>& vertices) const
 {
-	FILE* file = nullptr; errno_t error;
-
-	if ((error = fopen_s(&file, filename.c_str(), "r")) != 0)
-	{
-		std::cout << "The file could not be opened!" << std::endl;
+	vertices.resize(_face.size() * 3);
 
-		return false;
-	}
-
-	std::vector<glm::vec3> tempNormals;						// Temporal data for the loading process
-	std::vector<glm::vec2> tempTextures;
-	vec3 normal;
-	vec2 textCoord;
-
-	int result;
-	char lineHeader[128];
-	unsigned int incorrectPrimitives = 0;
-
-	while ((result = fscanf_s(file, "%s", lineHeader, sizeof(lineHeader))) != EOF)				// Type of geometry we are receiving
-	{
-		if (strcmp(lineHeader, "v") == 0)					// Vertex
+	std::for_each(std::execution::par_unseq, _face.begin(), _face.end(), [&](const Face& face)
 		{
-			vec3 vertex;
-			fscanf_s(file, "%f %f %f\n", &vertex.x, &vertex.y, &vertex.z);
+			const size_t faceIdx = &face - _face.data();
 
-			_position.push_back(vec4(vertex, 1.0f));
-			_normal.resize(_position.size());
-			_textCoord.resize(_position.size());
-
-			_aabb.update(vertex);
-		}
-		else if (strcmp(lineHeader, "vt") == 0)				// Texture coordinate
-		{
-			fscanf_s(file, "%f %f\n", &textCoord.x, &textCoord.y);
-
-			tempTextures.push_back(textCoord);
-		}
-		else if (strcmp(lineHeader, "vn") == 0)				// Normal
-		{
-			fscanf_s(file, "%f %f %f\n", &normal.x, &normal.y, &normal.z);
-
-			tempNormals.push_back(normal);
-		}
-		else if (strcmp(lineHeader, "f") == 0)				// Triangle mesh face indices
-		{
-			std::string vertex1, vertex2, vertex3;
-			unsigned int vertexIndex[3], textureIndex[3], normalIndex[3];
-			int matches = fscanf_s(file, "%d/%d/%d %d/%d/%d %d/%d/%d\n",
-				&vertexIndex[0], &textureIndex[0], &normalIndex[0],
-				&vertexIndex[1], &textureIndex[1], &normalIndex[1],
-				&vertexIndex[2], &textureIndex[2], &normalIndex[2]);
-
-			if (matches != 9) {
-				++incorrectPrimitives;
-			}
-
-			_face.push_back(Face(vertexIndex[0] - 1, vertexIndex[1] - 1, vertexIndex[2] - 1, this));
-
-			_normal[vertexIndex[0] - 1] = tempNormals[normalIndex[0] - 1];
-			_normal[vertexIndex[1] - 1] = tempNormals[normalIndex[1] - 1];
-			_normal[vertexIndex[2] - 1] = tempNormals[normalIndex[2] - 1];
-
-			_textCoord[vertexIndex[0] - 1] = tempTextures[textureIndex[0] - 1];
-			_textCoord[vertexIndex[1] - 1] = tempTextures[textureIndex[1] - 1];
-			_textCoord[vertexIndex[2] - 1] = tempTextures[textureIndex[2] - 1];
-		}
-	}
+			for (int i = 0; i < 3; ++i) vertices[faceIdx * 3 + i] = vec3(_position[face._index[i]]);
+		});
+}
 
-	fclose(file);
+bool TriangleMesh::loadOBJ(const std::string& filename)
+{
+	OBJParser::MeshData mesh;
 
-	if (incorrectPrimitives > 0)
+	if (!OBJParser::load(filename, mesh))
 	{
-		std::cout << incorrectPrimitives << " primitives were not a triangle!" << std::endl;
+		return false;
 	}
 
+	this->setGeometry(mesh._position, std::move(mesh._normal), std::move(mesh._textCoord), mesh._index);
+
 	return true;
 }
 
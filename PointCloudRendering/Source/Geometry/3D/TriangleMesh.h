@@ -1,9 +1,14 @@
 #pragma once
 
+#include <mutex>
+
 #include "Geometry/3D/AABB.h"
+#include "Geometry/3D/MeshSlicer.h"
 #include "Geometry/3D/Plane.h"
 #include "Geometry/3D/Ray3D.h"
+#include "Geometry/3D/SparseVoxelGrid.h"
 #include "Geometry/3D/Triangle3D.h"
+#include "Geometry/3D/TriangleBVH.h"
 
 /**
 *	@file Triangle3D.h
@@ -16,6 +21,7 @@
 */
 class TriangleMesh
 {
+	friend class DrawMesh;
 	friend class Model3D;
 	friend class ModelOBJ;
 	friend class PlanarSurface;
@@ -36,6 +42,8 @@ protected:
 
 	// [Spatial data]
 	AABB				_aabb;									//!< Axis-aligned bounding box
+	TriangleBVH			_bvh;									//!< Hierarchy of faces for ray queries, built on demand
+	std::mutex			_bvhMutex;								//!< Prevents concurrent queries from building the hierarchy twice
 
 protected:
 	/**
@@ -43,6 +51,11 @@ protected:
 	*/
 	void copyAttributes(const TriangleMesh& mesh);
 
+	/**
+	*	@brief Gathers the vertices of every face, so that every three consecutive vertices are a triangle.
+	*/
+	void getTriangleSoup(std::vector<vec3>& vertices) const;
+
 	/**
 	*	@brief Reads an obj file to load its data into a triangle mesh.
 	*/
@@ -75,15 +88,28 @@ public:
 	AABB aabb() const { return _aabb; }
 
 	/**
-	*	@brief Classifies the plane taking into account its relative position to the triangle mesh.
+	*	@brief Intersects the mesh with a plane.
+	*	@param section Polylines where the plane cuts the mesh.
 	*/
-	void classify(Plane& plane);
+	void classify(const Plane& plane, MeshSlicer::PolylineSet& section) const;
+
+	/**
+	*	@brief Finds the face nearest to the ray origin.
+	*	@param point Intersection point, if any.
+	*	@param faceIndex Index of the intersected face, if any.
+	*/
+	bool closestHit(Ray3D& ray, vec3& point, unsigned& faceIndex);
 
 	/**
 	*	@brief Computes tangents for every point of the triangle mesh, since it's never included by default.
 	*/
 	void computeTangents();
 
+	/**
+	*	@return Hierarchy of faces. It is built on the first request and rebuilt after the mesh topology changes.
+	*/
+	const TriangleBVH* getBVH();
+
 	/**
 	*	@return Number of faces of the mesh.
 	*/
@@ -105,7 +131,7 @@ public:
 	TriangleMesh& operator=(const TriangleMesh& mesh);
 
 	/**
-	*	@brief Checks if a point is inside the triangle mesh with an exhaustive method.
+	*	@brief Checks if a point is inside the triangle mesh by counting the faces crossed by axis-aligned rays.
 	*/
 	bool pointInMesh(const vec3& point);
 
@@ -122,9 +148,33 @@ public:
 	size_t pushBackVertex(const vec3& position, const vec3& normal, const vec2& textCoord = vec2(1.0f), const vec3& tangent = vec3(1.0f));
 
 	/**
-	*	@brief Calculates (exhaustively) all the triangles the given ray intersects.
+	*	@brief Calculates all the triangles the given ray intersects, sorted by distance.
 	*/
 	bool rayTraversalExh(Ray3D& ray, std::vector<vec3>& point, std::vector<Triangle3D>& triangle);
+
+	/**
+	*	@brief Replaces the whole geometry and topology of the mesh.
+	*	@param index Three vertices per triangle.
+	*/
+	void setGeometry(const std::vector<vec3>& position, std::vector<vec3>&& normal, std::vector<vec2>&& textCoord, const std::vector<unsigned>& index);
+
+	/**
+	*	@brief Computes the distance from every point to the mesh, negative behind the nearest face according to its winding.
+	*	@param points First point, followed by the rest every stride bytes.
+	*	@param maxDistance Points further than this distance from every face are given maxDistance.
+	*/
+	void signedDistance(const void* points, const size_t numPoints, const size_t stride, std::vector<float>& distances, const float maxDistance = FLT_MAX);
+
+	/**
+	*	@brief Intersects the mesh with a family of parallel planes, e.g. cross-sections along a tunnel axis.
+	*	@param sections Polylines of every plane.
+	*/
+	void slice(const MeshSlicer::PlaneFamily& planes, std::vector<MeshSlicer::PolylineSet>& sections) const;
+
+	/**
+	*	@brief Marks the voxels of a grid which are overlapped by the mesh faces.
+	*/
+	void voxelize(SparseVoxelGrid& grid) const;
 };
 
 class TriangleMesh::Face 
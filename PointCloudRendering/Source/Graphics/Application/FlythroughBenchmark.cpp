@@ -0,0 +1,212 @@
+#include "stdafx.h"
+#include "FlythroughBenchmark.h"
+
+#include "Graphics/Application/PointCloudScene.h"
+#include "Graphics/Application/Renderer.h"
+#include "Utilities/ChronoUtilities.h"
+#include "Utilities/MemoryTracker.h"
+
+// [Static members initialization]
+
+const unsigned FlythroughBenchmark::NUM_QUERIES = 4;
+const std::vector<float> FlythroughBenchmark::PERCENTILES = { 1.0f, 5.0f, 50.0f, 95.0f, 99.0f };
+
+/// [Public methods]
+
+FlythroughBenchmark::FlythroughBenchmark()
+{
+}
+
+FlythroughBenchmark::~FlythroughBenchmark()
+{
+}
+
+bool FlythroughBenchmark::loadWaypoints(const std::string& filename)
+{
+	std::ifstream file(filename);
+	std::string line;
+	std::vector<vec4> position, lookAt;
+
+	if (!file.is_open()) return false;
+
+	while (std::getline(file, line))
+	{
+		std::stringstream stream(line);
+		vec3 waypointPosition, waypointLookAt;
+
+		if (line.find_first_not_of(" \t\r") == std::string::npos || line[line.find_first_not_of(" \t\r")] == '#') continue;
+
+		if (!(stream >> waypointPosition.x >> waypointPosition.y >> waypointPosition.z >> waypointLookAt.x >> waypointLookAt.y >> waypointLookAt.z))
+		{
+			std::cout << "Malformed waypoint: " << line << std::endl;
+			return false;
+		}
+
+		position.push_back(vec4(waypointPosition, 1.0f));
+		lookAt.push_back(vec4(waypointLookAt, 1.0f));
+	}
+
+	if (position.size() < 2) return false;
+
+	// Time keys follow the travelled distance, unless the camera stays at some waypoint, which would lead to empty segments
+	std::vector<float> timeKey(position.size(), .0f);
+	bool emptySegment = false;
+
+	for (size_t waypointIdx = 1; waypointIdx < position.size(); ++waypointIdx)
+	{
+		const float length = glm::distance(vec3(position[waypointIdx - 1]), vec3(position[waypointIdx]));
+
+		timeKey[waypointIdx] = timeKey[waypointIdx - 1] + length;
+		emptySegment |= length < glm::epsilon<float>();
+	}
+
+	for (size_t waypointIdx = 1; waypointIdx < position.size(); ++waypointIdx)
+		timeKey[waypointIdx] = emptySegment ? float(waypointIdx) / (position.size() - 1) : timeKey[waypointIdx] / timeKey.back();
+
+	_positionPath.reset(new CatmullRom(position));
+	_positionPath->setTimeKey(timeKey);
+	_lookAtPath.reset(new CatmullRom(lookAt));
+	_lookAtPath->setTimeKey(timeKey);
+	_waypointFilename = filename;
+
+	return true;
+}
+
+bool FlythroughBenchmark::run(const unsigned numFrames, const unsigned numWarmupFrames)
+{
+	if (!_positionPath || !numFrames) return false;
+
+	Renderer* renderer = Renderer::getInstance();
+	PointCloudScene* scene = dynamic_cast<PointCloudScene*>(renderer->getCurrentScene());
+	Camera* camera = renderer->getActiveCamera();
+	const Camera initialCamera(*camera);
+
+	std::vector<GLuint> query(NUM_QUERIES);
+	std::vector<int> queryFrame(NUM_QUERIES, -1);								// Recorded frame measured by every query, if any
+	bool finished;
+
+	// Frames must not skip chunks which are still streaming, so that runs with different budgets are comparable
+	renderer->getRenderingParameters()->_completeFrames = true;
+
+	glGenQueries(NUM_QUERIES, query.data());
+	_frame.assign(numFrames, FrameRecord{ .0f, .0f, 0 });
+
+	auto readQuery = [&](const unsigned queryIdx)
+		{
+			GLuint64 elapsedTime;
+
+			if (queryFrame[queryIdx] < 0) return;
+
+			glGetQueryObjectui64v(query[queryIdx], GL_QUERY_RESULT, &elapsedTime);				// Waits for the frame issued NUM_QUERIES frames ago
+			_frame[queryFrame[queryIdx]]._gpuTime = elapsedTime / 1e6f;
+			queryFrame[queryIdx] = -1;
+		};
+
+	for (unsigned frameIdx = 0; frameIdx < numWarmupFrames + numFrames; ++frameIdx)
+	{
+		const int recordIdx = int(frameIdx) - int(numWarmupFrames);
+		const float t = recordIdx > 0 && numFrames > 1 ? float(recordIdx) / (numFrames - 1) : .0f;
+		const unsigned queryIdx = frameIdx % NUM_QUERIES;
+
+		camera->setPosition(vec3(_positionPath->getPosition(t, finished)));
+		camera->setLookAt(vec3(_lookAtPath->getPosition(t, finished)));
+
+		readQuery(queryIdx);
+
+		ChronoUtilities::initChrono();
+		glBeginQuery(GL_TIME_ELAPSED, query[queryIdx]);
+		renderer->render();
+		glEndQuery(GL_TIME_ELAPSED);
+		const float cpuTime = ChronoUtilities::getDuration(ChronoUtilities::NANOSECONDS) / 1e6f;
+
+		if (recordIdx >= 0)
+		{
+			_frame[recordIdx]._cpuTime = cpuTime;
+			_frame[recordIdx]._numPoints = scene ? scene->getNumProjectedPoints() : 0;
+			queryFrame[queryIdx] = recordIdx;
+		}
+	}
+
+	for (unsigned queryIdx = 0; queryIdx < NUM_QUERIES; ++queryIdx) readQuery(queryIdx);
+
+	glDeleteQueries(NUM_QUERIES, query.data());
+	*camera = initialCamera;
+	renderer->getRenderingParameters()->_completeFrames = false;
+
+	return true;
+}
+
+bool FlythroughBenchmark::writeJSON(const std::string& filename) const
+{
+	std::ofstream file(filename);
+	if (!file.is_open()) return false;
+
+	const ivec2 size = Renderer::getInstance()->getRenderingParameters()->_viewportSize;
+	std::vector<double> cpuTime(_frame.size()), gpuTime(_frame.size()), numPoints(_frame.size());
+
+	std::transform(_frame.begin(), _frame.end(), cpuTime.begin(), [](const FrameRecord& frame) { return frame._cpuTime; });
+	std::transform(_frame.begin(), _frame.end(), gpuTime.begin(), [](const FrameRecord& frame) { return frame._gpuTime; });
+	std::transform(_frame.begin(), _frame.end(), numPoints.begin(), [](const FrameRecord& frame) { return double(frame._numPoints); });
+
+	std::string waypointFilename = _waypointFilename;
+	std::replace(waypointFilename.begin(), waypointFilename.end(), '\\', '/');
+
+	file << "{" << std::endl;
+	file << "\t\"waypoints\": \"" << waypointFilename << "\"," << std::endl;
+	file << "\t\"renderer\": \"" << glGetString(GL_RENDERER) << "\"," << std::endl;
+	file << "\t\"version\": \"" << glGetString(GL_VERSION) << "\"," << std::endl;
+	file << "\t\"width\": " << size.x << "," << std::endl;
+	file << "\t\"height\": " << size.y << "," << std::endl;
+	file << "\t\"numFrames\": " << _frame.size() << "," << std::endl;
+
+	writeStatistics(file, "cpuTime", cpuTime);
+	file << "," << std::endl;
+	writeStatistics(file, "gpuTime", gpuTime);
+	file << "," << std::endl;
+	writeStatistics(file, "projectedPoints", numPoints);
+	file << "," << std::endl;
+
+	file << "\t\"memory\": {" << std::endl;
+	MemoryTracker::getInstance()->writeJSON(file, "\t\t");
+	file << "\t}," << std::endl;
+
+	file << "\t\"frames\": [" << std::endl;
+	for (size_t frameIdx = 0; frameIdx < _frame.size(); ++frameIdx)
+	{
+		const FrameRecord& frame = _frame[frameIdx];
+
+		file << "\t\t{ \"cpuTime\": " << frame._cpuTime << ", \"gpuTime\": " << frame._gpuTime << ", \"projectedPoints\": " << frame._numPoints << " }";
+		file << (frameIdx + 1 < _frame.size() ? "," : "") << std::endl;
+	}
+	file << "\t]" << std::endl;
+	file << "}" << std::endl;
+
+	return file.good();
+}
+
+/// [Protected methods]
+
+double FlythroughBenchmark::getPercentile(const std::vector<double>& sortedValues, const float percentile)
+{
+	if (sortedValues.empty()) return .0;
+
+	const double position = percentile / 100.0 * (sortedValues.size() - 1);
+	const size_t lowerIdx = size_t(position), upperIdx = (std::min)(lowerIdx + 1, sortedValues.size() - 1);
+
+	return glm::mix(sortedValues[lowerIdx], sortedValues[upperIdx], position - lowerIdx);
+}
+
+void FlythroughBenchmark::writeStatistics(std::ostream& stream, const std::string& name, std::vector<double> values)
+{
+	std::sort(values.begin(), values.end());
+
+	const double mean = values.empty() ? .0 : std::accumulate(values.begin(), values.end(), .0) / values.size();
+	const std::streamsize precision = stream.precision(std::numeric_limits<double>::digits10);		// Default precision rounds large counts
+
+	stream << "\t\"" << name << "\": { \"mean\": " << mean;
+	stream << ", \"min\": " << (values.empty() ? .0 : values.front()) << ", \"max\": " << (values.empty() ? .0 : values.back());
+	for (const float percentile : PERCENTILES) stream << ", \"p" << percentile << "\": " << getPercentile(values, percentile);
+	stream << " }";
+
+	stream.precision(precision);
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "Geometry/Animation/CatmullRom.h"
+
+/**
+*	@file FlythroughBenchmark.h
+*	@authors Alfonso Lpez Ruiz (alr00048@red.ujaen.es)
+*	@date 19/10/2026
+*/
+
+/**
+*	@brief Reproducible performance measurement. The active camera flies along Catmull-Rom paths through a list of waypoints during a
+*	fixed number of frames, and the CPU time, GPU time and projected points of every frame are recorded. GPU times are read back through
+*	a ring of timer queries, so that frames are not serialized by the measurement.
+*/
+class FlythroughBenchmark
+{
+public:
+	struct FrameRecord
+	{
+		float		_cpuTime;											//!< Milliseconds spent by the CPU submitting the frame
+		float		_gpuTime;											//!< Milliseconds spent by the GPU executing the frame
+		unsigned	_numPoints;											//!< Points projected in the frame
+	};
+
+protected:
+	const static unsigned NUM_QUERIES;									//!< Timer queries in flight, i.e. frames the GPU may lag behind
+	const static std::vector<float> PERCENTILES;						//!< Percentiles written for every measurement
+
+protected:
+	std::unique_ptr<CatmullRom>		_positionPath;						//!< Path of the camera position
+	std::unique_ptr<CatmullRom>		_lookAtPath;						//!< Path of the point the camera looks at
+	std::string						_waypointFilename;					//!< Source of the paths, written along with the results
+	std::vector<FrameRecord>		_frame;								//!< Records of the last run
+
+protected:
+	/**
+	*	@return Linearly interpolated percentile (0-100) of sorted values.
+	*/
+	static double getPercentile(const std::vector<double>& sortedValues, const float percentile);
+
+	/**
+	*	@brief Writes the mean, minimum, maximum and percentiles of a measurement as a JSON object. Values are handled as doubles, so that
+	*	point counts above 2^24 are written exactly.
+	*/
+	static void writeStatistics(std::ostream& stream, const std::string& name, std::vector<double> values);
+
+public:
+	/**
+	*	@brief Constructor. No path is defined until waypoints are loaded.
+	*/
+	FlythroughBenchmark();
+
+	/**
+	*	@brief Destructor.
+	*/
+	virtual ~FlythroughBenchmark();
+
+	/**
+	*	@return Records of the last run.
+	*/
+	const std::vector<FrameRecord>& getFrames() const { return _frame; }
+
+	/**
+	*	@brief Reads the waypoints of the flythrough. Every line is "px py pz lx ly lz", i.e. camera position and look-at point, while empty
+	*	lines and lines starting with # are skipped. Waypoints are timed by the distance travelled, so the camera keeps a steady speed.
+	*	@return False if the file could not be read or has less than two waypoints.
+	*/
+	bool loadWaypoints(const std::string& filename);
+
+	/**
+	*	@brief Renders the flythrough with the active camera, which is restored afterwards. Frames are not presented, so that the display
+	*	refresh rate does not bound the measurement.
+	*	@param numFrames Recorded frames, evenly spread along the paths.
+	*	@param numWarmupFrames Frames rendered at the first waypoint before recording.
+	*	@return False if no path was loaded.
+	*/
+	bool run(const unsigned numFrames, const unsigned numWarmupFrames = 30);
+
+	/**
+	*	@brief Writes the statistics and the records of the last run as JSON, together with the OpenGL renderer and the canvas size.
+	*	@return False if the file could not be written.
+	*/
+	bool writeJSON(const std::string& filename) const;
+};
+
@@ -12,13 +12,27 @@
 struct PointCloudParameters
 {
 public:
+	inline static GLint		_benchmarkFrames = 1000;			//!< Recorded frames of the flythrough benchmark
 	inline static bool		_buildDTM = true;					//!<
+	inline static GLuint	_chunkSize = 1 << 22;				//!< Maximum points of every chunk in video memory
 	inline static bool		_computeNormal = false;				//!<
+	inline static bool		_cpuRendering = false;				//!< Renders point clouds with the CPU rasterizer instead of compute shaders
 	inline static float		_distanceThreshold = 1.01f;			//!<
 	inline static bool		_enableHQR = true;					//!<
+	inline static GLint		_gpuBudget = 0;						//!< Megabytes of point chunks in video memory, zero for no limit
+	inline static bool		_gpuResidentOnly = false;			//!< Host points are freed after upload and read again from the binary file when needed
 	inline static GLint		_knn = 8;							//!<
+	inline static float		_meshMaxDistance = 1.0f;			//!< Distance to the mesh mapped to both ends of the palette
 	inline static ivec2		_numGridSubdivisions = ivec2(100);	//!<
+	inline static GLint		_outlierKnn = 8;					//!< Neighbours of statistical outlier removal
+	inline static GLint		_outlierMinNeighbours = 4;			//!< Minimum neighbours within radius of radius outlier removal
+	inline static float		_outlierRadius = 1.0f;				//!<
+	inline static float		_outlierStdMultiplier = 1.0f;		//!< Sigma factor of statistical outlier removal
 	inline static bool		_sortPointCloud = false;				//!<
 	inline static bool		_reducePointCloud = false;			//!<
 	inline static GLuint	_reduceIterations = 1;				//!<
+	inline static vec3		_sectionNormal = vec3(.0f, .0f, 1.0f);	//!< Slicing axis of mesh sections
+	inline static float		_sectionSpacing = 1.0f;				//!< Distance between mesh sections, zero for a single section through the mesh center
+	inline static float		_terrainMaxError = 0.1f;			//!< Maximum vertical distance from the DTM to the terrain mesh
+	inline static float		_voxelSize = 0.1f;					//!< Voxel side of occupancy comparisons between the point cloud and a mesh
 };
\ No newline at end of file
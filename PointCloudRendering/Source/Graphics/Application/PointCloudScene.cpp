@@ -3,11 +3,17 @@
 
 #include <filesystem>
 #include <regex>
+#include "Graphics/Application/PointCloudParameters.h"
 #include "Graphics/Application/Renderer.h"
 #include "Graphics/Application/TextureList.h"
+#include "Graphics/Core/ImageEncoder.h"
 #include "Graphics/Core/Light.h"
 #include "Graphics/Core/OpenGLUtilities.h"
 #include "Graphics/Core/ShaderList.h"
+#include "Geometry/3D/TerrainMesher.h"
+#include "Geometry/3D/TriangleMesh.h"
+#include "Utilities/ChronoUtilities.h"
+#include "Utilities/Profiler.h"
 
 /// Initialization of static attributes
 const std::string PointCloudScene::SCENE_CAMERA_FILE = "Camera.txt";
@@ -15,7 +21,7 @@ const std::string PointCloudScene::POINT_CLOUD_FILE = "Assets/Models/PointCloudS
 
 // [Public methods]
 
-PointCloudScene::PointCloudScene() : _pointCloud(nullptr), _pointCloudAggregator(nullptr)
+PointCloudScene::PointCloudScene() : _pointCloud(nullptr), _pointCloudAggregator(nullptr), _terrain(nullptr), _releaseHostPoints(false)
 {
 	ShaderList* shaderList = ShaderList::getInstance();
 
@@ -27,12 +33,148 @@ PointCloudScene::PointCloudScene() : _pointCloud(nullptr), _pointCloudAggregator
 
 PointCloudScene::~PointCloudScene()
 {
-	delete _pointCloud;
 	delete _pointCloudAggregator;
+	delete _pointCloud;
+	delete _terrain;
+}
+
+bool PointCloudScene::buildTerrainMesh(const float maxError)
+{
+	if (!_pointCloud || _pointCloudAggregator->getDTMHeights().empty())
+	{
+		std::cout << "A DTM must be built by filtering the point cloud by height first!" << std::endl;
+		return false;
+	}
+
+	const uvec2 size = _pointCloudAggregator->getDTMSize();
+	const AABB aabb = _pointCloud->getAABB();
+	const vec2 cellSize = vec2(aabb.size()) / vec2(size);
+	std::vector<float> heights = _pointCloudAggregator->getDTMHeights();
+	TriangleMesh* mesh = new TriangleMesh;
+
+	ChronoUtilities::initChrono();
+	if (!TerrainMesher::build(heights, size, vec3(vec2(aabb.min()) + cellSize / 2.0f, .0f), cellSize, maxError, *mesh))
+	{
+		std::cout << "The DTM has no valid cell!" << std::endl;
+		delete mesh;
+		return false;
+	}
+	std::cout << "Terrain mesh: " << mesh->getNumTriangles() << " triangles from " << size.x * size.y << " cells (" << ChronoUtilities::getDuration() << " ms)" << std::endl;
+
+	delete _terrain;
+	_terrain = new DrawMesh(mesh);
+
+	return _terrain->load();
+}
+
+bool PointCloudScene::compareMeshOccupancy(const std::string& meshFilename, const float voxelSize)
+{
+	if (!_pointCloud || voxelSize <= .0f) return false;
+
+	TriangleMesh mesh(meshFilename);
+	if (!mesh.getNumTriangles())
+	{
+		std::cout << "Mesh " << meshFilename << " could not be loaded!" << std::endl;
+		return false;
+	}
+
+	std::vector<PointCloud::PointModel>* points = _pointCloud->getPoints();
+	AABB aabb = _pointCloud->getAABB();
+	aabb.update(mesh.aabb());
+
+	// Both grids share domain and voxel size, so they can be compared voxel by voxel
+	SparseVoxelGrid meshGrid(aabb, voxelSize), pointGrid(aabb, voxelSize);
+	size_t shared, onlyMesh, onlyPoints;
+
+	ChronoUtilities::initChrono();
+	mesh.voxelize(meshGrid);
+	pointGrid.insertPoints(points->data(), points->size(), sizeof(PointCloud::PointModel));
+	meshGrid.compare(pointGrid, shared, onlyMesh, onlyPoints);
+
+	const size_t meshVoxels = (std::max)(shared + onlyMesh, size_t(1));
+	std::cout << "Occupancy (" << voxelSize << " voxels): " << shared << " shared, " << onlyMesh << " only in the mesh, " << onlyPoints << " only in the point cloud; "
+		<< 100.0f * shared / meshVoxels << "% of the mesh is covered (" << ChronoUtilities::getDuration() << " ms)" << std::endl;
+
+	return true;
+}
+
+bool PointCloudScene::computeMeshDistance(const std::string& meshFilename, const float maxDistance)
+{
+	if (!_pointCloud) return false;
+
+	TriangleMesh mesh(meshFilename);
+	if (!mesh.getNumTriangles())
+	{
+		std::cout << "Mesh " << meshFilename << " could not be loaded!" << std::endl;
+		return false;
+	}
+
+	std::vector<PointCloud::PointModel>* points = _pointCloud->getPoints();
+	std::vector<float> distances;
+
+	mesh.getBVH();																// Built before timing, so only the queries are measured
+
+	ChronoUtilities::initChrono();
+	mesh.signedDistance(points->data(), points->size(), sizeof(PointCloud::PointModel), distances, maxDistance);
+	const long long duration = ChronoUtilities::getDuration();
+	std::cout << "Distance to mesh: " << points->size() << " points (" << duration << " ms, " << points->size() / ((std::max)(duration, 1ll) * 1000.0f) << " million points/s)" << std::endl;
+
+	_pointCloudAggregator->setDistances(distances, maxDistance);
+
+	return true;
+}
+
+bool PointCloudScene::exportMeshSections(const std::string& meshFilename, const vec3& normal, const float spacing)
+{
+	if (glm::length(normal) < glm::epsilon<float>())
+	{
+		std::cout << "The slicing axis must not be null!" << std::endl;
+		return false;
+	}
+
+	TriangleMesh mesh(meshFilename);
+	if (!mesh.getNumTriangles())
+	{
+		std::cout << "Mesh " << meshFilename << " could not be loaded!" << std::endl;
+		return false;
+	}
+
+	const MeshSlicer::PlaneFamily planes = spacing > .0f ? MeshSlicer::PlaneFamily(mesh.aabb(), normal, spacing) : MeshSlicer::PlaneFamily(mesh.aabb().center(), normal, 1.0f, 1);
+	const std::filesystem::path path(meshFilename);
+	std::vector<MeshSlicer::PolylineSet> sections;
+	size_t numPolylines = 0;
+
+	ChronoUtilities::initChrono();
+	mesh.slice(planes, sections);
+	for (const MeshSlicer::PolylineSet& polylines : sections) numPolylines += polylines.size();
+	std::cout << "Mesh sections: " << numPolylines << " polylines over " << planes._numPlanes << " planes (" << ChronoUtilities::getDuration() << " ms)" << std::endl;
+
+	return MeshSlicer::exportOBJ(sections, (path.parent_path() / path.stem()).string() + "_section");
+}
+
+bool PointCloudScene::exportDTM(const std::string& filename)
+{
+	if (!_pointCloud || _pointCloudAggregator->getDTMHeights().empty())
+	{
+		std::cout << "A DTM must be built by filtering the point cloud by height first!" << std::endl;
+		return false;
+	}
+
+	ChronoUtilities::initChrono();
+	if (!ImageEncoder::saveFloatTIFF(filename, _pointCloudAggregator->getDTMHeights().data(), _pointCloudAggregator->getDTMSize(), true))
+	{
+		std::cout << "DTM " << filename << " could not be written!" << std::endl;
+		return false;
+	}
+	std::cout << "DTM written into " << filename << " (" << ChronoUtilities::getDuration() << " ms)" << std::endl;
+
+	return true;
 }
 
 void PointCloudScene::filterGround(CSF* csf)
 {
+	Profiler::ScopedZone zone("Ground filter");
+
 	std::vector<GLint> groundIndices;
 
 	_pointCloud->filterGround(csf, groundIndices);
@@ -45,6 +187,32 @@ void PointCloudScene::filterPointCloudByHeight(const uvec2& subdivisions)
 		_pointCloudAggregator->filterByHeight(subdivisions);
 }
 
+void PointCloudScene::filterRadiusOutliers(const float radius, const unsigned minNeighbours)
+{
+	if (!_pointCloud) return;
+
+	std::vector<uint8_t> inliers;
+
+	ChronoUtilities::initChrono();
+	_pointCloud->filterRadiusOutliers(radius, minNeighbours, inliers);
+	std::cout << "Radius outlier removal: " << std::count(inliers.begin(), inliers.end(), uint8_t(0)) << " outliers (" << ChronoUtilities::getDuration() << " ms)" << std::endl;
+
+	_pointCloudAggregator->filterOutliers(inliers);
+}
+
+void PointCloudScene::filterStatisticalOutliers(const unsigned k, const float stdMultiplier)
+{
+	if (!_pointCloud) return;
+
+	std::vector<uint8_t> inliers;
+
+	ChronoUtilities::initChrono();
+	_pointCloud->filterStatisticalOutliers(k, stdMultiplier, inliers);
+	std::cout << "Statistical outlier removal: " << std::count(inliers.begin(), inliers.end(), uint8_t(0)) << " outliers (" << ChronoUtilities::getDuration() << " ms)" << std::endl;
+
+	_pointCloudAggregator->filterOutliers(inliers);
+}
+
 float PointCloudScene::getPointCloudScaleFactor()
 {
 	if (_pointCloud)
@@ -56,15 +224,22 @@ float PointCloudScene::getPointCloudScaleFactor()
 	return .0f;
 }
 
-bool PointCloudScene::loadPointCloud(const std::string& path)
+bool PointCloudScene::loadPointCloud(const std::string& path, const PointCloud::LoadFilter& loadFilter)
 {
+	Profiler::ScopedZone zone("Load point cloud");
+
 	bool nullPointCloud = _pointCloud == nullptr;
 	
+	_pointCloudAggregator->deletePointCloudBuffers();					// Pending uploads may still read the previous points
 	delete _pointCloud;
 	_pointCloud = new PointCloud(path, true);
+	_pointCloud->setLoadFilter(loadFilter);
 	if (!_pointCloud->load()) return false;
 	_pointCloudAggregator->setPointCloud(_pointCloud);
 
+	// Chunks uploaded in this mode do not refer to the host points, which can be freed
+	_releaseHostPoints = PointCloudParameters::_gpuResidentOnly && _pointCloud->releasePoints();
+
 	if (Renderer::getInstance()->getRenderingParameters()->_updateCamera) this->loadDefaultCamera(_cameraManager->getActiveCamera());
 
 	return true;
@@ -72,7 +247,7 @@ bool PointCloudScene::loadPointCloud(const std::string& path)
 
 void PointCloudScene::modifySize(const uint16_t width, const uint16_t height)
 {
-	this->modifySize(width, height);
+	Scene::modifySize(width, height);
 
 	_pointCloudAggregator->changedSize(width, height);
 }
@@ -80,7 +255,15 @@ void PointCloudScene::modifySize(const uint16_t width, const uint16_t height)
 void PointCloudScene::render(const mat4& mModel, RenderingParameters* rendParams)
 {
 	Scene::bindDefaultFramebuffer(rendParams);	
-	this->drawAsPoints(mModel, rendParams);
+
+	if (rendParams->_showTerrain && _terrain)
+	{
+		this->drawAsTriangles(mModel, rendParams);
+	}
+	else
+	{
+		this->drawAsPoints(mModel, rendParams);
+	}
 }
 
 // [Protected methods]
@@ -89,9 +272,17 @@ void PointCloudScene::drawAsPoints(const mat4& mModel, RenderingParameters* rend
 {
 	Camera* activeCamera		= _cameraManager->getActiveCamera();
 	const mat4 projectionMatrix = activeCamera->getViewProjMatrix() * mModel;
+	const vec3 viewer			= vec3(glm::inverse(mModel) * vec4(activeCamera->getEye(), 1.0f));		// Chunk boundaries are not transformed
+
+	_pointCloudAggregator->render(projectionMatrix, viewer);
 
-	_pointCloudAggregator->render(projectionMatrix);
+	// Points restored by CPU-side features are freed again, unless the CPU renders them every frame
+	if (_releaseHostPoints && _pointCloud && _pointCloud->hasHostPoints() && !PointCloudParameters::_cpuRendering && _pointCloudAggregator->isGPURenderingSupported())
+	{
+		_pointCloud->releasePoints();
+	}
 
+	Profiler::GPUZone gpuZone("Composite");
 	_quadRenderer->use();
 	_quadRenderer->applyActiveSubroutines();
 	this->bindTexture(_pointCloudAggregator->getTexture(), _quadRenderer, "texSampler", 0);
@@ -99,6 +290,11 @@ void PointCloudScene::drawAsPoints(const mat4& mModel, RenderingParameters* rend
 	_quadVAO->drawObject(RendEnum::IBO_TRIANGLE_MESH, GL_TRIANGLES, 2 * 4);
 }
 
+void PointCloudScene::drawSceneAsTriangles(RenderingShader* shader, RendEnum::RendShaderTypes shaderType, std::vector<mat4>* matrix, RenderingParameters* rendParams)
+{
+	if (_terrain) _terrain->drawAsTriangles(shader, shaderType, *matrix);
+}
+
 void PointCloudScene::loadDefaultCamera(Camera* camera)
 {
 	if (_pointCloud)
@@ -126,6 +322,19 @@ void PointCloudScene::loadCameras()
 void PointCloudScene::loadLights()
 {
 	Scene::loadLights();
+
+	// Only the terrain mesh is lit, points keep their own colours
+	Light* ambientLight = new Light;
+	ambientLight->setLightType(Light::AMBIENT_LIGHT);
+	ambientLight->setIa(vec3(0.3f));
+	_lights.push_back(std::unique_ptr<Light>(ambientLight));
+
+	Light* sunLight = new Light;
+	sunLight->setLightType(Light::DIRECTIONAL_LIGHT);
+	sunLight->setDirection(glm::normalize(vec3(-0.3f, -0.4f, -1.0f)));
+	sunLight->setId(vec3(0.7f));
+	sunLight->setIs(vec3(0.1f));
+	_lights.push_back(std::unique_ptr<Light>(sunLight));
 }
 
 void PointCloudScene::loadModels()
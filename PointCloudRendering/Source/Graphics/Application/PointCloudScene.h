@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Graphics/Application/Scene.h"
+#include "Graphics/Core/DrawMesh.h"
 #include "Graphics/Core/PointCloud.h"
 #include "Graphics/Core/PointCloudAggregator.h"
 
@@ -26,6 +27,8 @@ protected:
 protected:
 	PointCloud*				_pointCloud;
 	PointCloudAggregator*	_pointCloudAggregator;
+	DrawMesh*				_terrain;								//!< Terrain mesh built from the last DTM, if any
+	bool					_releaseHostPoints;						//!< Points were uploaded in GPU-resident only mode
 
 	// Rendering
 	RenderingShader*		_quadRenderer;
@@ -67,6 +70,15 @@ protected:
 	*/
 	virtual void drawAsPoints(const mat4& mModel, RenderingParameters* rendParams);
 
+	/**
+	*	@brief Decides which objects are going to be rendered as a triangle mesh.
+	*	@param shader Rendering shader which is drawing the scene.
+	*	@param shaderType Unique ID of "shader".
+	*	@param matrix Vector of matrices, including view, projection, etc.
+	*	@param rendParams Parameters which indicates how the scene is rendered.
+	*/
+	virtual void drawSceneAsTriangles(RenderingShader* shader, RendEnum::RendShaderTypes shaderType, std::vector<mat4>* matrix, RenderingParameters* rendParams);
+
 public:
 	/**
 	*	@brief Default constructor.
@@ -78,6 +90,42 @@ public:
 	*/
 	virtual ~PointCloudScene();
 
+	/**
+	*	@brief Builds an adaptive triangle mesh from the DTM of the last height filter.
+	*	@param maxError Maximum vertical distance from the DTM to the mesh.
+	*	@return False if no DTM is available.
+	*/
+	bool buildTerrainMesh(const float maxError);
+
+	/**
+	*	@brief Voxelizes an OBJ mesh and the point cloud over the same grid and prints how many voxels are occupied by both, only by the
+	*	mesh or only by the points, e.g. to check how much of a design model has been built.
+	*	@return False if the mesh could not be loaded.
+	*/
+	bool compareMeshOccupancy(const std::string& meshFilename, const float voxelSize);
+
+	/**
+	*	@brief Computes the signed distance from every point to an OBJ mesh, which must share the coordinates of the point cloud, and
+	*	uploads it for the distance colour mode.
+	*	@param maxDistance Distances are clamped to this value, which also bounds the search.
+	*	@return False if the mesh could not be loaded.
+	*/
+	bool computeMeshDistance(const std::string& meshFilename, const float maxDistance);
+
+	/**
+	*	@brief Writes the heights of the DTM from the last height filter as a float TIFF raster, north up. Empty cells are written as no data.
+	*	@return False if no DTM is available or the file could not be written.
+	*/
+	bool exportDTM(const std::string& filename);
+
+	/**
+	*	@brief Cuts an OBJ mesh with a family of parallel planes across its bounding box and writes the polylines of every plane into
+	*	an OBJ file next to the mesh, named after it.
+	*	@param spacing Distance between planes, zero for a single plane through the center of the mesh.
+	*	@return False if the mesh could not be loaded or any section could not be written.
+	*/
+	bool exportMeshSections(const std::string& meshFilename, const vec3& normal, const float spacing);
+
 	/**
 	*	@brief 
 	*/
@@ -88,15 +136,36 @@ public:
 	*/
 	void filterPointCloudByHeight(const uvec2& subdivisions);
 
+	/**
+	*	@brief Hides points with fewer than minNeighbours neighbours within the given radius.
+	*/
+	void filterRadiusOutliers(const float radius, const unsigned minNeighbours);
+
+	/**
+	*	@brief Hides points whose mean distance to their k nearest neighbours exceeds the global mean by stdMultiplier deviations.
+	*/
+	void filterStatisticalOutliers(const unsigned k, const float stdMultiplier);
+
+	/**
+	*	@return Number of points projected in the last frame.
+	*/
+	unsigned getNumProjectedPoints() const { return _pointCloudAggregator ? _pointCloudAggregator->getNumProjectedPoints() : 0; }
+
+	/**
+	*	@return Manager of the point cloud chunks in video memory, null if there is no point cloud.
+	*/
+	const PointCloudResidency* getPointCloudResidency() const { return _pointCloudAggregator ? _pointCloudAggregator->getResidency() : nullptr; }
+
 	/**
 	*	@return Y / X factor from the point cloud's size.
 	*/
 	float getPointCloudScaleFactor();
 
 	/**
+	*	@param loadFilter Points rejected while decoding the file.
 	*	@return True if the point cloud was successfully loaded.
 	*/
-	bool loadPointCloud(const std::string& path);
+	bool loadPointCloud(const std::string& path, const PointCloud::LoadFilter& loadFilter = PointCloud::LoadFilter());
 
 	/**
 	*	@brief Resize event.
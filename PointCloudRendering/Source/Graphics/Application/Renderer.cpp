@@ -5,6 +5,7 @@
 #include "Graphics/Core/PointCloudAggregator.h"
 #include "Interface/Window.h"
 #include "Utilities/FileManagement.h"
+#include "Utilities/Profiler.h"
 
 // [Static attributes]
 
@@ -13,6 +14,7 @@ const std::string Renderer::SCENE_INDEX_FILENAME = "Settings/SceneIndex.txt";
 /// [Protected methods]
 
 Renderer::Renderer() :
+	_asyncScreenshot(nullptr),
 	_currentScene(0),
 	_screenshotFBO(nullptr),
 	_scene(1),
@@ -20,11 +22,38 @@ Renderer::Renderer() :
 {
 }
 
+ivec2 Renderer::beginScreenshot()
+{
+	const ivec2 size = _state->_viewportSize;
+	const ivec2 newSize = ivec2(_state->_viewportSize.x * _state->_screenshotMultiplier, _state->_viewportSize.y * _state->_screenshotMultiplier);
+
+	_state->_completeFrames = true;
+	_scene[_currentScene]->modifyNextFramebufferID(_screenshotFBO->getIdentifier());
+	if (newSize != size)												// Window buffers are kept for back-to-back captures at the same size
+	{
+		this->resize(newSize.x, newSize.y);
+		Window::getInstance()->changedSize(newSize.x, newSize.y);
+	}
+
+	return size;
+}
+
 Scene* Renderer::createScene(const uint8_t sceneType)
 {
 	return new PointCloudScene();
 }
 
+void Renderer::endScreenshot(const ivec2& size)
+{
+	_state->_completeFrames = false;
+	_scene[_currentScene]->modifyNextFramebufferID(0);
+	if (size != _state->_viewportSize)
+	{
+		this->resize(size.x, size.y);
+		Window::getInstance()->changedSize(size.x, size.y);
+	}
+}
+
 /// [Public methods]
 
 Renderer::~Renderer()
@@ -54,6 +83,7 @@ void Renderer::prepareOpenGL(const uint16_t width, const uint16_t height)
 	glPrimitiveRestartIndex(Model3D::RESTART_PRIMITIVE_INDEX);
 
 	ComputeShader::initializeMaxGroupSize();			// Once the context is ready we can query for maximum work group size
+	ShaderProgram::initializeCompilation();				// Binary cache and parallel compilation depend on the driver
 	Model3D::buildShadowOffsetTexture();				// Alternative shadow technique
 	Model3D::buildSSAONoiseKernels();					// Ambient occlusion samples
 
@@ -69,32 +99,96 @@ void Renderer::prepareOpenGL(const uint16_t width, const uint16_t height)
 	// [Framebuffers]
 
 	_screenshotFBO = std::unique_ptr<FBOScreenshot>(new FBOScreenshot(width, height));
+	_asyncScreenshot = std::unique_ptr<AsyncScreenshot>(new AsyncScreenshot());
 }
 
 void Renderer::render()
 {
+	Profiler::ScopedZone zone("Render");
+	Profiler::GPUZone gpuZone("Render");
+
+	_asyncScreenshot->update();											// Finished readbacks are handed to the encoding threads
 	_scene[_currentScene]->render(glm::rotate(mat4(1.0f), -glm::pi<float>() / 2.0f, vec3(1.0f, .0f, .0f)), _state.get());
 }
 
-bool Renderer::getScreenshot(const std::string& filename)
+Image* Renderer::captureScreenshot()
 {
-	const ivec2 size = _state->_viewportSize;
-	const ivec2 newSize = ivec2(_state->_viewportSize.x * _state->_screenshotMultiplier, _state->_viewportSize.y * _state->_screenshotMultiplier);
+	const ivec2 size = this->beginScreenshot();
 
-	_scene[_currentScene]->modifyNextFramebufferID(_screenshotFBO->getIdentifier());
-	this->resize(newSize.x, newSize.y);
-	Window::getInstance()->changedSize(newSize.x, newSize.y);
+	this->render();
+	Image* image = _screenshotFBO->getImage();
+
+	this->endScreenshot(size);
+
+	return image;
+}
+
+void Renderer::flushScreenshots()
+{
+	if (_asyncScreenshot) _asyncScreenshot->flush();
+}
+
+bool Renderer::getScreenshot(const std::string& filename)
+{
+	const ivec2 size = this->beginScreenshot();
 
 	this->render();
-	const bool success = _screenshotFBO->saveImage(filename);
+	const bool success = _asyncScreenshot->capture(*_screenshotFBO, filename);
 
-	_scene[_currentScene]->modifyNextFramebufferID(0);
-	this->resize(size.x, size.y);
-	Window::getInstance()->changedSize(size.x, size.y);
+	this->endScreenshot(size);
 
 	return success;
 }
 
+bool Renderer::getTiledScreenshot(const std::string& filename)
+{
+	const ivec2 viewport = _state->_viewportSize;
+	const uvec2 size = uvec2(glm::round(vec2(viewport) * _state->_screenshotMultiplier));
+	const uvec2 tileSize = uvec2(viewport) / 16u * 16u;						// TIFF tiles must be multiple of 16
+
+	TiledImageWriter writer;
+	if (!writer.open(filename, size, tileSize))
+	{
+		return false;
+	}
+
+	Camera* camera = this->getActiveCamera();
+	const uvec2 numTiles = writer.getNumTiles();
+	std::vector<GLubyte> tile(tileSize.x * tileSize.y * 3);
+	bool success = true;
+
+	_state->_completeFrames = true;											// Otherwise, every tile would start streams which it never waits for
+	_scene[_currentScene]->modifyNextFramebufferID(_screenshotFBO->getIdentifier());
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+	for (unsigned row = 0; row < numTiles.y && success; ++row)
+	{
+		for (unsigned col = 0; col < numTiles.x && success; ++col)
+		{
+			// The viewport covers the image from the top left corner of the tile, which is then read from the top of the framebuffer
+			const vec2 minCorner = vec2(col * tileSize.x, row * tileSize.y) / vec2(size);
+			const vec2 maxCorner = vec2(col * tileSize.x + viewport.x, row * tileSize.y + viewport.y) / vec2(size);
+
+			camera->setProjectionWindow(vec4(minCorner.x * 2.0f - 1.0f, 1.0f - maxCorner.y * 2.0f, maxCorner.x * 2.0f - 1.0f, 1.0f - minCorner.y * 2.0f));
+			this->render();
+
+			success = _screenshotFBO->resolve();
+			glReadPixels(0, viewport.y - tileSize.y, tileSize.x, tileSize.y, GL_RGB, GL_UNSIGNED_BYTE, tile.data());
+
+			Image::flipImageVertically(tile, tileSize.x, tileSize.y, 3);
+			success &= writer.writeTile(uvec2(col, row), tile.data());
+		}
+	}
+
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	camera->setProjectionWindow();
+	_scene[_currentScene]->modifyNextFramebufferID(0);
+	_state->_completeFrames = false;
+
+	return writer.close() && success;
+}
+
 void Renderer::resize(const uint16_t width, const uint16_t height)
 {
 	// Viewport state
@@ -4,10 +4,12 @@
 #include "Graphics/Application/GraphicsAppEnumerations.h"
 #include "Graphics/Application/RenderingParameters.h"
 #include "Graphics/Application/Scene.h"
+#include "Graphics/Core/AsyncScreenshot.h"
 #include "Graphics/Core/Camera.h"
 #include "Graphics/Core/FBOScreenshot.h"
 #include "Graphics/Core/Model3D.h"
 #include "Graphics/Core/RenderingShader.h"
+#include "Graphics/Core/TiledImageWriter.h"
 #include "Utilities/Singleton.h"
 
 /**
@@ -28,6 +30,7 @@ protected:
 
 protected:
 	// [Rendering]
+	std::unique_ptr<AsyncScreenshot>			_asyncScreenshot;		//!< Readback and encoding of screenshots out of the render loop
 	uint8_t										_currentScene;			//!< Active scene
 	std::unique_ptr<FBOScreenshot>				_screenshotFBO;			//!< Framebuffer which allows us to capture the scene (and save it) at higher resolution
 	std::vector<std::unique_ptr<Scene>>		_scene;						//!< Array of scenes which can be represented. Components are only initialized when asked for
@@ -45,6 +48,18 @@ protected:
 	*/
 	Scene* createScene(const uint8_t sceneType);
 
+	/**
+	*	@brief Redirects the next render into the screenshot FBO, scaling the viewport by the screenshot multiplier.
+	*	@return Viewport size to be restored by endScreenshot.
+	*/
+	ivec2 beginScreenshot();
+
+	/**
+	*	@brief Renders into the window again after a screenshot.
+	*	@param size Viewport size returned by beginScreenshot.
+	*/
+	void endScreenshot(const ivec2& size);
+
 public:
 	/**
 	*	@brief Destructor. Frees resources.
@@ -86,11 +101,30 @@ public:
 	RenderingParameters* getRenderingParameters() { return _state.get(); }
 
 	/**
-	*	@brief Renders the scene into an FBO.
+	*	@brief Renders the scene into an FBO, scaling the viewport by the screenshot multiplier.
+	*	@return Image read from the FBO, bottom row first, which must be deleted by the caller. Null if the FBO is not valid.
+	*/
+	Image* captureScreenshot();
+
+	/**
+	*	@brief Waits until every screenshot requested through getScreenshot has been written. Must be called before the context is destroyed.
+	*/
+	void flushScreenshots();
+
+	/**
+	*	@brief Renders the scene into an FBO. The image is read back and written asynchronously.
 	*	@param filename Path of file system where the image needs to be saved.
 	*/
 	bool getScreenshot(const std::string& filename);
 
+	/**
+	*	@brief Renders the scene at the size of the viewport scaled by the screenshot multiplier, one viewport-sized tile at a time. Every
+	*	tile is rendered through an off-centre projection and streamed into a tiled TIFF file, so that neither the window buffers nor the
+	*	memory grow with the final resolution.
+	*	@param filename Path of file system where the image needs to be saved.
+	*/
+	bool getTiledScreenshot(const std::string& filename);
+
 	// [Events]
 
 	/**
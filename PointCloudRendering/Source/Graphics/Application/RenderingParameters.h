@@ -16,7 +16,7 @@ struct RenderingParameters
 public:
 	enum PointCloudRendering
 	{
-		RGB, NORMAL, HEIGHT, CLASS
+		RGB, NORMAL, HEIGHT, CLASS, DISTANCE
 	};
 
 public:
@@ -31,16 +31,20 @@ public:
 	// Screenshot
 	float							_antialiasingMultiplier;				//!< 
 	char							_screenshotFilenameBuffer[32];			//!< Location of screenshot
+	int								_screenshotFormat;						//!< Image format (ImageEncoder::Format) of screenshots which are not tiled
 	float							_screenshotMultiplier;					//!< Multiplier of current size of GLFW window
+	bool							_screenshotTiled;						//!< Renders the screenshot tile by tile into a TIFF file, without resizing any buffer
 
 	// Rendering type
 	int								_visualizationMode;						//!< Only triangle mesh is defined here
 	
 	// Point cloud
 	ivec2							_classRange;							//!<
+	bool							_completeFrames;						//!< Visible point chunks are uploaded before rendering rather than streamed, as offline captures need
 	CSF								_csf;									//!<
 	bool							_filterByGround;						//!<
 	bool							_filterByHeight;						//!<
+	bool							_filterOutliers;						//!<
 	bool							_normalizedColor;						//!<
 	float							_returnFactor;							//!<
 	float							_scenePointSize;						//!<
@@ -49,6 +53,7 @@ public:
 	// Triangle mesh
 	bool							_ambientOcclusion;						//!< Boolean value to enable/disable occlusion
 	bool							_renderSemanticConcept;					//!< Boolean value to indicate if rendering semantic concepts is needed
+	bool							_showTerrain;							//!< Renders the terrain mesh instead of the point cloud, if built
 
 	// What to see		
 	bool							_updateCamera;							//!< Updates camera accordingly to scene AABB
@@ -66,18 +71,23 @@ public:
 
 		_antialiasingMultiplier(3),
 		_screenshotFilenameBuffer("Screenshot.png"),
+		_screenshotFormat(0),
 		_screenshotMultiplier(1.0f),
+		_screenshotTiled(false),
 
 		_visualizationMode(0),
 
 		_classRange(0, 256),
+		_completeFrames(false),
 		_filterByGround(false),
 		_filterByHeight(false),
+		_filterOutliers(false),
 		_normalizedColor(true),
 		_scenePointSize(2.0f),
 		_scenePointCloudColor(1.0f, .0f, .0f),
 
 		_ambientOcclusion(true),
+		_showTerrain(false),
 
 		_updateCamera(true)
 	{
@@ -0,0 +1,184 @@
+#include "stdafx.h"
+#include "AsyncScreenshot.h"
+
+#include "Utilities/FileManagement.h"
+#include "Utilities/MemoryTracker.h"
+#include "Utilities/Profiler.h"
+
+// [Static members initialization]
+
+const unsigned AsyncScreenshot::NUM_BUFFERS = 3;
+
+/// [Public methods]
+
+AsyncScreenshot::AsyncScreenshot() :
+	_slot(NUM_BUFFERS, Slot{ 0, nullptr, 0, nullptr, uvec2(0), "", FREE }), _nextSlot(0)
+{
+}
+
+AsyncScreenshot::~AsyncScreenshot()
+{
+	this->flush();
+
+	for (Slot& slot : _slot)
+	{
+		if (slot._pbo)
+		{
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, slot._pbo);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+			glDeleteBuffers(1, &slot._pbo);
+			MemoryTracker::getInstance()->releaseBuffer(slot._pbo);
+		}
+	}
+}
+
+bool AsyncScreenshot::capture(const FBOScreenshot& fbo, const std::string& filename)
+{
+	if (!fbo.resolve())
+	{
+		return false;
+	}
+
+	// Buffers are reused in order, so only the oldest capture is waited for when the ring is full
+	const unsigned slotIdx = _nextSlot;
+	Slot& slot = _slot[slotIdx];
+
+	if (slot._fence) this->waitTransfer(slotIdx, (std::numeric_limits<GLuint64>::max)());
+
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_slotCondition.wait(lock, [&slot]() { return slot._state == FREE; });
+
+		slot._state = READING;
+	}
+
+	const uvec2 size = fbo.getSize();
+
+	this->reserve(slot, size_t(size.x) * size.y * 4);
+	slot._size = size;
+	slot._filename = filename;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot._pbo);
+	glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);			// Returns once the transfer is queued
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	slot._fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	_nextSlot = (_nextSlot + 1) % NUM_BUFFERS;
+
+	return true;
+}
+
+void AsyncScreenshot::flush()
+{
+	for (unsigned slotIdx = 0; slotIdx < NUM_BUFFERS; ++slotIdx)
+	{
+		if (_slot[slotIdx]._fence) this->waitTransfer(slotIdx, (std::numeric_limits<GLuint64>::max)());
+	}
+
+	try
+	{
+		_encodingTasks.wait();
+	}
+	catch (std::exception& exception)
+	{
+		std::cout << "Screenshot could not be encoded: " << exception.what() << std::endl;
+	}
+}
+
+void AsyncScreenshot::update()
+{
+	for (unsigned slotIdx = 0; slotIdx < NUM_BUFFERS; ++slotIdx)
+	{
+		if (_slot[slotIdx]._fence) this->waitTransfer(slotIdx, 0);
+	}
+}
+
+/// [Protected methods]
+
+void AsyncScreenshot::encodeImage(const unsigned slotIdx)
+{
+	Profiler::ScopedZone zone("Screenshot encoding");
+
+	// Rows are flipped while copying out of the mapped buffer, which is released before the slower encoding starts
+	const Slot& slot = _slot[slotIdx];
+	const uvec2 size = slot._size;
+	const size_t rowSize = size_t(size.x) * 4;
+	const std::string filename = slot._filename;
+	std::vector<GLubyte> pixels(rowSize * size.y);
+
+	for (unsigned row = 0; row < size.y; ++row)
+	{
+		memcpy(pixels.data() + row * rowSize, slot._pixels + (size.y - row - 1) * rowSize, rowSize);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_slot[slotIdx]._state = FREE;
+	}
+
+	_slotCondition.notify_all();
+
+	if (!FileManagement::saveImage(filename, &pixels, size.x, size.y))
+	{
+		std::cout << "Screenshot " << filename << " could not be written!" << std::endl;
+	}
+}
+
+void AsyncScreenshot::enqueue(const unsigned slotIdx)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_slot[slotIdx]._state = ENCODING;
+	}
+
+	_encodingTasks.run([this, slotIdx]() { this->encodeImage(slotIdx); });
+}
+
+void AsyncScreenshot::reserve(Slot& slot, const size_t bytes)
+{
+	if (slot._capacity >= bytes)
+	{
+		return;
+	}
+
+	const GLbitfield mapFlags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	if (slot._pbo)
+	{
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot._pbo);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		glDeleteBuffers(1, &slot._pbo);
+		MemoryTracker::getInstance()->releaseBuffer(slot._pbo);
+	}
+
+	// Client storage hints the driver to keep the buffer in host memory, where workers read it
+	glGenBuffers(1, &slot._pbo);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot._pbo);
+	glBufferStorage(GL_PIXEL_PACK_BUFFER, bytes, nullptr, mapFlags | GL_CLIENT_STORAGE_BIT);
+	slot._pixels = static_cast<GLubyte*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, mapFlags));
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	MemoryTracker::ScopedTag tag("Screenshots");
+	MemoryTracker::getInstance()->registerBuffer(slot._pbo, bytes);
+
+	slot._capacity = bytes;
+}
+
+bool AsyncScreenshot::waitTransfer(const unsigned slotIdx, const GLuint64 timeout)
+{
+	Slot& slot = _slot[slotIdx];
+	const GLenum result = glClientWaitSync(slot._fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+
+	if (result == GL_TIMEOUT_EXPIRED)
+	{
+		return false;
+	}
+
+	glDeleteSync(slot._fence);
+	slot._fence = nullptr;
+	this->enqueue(slotIdx);
+
+	return true;
+}
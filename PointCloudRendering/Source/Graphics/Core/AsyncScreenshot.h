@@ -0,0 +1,99 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+
+#include "Graphics/Core/FBOScreenshot.h"
+#include "Utilities/ThreadPool.h"
+
+/**
+*	@file AsyncScreenshot.h
+*	@authors Alfonso Lpez Ruiz (alr00048@red.ujaen.es)
+*	@date 19/10/2026
+*/
+
+/**
+*	@brief Screenshot capture which does not stall the render loop. The framebuffer is read into a ring of persistently mapped pixel-pack
+*	buffers guarded by fences, and every image is flipped and encoded by the thread pool once the GPU has finished the transfer.
+*	Every OpenGL call is issued from the thread which owns the context; encoding tasks only read the mapped memory of their buffer.
+*/
+class AsyncScreenshot
+{
+protected:
+	const static unsigned NUM_BUFFERS;										//!< Captures which can be in flight at the same time
+
+protected:
+	enum SlotState
+	{
+		FREE, READING, ENCODING
+	};
+
+	struct Slot
+	{
+		GLuint			_pbo;												//!< Pixel-pack buffer
+		GLubyte*		_pixels;											//!< Persistent mapping of the buffer
+		size_t			_capacity;											//!< Bytes of the buffer
+		GLsync			_fence;												//!< Signalled once the pixels have been transferred
+		uvec2			_size;												//!< Size of the captured image
+		std::string		_filename;											//!< Path where the image is saved
+		SlotState		_state;												//!< Stage of the capture, guarded by the mutex
+	};
+
+protected:
+	std::vector<Slot>			_slot;										//!< Ring of readback buffers
+	ThreadPool::TaskGroup		_encodingTasks;								//!< Captures which have not been written yet
+	std::mutex					_mutex;										//!< Guards the state of every slot
+	std::condition_variable		_slotCondition;								//!< Wakes the render thread when a slot is freed
+	unsigned					_nextSlot;									//!< Oldest slot of the ring
+
+protected:
+	/**
+	*	@brief Flips and writes the capture of a slot whose transfer is finished, releasing the slot as soon as its pixels are copied.
+	*/
+	void encodeImage(const unsigned slotIdx);
+
+	/**
+	*	@brief Hands a slot whose fence has been signalled to the thread pool.
+	*/
+	void enqueue(const unsigned slotIdx);
+
+	/**
+	*	@brief Reallocates the buffer of a free slot if it cannot hold the given number of bytes.
+	*/
+	void reserve(Slot& slot, const size_t bytes);
+
+	/**
+	*	@brief Checks the fence of a slot which is being read.
+	*	@param timeout Nanoseconds to wait for the transfer, zero to just poll it.
+	*	@return True if the transfer is finished and the slot has been enqueued.
+	*/
+	bool waitTransfer(const unsigned slotIdx, const GLuint64 timeout);
+
+public:
+	/**
+	*	@brief Constructor. Buffers are allocated on the first capture, once the size of the images is known.
+	*/
+	AsyncScreenshot();
+
+	/**
+	*	@brief Destructor. Waits for the pending captures before releasing the buffers.
+	*/
+	virtual ~AsyncScreenshot();
+
+	/**
+	*	@brief Starts reading the content of a framebuffer. Only blocks if every buffer of the ring is still in use.
+	*	@return False if the framebuffer is not valid.
+	*/
+	bool capture(const FBOScreenshot& fbo, const std::string& filename);
+
+	/**
+	*	@brief Waits until every capture has been written.
+	*/
+	void flush();
+
+	/**
+	*	@brief Hands finished transfers to the thread pool. Must be called periodically from the thread which owns the context.
+	*/
+	void update();
+};
+
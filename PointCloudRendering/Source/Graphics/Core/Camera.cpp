@@ -33,6 +33,8 @@ Camera::Camera(const uint16_t width, const uint16_t height): _backupCamera(nullp
 	_zNear	= ZNEAR;
 	_zFar	= ZFAR;
 
+	_projectionWindow = vec4(-1.0f, -1.0f, 1.0f, 1.0f);
+
 	_width	= width;
 	_height = height;
 	_aspect = this->computeAspect();
@@ -129,6 +131,13 @@ void Camera::setPosition(const vec3& position)
 	this->computeViewMatrices();
 }
 
+void Camera::setProjectionWindow(const vec4& window)
+{
+	_projectionWindow = window;
+
+	this->computeProjectionMatrices();
+}
+
 void Camera::setRaspect(const uint16_t width, const uint16_t height)
 {
 	_width	= width;
@@ -313,7 +322,11 @@ float Camera::computeFovY()
 
 void Camera::computeProjectionMatrices()
 {
-	_projectionMatrix = CAMERA_PROJECTION[_cameraType]->calculateProjectionMatrix(this);
+	// Off-centre projection of a window of the view volume: its normalized coordinates are scaled and translated into [-1, 1]
+	const vec2 windowMin = vec2(_projectionWindow.x, _projectionWindow.y), windowMax = vec2(_projectionWindow.z, _projectionWindow.w);
+	const mat4 windowMatrix = glm::scale(glm::translate(mat4(1.0f), vec3(-(windowMax + windowMin) / (windowMax - windowMin), .0f)), vec3(2.0f / (windowMax - windowMin), 1.0f));
+
+	_projectionMatrix = windowMatrix * CAMERA_PROJECTION[_cameraType]->calculateProjectionMatrix(this);
 	_viewProjectionMatrix = _projectionMatrix * _viewMatrix;
 }
 
@@ -346,6 +359,7 @@ void Camera::copyCameraAttributes(const Camera* camera)
 	this->_viewMatrix			= camera->_viewMatrix;
 	this->_projectionMatrix		= camera->_projectionMatrix;
 	this->_viewProjectionMatrix = camera->_viewProjectionMatrix;
+	this->_projectionWindow		= camera->_projectionWindow;
 
 	this->_fovX = camera->_fovX;
 	this->_fovY = camera->_fovY;
@@ -47,6 +47,7 @@ protected:
 	mat4			_viewMatrix,						//!< World point => Camera system
 					_projectionMatrix,					//!< Camera system => Normalized system
 					_viewProjectionMatrix;				//!< World point => Normalized system
+	vec4			_projectionWindow;					//!< Region of the normalized view volume stretched over the viewport (min x, min y, max x, max y)
 
 	Camera*			_backupCamera;						//!< Copy of the initial camera so the user can reset it anytime
 
@@ -238,6 +239,12 @@ public:
 	*/
 	void setPosition(const vec3& position);
 
+	/**
+	*	@brief Restricts the projection to a region of the normalized view volume, so that a tile of a larger image fills the viewport.
+	*	@param window Minimum and maximum normalized coordinates (x, y, z, w => min x, min y, max x, max y). The whole volume is [-1, 1].
+	*/
+	void setProjectionWindow(const vec4& window = vec4(-1.0f, -1.0f, 1.0f, 1.0f));
+
 	/**
 	*	@brief Modifies the aspect of the view volume in x and y axes.
 	*	@param width Width of screen (persp) or width of canonical view volume (ortho).
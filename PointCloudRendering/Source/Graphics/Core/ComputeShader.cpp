@@ -42,52 +42,48 @@ GLuint ComputeShader::createShaderProgram(const char* filename)
 		}
 	}
 
+	_name = filename;
+
 	char fileNameComplete[256];
 	strcpy_s(fileNameComplete, filename);
 	strcat_s(fileNameComplete, "-comp.glsl");
-	const GLuint vertexShaderObject = compileShader(fileNameComplete, GL_COMPUTE_SHADER);
-	if (vertexShaderObject == 0) 
+
+	std::string shaderSource;
+	if (!this->preprocessShader(fileNameComplete, shaderSource))
 	{
 		return 0;
 	}
 
-	glAttachShader(_handler, vertexShaderObject);				// Link shader program and compute shader
-	glLinkProgram(_handler);									// Link shader program to check errors
-	GLint linkSuccess = 0;
-	glGetProgramiv(_handler, GL_LINK_STATUS, &linkSuccess);
-
-	if (linkSuccess == GL_FALSE)
+	this->computeBinaryKey({ shaderSource });
+	if (this->loadProgramBinary())								// Warm start: no GLSL compilation at all
 	{
-		GLint logLen = 0;
-		glGetProgramiv(_handler, GL_INFO_LOG_LENGTH, &logLen);
+		_linked = true;
+		this->reserveSubroutines();
 
-		if (logLen > 0) 
-		{
-			char* cLogString = new char[logLen];
-			GLint written = 0;
-			
-			glGetProgramInfoLog(_handler, logLen, &written, cLogString);
-			_logString.assign(cLogString);
-			delete[] cLogString;
-
-			std::cout << "Cannot link shader " << filename << ":" << std::endl << _logString << std::endl;
-		}
+		return _handler;
+	}
 
+	const GLuint computeShaderObject = this->compileShaderSource(shaderSource, GL_COMPUTE_SHADER);
+	if (computeShaderObject == 0) 
+	{
 		return 0;
 	}
-	else
+
+	this->linkProgram({ computeShaderObject });					// Link shader program and compute shader
+
+	return (_linked || _pendingLink) ? _handler : 0;
+}
+
+void ComputeShader::deleteBuffers(const GLsizei numBuffers, const GLuint* bufferID)
+{
+	MemoryTracker* memoryTracker = MemoryTracker::getInstance();
+
+	for (GLsizei bufferIdx = 0; bufferIdx < numBuffers; ++bufferIdx)
 	{
-		_linked = true;
+		memoryTracker->releaseBuffer(bufferID[bufferIdx]);
 	}
 
-	// Reserve space for subroutines
-	GLint numSubroutines;
-	
-	glGetProgramStageiv(_handler, GL_COMPUTE_SHADER, GL_ACTIVE_SUBROUTINE_UNIFORMS, &numSubroutines);
-	_activeSubroutineUniform[COMPUTE_SHADER].resize(numSubroutines);
-	std::fill(_activeSubroutineUniform[COMPUTE_SHADER].begin(), _activeSubroutineUniform[COMPUTE_SHADER].end(), -1);		// Non valid id
-
-	return _handler;
+	glDeleteBuffers(numBuffers, bufferID);
 }
 
 void ComputeShader::execute(GLuint numGroups_x, GLuint numGroups_y, GLuint numGroups_z, GLuint workGroup_x, GLuint workGroup_y, GLuint workGroup_z)
@@ -126,4 +122,15 @@ void ComputeShader::setImageUniform(const GLint id, const std::string& shaderVar
 {
 	int location = glGetUniformLocation(_handler, shaderVariable.c_str());
 	glProgramUniform1i(_handler, location, id);
-}
\ No newline at end of file
+}
+
+/// [Protected methods]
+
+void ComputeShader::reserveSubroutines()
+{
+	GLint numSubroutines;
+	
+	glGetProgramStageiv(_handler, GL_COMPUTE_SHADER, GL_ACTIVE_SUBROUTINE_UNIFORMS, &numSubroutines);
+	_activeSubroutineUniform[COMPUTE_SHADER].resize(numSubroutines);
+	std::fill(_activeSubroutineUniform[COMPUTE_SHADER].begin(), _activeSubroutineUniform[COMPUTE_SHADER].end(), -1);		// Non valid id
+}
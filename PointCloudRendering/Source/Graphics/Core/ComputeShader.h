@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Graphics/Core/ShaderProgram.h"
+#include "Utilities/MemoryTracker.h"
 
 /**
 *	@file ComputeShader.h
@@ -19,6 +20,12 @@ public:
 protected:
 	static std::vector<GLint> MAX_WORK_GROUP_SIZE;					//!< This value can be useful since the number of groups is not as limited as group size
 
+protected:
+	/**
+	*	@brief Reserves space for the subroutine uniforms of the compute stage.
+	*/
+	virtual void reserveSubroutines();
+
 public:	
 	/**
 	*	@brief Default constructor.
@@ -46,6 +53,16 @@ public:
 	*/
 	virtual GLuint createShaderProgram(const char* filename);
 
+	/**
+	*	@brief Deletes a buffer created by this class.
+	*/
+	static void deleteBuffer(const GLuint bufferID) { deleteBuffers(1, &bufferID); }
+
+	/**
+	*	@brief Deletes buffers created by this class, so that they are no longer accounted by the memory tracker.
+	*/
+	static void deleteBuffers(const GLsizei numBuffers, const GLuint* bufferID);
+
 	/**
 	*	@brief Executes the compute shader with many groups and works as specified and waits till the execution is over.
 	*/
@@ -147,6 +164,7 @@ inline GLuint ComputeShader::setReadBuffer(const std::vector<T>& data, const GLu
 	glGenBuffers(1, &id);
 	glBindBuffer(GL_SHADER_STORAGE_BUFFER, id);
 	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(T) * data.size(), data.data(), changeFrequency);
+	MemoryTracker::getInstance()->registerBuffer(id, sizeof(T) * data.size());
 
 	return id;
 }
@@ -158,6 +176,7 @@ inline GLuint ComputeShader::setReadBuffer(const T* data, const unsigned arraySi
 	glGenBuffers(1, &id);
 	glBindBuffer(GL_SHADER_STORAGE_BUFFER, id);
 	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(T) * arraySize, data, changeFrequency);
+	MemoryTracker::getInstance()->registerBuffer(id, sizeof(T) * arraySize);
 
 	return id;
 }
@@ -169,6 +188,7 @@ inline GLuint ComputeShader::setReadData(const T& data, const GLuint changeFrequ
 	glGenBuffers(1, &id);
 	glBindBuffer(GL_SHADER_STORAGE_BUFFER, id);
 	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(T), &data, changeFrequency);
+	MemoryTracker::getInstance()->registerBuffer(id, sizeof(T));
 
 	return id;
 }
@@ -180,6 +200,7 @@ inline GLuint ComputeShader::setWriteBuffer(const T& dataType, const GLuint arra
 	glGenBuffers(1, &id);
 	glBindBuffer(GL_SHADER_STORAGE_BUFFER, id);
 	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(dataType) * arraySize, nullptr, changeFrequency);
+	MemoryTracker::getInstance()->registerBuffer(id, sizeof(dataType) * arraySize);
 
 	return id;
 }
@@ -189,6 +210,7 @@ inline void ComputeShader::updateReadBuffer(const GLuint id, const T* data, cons
 {
 	glBindBuffer(GL_SHADER_STORAGE_BUFFER, id);
 	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(T) * arraySize, data, changeFrequency);
+	MemoryTracker::getInstance()->registerBuffer(id, sizeof(T) * arraySize);
 }
 
 template<typename T>
@@ -196,4 +218,5 @@ inline void ComputeShader::updateWriteBuffer(const GLuint id, const T& dataType,
 {
 	glBindBuffer(GL_SHADER_STORAGE_BUFFER, id);
 	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(dataType) * arraySize, nullptr, changeFrequency);
+	MemoryTracker::getInstance()->registerBuffer(id, sizeof(dataType) * arraySize);
 }
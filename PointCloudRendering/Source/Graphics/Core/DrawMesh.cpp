@@ -0,0 +1,57 @@
+#include "stdafx.h"
+#include "DrawMesh.h"
+
+#include "Graphics/Application/MaterialList.h"
+
+/// [Public methods]
+
+DrawMesh::DrawMesh(TriangleMesh* mesh, const mat4& modelMatrix) :
+	Model3D(modelMatrix, 1), _triangleMesh(mesh)
+{
+}
+
+DrawMesh::~DrawMesh()
+{
+	delete _triangleMesh;
+}
+
+bool DrawMesh::load(const mat4& modelMatrix)
+{
+	if (_loaded) return true;
+	if (!_triangleMesh || !_triangleMesh->getNumTriangles()) return false;
+
+	ModelComponent* modelComp = _modelComp[0];
+	const bool hasTangents = _triangleMesh->_tangent.size() == _triangleMesh->_position.size();
+
+	modelComp->_geometry.resize(_triangleMesh->_position.size());
+	std::for_each(std::execution::par_unseq, modelComp->_geometry.begin(), modelComp->_geometry.end(), [&](VertexGPUData& vertex)
+		{
+			const size_t vertexIdx = &vertex - modelComp->_geometry.data();
+
+			vertex._position = vec3(_triangleMesh->_position[vertexIdx]);
+			vertex._normal = _triangleMesh->_normal[vertexIdx];
+			vertex._textCoord = _triangleMesh->_textCoord[vertexIdx];
+			vertex._tangent = hasTangents ? _triangleMesh->_tangent[vertexIdx] : vec3(.0f);
+		});
+
+	// Every triangle is closed by the restart index, as in the rest of triangle topologies
+	modelComp->_triangleMesh.resize(_triangleMesh->_face.size() * 4);
+	std::for_each(std::execution::par_unseq, _triangleMesh->_face.begin(), _triangleMesh->_face.end(), [&](const TriangleMesh::Face& face)
+		{
+			GLuint* indices = &modelComp->_triangleMesh[(&face - _triangleMesh->_face.data()) * 4];
+
+			std::copy(face._index, face._index + 3, indices);
+			indices[3] = RESTART_PRIMITIVE_INDEX;
+		});
+
+	modelComp->buildPointCloudTopology();
+	modelComp->buildWireframeTopology();
+	modelComp->_material = MaterialList::getInstance()->getMaterial(CGAppEnum::MATERIAL_CAD_WHITE);
+
+	this->setVAOData();
+	modelComp->releaseMemory();
+
+	this->_loaded = true;
+
+	return true;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "Geometry/3D/TriangleMesh.h"
+#include "Graphics/Core/Model3D.h"
+
+/**
+*	@file DrawMesh.h
+*	@authors Alfonso Lpez Ruiz (alr00048@red.ujaen.es)
+*	@date 19/10/2026
+*/
+
+/**
+*	@brief Painter of a triangle mesh built at runtime, e.g. a terrain extracted from the point cloud.
+*/
+class DrawMesh: public Model3D
+{
+protected:
+	TriangleMesh*	_triangleMesh;				//!< Geometry and topology to be sent to GPU, owned by this model
+
+public:
+	/**
+	*	@brief Constructor.
+	*	@param mesh Triangle mesh, which is deleted together with this model.
+	*	@param modelMatrix First model transformation.
+	*/
+	DrawMesh(TriangleMesh* mesh, const mat4& modelMatrix = mat4(1.0f));
+
+	/**
+	*	@brief Destructor.
+	*/
+	virtual ~DrawMesh();
+
+	/**
+	*	@return Triangle mesh which is rendered.
+	*/
+	TriangleMesh* getTriangleMesh() const { return _triangleMesh; }
+
+	/**
+	*	@brief Sends the mesh data to GPU.
+	*	@return Success of operation.
+	*/
+	virtual bool load(const mat4& modelMatrix = mat4(1.0f));
+};
+
@@ -72,16 +72,11 @@ bool FBOScreenshot::bindFBO()
 
 Image* FBOScreenshot::getImage() const
 {
-	if (!_success)
+	if (!this->resolve())
 	{
 		return nullptr;
 	}
 
-	glBindFramebuffer(GL_READ_FRAMEBUFFER, _multisampledFBO);
-	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _id);
-	glBlitFramebuffer(0, 0, _size.x, _size.y, 0, 0, _size.x, _size.y, GL_COLOR_BUFFER_BIT, GL_LINEAR);
-	glBindFramebuffer(GL_FRAMEBUFFER, _id);
-
 	GLubyte* pixels = (GLubyte*)malloc((int) _size.x * (int) _size.y * 4);
 	glReadPixels(0, 0, _size.x, _size.y, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
 
@@ -118,6 +113,21 @@ void FBOScreenshot::modifySize(const uint16_t width, const uint16_t height)
 	}
 }
 
+bool FBOScreenshot::resolve() const
+{
+	if (!_success)
+	{
+		return false;
+	}
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, _multisampledFBO);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _id);
+	glBlitFramebuffer(0, 0, _size.x, _size.y, 0, 0, _size.x, _size.y, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+	glBindFramebuffer(GL_FRAMEBUFFER, _id);
+
+	return true;
+}
+
 bool FBOScreenshot::saveImage(const std::string& filename)
 {
 	Image* image = this->getImage();
@@ -127,6 +137,8 @@ bool FBOScreenshot::saveImage(const std::string& filename)
 		image->flipImageVertically();
 		image->saveImage(filename);
 
+		delete image;
+
 		return true;
 	}
 
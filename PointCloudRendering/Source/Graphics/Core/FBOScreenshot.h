@@ -53,6 +53,12 @@ public:
 	*/
 	virtual void modifySize(const uint16_t width, const uint16_t height);
 
+	/**
+	*	@brief Resolves the multisampled framebuffer, which is left bound for reading.
+	*	@return False if the framebuffer is not valid.
+	*/
+	bool resolve() const;
+
 	/**
 	*	@brief Saves the captured scene in a file.
 	*	@param filename Path of file.
@@ -11,10 +11,14 @@
 #include "Graphics/Core/VAO.h"
 #include "Utilities/ChronoUtilities.h"
 
+/// [Static members initialization]
+
+const unsigned Group3D::BVH_DEFAULT_RADIUS = 16;
+
 /// [Public methods]
 
 Group3D::Group3D(const mat4& modelMatrix):
-	Model3D(modelMatrix, 1)		
+	Model3D(modelMatrix, 1), _staticGPUData{ 0, 0, 0, 0, 0, 0, .0f }
 {
 }
 
@@ -24,6 +28,8 @@ Group3D::~Group3D()
 	{
 		delete object;
 	}
+
+	this->deleteStaticGPUData();
 }
 
 void Group3D::addComponent(Model3D* object)
@@ -31,6 +37,127 @@ void Group3D::addComponent(Model3D* object)
 	_objects.push_back(object);
 }
 
+bool Group3D::buildBVH(const unsigned radius)
+{
+	MemoryTracker::ScopedTag tag("Mesh BVH");
+
+	if (_globalModelComp.empty()) this->registerScene();
+
+	AABB aabb;
+	if (!this->aggregateStaticGPUData(aabb)) return false;
+
+	ShaderList* shaderList = ShaderList::getInstance();
+	shaderList->compileComputeShaders({
+		RendEnum::COMPUTE_MORTON_CODES, RendEnum::BUILD_CLUSTER_BUFFER, RendEnum::FIND_BEST_NEIGHBOR, RendEnum::CLUSTER_MERGING,
+		RendEnum::REALLOCATE_CLUSTERS, RendEnum::END_LOOP_COMPUTATIONS
+	});
+
+	ComputeShader* computeMortonShader	= shaderList->getComputeShader(RendEnum::COMPUTE_MORTON_CODES);
+	ComputeShader* buildClusterShader	= shaderList->getComputeShader(RendEnum::BUILD_CLUSTER_BUFFER);
+	ComputeShader* findNeighborShader	= shaderList->getComputeShader(RendEnum::FIND_BEST_NEIGHBOR);
+	ComputeShader* mergeClustersShader	= shaderList->getComputeShader(RendEnum::CLUSTER_MERGING);
+	ComputeShader* reallocateShader		= shaderList->getComputeShader(RendEnum::REALLOCATE_CLUSTERS);
+	ComputeShader* endLoopShader		= shaderList->getComputeShader(RendEnum::END_LOOP_COMPUTATIONS);
+
+	glFinish();																		// Uploading the faces is not part of the build
+	ChronoUtilities::initChrono();
+
+	const unsigned arraySize	= _staticGPUData._numTriangles;
+	const unsigned clusterSize	= arraySize * 2 - 1;
+	const int numGroups			= ComputeShader::getNumGroups(arraySize);
+	const int maxGroupSize		= ComputeShader::getMaxGroupSize();
+
+	// Morton codes of face centroids, so that close faces are also close in the cluster array
+	const GLuint mortonCodeSSBO = ComputeShader::setWriteBuffer(GLuint(), arraySize);
+
+	computeMortonShader->bindBuffers(std::vector<GLuint> { _staticGPUData._faceSSBO, mortonCodeSSBO });
+	computeMortonShader->use();
+	computeMortonShader->setUniform("arraySize", arraySize);
+	computeMortonShader->setUniform("sceneMaxBoundary", aabb.max());
+	computeMortonShader->setUniform("sceneMinBoundary", aabb.min());
+	computeMortonShader->execute(numGroups, 1, 1, maxGroupSize, 1, 1);
+
+	const GLuint sortedIndicesSSBO = OpenGLUtilities::sortByMortonCode(mortonCodeSSBO, arraySize);
+
+	// Leaves: clusters are merged in a temporary buffer while the tree is written into the cluster buffer
+	std::vector<GLuint> currentPosition(arraySize);
+	std::iota(currentPosition.begin(), currentPosition.end(), 0);
+
+	_staticGPUData._clusterSSBO		= ComputeShader::setWriteBuffer(BVHCluster(), clusterSize);
+	GLuint tempClusterSSBO			= ComputeShader::setWriteBuffer(BVHCluster(), arraySize);
+	GLuint tempCluster2SSBO			= ComputeShader::setWriteBuffer(BVHCluster(), arraySize);
+	GLuint currentPositionSSBO		= ComputeShader::setReadBuffer(currentPosition);
+	GLuint currentPosition2SSBO		= ComputeShader::setWriteBuffer(GLuint(), arraySize);
+	const GLuint neighborSSBO		= ComputeShader::setWriteBuffer(GLuint(), arraySize);
+	const GLuint validClusterSSBO	= ComputeShader::setWriteBuffer(GLuint(), arraySize);
+	const GLuint mergedClusterSSBO	= ComputeShader::setWriteBuffer(GLuint(), arraySize);
+	const GLuint prefixScanSSBO		= ComputeShader::setWriteBuffer(GLuint(), arraySize);
+	const GLuint numNodesSSBO		= ComputeShader::setReadData(arraySize);
+	const GLuint numClustersSSBO	= ComputeShader::setReadData(arraySize);
+
+	buildClusterShader->bindBuffers(std::vector<GLuint> { _staticGPUData._faceSSBO, sortedIndicesSSBO, _staticGPUData._clusterSSBO, tempClusterSSBO });
+	buildClusterShader->use();
+	buildClusterShader->setUniform("arraySize", arraySize);
+	buildClusterShader->execute(numGroups, 1, 1, maxGroupSize, 1, 1);
+
+	unsigned numClusters = arraySize;
+	bool success = true;
+
+	while (numClusters > 1)
+	{
+		const int numClusterGroups = ComputeShader::getNumGroups(numClusters);
+
+		// FIRST STEP: nearest neighbour of every cluster within the radius
+		findNeighborShader->bindBuffers(std::vector<GLuint> { tempClusterSSBO, neighborSSBO });
+		findNeighborShader->use();
+		findNeighborShader->setUniform("arraySize", numClusters);
+		findNeighborShader->setUniform("radius", radius);
+		findNeighborShader->execute(numClusterGroups, 1, 1, maxGroupSize, 1, 1);
+
+		// SECOND STEP: mutual neighbours are merged into a new node
+		mergeClustersShader->bindBuffers(std::vector<GLuint> { tempClusterSSBO, _staticGPUData._clusterSSBO, neighborSSBO, validClusterSSBO, mergedClusterSSBO, prefixScanSSBO, currentPositionSSBO, numNodesSSBO });
+		mergeClustersShader->use();
+		mergeClustersShader->setUniform("arraySize", numClusters);
+		mergeClustersShader->execute(numClusterGroups, 1, 1, maxGroupSize, 1, 1);
+
+		// THIRD STEP: compact the clusters which are still valid
+		OpenGLUtilities::exclusivePrefixScan(prefixScanSSBO, numClusters);
+
+		endLoopShader->bindBuffers(std::vector<GLuint> { numClustersSSBO, prefixScanSSBO, validClusterSSBO });
+		endLoopShader->use();
+		endLoopShader->setUniform("arraySize", numClusters);
+		endLoopShader->execute(1, 1, 1, 1, 1, 1);
+
+		reallocateShader->bindBuffers(std::vector<GLuint> { tempClusterSSBO, tempCluster2SSBO, validClusterSSBO, prefixScanSSBO, currentPositionSSBO, currentPosition2SSBO });
+		reallocateShader->use();
+		reallocateShader->setUniform("arraySize", numClusters);
+		reallocateShader->execute(numClusterGroups, 1, 1, maxGroupSize, 1, 1);
+
+		std::swap(tempClusterSSBO, tempCluster2SSBO);
+		std::swap(currentPositionSSBO, currentPosition2SSBO);
+
+		const unsigned remainingClusters = *ComputeShader::readData(numClustersSSBO, GLuint());
+		if (remainingClusters >= numClusters)										// Ties in the merging cost can prevent clusters from being mutual neighbours
+		{
+			std::cout << "BVH construction stalled with " << numClusters << " clusters!" << std::endl;
+			success = false;
+			break;
+		}
+
+		numClusters = remainingClusters;
+	}
+
+	_staticGPUData._numClusters = *ComputeShader::readData(numNodesSSBO, GLuint());
+	_staticGPUData._buildTime = ChronoUtilities::getDuration(ChronoUtilities::MICROSECONDS) / 1000.0f;
+
+	GLuint buffers[] = { mortonCodeSSBO, sortedIndicesSSBO, tempClusterSSBO, tempCluster2SSBO, currentPositionSSBO, currentPosition2SSBO, neighborSSBO, validClusterSSBO, mergedClusterSSBO, prefixScanSSBO, numNodesSSBO, numClustersSSBO };
+	ComputeShader::deleteBuffers(sizeof(buffers) / sizeof(GLuint), buffers);
+
+	std::cout << "BVH built over " << arraySize << " triangles in " << _staticGPUData._buildTime << " ms (" << this->getBVHBuildTimePerMillionTriangles() << " ms per million triangles)" << std::endl;
+
+	return success;
+}
+
 Model3D::ModelComponent* Group3D::getModelComponent(unsigned id)
 {
 	return _globalModelComp[id];
@@ -120,4 +247,65 @@ void Group3D::drawAsTriangles4Shadows(RenderingShader* shader, const RendEnum::R
 	{
 		object->drawAsTriangles4Shadows(shader, shaderType, matrix);
 	}
-}
\ No newline at end of file
+}
+
+/// [Protected methods]
+
+bool Group3D::aggregateStaticGPUData(AABB& aabb)
+{
+	MemoryTracker::ScopedTag tag("Meshes");
+
+	this->deleteStaticGPUData();
+
+	std::vector<unsigned> vertexOffset(_globalModelComp.size() + 1, 0), faceOffset(_globalModelComp.size() + 1, 0);
+
+	for (unsigned compIdx = 0; compIdx < _globalModelComp.size(); ++compIdx)
+	{
+		vertexOffset[compIdx + 1] = vertexOffset[compIdx] + unsigned(_globalModelComp[compIdx]->_geometry.size());
+		faceOffset[compIdx + 1] = faceOffset[compIdx] + unsigned(_globalModelComp[compIdx]->_topology.size());
+	}
+
+	if (!faceOffset.back()) return false;
+
+	std::vector<VertexGPUData> geometry(vertexOffset.back());
+	std::vector<FaceGPUData> topology(faceOffset.back());
+
+	for (unsigned compIdx = 0; compIdx < _globalModelComp.size(); ++compIdx)
+	{
+		const ModelComponent* modelComp = _globalModelComp[compIdx];
+		const unsigned startVertex = vertexOffset[compIdx];
+
+		std::copy(modelComp->_geometry.begin(), modelComp->_geometry.end(), geometry.begin() + startVertex);
+		std::transform(std::execution::par_unseq, modelComp->_topology.begin(), modelComp->_topology.end(), topology.begin() + faceOffset[compIdx], [&](FaceGPUData face)
+			{
+				face._vertices += uvec3(startVertex);
+
+				const vec3& v1 = geometry[face._vertices.x]._position, & v2 = geometry[face._vertices.y]._position, & v3 = geometry[face._vertices.z]._position;
+				face._minPoint = glm::min(v1, glm::min(v2, v3));
+				face._maxPoint = glm::max(v1, glm::max(v2, v3));
+
+				return face;
+			});
+	}
+
+	aabb = std::transform_reduce(std::execution::par_unseq, topology.begin(), topology.end(), AABB(),
+		[](AABB aabb1, const AABB& aabb2) -> AABB { aabb1.update(aabb2); return aabb1; },
+		[](const FaceGPUData& face) -> AABB { return AABB(face._minPoint, face._maxPoint); });
+
+	_staticGPUData._geometrySSBO	= ComputeShader::setReadBuffer(geometry, GL_STATIC_DRAW);
+	_staticGPUData._faceSSBO		= ComputeShader::setReadBuffer(topology, GL_STATIC_DRAW);
+	_staticGPUData._numVertices		= unsigned(geometry.size());
+	_staticGPUData._numTriangles	= unsigned(topology.size());
+
+	return true;
+}
+
+void Group3D::deleteStaticGPUData()
+{
+	if (!_staticGPUData._geometrySSBO) return;
+
+	GLuint buffers[] = { _staticGPUData._geometrySSBO, _staticGPUData._faceSSBO, _staticGPUData._clusterSSBO };
+	ComputeShader::deleteBuffers(3, buffers);														// Zero names are silently ignored
+
+	_staticGPUData = StaticGPUData{ 0, 0, 0, 0, 0, 0, .0f };
+}
@@ -19,11 +19,43 @@ class Group3D: public Model3D
 public:
 	struct VolatileGPUData;
 	struct VolatileGroupData;
-	struct StaticGPUData;
+
+	/**
+	*	@brief Geometry and topology of every registered component, gathered into single buffers, and the BVH built over them.
+	*/
+	struct StaticGPUData
+	{
+		GLuint		_geometrySSBO;												//!< Vertices of every registered component (VertexGPUData)
+		GLuint		_faceSSBO;													//!< Faces with global vertex indices (FaceGPUData)
+		GLuint		_clusterSSBO;												//!< BVH nodes (BVHCluster): leaves in Morton order first, root last
+
+		unsigned	_numVertices;												//!< Size of geometry buffer
+		unsigned	_numTriangles;												//!< Size of face buffer
+		unsigned	_numClusters;												//!< Number of BVH nodes
+
+		float		_buildTime;													//!< Milliseconds spent building the BVH, without uploading the faces
+	};
+
+public:
+	const static unsigned				BVH_DEFAULT_RADIUS;				//!< Search radius for the nearest cluster, larger values produce better trees
 		
 protected:
 	std::vector<ModelComponent*>		_globalModelComp;				//!< Wraps every model component from the group
 	std::vector<Model3D*>				_objects;						//!< Elements which take part of the group
+	StaticGPUData						_staticGPUData;					//!< Buffers for GPU queries over the whole group
+
+protected:
+	/**
+	*	@brief Gathers the geometry and topology of every registered component into GPU buffers.
+	*	@param aabb Boundaries of the gathered faces.
+	*	@return False if there are no faces.
+	*/
+	bool aggregateStaticGPUData(AABB& aabb);
+
+	/**
+	*	@brief Releases the GPU buffers of the group.
+	*/
+	void deleteStaticGPUData();
 
 public:
 	/**
@@ -42,6 +74,14 @@ public:
 	*/
 	void addComponent(Model3D* object);
 
+	/**
+	*	@brief Builds a BVH over the faces of every registered component on the GPU. Clusters sorted by Morton code are merged with
+	*	their nearest neighbour (smallest merged surface area) within a radius until a single cluster remains (PLOC).
+	*	@param radius Number of clusters at each side that are considered as neighbours.
+	*	@return False if there are no faces or the clusters could not be merged.
+	*/
+	bool buildBVH(const unsigned radius = BVH_DEFAULT_RADIUS);
+
 	/**
 	*	@brief Loads all those components who belong to this group, applying the model matrix linked to such group.
 	*/
@@ -74,6 +114,26 @@ public:
 	*/
 	std::vector<ModelComponent*>* getRegisteredModelComponents() { return &_globalModelComp; }
 
+	/**
+	*	@return Buffer with the BVH nodes. Leaves reference faces of the face buffer; the root is the last node.
+	*/
+	GLuint getBVHBuffer() const { return _staticGPUData._clusterSSBO; }
+
+	/**
+	*	@return Milliseconds spent building the BVH per million triangles.
+	*/
+	float getBVHBuildTimePerMillionTriangles() const { return _staticGPUData._numTriangles ? _staticGPUData._buildTime * 1e6f / _staticGPUData._numTriangles : .0f; }
+
+	/**
+	*	@return Number of nodes of the BVH, zero if it has not been built.
+	*/
+	unsigned getNumBVHNodes() const { return _staticGPUData._numClusters; }
+
+	/**
+	*	@return Buffers gathered from the registered components.
+	*/
+	const StaticGPUData& getStaticGPUData() const { return _staticGPUData; }
+
 	// ---------------------------- Rendering ---------------------------------
 	
 	/**
@@ -2,6 +2,7 @@
 #include "Image.h"
 
 #include "Utilities/FileManagement.h"
+#include "Utilities/ThreadPool.h"
 
 /// [Public methods]
 
@@ -64,16 +65,11 @@ void Image::flipImageVertically()
 	Image::flipImageVertically(_image, _width, _height, _depth);
 }
 
-void Image::saveImage(const std::string& filename)
+std::future<bool> Image::saveImage(const std::string& filename)
 {
-	// Launch image writing in a thread
-	std::thread writeImageThread(&Image::threadedWriteImage, this, &_image, filename, _width, _height);
-	writeImageThread.detach();
-}
-
-/// [Protected methods]
-
-void Image::threadedWriteImage(std::vector<GLubyte>* pixels, const std::string& filename, const uint16_t width, const uint16_t height)
-{
-	FileManagement::saveImage(filename, pixels, width, height);
+	// The task owns a copy of the pixels as the image may be destroyed before it finishes
+	return ThreadPool::getInstance()->submit([pixels = _image, filename, width = _width, height = _height]() mutable
+		{
+			return FileManagement::saveImage(filename, &pixels, width, height);
+		});
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <future>
+
 /**
 *	@file Image.h
 *	@authors Alfonso Lpez Ruiz (alr00048@red.ujaen.es)
@@ -15,16 +17,6 @@ protected:
 	std::vector<unsigned char> _image;					//!< Image bits
 	unsigned _width, _height, _depth;					//!< Image dimensions
 
-protected:
-	/**
-	*	@brief Writes an image in file system in an isolated thread, so the application doesn't get stuck.
-	*	@param pixels Pixels of image to be written.
-	*	@param filename Path where the image must be written.
-	*	@param width Width of image.
-	*	@param height Height of image.
-	*/
-	void threadedWriteImage(std::vector<GLubyte>* pixels, const std::string& filename, const uint16_t width, const uint16_t height);
-
 public:
 	/**
 	*	@brief Constructor of image from a filename from the system.
@@ -61,10 +53,11 @@ public:
 	void flipImageVertically();
 
 	/**
-	*	@brief Saves the captured scene in a file.
+	*	@brief Saves the captured scene in a file. The image is written by the thread pool from a copy of the pixels, so the application doesn't get stuck.
 	*	@param filename Path of file.
+	*	@return Success of the writing process, once it is finished.
 	*/
-	void saveImage(const std::string& filename);
+	std::future<bool> saveImage(const std::string& filename);
 	
 	// ---------- Getters ------------
 
@@ -0,0 +1,564 @@
+#include "stdafx.h"
+#include "ImageEncoder.h"
+
+#include <filesystem>
+#include "Graphics/Core/TiledImageWriter.h"
+#include "Utilities/ThreadPool.h"
+
+// [Static members initialization]
+
+const std::string ImageEncoder::FORMAT_EXTENSION[NUM_FORMATS] = { ".png", ".qoi", ".tif" };
+const char* ImageEncoder::FORMAT_STR[NUM_FORMATS] = { "PNG", "QOI", "TIFF" };
+
+const size_t ImageEncoder::STRIP_BYTES = 1 << 20;
+const unsigned ImageEncoder::HASH_BITS = 15;
+const unsigned ImageEncoder::MAX_DISTANCE = 32768;
+const unsigned ImageEncoder::MAX_MATCH = 258;
+const unsigned ImageEncoder::MIN_MATCH = 4;
+const unsigned ImageEncoder::TIFF_TILE_SIZE = 256;
+
+const std::vector<uint32_t> ImageEncoder::CRC_TABLE = ImageEncoder::getCRCTable();
+
+/// [Public methods]
+
+bool ImageEncoder::encodePNG(const GLubyte* pixels, const uvec2& size, const unsigned channels, std::vector<GLubyte>& png)
+{
+	const GLubyte colorType[] = { 0, 4, 2, 6 };
+
+	if (channels < 1 || channels > 4 || !size.x || !size.y)
+	{
+		return false;
+	}
+
+	const size_t rowBytes = size_t(size.x) * channels;
+	const unsigned rowsPerStrip = unsigned((std::max)(STRIP_BYTES / (rowBytes + 1), size_t(1)));
+	const unsigned numStrips = (size.y + rowsPerStrip - 1) / rowsPerStrip;
+	std::vector<std::vector<GLubyte>> strip(numStrips);
+	std::vector<uint32_t> stripAdler(numStrips);
+
+	// Every strip is filtered and compressed into its own IDAT chunk; filters only need the previous row, which is read from the image
+	ThreadPool::getInstance()->parallelFor(0, strip.size(), [&](const size_t stripIdx)
+	{
+		std::vector<GLubyte>& chunk = strip[stripIdx];
+		const unsigned firstRow = unsigned(stripIdx) * rowsPerStrip, numRows = (std::min)(rowsPerStrip, size.y - firstRow);
+		std::vector<GLubyte> filtered(numRows * (rowBytes + 1));
+
+		for (unsigned rowIdx = 0; rowIdx < numRows; ++rowIdx)
+		{
+			const GLubyte* row = pixels + (firstRow + rowIdx) * rowBytes;
+			const GLubyte* previousRow = firstRow + rowIdx ? row - rowBytes : nullptr;
+			GLubyte* output = filtered.data() + rowIdx * (rowBytes + 1);
+
+			*output++ = 4;																		// Paeth filter
+
+			for (size_t byteIdx = 0; byteIdx < rowBytes; ++byteIdx)
+			{
+				const int left = byteIdx >= channels ? row[byteIdx - channels] : 0;
+				const int up = previousRow ? previousRow[byteIdx] : 0;
+				const int upLeft = previousRow && byteIdx >= channels ? previousRow[byteIdx - channels] : 0;
+				const int leftDistance = std::abs(up - upLeft), upDistance = std::abs(left - upLeft), upLeftDistance = std::abs(left + up - 2 * upLeft);
+				const int predictor = leftDistance <= upDistance && leftDistance <= upLeftDistance ? left : (upDistance <= upLeftDistance ? up : upLeft);
+
+				output[byteIdx] = GLubyte(row[byteIdx] - predictor);
+			}
+		}
+
+		stripAdler[stripIdx] = ImageEncoder::getAdler32(filtered.data(), filtered.size());
+
+		const size_t start = ImageEncoder::openChunk(chunk, "IDAT");
+		if (!stripIdx)
+		{
+			chunk.push_back(0x78);																// zlib header, 32 KB window
+			chunk.push_back(0x01);
+		}
+
+		ImageEncoder::deflate(filtered.data(), filtered.size(), chunk);
+		ImageEncoder::closeChunk(chunk, start);
+	}, 1);
+
+	const GLubyte signature[] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+	png.assign(signature, signature + sizeof(signature));
+
+	size_t chunk = ImageEncoder::openChunk(png, "IHDR");
+	ImageEncoder::writeBigEndian(png, size.x);
+	ImageEncoder::writeBigEndian(png, size.y);
+	png.insert(png.end(), { 8, colorType[channels - 1], 0, 0, 0 });									// Depth, colour type, compression, filter, interlace
+	ImageEncoder::closeChunk(png, chunk);
+
+	uint32_t adler = 1;
+
+	for (unsigned stripIdx = 0; stripIdx < numStrips; ++stripIdx)
+	{
+		const unsigned numRows = (std::min)(rowsPerStrip, size.y - stripIdx * rowsPerStrip);
+
+		adler = ImageEncoder::combineAdler32(adler, stripAdler[stripIdx], numRows * (rowBytes + 1));
+		png.insert(png.end(), strip[stripIdx].begin(), strip[stripIdx].end());
+		std::vector<GLubyte>().swap(strip[stripIdx]);
+	}
+
+	// The stream is closed with an empty final block and the checksum of the whole filtered image
+	chunk = ImageEncoder::openChunk(png, "IDAT");
+	png.insert(png.end(), { 0x03, 0x00 });
+	ImageEncoder::writeBigEndian(png, adler);
+	ImageEncoder::closeChunk(png, chunk);
+
+	chunk = ImageEncoder::openChunk(png, "IEND");
+	ImageEncoder::closeChunk(png, chunk);
+
+	return true;
+}
+
+bool ImageEncoder::encodeQOI(const GLubyte* pixels, const uvec2& size, const unsigned channels, std::vector<GLubyte>& qoi)
+{
+	if ((channels != 3 && channels != 4) || !size.x || !size.y)
+	{
+		return false;
+	}
+
+	const size_t numPixels = size_t(size.x) * size.y;
+	const size_t pixelsPerStrip = (std::max)(STRIP_BYTES / channels, size_t(1));
+	const unsigned numStrips = unsigned((numPixels + pixelsPerStrip - 1) / pixelsPerStrip);
+
+	auto getPixel = [pixels, channels](const size_t pixelIdx) -> uint32_t
+	{
+		const GLubyte* pixel = pixels + pixelIdx * channels;
+		return uint32_t(pixel[0]) | uint32_t(pixel[1]) << 8 | uint32_t(pixel[2]) << 16 | uint32_t(channels == 4 ? pixel[3] : 255) << 24;
+	};
+
+	auto getHash = [](const uint32_t pixel) -> unsigned
+	{
+		return ((pixel & 0xFF) * 3 + (pixel >> 8 & 0xFF) * 5 + (pixel >> 16 & 0xFF) * 7 + (pixel >> 24) * 11) % 64;
+	};
+
+	// The decoder keeps the last pixel of every hash, so the table at the start of a strip follows from the last pixels of previous strips
+	std::vector<uint64_t> stripMask(numStrips, 0);
+	std::vector<uint32_t> stripLastPixel(numStrips * 64), index(numStrips * 64, 0);
+
+	ThreadPool::getInstance()->parallelFor(0, stripMask.size(), [&](const size_t stripIdx)
+	{
+		uint64_t& mask = stripMask[stripIdx];
+
+		for (size_t pixelIdx = stripIdx * pixelsPerStrip; pixelIdx < (std::min)(numPixels, (stripIdx + 1) * pixelsPerStrip); ++pixelIdx)
+		{
+			const uint32_t pixel = getPixel(pixelIdx);
+			const unsigned hash = getHash(pixel);
+
+			stripLastPixel[stripIdx * 64 + hash] = pixel;
+			mask |= uint64_t(1) << hash;
+		}
+	}, 1);
+
+	for (unsigned stripIdx = 1; stripIdx < numStrips; ++stripIdx)
+	{
+		for (unsigned hash = 0; hash < 64; ++hash)
+		{
+			const bool seen = stripMask[stripIdx - 1] >> hash & 1;
+			index[stripIdx * 64 + hash] = seen ? stripLastPixel[(stripIdx - 1) * 64 + hash] : index[(stripIdx - 1) * 64 + hash];
+		}
+	}
+
+	std::vector<std::vector<GLubyte>> strip(numStrips);
+
+	ThreadPool::getInstance()->parallelFor(0, strip.size(), [&](const size_t stripIdx)
+	{
+		std::vector<GLubyte>& output = strip[stripIdx];
+		const size_t firstPixel = stripIdx * pixelsPerStrip, lastPixel = (std::min)(numPixels, firstPixel + pixelsPerStrip);
+		uint32_t* stripIndex = &index[stripIdx * 64];
+		uint32_t previous = firstPixel ? getPixel(firstPixel - 1) : 0xFF000000u;
+		unsigned run = 0;
+
+		output.reserve((lastPixel - firstPixel) * (channels + 1) / 2);
+
+		for (size_t pixelIdx = firstPixel; pixelIdx < lastPixel; ++pixelIdx)
+		{
+			const uint32_t pixel = getPixel(pixelIdx);
+
+			if (pixel == previous)
+			{
+				if (++run == 62)
+				{
+					output.push_back(GLubyte(0xC0 | (run - 1)));
+					run = 0;
+				}
+
+				continue;
+			}
+
+			if (run)
+			{
+				output.push_back(GLubyte(0xC0 | (run - 1)));
+				run = 0;
+			}
+
+			const unsigned hash = getHash(pixel);
+
+			if (stripIndex[hash] == pixel)
+			{
+				output.push_back(GLubyte(hash));
+			}
+			else if ((pixel >> 24) == (previous >> 24))
+			{
+				stripIndex[hash] = pixel;
+
+				// Differences wrap around, just as the decoder adds them
+				const int dr = int8_t(GLubyte(pixel) - GLubyte(previous)), dg = int8_t(GLubyte(pixel >> 8) - GLubyte(previous >> 8));
+				const int db = int8_t(GLubyte(pixel >> 16) - GLubyte(previous >> 16));
+				const int drdg = int8_t(dr - dg), dbdg = int8_t(db - dg);
+
+				if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+				{
+					output.push_back(GLubyte(0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2)));
+				}
+				else if (dg >= -32 && dg <= 31 && drdg >= -8 && drdg <= 7 && dbdg >= -8 && dbdg <= 7)
+				{
+					output.push_back(GLubyte(0x80 | (dg + 32)));
+					output.push_back(GLubyte((drdg + 8) << 4 | (dbdg + 8)));
+				}
+				else
+				{
+					output.insert(output.end(), { 0xFE, GLubyte(pixel), GLubyte(pixel >> 8), GLubyte(pixel >> 16) });
+				}
+			}
+			else
+			{
+				stripIndex[hash] = pixel;
+				output.insert(output.end(), { 0xFF, GLubyte(pixel), GLubyte(pixel >> 8), GLubyte(pixel >> 16), GLubyte(pixel >> 24) });
+			}
+
+			previous = pixel;
+		}
+
+		if (run) output.push_back(GLubyte(0xC0 | (run - 1)));
+	}, 1);
+
+	qoi.assign({ 'q', 'o', 'i', 'f' });
+	ImageEncoder::writeBigEndian(qoi, size.x);
+	ImageEncoder::writeBigEndian(qoi, size.y);
+	qoi.insert(qoi.end(), { GLubyte(channels), 0 });											// Channels and sRGB colour space
+
+	for (std::vector<GLubyte>& output : strip)
+	{
+		qoi.insert(qoi.end(), output.begin(), output.end());
+		std::vector<GLubyte>().swap(output);
+	}
+
+	qoi.insert(qoi.end(), { 0, 0, 0, 0, 0, 0, 0, 1 });
+
+	return true;
+}
+
+ImageEncoder::Format ImageEncoder::getFormat(const std::string& filename)
+{
+	std::string extension = std::filesystem::path(filename).extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](const char character) { return char(std::tolower(character)); });
+
+	if (extension == ".tiff") return TIFF;
+
+	for (int formatIdx = 0; formatIdx < NUM_FORMATS; ++formatIdx)
+	{
+		if (extension == FORMAT_EXTENSION[formatIdx]) return Format(formatIdx);
+	}
+
+	return PNG;
+}
+
+bool ImageEncoder::saveFloatTIFF(const std::string& filename, const float* values, const uvec2& size, const bool bottomRowFirst)
+{
+	TiledImageWriter writer;
+	if (!writer.open(filename, size, uvec2(TIFF_TILE_SIZE), TiledImageWriter::FLOAT32))
+	{
+		return false;
+	}
+
+	const uvec2 numTiles = writer.getNumTiles();
+	std::vector<float> tile(TIFF_TILE_SIZE * TIFF_TILE_SIZE);
+	bool success = true;
+
+	for (unsigned tileY = 0; tileY < numTiles.y && success; ++tileY)
+	{
+		for (unsigned tileX = 0; tileX < numTiles.x && success; ++tileX)
+		{
+			std::fill(tile.begin(), tile.end(), NAN);												// Tiles exceeding the raster are padded with no data
+
+			for (unsigned y = tileY * TIFF_TILE_SIZE; y < (std::min)(size.y, (tileY + 1) * TIFF_TILE_SIZE); ++y)
+			{
+				const float* row = values + size_t(bottomRowFirst ? size.y - 1 - y : y) * size.x;
+				const unsigned firstX = tileX * TIFF_TILE_SIZE, lastX = (std::min)(size.x, firstX + TIFF_TILE_SIZE);
+
+				std::copy(row + firstX, row + lastX, tile.begin() + (y - tileY * TIFF_TILE_SIZE) * TIFF_TILE_SIZE);
+			}
+
+			success = writer.writeTile(uvec2(tileX, tileY), (const GLubyte*)tile.data());
+		}
+	}
+
+	return writer.close() && success;
+}
+
+bool ImageEncoder::saveImage(const std::string& filename, const GLubyte* pixels, const uvec2& size, const unsigned channels)
+{
+	const Format format = ImageEncoder::getFormat(filename);
+
+	if (format == TIFF)
+	{
+		TiledImageWriter writer;
+		if (channels < 1 || channels > 4 || !writer.open(filename, size, uvec2(TIFF_TILE_SIZE)))
+		{
+			return false;
+		}
+
+		const uvec2 numTiles = writer.getNumTiles();
+		std::vector<GLubyte> tile(TIFF_TILE_SIZE * TIFF_TILE_SIZE * 3);
+		bool success = true;
+
+		for (unsigned tileY = 0; tileY < numTiles.y && success; ++tileY)
+		{
+			for (unsigned tileX = 0; tileX < numTiles.x && success; ++tileX)
+			{
+				std::fill(tile.begin(), tile.end(), 0);
+
+				for (unsigned y = tileY * TIFF_TILE_SIZE; y < (std::min)(size.y, (tileY + 1) * TIFF_TILE_SIZE); ++y)
+				{
+					for (unsigned x = tileX * TIFF_TILE_SIZE; x < (std::min)(size.x, (tileX + 1) * TIFF_TILE_SIZE); ++x)
+					{
+						const GLubyte* pixel = pixels + (size_t(y) * size.x + x) * channels;
+						GLubyte* output = &tile[((y - tileY * TIFF_TILE_SIZE) * TIFF_TILE_SIZE + x - tileX * TIFF_TILE_SIZE) * 3];
+
+						output[0] = pixel[0];
+						output[1] = channels >= 3 ? pixel[1] : pixel[0];								// Gray images are replicated
+						output[2] = channels >= 3 ? pixel[2] : pixel[0];
+					}
+				}
+
+				success = writer.writeTile(uvec2(tileX, tileY), tile.data());
+			}
+		}
+
+		return writer.close() && success;
+	}
+
+	std::vector<GLubyte> encoded;
+	if (!(format == QOI ? ImageEncoder::encodeQOI(pixels, size, channels, encoded) : ImageEncoder::encodePNG(pixels, size, channels, encoded)))
+	{
+		return false;
+	}
+
+	std::ofstream file(filename, std::ios::out | std::ios::binary);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	file.write((const char*)encoded.data(), encoded.size());
+
+	return file.good();
+}
+
+/// [Protected methods]
+
+void ImageEncoder::BitWriter::flush()
+{
+	if (_numBits) _output->push_back(GLubyte(_buffer));
+
+	_buffer = 0;
+	_numBits = 0;
+}
+
+void ImageEncoder::BitWriter::write(const uint32_t value, const unsigned numBits)
+{
+	_buffer |= uint64_t(value) << _numBits;
+	_numBits += numBits;
+
+	while (_numBits >= 8)
+	{
+		_output->push_back(GLubyte(_buffer));
+		_buffer >>= 8;
+		_numBits -= 8;
+	}
+}
+
+void ImageEncoder::BitWriter::writeCode(const uint32_t code, const unsigned length)
+{
+	uint32_t reversed = 0;
+	for (unsigned bitIdx = 0; bitIdx < length; ++bitIdx) reversed |= (code >> bitIdx & 1) << (length - 1 - bitIdx);
+
+	this->write(reversed, length);
+}
+
+void ImageEncoder::closeChunk(std::vector<GLubyte>& output, const size_t start)
+{
+	const uint32_t length = uint32_t(output.size() - start - 8);
+
+	for (unsigned byteIdx = 0; byteIdx < 4; ++byteIdx) output[start + byteIdx] = GLubyte(length >> (24 - byteIdx * 8));
+
+	ImageEncoder::writeBigEndian(output, ImageEncoder::getCRC32(output.data() + start + 4, length + 4));
+}
+
+uint32_t ImageEncoder::combineAdler32(const uint32_t adler1, const uint32_t adler2, const size_t size2)
+{
+	const uint64_t base = 65521, remainder = size2 % base;
+	uint64_t sum1 = adler1 & 0xFFFF, sum2 = remainder * sum1 % base;
+
+	sum1 += (adler2 & 0xFFFF) + base - 1;
+	sum2 += (adler1 >> 16) + (adler2 >> 16) + base - remainder;
+
+	if (sum1 >= base) sum1 -= base;
+	if (sum1 >= base) sum1 -= base;
+	if (sum2 >= base * 2) sum2 -= base * 2;
+	if (sum2 >= base) sum2 -= base;
+
+	return uint32_t(sum1 | sum2 << 16);
+}
+
+void ImageEncoder::deflate(const GLubyte* data, const size_t size, std::vector<GLubyte>& output)
+{
+	const unsigned lengthBase[] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const unsigned lengthExtra[] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const unsigned distanceBase[] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	const unsigned distanceExtra[] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	const size_t start = output.size();
+	std::vector<int64_t> head(size_t(1) << HASH_BITS, -1);
+	BitWriter writer{ &output, 0, 0 };
+
+	auto writeSymbol = [&writer](const unsigned symbol)
+	{
+		if (symbol < 144) writer.writeCode(0x30 + symbol, 8);
+		else if (symbol < 256) writer.writeCode(0x190 + symbol - 144, 9);
+		else if (symbol < 280) writer.writeCode(symbol - 256, 7);
+		else writer.writeCode(0xC0 + symbol - 280, 8);
+	};
+
+	auto insertPosition = [&](const size_t position) -> int64_t
+	{
+		uint32_t key;
+		memcpy(&key, data + position, sizeof(uint32_t));
+
+		int64_t& entry = head[(key * 2654435761u) >> (32 - HASH_BITS)];
+		const int64_t candidate = entry;
+		entry = int64_t(position);
+
+		return candidate;
+	};
+
+	writer.write(2, 3);																			// Non-final block with fixed codes
+
+	size_t position = 0;
+
+	while (position < size)
+	{
+		unsigned length = 0;
+		size_t distance = 0;
+
+		if (position + MIN_MATCH <= size)
+		{
+			const int64_t candidate = insertPosition(position);
+
+			if (candidate >= 0 && position - candidate <= MAX_DISTANCE)
+			{
+				const size_t maxLength = (std::min)(size_t(MAX_MATCH), size - position);
+				while (length < maxLength && data[candidate + length] == data[position + length]) ++length;
+
+				if (length >= MIN_MATCH) distance = position - size_t(candidate);
+				else length = 0;
+			}
+		}
+
+		if (!length)
+		{
+			writeSymbol(data[position++]);
+			continue;
+		}
+
+		const unsigned lengthCode = unsigned(std::upper_bound(lengthBase, lengthBase + 29, length) - lengthBase - 1);
+		const unsigned distanceCode = unsigned(std::upper_bound(distanceBase, distanceBase + 30, unsigned(distance)) - distanceBase - 1);
+
+		writeSymbol(257 + lengthCode);
+		writer.write(length - lengthBase[lengthCode], lengthExtra[lengthCode]);
+		writer.writeCode(distanceCode, 5);
+		writer.write(unsigned(distance) - distanceBase[distanceCode], distanceExtra[distanceCode]);
+
+		// Positions within the match are indexed as well, since rows of images repeat at long distances
+		for (size_t matched = position + 1; matched < position + length && matched + MIN_MATCH <= size; ++matched) insertPosition(matched);
+		position += length;
+	}
+
+	writeSymbol(256);																			// End of block
+	writer.write(0, 3);																			// Empty stored block which aligns the stream to a byte
+	writer.flush();
+	output.insert(output.end(), { 0x00, 0x00, 0xFF, 0xFF });
+
+	// Incompressible data is stored instead, in blocks of at most 64 KB which already end at a byte boundary
+	if (output.size() - start > size + (size / 65535 + 1) * 5)
+	{
+		output.resize(start);
+
+		for (size_t blockStart = 0; blockStart < size; blockStart += 65535)
+		{
+			const uint16_t blockSize = uint16_t((std::min)(size - blockStart, size_t(65535)));
+
+			output.insert(output.end(), { 0x00, GLubyte(blockSize), GLubyte(blockSize >> 8), GLubyte(~blockSize), GLubyte(~blockSize >> 8) });
+			output.insert(output.end(), data + blockStart, data + blockStart + blockSize);
+		}
+	}
+}
+
+uint32_t ImageEncoder::getAdler32(const GLubyte* data, const size_t size)
+{
+	const uint32_t base = 65521, maxBlockSize = 5552;							// Largest block whose sums cannot overflow before the modulo
+	uint32_t sum1 = 1, sum2 = 0;
+
+	for (size_t blockStart = 0; blockStart < size; blockStart += maxBlockSize)
+	{
+		const size_t blockEnd = (std::min)(size, blockStart + maxBlockSize);
+
+		for (size_t byteIdx = blockStart; byteIdx < blockEnd; ++byteIdx)
+		{
+			sum1 += data[byteIdx];
+			sum2 += sum1;
+		}
+
+		sum1 %= base;
+		sum2 %= base;
+	}
+
+	return sum2 << 16 | sum1;
+}
+
+uint32_t ImageEncoder::getCRC32(const GLubyte* data, const size_t size, const uint32_t crc)
+{
+	uint32_t result = ~crc;
+	for (size_t byteIdx = 0; byteIdx < size; ++byteIdx) result = CRC_TABLE[(result ^ data[byteIdx]) & 0xFF] ^ (result >> 8);
+
+	return ~result;
+}
+
+std::vector<uint32_t> ImageEncoder::getCRCTable()
+{
+	std::vector<uint32_t> table(256);
+
+	for (uint32_t value = 0; value < 256; ++value)
+	{
+		uint32_t crc = value;
+		for (unsigned bitIdx = 0; bitIdx < 8; ++bitIdx) crc = crc & 1 ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+
+		table[value] = crc;
+	}
+
+	return table;
+}
+
+size_t ImageEncoder::openChunk(std::vector<GLubyte>& output, const char* type)
+{
+	const size_t start = output.size();
+
+	output.insert(output.end(), 4, 0);
+	output.insert(output.end(), type, type + 4);
+
+	return start;
+}
+
+void ImageEncoder::writeBigEndian(std::vector<GLubyte>& output, const uint32_t value)
+{
+	output.insert(output.end(), { GLubyte(value >> 24), GLubyte(value >> 16), GLubyte(value >> 8), GLubyte(value) });
+}
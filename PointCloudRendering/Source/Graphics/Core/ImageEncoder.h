@@ -0,0 +1,135 @@
+#pragma once
+
+/**
+*	@file ImageEncoder.h
+*	@authors Alfonso Lpez Ruiz (alr00048@red.ujaen.es)
+*	@date 19/10/2026
+*/
+
+/**
+*	@brief Multithreaded image writers. PNG files are split into strips of rows which are filtered and compressed in parallel as
+*	independent deflate blocks, so that any decoder reads them as a single stream. QOI files are encoded by strips too, starting each one
+*	from the decoder state left by the previous strips. Float rasters, such as terrain heights, are written as tiled TIFF files.
+*/
+class ImageEncoder
+{
+public:
+	enum Format
+	{
+		PNG, QOI, TIFF, NUM_FORMATS
+	};
+
+	const static std::string	FORMAT_EXTENSION[NUM_FORMATS];					//!< Extension of every format, including the dot
+	const static char*			FORMAT_STR[NUM_FORMATS];						//!< Name of every format for the interface
+
+protected:
+	const static size_t			STRIP_BYTES;									//!< Approximate size of the data encoded by every task
+	const static unsigned		HASH_BITS;										//!< Size of the table of previous matches used by deflate
+	const static unsigned		MAX_DISTANCE;									//!< Deflate window
+	const static unsigned		MAX_MATCH;										//!< Longest deflate match
+	const static unsigned		MIN_MATCH;										//!< Shortest match worth encoding
+	const static unsigned		TIFF_TILE_SIZE;									//!< Tiles of TIFF files
+
+	const static std::vector<uint32_t> CRC_TABLE;								//!< CRC-32 of every byte value
+
+protected:
+	struct BitWriter
+	{
+		std::vector<GLubyte>*	_output;										//!< Destination of complete bytes
+		uint64_t				_buffer;										//!< Bits not yet written, least significant first
+		unsigned				_numBits;										//!< Valid bits of the buffer
+
+		/**
+		*	@brief Appends the lowest bits of a value.
+		*/
+		void write(const uint32_t value, const unsigned numBits);
+
+		/**
+		*	@brief Appends a Huffman code, which is written from its most significant bit.
+		*/
+		void writeCode(const uint32_t code, const unsigned length);
+
+		/**
+		*	@brief Pads the last byte with zeros.
+		*/
+		void flush();
+	};
+
+protected:
+	/**
+	*	@brief Appends a PNG chunk whose data is already at the end of the output, after space reserved for its length and type.
+	*	@param start Position of the chunk in the output.
+	*/
+	static void closeChunk(std::vector<GLubyte>& output, const size_t start);
+
+	/**
+	*	@return Adler-32 checksum of two consecutive buffers from their checksums.
+	*	@param size2 Bytes of the second buffer.
+	*/
+	static uint32_t combineAdler32(const uint32_t adler1, const uint32_t adler2, const size_t size2);
+
+	/**
+	*	@brief Compresses a buffer as a non-final deflate block ended at a byte boundary, so that blocks of several buffers can be joined.
+	*	Matches are searched with a single-entry hash table and encoded with the fixed Huffman codes; buffers which do not shrink are stored.
+	*/
+	static void deflate(const GLubyte* data, const size_t size, std::vector<GLubyte>& output);
+
+	/**
+	*	@return Adler-32 checksum of a buffer.
+	*/
+	static uint32_t getAdler32(const GLubyte* data, const size_t size);
+
+	/**
+	*	@return CRC-32 of a buffer, continuing a previous one.
+	*/
+	static uint32_t getCRC32(const GLubyte* data, const size_t size, const uint32_t crc = 0);
+
+	/**
+	*	@return Table of CRC-32 values for every byte.
+	*/
+	static std::vector<uint32_t> getCRCTable();
+
+	/**
+	*	@brief Reserves the length and type of a PNG chunk at the end of the output.
+	*	@return Position of the chunk.
+	*/
+	static size_t openChunk(std::vector<GLubyte>& output, const char* type);
+
+	/**
+	*	@brief Appends a big-endian integer.
+	*/
+	static void writeBigEndian(std::vector<GLubyte>& output, const uint32_t value);
+
+public:
+	/**
+	*	@brief Encodes an image as PNG.
+	*	@param pixels Top row first, with 1 (gray), 2 (gray and alpha), 3 (RGB) or 4 (RGBA) channels.
+	*	@return False if the number of channels is not supported.
+	*/
+	static bool encodePNG(const GLubyte* pixels, const uvec2& size, const unsigned channels, std::vector<GLubyte>& png);
+
+	/**
+	*	@brief Encodes an image as QOI.
+	*	@param pixels Top row first, with 3 (RGB) or 4 (RGBA) channels.
+	*	@return False if the number of channels is not supported.
+	*/
+	static bool encodeQOI(const GLubyte* pixels, const uvec2& size, const unsigned channels, std::vector<GLubyte>& qoi);
+
+	/**
+	*	@return Format given by the extension of a file, PNG if not recognized.
+	*/
+	static Format getFormat(const std::string& filename);
+
+	/**
+	*	@brief Saves a single-channel float raster, such as a DTM, into a TIFF file. NaN values are flagged as no data.
+	*	@param bottomRowFirst True if the first row of the raster is the lowest one, as in grids indexed by increasing Y.
+	*/
+	static bool saveFloatTIFF(const std::string& filename, const float* values, const uvec2& size, const bool bottomRowFirst);
+
+	/**
+	*	@brief Saves an image in the format given by the extension of the file. TIFF files keep RGB channels only.
+	*	@param pixels Top row first, with 1 to 4 channels.
+	*/
+	static bool saveImage(const std::string& filename, const GLubyte* pixels, const uvec2& size, const unsigned channels);
+};
+
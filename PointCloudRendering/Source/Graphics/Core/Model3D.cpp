@@ -268,6 +268,8 @@ void Model3D::captureTexture(FBOScreenshot* fbo, const std::vector<vec4>& pixels
 
 void Model3D::computeTangents(ModelComponent* modelComp)
 {
+	MemoryTracker::ScopedTag tag("Meshes");
+
 	ComputeShader* shader	= ShaderList::getInstance()->getComputeShader(RendEnum::COMPUTE_TANGENTS_1);
 	const int numVertices	= modelComp->_geometry.size(), numTriangles = modelComp->_topology.size();
 	int numGroups			= ComputeShader::getNumGroups(numTriangles);
@@ -293,9 +295,9 @@ void Model3D::computeTangents(ModelComponent* modelComp)
 	VertexGPUData* data		= ComputeShader::readData(geometryBufferID, VertexGPUData());
 	modelComp->_geometry	= std::move(std::vector<VertexGPUData>(data, data + numVertices));
 
-	glDeleteBuffers(1, &geometryBufferID);
-	glDeleteBuffers(1, &meshBufferID);
-	glDeleteBuffers(1, &outBufferID);
+	ComputeShader::deleteBuffer(geometryBufferID);
+	ComputeShader::deleteBuffer(meshBufferID);
+	ComputeShader::deleteBuffer(outBufferID);
 }
 
 void Model3D::generatePointCloud()
@@ -1,11 +1,126 @@
 #include "stdafx.h"
 #include "OpenGLUtilities.h"
 
+#include "Graphics/Core/ShaderList.h"
+
 /// [Static members initialization]
 
 std::unique_ptr<VAO> _cubeVAO;
 std::unique_ptr<VAO> _quadVAO;
 
+/// [OpenGLUtilities]
+
+void OpenGLUtilities::exclusivePrefixScan(const GLuint bufferSSBO, const unsigned arraySize)
+{
+	if (arraySize < 2)									// Nothing to accumulate, the only value is zero
+	{
+		const GLuint zero = 0;
+		ComputeShader::updateReadBuffer(bufferSSBO, &zero, arraySize);
+
+		return;
+	}
+
+	ComputeShader* reduceShader = ShaderList::getInstance()->getComputeShader(RendEnum::REDUCE_PREFIX_SCAN);
+	ComputeShader* downSweepShader = ShaderList::getInstance()->getComputeShader(RendEnum::DOWN_SWEEP_PREFIX_SCAN);
+	ComputeShader* resetPositionShader = ShaderList::getInstance()->getComputeShader(RendEnum::RESET_LAST_POSITION_PREFIX_SCAN);
+
+	const int maxGroupSize = ComputeShader::getMaxGroupSize();
+
+	// Binary tree parameters
+	const unsigned startThreads = unsigned(std::ceil(arraySize / 2.0f));
+	const unsigned numExec = unsigned(std::ceil(std::log2(arraySize)));
+	const unsigned numGroups2Log = unsigned(ComputeShader::getNumGroups(startThreads));
+	unsigned numThreads = 0, iteration;
+
+	std::vector<GLuint> threadCount{ startThreads };
+	threadCount.reserve(numExec);
+
+	// FIRST STEP: build a binary tree with a summatory of the array
+	reduceShader->bindBuffers(std::vector<GLuint> { bufferSSBO });
+	reduceShader->use();
+	reduceShader->setUniform("arraySize", arraySize);
+
+	iteration = 0;
+	while (iteration < numExec)
+	{
+		numThreads = threadCount[threadCount.size() - 1];
+
+		reduceShader->setUniform("iteration", iteration++);
+		reduceShader->setUniform("numThreads", numThreads);
+		reduceShader->execute(numGroups2Log, 1, 1, maxGroupSize, 1, 1);
+
+		threadCount.push_back(std::ceil(numThreads / 2.0f));
+	}
+
+	// SECOND STEP: set last position to zero, its faster to do it in GPU than retrieve the array in CPU, modify and write it again to GPU
+	resetPositionShader->bindBuffers(std::vector<GLuint> { bufferSSBO });
+	resetPositionShader->use();
+	resetPositionShader->setUniform("arraySize", arraySize);
+	resetPositionShader->execute(1, 1, 1, 1, 1, 1);
+
+	// THIRD STEP: build tree back to first level and compute position of each element
+	downSweepShader->bindBuffers(std::vector<GLuint> { bufferSSBO });
+	downSweepShader->use();
+	downSweepShader->setUniform("arraySize", arraySize);
+
+	iteration = unsigned(threadCount.size()) - 2;
+	while (iteration >= 0 && iteration < numExec)
+	{
+		downSweepShader->setUniform("iteration", iteration);
+		downSweepShader->setUniform("numThreads", threadCount[iteration--]);
+		downSweepShader->execute(numGroups2Log, 1, 1, maxGroupSize, 1, 1);
+	}
+}
+
+GLuint OpenGLUtilities::sortByMortonCode(const GLuint mortonCodes, const unsigned arraySize)
+{
+	ComputeShader* bitMaskShader = ShaderList::getInstance()->getComputeShader(RendEnum::BIT_MASK_RADIX_SORT);
+	ComputeShader* reallocatePositionShader = ShaderList::getInstance()->getComputeShader(RendEnum::REALLOCATE_RADIX_SORT);
+
+	const unsigned numBits	= 30;			// 10 bits per coordinate (3D)
+	unsigned currentBits	= 0;
+	const int numGroups		= ComputeShader::getNumGroups(arraySize);
+	const int maxGroupSize	= ComputeShader::getMaxGroupSize();
+
+	// Fill indices array from zero to arraySize - 1
+	std::vector<GLuint> indices(arraySize);
+	std::iota(indices.begin(), indices.end(), 0);
+
+	GLuint indicesBufferID_1, indicesBufferID_2, pBitsBufferID, nBitsBufferID;
+	indicesBufferID_1 = ComputeShader::setWriteBuffer(GLuint(), arraySize);
+	indicesBufferID_2 = ComputeShader::setReadBuffer(indices);								// Substitutes indicesBufferID_1 for the next iteration
+	pBitsBufferID = ComputeShader::setWriteBuffer(GLuint(), arraySize);
+	nBitsBufferID = ComputeShader::setWriteBuffer(GLuint(), arraySize);
+
+	while (currentBits < numBits)
+	{
+		std::swap(indicesBufferID_1, indicesBufferID_2);							// indicesBufferID_2 is initialized with indices cause it's swapped here
+
+		// FIRST STEP: BIT MASK, check if a morton code gives zero or one for a certain mask (iteration)
+		unsigned bitMask = 1 << currentBits++;
+
+		bitMaskShader->bindBuffers(std::vector<GLuint> { mortonCodes, indicesBufferID_1, pBitsBufferID, nBitsBufferID });
+		bitMaskShader->use();
+		bitMaskShader->setUniform("arraySize", arraySize);
+		bitMaskShader->setUniform("bitMask", bitMask);
+		bitMaskShader->execute(numGroups, 1, 1, maxGroupSize, 1, 1);
+
+		// SECOND STEP: position of each index whose bit is zero
+		OpenGLUtilities::exclusivePrefixScan(nBitsBufferID, arraySize);
+
+		reallocatePositionShader->bindBuffers(std::vector<GLuint> { pBitsBufferID, nBitsBufferID, indicesBufferID_1, indicesBufferID_2 });
+		reallocatePositionShader->use();
+		reallocatePositionShader->setUniform("arraySize", arraySize);
+		reallocatePositionShader->execute(numGroups, 1, 1, maxGroupSize, 1, 1);
+	}
+
+	ComputeShader::deleteBuffer(indicesBufferID_1);
+	ComputeShader::deleteBuffer(pBitsBufferID);
+	ComputeShader::deleteBuffer(nBitsBufferID);
+
+	return indicesBufferID_2;
+}
+
 /// [Public methods]
 
 std::vector<vec4> Primitives::getCubePoints(const vec3& minValues, const vec3& maxValues)
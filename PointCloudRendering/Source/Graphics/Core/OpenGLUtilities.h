@@ -15,6 +15,16 @@
 */
 namespace OpenGLUtilities
 {
+	/**
+	*	@brief Replaces the content of a GPU buffer of unsigned integers by its exclusive prefix sum (reduction and down-sweep).
+	*/
+	void exclusivePrefixScan(const GLuint bufferSSBO, const unsigned arraySize);
+
+	/**
+	*	@brief Sorts the indices of an array of 30-bit Morton codes with a GPU radix sort.
+	*	@return Buffer with the sorted indices. The caller is responsible for deleting it.
+	*/
+	GLuint sortByMortonCode(const GLuint mortonCodes, const unsigned arraySize);
 };
 
 class Primitives
@@ -7,23 +7,99 @@
 #include "Graphics/Core/ShaderList.h"
 #include "Graphics/Core/VAO.h"
 #include "LASlib/lasreader.hpp"
-#include <pcl/features/normal_3d.h>
-#include <pcl/features/normal_3d_omp.h>
-#include <pcl/point_types.h>
+#include <pcl/common/eigen.h>
 #include "tinyply/tinyply.h"
+#include "Utilities/MemoryTracker.h"
+#include "Utilities/Profiler.h"
+#include "Utilities/ThreadPool.h"
 
 // Initialization of static attributes
 const std::string	PointCloud::WRITE_POINT_CLOUD_FOLDER = "PointClouds/";
 
 /// Public methods
 
+PointCloud::LoadFilter::LoadFilter() :
+	_returnRange(0, UINT_MAX), _minXY(-DBL_MAX), _maxXY(DBL_MAX), _decimation(1)
+{
+	_classes.set();
+}
+
+bool PointCloud::LoadFilter::acceptPosition(const double x, const double y) const
+{
+	if (x < _minXY.x || y < _minXY.y || x > _maxXY.x || y > _maxXY.y) return false;
+	if (_polygon.size() < 3) return true;
+
+	// Even-odd rule
+	bool inside = false;
+
+	for (size_t i = 0, j = _polygon.size() - 1; i < _polygon.size(); j = i++)
+	{
+		const glm::dvec2& a = _polygon[i], & b = _polygon[j];
+
+		if ((a.y > y) != (b.y > y) && x < (b.x - a.x) * (y - a.y) / (b.y - a.y) + a.x)
+			inside = !inside;
+	}
+
+	return inside;
+}
+
+std::string PointCloud::LoadFilter::getSignature() const
+{
+	size_t hash = std::hash<std::bitset<256>>()(_classes);
+	auto combine = [&hash](const size_t value) { hash ^= value + 0x9e3779b97f4a7c15 + (hash << 6) + (hash >> 2); };
+
+	combine(std::hash<unsigned>()(_returnRange.x));
+	combine(std::hash<unsigned>()(_returnRange.y));
+	combine(std::hash<double>()(_minXY.x));
+	combine(std::hash<double>()(_minXY.y));
+	combine(std::hash<double>()(_maxXY.x));
+	combine(std::hash<double>()(_maxXY.y));
+	for (const glm::dvec2& vertex : _polygon)
+	{
+		combine(std::hash<double>()(vertex.x));
+		combine(std::hash<double>()(vertex.y));
+	}
+	combine(std::hash<unsigned>()(_decimation));
+
+	std::stringstream stream;
+	stream << std::hex << hash;
+
+	return stream.str();
+}
+
+void PointCloud::LoadFilter::setPolygon(const std::vector<glm::dvec2>& polygon)
+{
+	glm::dvec2 minPolygon(DBL_MAX), maxPolygon(-DBL_MAX);
+
+	for (const glm::dvec2& vertex : polygon)
+	{
+		minPolygon = glm::min(minPolygon, vertex);
+		maxPolygon = glm::max(maxPolygon, vertex);
+	}
+
+	_polygon = polygon;
+
+	if (!polygon.empty())
+	{
+		_minXY = glm::max(_minXY, minPolygon);
+		_maxXY = glm::min(_maxXY, maxPolygon);
+	}
+}
+
 PointCloud::PointCloud(const std::string& filename, const bool useBinary, const mat4& modelMatrix) : 
-	Model3D(modelMatrix, 1), _filename(filename), _useBinary(useBinary), _calculatedNormals(false), _minColor(FLT_MAX), _maxColor(FLT_MIN), _maxClassId(0), _maxReturns(.0f)
+	Model3D(modelMatrix, 1), _filename(filename), _useBinary(useBinary), _calculatedNormals(false), _numPoints(0), _minColor(FLT_MAX), _maxColor(FLT_MIN), _maxClassId(0), _maxReturns(.0f)
 {
 }
 
 PointCloud::~PointCloud()
 {
+	MemoryTracker::getInstance()->setHostAllocation(&_points, "Points", 0);
+	MemoryTracker::getInstance()->setHostAllocation(&_spatialIndex, "Spatial index", 0);
+}
+
+bool PointCloud::canReleasePoints() const
+{
+	return _useBinary && std::filesystem::exists(this->getBinaryFilename());
 }
 
 void PointCloud::filterGround(CSF* csf, std::vector<GLint>& groundIndices)
@@ -31,6 +107,8 @@ void PointCloud::filterGround(CSF* csf, std::vector<GLint>& groundIndices)
 	std::vector<csf::Point> csfPoints;
 	std::vector<GLint> offGroundIndices;
 
+	this->restorePoints();
+
 	for (PointModel& point : _points)
 	{
 		csf::Point csfPoint;
@@ -41,48 +119,143 @@ void PointCloud::filterGround(CSF* csf, std::vector<GLint>& groundIndices)
 		csfPoints.push_back(csfPoint);
 	}
 
+	// Loops of the cloth simulation run on the shared pool rather than on their own threads
+	csf::setParallelFor([](const int count, const std::function<void(int)>& body)
+		{
+			ThreadPool::getInstance()->parallelFor(0, size_t(count), [&body](const size_t index) { body(int(index)); });
+		});
+
+	// Stages of the simulation are nested in the zone of the calling thread
+	csf::setStageCallbacks(
+		[](const char* name) -> void* { return Profiler::isEnabled() ? new Profiler::ScopedZone(name) : nullptr; },
+		[](void* handle) { delete static_cast<Profiler::ScopedZone*>(handle); });
+
+	// The library keeps its own copy of the points, with the same layout
+	MemoryTracker::getInstance()->setHostAllocation(&csfPoints, "CSF", 2 * csfPoints.capacity() * sizeof(csf::Point));
+
 	csf->setPointCloud(csfPoints);
 	csf->do_filtering(groundIndices, offGroundIndices, true);
 
+	MemoryTracker::getInstance()->setHostAllocation(&csfPoints, "CSF", 0);
+
 	std::vector<GLint> indices (1e6);
 	std::iota(indices.begin(), indices.end(), 0);
 	csf->savePoints(indices, "Hola.xyz");
 }
 
+void PointCloud::filterRadiusOutliers(const float radius, const unsigned minNeighbours, std::vector<uint8_t>& inliers)
+{
+	Profiler::ScopedZone zone("Radius outlier filter");
+
+	this->restorePoints();
+	inliers.resize(_points.size());
+
+	if (!minNeighbours)
+	{
+		std::fill(inliers.begin(), inliers.end(), uint8_t(1));
+		return;
+	}
+
+	if (!_spatialIndex.isBuilt()) this->buildSpatialIndex();
+
+	// Having minNeighbours points within the radius is equivalent to the minNeighbours-th nearest neighbour being within the radius
+	const float sqrRadius = radius * radius;
+
+	_spatialIndex.knnSearchAll(minNeighbours, [&](const unsigned pointIdx, const unsigned* neighbours, const float* sqrDistances, const unsigned numNeighbours)
+		{
+			inliers[pointIdx] = uint8_t(numNeighbours == minNeighbours && sqrDistances[numNeighbours - 1] <= sqrRadius);
+		});
+}
+
+void PointCloud::filterStatisticalOutliers(const unsigned k, const float stdMultiplier, std::vector<uint8_t>& inliers)
+{
+	Profiler::ScopedZone zone("Statistical outlier filter");
+
+	this->restorePoints();
+	std::vector<float> meanDistance(_points.size(), .0f);
+	inliers.resize(_points.size());
+
+	if (!_spatialIndex.isBuilt()) this->buildSpatialIndex();
+
+	_spatialIndex.knnSearchAll(k, [&](const unsigned pointIdx, const unsigned* neighbours, const float* sqrDistances, const unsigned numNeighbours)
+		{
+			float distance = .0f;
+			for (unsigned neighbourIdx = 0; neighbourIdx < numNeighbours; ++neighbourIdx) distance += std::sqrt(sqrDistances[neighbourIdx]);
+
+			meanDistance[pointIdx] = numNeighbours ? distance / numNeighbours : .0f;
+		});
+
+	// Global distribution of mean distances, accumulated in double to avoid losing precision with hundreds of millions of points
+	const double numPoints = double(_points.size());
+	const double mean = std::reduce(std::execution::par_unseq, meanDistance.begin(), meanDistance.end(), .0) / numPoints;
+	const double variance = std::transform_reduce(std::execution::par_unseq, meanDistance.begin(), meanDistance.end(), .0, std::plus<double>(),
+		[mean](const float distance) { return (distance - mean) * (distance - mean); }) / (std::max)(numPoints - 1.0, 1.0);
+	const float threshold = float(mean + stdMultiplier * std::sqrt(variance));
+
+	std::transform(std::execution::par_unseq, meanDistance.begin(), meanDistance.end(), inliers.begin(), [threshold](const float distance)
+		{
+			return uint8_t(distance <= threshold);
+		});
+}
+
 bool PointCloud::load(const mat4& modelMatrix)
 {
+	Profiler::ScopedZone zone("Point cloud loading");
+
 	if (!_loaded)
 	{
 		bool success = false, binaryExists = false;
 
-		if (_useBinary && (binaryExists = std::filesystem::exists(_filename + BINARY_EXTENSION)))
+		if (_useBinary && (binaryExists = std::filesystem::exists(this->getBinaryFilename())))
 		{
 			success = this->loadModelFromBinaryFile();
 
-			if (PointCloudParameters::_computeNormal && !_calculatedNormals)
+			if (success)
 			{
-				this->computeNormals();
-				this->writeToBinary(_filename + BINARY_EXTENSION);
+				bool updateBinary = false;
+
+				// Binary files written before the spatial index was cached
+				if (!_spatialIndex.isBuilt())
+				{
+					this->buildSpatialIndex();
+					updateBinary = true;
+				}
+
+				if (PointCloudParameters::_computeNormal && !_calculatedNormals)
+				{
+					this->computeNormals();
+					updateBinary = true;
+				}
+
+				if (updateBinary) this->writeToBinary(this->getBinaryFilename());
 			}
 		}
 
 		if (!success)
 		{
-			if (std::filesystem::exists(_filename + BINARY_EXTENSION))
+			if (std::filesystem::exists(_filename + PLY_EXTENSION))
 				success = this->loadModelFromPLY(modelMatrix);
 
 			else if (std::filesystem::exists(_filename + LAS_EXTENSION))
 				success = this->loadModelFromLAS(modelMatrix);
 
-			if (success && PointCloudParameters::_computeNormal)
-				this->computeNormals();
+			if (success)
+			{
+				this->buildSpatialIndex();
+
+				if (PointCloudParameters::_computeNormal)
+					this->computeNormals();
+			}
 		}
 
 		std::cout << "Number of Points: " << _points.size() << std::endl;
 
+		_numPoints = unsigned(_points.size());
+		this->updateHostMemory();
+
 		if (success && !binaryExists)
 		{
-			this->writeToBinary(_filename + BINARY_EXTENSION);
+			this->writeToBinary(this->getBinaryFilename());
 		}
 
 		_loaded = true;
@@ -93,14 +266,50 @@ bool PointCloud::load(const mat4& modelMatrix)
 	return false;
 }
 
-bool PointCloud::writePointCloud(const std::string& filename, const bool ascii)
+bool PointCloud::releasePoints()
 {
-	std::thread writePointCloudThread(&PointCloud::threadedWritePointCloud, this, filename, ascii);
-	writePointCloudThread.detach();
+	if (_points.empty()) return true;
+
+	if (!this->canReleasePoints())
+	{
+		std::cout << "Points are kept in host memory, as there is no binary file to restore them from" << std::endl;
+		return false;
+	}
+
+	std::vector<PointModel>().swap(_points);
+	_spatialIndex.clear();
+	this->updateHostMemory();
 
 	return true;
 }
 
+bool PointCloud::restorePoints()
+{
+	if (!_points.empty() || !_numPoints) return true;
+
+	Profiler::ScopedZone zone("Point restoration");
+
+	// The binary file was written from the same points, so only its size is checked
+	if (!this->loadModelFromBinaryFile() || _points.size() != _numPoints)
+	{
+		std::cout << "Points could not be restored from " << this->getBinaryFilename() << "!" << std::endl;
+		std::vector<PointModel>().swap(_points);
+		return false;
+	}
+
+	if (!_spatialIndex.isBuilt()) this->buildSpatialIndex();
+	this->updateHostMemory();
+
+	return true;
+}
+
+std::future<void> PointCloud::writePointCloud(const std::string& filename, const bool ascii)
+{
+	this->restorePoints();
+
+	return ThreadPool::getInstance()->submit([this, filename, ascii]() { this->threadedWritePointCloud(filename, ascii); });
+}
+
 /// [Protected methods]
 
 void PointCloud::computeCloudData()
@@ -112,44 +321,73 @@ void PointCloud::computeCloudData()
 	std::iota(modelComp->_pointCloud.begin(), modelComp->_pointCloud.end(), 0);
 }
 
+void PointCloud::buildSpatialIndex()
+{
+	Profiler::ScopedZone zone("Kd-tree construction");
+
+	if (_points.empty()) return;
+
+	_spatialIndex.build(&_points[0]._point, _points.size(), sizeof(PointModel));
+}
+
 void PointCloud::computeNormals()
 {
-	pcl::PointCloud<pcl::PointXYZ>::Ptr cloud(new pcl::PointCloud<pcl::PointXYZ>);
+	Profiler::ScopedZone zone("Normal estimation");
 
-	for (PointModel& point : _points)
-	{
-		pcl::PointXYZ pclPoint(point._point.x, point._point.y, point._point.z);
-		cloud->push_back(pclPoint);
-	}
+	if (!_spatialIndex.isBuilt()) this->buildSpatialIndex();
 
-	// Create the normal estimation class, and pass the input dataset to it
-	pcl::NormalEstimationOMP<pcl::PointXYZ, pcl::Normal> ne;
-	ne.setInputCloud(cloud);
+	_spatialIndex.knnSearchAll(PointCloudParameters::_knn, [&](const unsigned pointIdx, const unsigned* neighbours, const float* sqrDistances, const unsigned numNeighbours)
+		{
+			// Covariance of the neighbourhood, including the point itself
+			const vec3& point = _points[pointIdx]._point;
+			vec3 centroid = point;
 
-	// Create an empty kdtree representation
-	pcl::search::KdTree<pcl::PointXYZ>::Ptr tree(new pcl::search::KdTree<pcl::PointXYZ>());
-	ne.setSearchMethod(tree);
+			for (unsigned neighbourIdx = 0; neighbourIdx < numNeighbours; ++neighbourIdx) centroid += _points[neighbours[neighbourIdx]]._point;
+			centroid /= float(numNeighbours + 1);
 
-	// Output datasets
-	pcl::PointCloud<pcl::Normal>::Ptr cloudNormals(new pcl::PointCloud<pcl::Normal>);
-	ne.setKSearch(PointCloudParameters::_knn);
-	ne.compute(*cloudNormals);
+			Eigen::Matrix3f covariance = Eigen::Matrix3f::Zero();
+			auto accumulate = [&](const vec3& neighbour)
+			{
+				const Eigen::Vector3f diff(neighbour.x - centroid.x, neighbour.y - centroid.y, neighbour.z - centroid.z);
+				covariance += diff * diff.transpose();
+			};
 
-	for (int normalIdx = 0; normalIdx < cloudNormals->size(); ++normalIdx)
-	{
-		_points[normalIdx]._normal = vec4(glm::normalize(vec3(cloudNormals->at(normalIdx).normal_x, cloudNormals->at(normalIdx).normal_y, cloudNormals->at(normalIdx).normal_z)), .0f);
-	}
+			accumulate(point);
+			for (unsigned neighbourIdx = 0; neighbourIdx < numNeighbours; ++neighbourIdx) accumulate(_points[neighbours[neighbourIdx]]._point);
+
+			// Normal is the eigenvector of the smallest eigenvalue, flipped towards the origin as PCL does
+			float eigenValue;
+			Eigen::Vector3f eigenVector;
+			pcl::eigen33(covariance, eigenValue, eigenVector);
+
+			vec3 normal(eigenVector.x(), eigenVector.y(), eigenVector.z());
+			if (glm::dot(normal, -point) < .0f) normal = -normal;
+
+			_points[pointIdx]._normal = glm::any(glm::isnan(normal)) ? vec3(.0f) : glm::normalize(normal);
+		});
 
 	_calculatedNormals = true;
 }
 
+std::string PointCloud::getBinaryFilename() const
+{
+	if (_loadFilter.isActive())
+		return _filename + "_" + _loadFilter.getSignature() + BINARY_EXTENSION;
+
+	return _filename + BINARY_EXTENSION;
+}
+
 bool PointCloud::loadModelFromBinaryFile()
 {
-	return this->readBinary(_filename + BINARY_EXTENSION, _modelComp);
+	Profiler::ScopedZone zone("Binary reading");
+
+	return this->readBinary(this->getBinaryFilename(), _modelComp);
 }
 
 bool PointCloud::loadModelFromLAS(const mat4& modelMatrix)
 {
+	Profiler::ScopedZone zone("LAS reading");
+
 	std::string filename = _filename + std::string(LAS_EXTENSION);
 	LASreadOpener lasReadOpener;
 	lasReadOpener.set_file_name(filename.c_str());
@@ -161,34 +399,63 @@ bool PointCloud::loadModelFromLAS(const mat4& modelMatrix)
 		return false;
 	}
 
-	float x, y, z, intensity, xoffset = lasReader->header.x_offset, yoffset = lasReader->header.y_offset, zoffset = lasReader->header.z_offset;
-	unsigned returnNumber, numReturns, classId;
+	const double xoffset = lasReader->header.x_offset, yoffset = lasReader->header.y_offset, zoffset = lasReader->header.z_offset;
+	const bool filterActive = _loadFilter.isActive();
+	double x, y, z;
+	float intensity;
+	unsigned returnNumber, numReturns, classId, numAcceptedPoints = 0;
 
 	for (int i = 0; i < 5 && lasReader->header.number_of_points_by_return[i] != 0; ++i) ++_maxReturns;
 	_maxReturns = glm::clamp(_maxReturns - 1.0f, 1.0f, 255.0f);
 
-	for (int idx = 0; idx < lasReader->npoints; idx++)
+	// The region of interest is pushed down to the reader, which can skip whole blocks if the file is spatially indexed
+	if (_loadFilter.hasRegion())
+		lasReader->inside_rectangle(_loadFilter._minXY.x, _loadFilter._minXY.y, _loadFilter._maxXY.x, _loadFilter._maxXY.y);
+	else
+		_points.reserve(lasReader->npoints / (std::max)(_loadFilter._decimation, 1u));
+
+	while (lasReader->read_point())
 	{
-		lasReader->read_point();
 		LASpoint& pointReader = lasReader->point;
-		
+
 		x = pointReader.get_x(); y = pointReader.get_y(), z = pointReader.get_z(), intensity = pointReader.get_intensity();
 		returnNumber = pointReader.get_return_number(); numReturns = pointReader.get_number_of_returns();
 		classId = pointReader.get_classification();
 
+		if (filterActive)
+		{
+			if (!_loadFilter.acceptAttributes(classId, returnNumber) || !_loadFilter.acceptPosition(x, y)) continue;
+			if (numAcceptedPoints++ % (std::max)(_loadFilter._decimation, 1u) != 0) continue;
+		}
+
 		_points.push_back(PointModel{ vec3(x - xoffset, y - yoffset, z - zoffset), unsigned(intensity), vec3(.0f), PointModel::encodeReturnsClass(returnNumber / _maxReturns, numReturns / _maxReturns, classId / 256.0f) });
 		_minColor = (std::min)(_minColor, intensity);
 		_maxColor = (std::max)(_maxColor, intensity);
 		_maxClassId = (std::max)(_maxClassId, classId);
 	}
 
-	_aabb = AABB(
-		vec3(lasReader->get_min_x() - xoffset, lasReader->get_min_y() - yoffset, lasReader->get_min_z() - zoffset),
-		vec3(lasReader->get_max_x() - xoffset, lasReader->get_max_y() - yoffset, lasReader->get_max_z() - zoffset));
+	if (filterActive)
+	{
+		_points.shrink_to_fit();
+		for (const PointModel& point : _points) _aabb.update(point._point);
+	}
+	else
+	{
+		_aabb = AABB(
+			vec3(lasReader->get_min_x() - xoffset, lasReader->get_min_y() - yoffset, lasReader->get_min_z() - zoffset),
+			vec3(lasReader->get_max_x() - xoffset, lasReader->get_max_y() - yoffset, lasReader->get_max_z() - zoffset));
+	}
+
+	lasReader->close();
+	delete lasReader;
+
+	return !_points.empty();
 }
 
 bool PointCloud::loadModelFromPLY(const mat4& modelMatrix)
 {
+	Profiler::ScopedZone zone("PLY reading");
+
 	std::unique_ptr<std::istream> fileStream;
 	std::vector<uint8_t> byteBuffer;
 	std::shared_ptr<tinyply::PlyData> plyPoints, plyColors;
@@ -196,6 +463,15 @@ bool PointCloud::loadModelFromPLY(const mat4& modelMatrix)
 	float* pointsRawFloat = nullptr;
 	double* pointsRawDouble = nullptr;
 	uint8_t* colorsRaw;
+	unsigned numAcceptedPoints = 0;
+
+	// PLY files have no classes nor returns, hence only the region and decimation are applied
+	auto acceptPoint = [&](const double x, const double y) -> bool
+	{
+		if (!_loadFilter.acceptPosition(x, y)) return false;
+
+		return numAcceptedPoints++ % (std::max)(_loadFilter._decimation, 1u) == 0;
+	};
 
 	try
 	{
@@ -227,8 +503,10 @@ bool PointCloud::loadModelFromPLY(const mat4& modelMatrix)
 			const size_t numColors = plyColors->count;
 			const size_t numColorsBytes = numColors * 1 * 3;
 
-			// Allocate space
-			_points.resize(numPoints);
+			// Allocate space only for accepted points, which are unknown beforehand if there is a region of interest
+			const size_t decimation = (std::max)(_loadFilter._decimation, 1u);
+			if (!_loadFilter.hasRegion()) _points.reserve((numPoints + decimation - 1) / decimation);
+
 			if (!isDouble)
 			{
 				pointsRawFloat = new float[numPoints * 3];
@@ -248,12 +526,13 @@ bool PointCloud::loadModelFromPLY(const mat4& modelMatrix)
 				for (unsigned index = 0; index < numPoints; ++index)
 				{
 					baseIndex = index * 3;
+					if (!acceptPoint(pointsRawFloat[baseIndex], pointsRawFloat[baseIndex + 1])) continue;
 
-					_points[index] = PointModel{ vec3(pointsRawFloat[baseIndex], pointsRawFloat[baseIndex + 1], pointsRawFloat[baseIndex + 2]),
-												 PointModel::getRGBColor(vec3(colorsRaw[baseIndex], colorsRaw[baseIndex + 1], colorsRaw[baseIndex + 2])) };
+					_points.push_back(PointModel{ vec3(pointsRawFloat[baseIndex], pointsRawFloat[baseIndex + 1], pointsRawFloat[baseIndex + 2]),
+												 PointModel::getRGBColor(vec3(colorsRaw[baseIndex], colorsRaw[baseIndex + 1], colorsRaw[baseIndex + 2])) });
 					_minColor = (std::min)(_minColor, float((std::min)((std::min)(colorsRaw[baseIndex], colorsRaw[baseIndex + 1]), colorsRaw[baseIndex + 2])));
 					_maxColor = (std::max)(_maxColor, float((std::max)((std::max)(colorsRaw[baseIndex], colorsRaw[baseIndex + 1]), colorsRaw[baseIndex + 2])));
-					_aabb.update(_points[index]._point);
+					_aabb.update(_points.back()._point);
 				}
 			}
 			else
@@ -261,14 +540,21 @@ bool PointCloud::loadModelFromPLY(const mat4& modelMatrix)
 				for (unsigned index = 0; index < numPoints; ++index)
 				{
 					baseIndex = index * 3;
+					if (!acceptPoint(pointsRawDouble[baseIndex], pointsRawDouble[baseIndex + 1])) continue;
 
-					_points[index] = PointModel{ vec3(pointsRawDouble[baseIndex], pointsRawDouble[baseIndex + 1], pointsRawDouble[baseIndex + 2]),
-												 PointModel::getRGBColor(vec3(colorsRaw[baseIndex], colorsRaw[baseIndex + 1], colorsRaw[baseIndex + 2])) };
+					_points.push_back(PointModel{ vec3(pointsRawDouble[baseIndex], pointsRawDouble[baseIndex + 1], pointsRawDouble[baseIndex + 2]),
+												 PointModel::getRGBColor(vec3(colorsRaw[baseIndex], colorsRaw[baseIndex + 1], colorsRaw[baseIndex + 2])) });
 					_minColor = (std::min)(_minColor, float((std::min)((std::min)(colorsRaw[baseIndex], colorsRaw[baseIndex + 1]), colorsRaw[baseIndex + 2])));
 					_maxColor = (std::max)(_maxColor, float((std::max)((std::max)(colorsRaw[baseIndex], colorsRaw[baseIndex + 1]), colorsRaw[baseIndex + 2])));
-					_aabb.update(_points[index]._point);
+					_aabb.update(_points.back()._point);
 				}
 			}
+
+			if (_loadFilter.hasRegion()) _points.shrink_to_fit();
+
+			delete[] pointsRawFloat;
+			delete[] pointsRawDouble;
+			delete[] colorsRaw;
 		}
 	}
 	catch (const std::exception & e)
@@ -278,7 +564,7 @@ bool PointCloud::loadModelFromPLY(const mat4& modelMatrix)
 		return false;
 	}
 
-	return true;
+	return !_points.empty();
 }
 
 bool PointCloud::readBinary(const std::string& filename, const std::vector<Model3D::ModelComponent*>& modelComp)
@@ -301,6 +587,10 @@ bool PointCloud::readBinary(const std::string& filename, const std::vector<Model
 	fin.read((char*)&_maxClassId, sizeof(uint8_t));
 	fin.read((char*)&_maxReturns, sizeof(float));
 
+	// Older binary files end here, so the index is rebuilt if it cannot be read
+	if (numPoints == 0 || !_spatialIndex.read(fin, &_points[0]._point, _points.size(), sizeof(PointModel)))
+		_spatialIndex.clear();
+
 	fin.close();
 
 	return true;
@@ -342,8 +632,16 @@ void PointCloud::threadedWritePointCloud(const std::string& filename, const bool
 	pointCloud.write(outstream, !ascii);
 }
 
+void PointCloud::updateHostMemory()
+{
+	MemoryTracker::getInstance()->setHostAllocation(&_points, "Points", _points.capacity() * sizeof(PointModel));
+	MemoryTracker::getInstance()->setHostAllocation(&_spatialIndex, "Spatial index", _spatialIndex.getMemorySize());
+}
+
 bool PointCloud::writeToBinary(const std::string& filename)
 {
+	Profiler::ScopedZone zone("Binary writing");
+
 	std::ofstream fout(filename, std::ios::out | std::ios::binary);
 	if (!fout.is_open())
 	{
@@ -359,6 +657,7 @@ bool PointCloud::writeToBinary(const std::string& filename)
 	fout.write((char*)&_minColor, sizeof(float));
 	fout.write((char*)&_maxClassId, sizeof(uint8_t));
 	fout.write((char*)&_maxReturns, sizeof(float));
+	_spatialIndex.write(fout);
 
 	fout.close();
 
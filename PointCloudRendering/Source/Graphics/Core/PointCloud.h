@@ -1,6 +1,9 @@
 #pragma once
 
+#include <bitset>
+#include <future>
 #include "Geometry/3D/AABB.h"
+#include "Geometry/3D/KdTree.h"
 #include "Graphics/Application/RenderingParameters.h"
 #include "Graphics/Core/Model3D.h"
 
@@ -49,11 +52,59 @@ public:
 		void saveRGB(const vec3& rgb) { _rgb = this->getRGBColor(rgb); }
 	};
 
+	/**
+	*	@brief Predicates evaluated while decoding the point cloud, so that rejected points are never stored nor uploaded to GPU.
+	*/
+	struct LoadFilter
+	{
+		std::bitset<256>			_classes;								//!< Accepted class ids, all of them by default
+		uvec2						_returnRange;							//!< Accepted return numbers, both limits included
+		glm::dvec2					_minXY, _maxXY;							//!< Region of interest in file coordinates (before removing the offset)
+		std::vector<glm::dvec2>		_polygon;								//!< Optional XY polygon of interest in file coordinates
+		unsigned					_decimation;							//!< Only one out of every n accepted points is kept
+
+		/**
+		*	@brief Default constructor, which accepts any point.
+		*/
+		LoadFilter();
+
+		/**
+		*	@return True if both class id and return number are accepted.
+		*/
+		bool acceptAttributes(const unsigned classId, const unsigned returnNumber) const { return _classes[classId & 255] && returnNumber >= _returnRange.x && returnNumber <= _returnRange.y; }
+
+		/**
+		*	@return True if the XY position is within the region and the polygon, if any.
+		*/
+		bool acceptPosition(const double x, const double y) const;
+
+		/**
+		*	@return True if the region is bounded and may be pushed down to the reader.
+		*/
+		bool hasRegion() const { return _minXY.x > -DBL_MAX || _minXY.y > -DBL_MAX || _maxXY.x < DBL_MAX || _maxXY.y < DBL_MAX || !_polygon.empty(); }
+
+		/**
+		*	@return Hash of the filter, used to tell apart the binary files of differently filtered point clouds.
+		*/
+		std::string getSignature() const;
+
+		/**
+		*	@return True if any point could be rejected.
+		*/
+		bool isActive() const { return !_classes.all() || _returnRange != uvec2(0, UINT_MAX) || this->hasRegion() || _decimation > 1; }
+
+		/**
+		*	@brief Restricts the region to the bounding box of the polygon, so that it can be used for pushing down the search to the reader.
+		*/
+		void setPolygon(const std::vector<glm::dvec2>& polygon);
+	};
+
 protected:
 	const static std::string	WRITE_POINT_CLOUD_FOLDER;					//!<
 
 protected:
 	std::string					_filename;									//!<
+	LoadFilter					_loadFilter;								//!< Points rejected while decoding
 
 	bool						_calculatedNormals;							//!<
 	bool						_useBinary;									//!<
@@ -61,7 +112,9 @@ protected:
 	// Spatial information
 	AABB						_aabb;										//!<
 	float						_lidarBeamWidth;							//!<
-	std::vector<PointModel>		_points;									//!<
+	std::vector<PointModel>		_points;									//!< Empty if released after the upload
+	unsigned					_numPoints;									//!< Loaded points, even if released
+	KdTree						_spatialIndex;								//!< Neighbourhood queries over point positions
 
 	// Radiometric information
 	float						_minColor, _maxColor, _maxReturns;			//!<
@@ -74,10 +127,20 @@ protected:
 	void computeCloudData();
 
 	/**
-	*	@brief Computes normal vectors with PCL.
+	*	@brief Builds the spatial index over the loaded points.
+	*/
+	void buildSpatialIndex();
+
+	/**
+	*	@brief Computes normal vectors from the covariance of the k nearest neighbours of each point.
 	*/
 	void computeNormals();
 
+	/**
+	*	@return Path of the binary file, which depends on the load filter.
+	*/
+	std::string getBinaryFilename() const;
+
 	/**
 	*	@brief Fills the content of model component with binary file data.
 	*/
@@ -104,10 +167,15 @@ protected:
 	virtual void setVAOData();
 
 	/**
-	*	@brief
+	*	@brief Writes the point cloud as a PLY file in the calling thread.
 	*/
 	void threadedWritePointCloud(const std::string& filename, const bool ascii);
 
+	/**
+	*	@brief Reports the size of the points and the spatial index to the memory tracker.
+	*/
+	void updateHostMemory();
+
 	/**
 	*	@brief Writes the model to a binary file in order to fasten the following executions.
 	*	@return Success of writing process.
@@ -125,11 +193,29 @@ public:
 	*/
 	virtual ~PointCloud();
 
+	/**
+	*	@return True if the points can be released from host memory, i.e. if they can be restored from the binary file.
+	*/
+	bool canReleasePoints() const;
+
 	/**
 	*	@brief
 	*/
 	void filterGround(CSF* csf, std::vector<GLint>& groundIndices);
 
+	/**
+	*	@brief Radius outlier removal: a point is an inlier if it has at least minNeighbours points within the given radius.
+	*	@param inliers Per-point mask, 1 for inliers and 0 for outliers.
+	*/
+	void filterRadiusOutliers(const float radius, const unsigned minNeighbours, std::vector<uint8_t>& inliers);
+
+	/**
+	*	@brief Statistical outlier removal: a point is an inlier if the mean distance to its k nearest neighbours is below the global mean
+	*	plus stdMultiplier times the standard deviation.
+	*	@param inliers Per-point mask, 1 for inliers and 0 for outliers.
+	*/
+	void filterStatisticalOutliers(const unsigned k, const float stdMultiplier, std::vector<uint8_t>& inliers);
+
 	/**
 	*	@brief Loads the point cloud, either from a binary or a PLY file.
 	*	@param modelMatrix Model transformation matrix.
@@ -137,15 +223,34 @@ public:
 	*/
 	virtual bool load(const mat4& modelMatrix = mat4(1.0f));
 
+	/**
+	*	@brief Frees the points and the spatial index in host memory, e.g. once they have been uploaded to GPU. Only done if they can be
+	*	restored from the binary file.
+	*	@return True if they are no longer in host memory.
+	*/
+	bool releasePoints();
+
+	/**
+	*	@brief Reads the points and the spatial index from the binary file if they were released. Otherwise, it does nothing.
+	*	@return True if they are in host memory.
+	*/
+	bool restorePoints();
+
+	/**
+	*	@brief Defines which points are loaded. It must be set before calling load().
+	*/
+	void setLoadFilter(const LoadFilter& loadFilter) { _loadFilter = loadFilter; }
+
 	/**
 	*	@brief Updates the current Axis-Aligned Bounding-Box.
 	*/
 	void updateBoundaries(const vec3& xyz) { _aabb.update(xyz); }
 
 	/**
-	*	@brief Writes point cloud as a PLY file.
+	*	@brief Writes point cloud as a PLY file in the thread pool. The point cloud must not be destroyed nor released until the returned future is ready.
+	*	@return Future which rethrows the writing errors.
 	*/
-	bool writePointCloud(const std::string& filename, const bool ascii);
+	std::future<void> writePointCloud(const std::string& filename, const bool ascii);
 
 	// Getters
 
@@ -182,11 +287,21 @@ public:
 	/**
 	*	@brief
 	*/
-	unsigned getNumberOfPoints() { return unsigned(_points.size()); }
+	unsigned getNumberOfPoints() { return _numPoints; }
 
 	/**
-	*	@return
+	*	@return Points in host memory, which are restored first if they were released.
+	*/
+	std::vector<PointModel>* getPoints() { this->restorePoints(); return &_points; }
+
+	/**
+	*	@return Spatial index over point positions, shared by any algorithm that needs neighbourhoods. Restored as the points.
+	*/
+	const KdTree* getSpatialIndex() { this->restorePoints(); return &_spatialIndex; }
+
+	/**
+	*	@return True if the points are in host memory.
 	*/
-	std::vector<PointModel>* getPoints() { return &_points; }
+	bool hasHostPoints() const { return !_points.empty(); }
 };
 
@@ -6,16 +6,30 @@
 #include "Graphics/Core/OpenGLUtilities.h"
 #include "Graphics/Core/ShaderList.h"
 #include "Interface/Window.h"
+#include "Utilities/MemoryTracker.h"
+#include "Utilities/Profiler.h"
 
 // [Public methods]
 
 PointCloudAggregator::PointCloudAggregator() :
-	_pointCloud(nullptr), _textureID(-1), _depthBufferSSBO(-1)
+	_pointCloud(nullptr), _textureID(-1), _maxDistance(1.0f), _rasterizer(nullptr), _dtmSize(0), _numProjectedPoints(0), _depthBufferSSBO(-1),
+	_pointCloudResidency(new PointCloudResidency)
 {
 	ShaderList* shaderList	= ShaderList::getInstance();
 	Window* window			= Window::getInstance();
 
 	_renderingParameters	= Renderer::getInstance()->getRenderingParameters();
+	_gpuRendering			= glewIsSupported("GL_ARB_gpu_shader_int64 GL_NV_shader_atomic_int64 GL_NV_shader_thread_group GL_NV_shader_thread_shuffle GL_ARB_shader_ballot GL_ARB_shader_group_vote GL_NV_shader_subgroup_partitioned");
+
+	if (!_gpuRendering)
+	{
+		std::cout << "The GPU lacks the extensions of the projection shaders, so point clouds are rendered by the CPU" << std::endl;
+	}
+
+	shaderList->compileComputeShaders({
+		RendEnum::ADD_COLORS_HQR, RendEnum::RESET_DEPTH_BUFFER_SHADER, RendEnum::RESET_DEPTH_BUFFER_HQR_SHADER, RendEnum::PROJECTION_SHADER,
+		RendEnum::PROJECTION_FILTER_SHADER, RendEnum::PROJECTION_HQR_SHADER, RendEnum::STORE_TEXTURE_SHADER, RendEnum::STORE_TEXTURE_HQR_SHADER
+	});
 
 	_addColorsHQRShader		= shaderList->getComputeShader(RendEnum::ADD_COLORS_HQR);
 	_resetDepthBufferShader = shaderList->getComputeShader(RendEnum::RESET_DEPTH_BUFFER_SHADER);
@@ -25,10 +39,10 @@ PointCloudAggregator::PointCloudAggregator() :
 	_projectionHQRShader	= shaderList->getComputeShader(RendEnum::PROJECTION_HQR_SHADER);
 	_storeTexture			= shaderList->getComputeShader(RendEnum::STORE_TEXTURE_SHADER);
 	_storeHQRTexture		= shaderList->getComputeShader(RendEnum::STORE_TEXTURE_HQR_SHADER);
-	_supportBuffer.resize(this->getAllowedNumberOfPoints());
 
 	_windowSize				= window->getSize();
 
+	MemoryTracker::ScopedTag tag("Framebuffers");
 	_color01SSBO			= ComputeShader::setWriteBuffer(uint64_t(), _windowSize.x * _windowSize.y, GL_DYNAMIC_DRAW);
 	_color02SSBO			= ComputeShader::setWriteBuffer(uint64_t(), _windowSize.x * _windowSize.y, GL_DYNAMIC_DRAW);
 	_depthBufferSSBO		= ComputeShader::setWriteBuffer(uint64_t(), _windowSize.x * _windowSize.y, GL_DYNAMIC_DRAW);
@@ -42,17 +56,25 @@ PointCloudAggregator::PointCloudAggregator() :
 
 	// Palette
 	_inferno = new Texture("Assets/Textures/Inferno.png");
+
+	this->updateHostMemory();
 }
 
 PointCloudAggregator::~PointCloudAggregator()
 {
 	this->deletePointCloudBuffers();
-	glDeleteBuffers(1, &_color01SSBO);
-	glDeleteBuffers(1, &_color02SSBO);
-	glDeleteBuffers(1, &_depthBufferSSBO);
-	glDeleteBuffers(1, &_rawDepthBufferSSBO);
+	delete _pointCloudResidency;
+	_supportBuffer.clear();
+	_supportBuffer.shrink_to_fit();
+	this->updateHostMemory();
+
+	ComputeShader::deleteBuffer(_color01SSBO);
+	ComputeShader::deleteBuffer(_color02SSBO);
+	ComputeShader::deleteBuffer(_depthBufferSSBO);
+	ComputeShader::deleteBuffer(_rawDepthBufferSSBO);
 	glDeleteTextures(1, &_textureID);
 	delete _inferno;
+	delete _rasterizer;
 }
 
 void PointCloudAggregator::changedSize(const uint16_t width, const uint16_t height)
@@ -63,39 +85,36 @@ void PointCloudAggregator::changedSize(const uint16_t width, const uint16_t heig
 
 void PointCloudAggregator::filterByGround(const std::vector<GLint>& groundIndices)
 {
+	Profiler::ScopedZone zone("Upload ground mask");
+
 	for (GLuint ssbo : _groundSSBO)
 	{
-		glDeleteBuffers(1, &ssbo);
+		ComputeShader::deleteBuffer(ssbo);
 	}
 	_groundSSBO.clear();
 
-	std::vector<std::vector<uint8_t>> ground;
-	unsigned maxChunkSize = _pointCloudChunkSize[0], shift, chunk;
+	_groundMask.assign(_pointCloud->getNumberOfPoints(), 0);
 
-	for (int chunkIdx = 0; chunkIdx < _pointCloudSSBO.size(); ++chunkIdx)
+	for (const GLint pointIdx : groundIndices)
 	{
-		std::vector<uint8_t> groundLocal(_pointCloudChunkSize[chunkIdx], 0);
-		ground.push_back(groundLocal);
+		_groundMask[pointIdx] = uint8_t(1);
 	}
 
-	for (int pointIdx = 0; pointIdx < groundIndices.size(); ++pointIdx)
-	{
-		chunk = std::floor(groundIndices[pointIdx] / maxChunkSize);
-		shift = (groundIndices[pointIdx] % maxChunkSize);
-		ground[chunk][shift] = uint8_t(1);
-	}
+	MemoryTracker::ScopedTag tag("Point masks");
+	_groundSSBO = this->writeChunkBuffers(this->toChunkOrder(_groundMask));
 
-	for (int chunkIdx = 0; chunkIdx < _pointCloudSSBO.size(); ++chunkIdx)
-	{
-		_groundSSBO.push_back(ComputeShader::setReadBuffer(ground[chunkIdx]));
-	}
+	this->updateHostMemory();
 }
 
 void PointCloudAggregator::filterByHeight(const uvec2& subdivisions)
 {
+	Profiler::ScopedZone zone("Height filter");
+	Profiler::GPUZone gpuZone("Height filter");
+	MemoryTracker::ScopedTag tag("Point masks");
+
 	for (GLuint ssbo : _visibilitySSBO)
 	{
-		glDeleteBuffers(1, &ssbo);
+		ComputeShader::deleteBuffer(ssbo);
 	}
 	_visibilitySSBO.clear();
 
@@ -104,7 +123,6 @@ void PointCloudAggregator::filterByHeight(const uvec2& subdivisions)
 	AABB aabb = _pointCloud->getAABB();
 	vec3 cellSize = aabb.size() / vec3(subdivisions.x, subdivisions.y, 1);
 	GLuint gridSSBO = ComputeShader::setWriteBuffer(uint64_t(), subdivisions.x * subdivisions.y, GL_DYNAMIC_DRAW);
-	std::vector<std::vector<uint8_t>> visibility;
 
 	// 1. Fill buffer of 64 bits with UINT64_MAX, i.e. the null index is UINT_MAX
 	_resetDepthBufferShader->bindBuffers(std::vector<GLuint> { gridSSBO });
@@ -112,10 +130,11 @@ void PointCloudAggregator::filterByHeight(const uvec2& subdivisions)
 	_resetDepthBufferShader->setUniform("windowSize", subdivisions);
 	_resetDepthBufferShader->execute(numGroupsGrid, 1, 1, ComputeShader::getMaxGroupSize(), 1, 1);
 
-	for (GLuint pointsSSBO : _pointCloudSSBO)
+	for (chunk = 0; chunk < _pointCloudChunkSize.size(); ++chunk)
 	{
 		const unsigned numPoints = _pointCloudChunkSize[chunk];
 		const int numGroupsPoints = ComputeShader::getNumGroups(numPoints);
+		const GLuint pointsSSBO = _pointCloudResidency->acquireBuffer(chunk);	// Every chunk takes part, even if it was evicted
 
 		// 2. Transform points and use atomicMin to retrieve the nearest point
 		_projectionFilterShader->bindBuffers(std::vector<GLuint> { gridSSBO, pointsSSBO });
@@ -126,27 +145,28 @@ void PointCloudAggregator::filterByHeight(const uvec2& subdivisions)
 		_projectionFilterShader->setUniform("shift", unsigned(accumSize));
 		_projectionFilterShader->setUniform("windowSize", subdivisions);
 		_projectionFilterShader->execute(numGroupsPoints, 1, 1, ComputeShader::getMaxGroupSize(), 1, 1);
+		_pointCloudResidency->enforceBudget();
 
-		accumSize += _pointCloudChunkSize[chunk++];
+		accumSize += _pointCloudChunkSize[chunk];
 	}
 
-	unsigned maxChunkSize = _pointCloudChunkSize[0], visiblePoint, shift;
-	uint64_t* gridData = ComputeShader::readData(gridSSBO, uint64_t());
+	unsigned visiblePoint;
+	std::vector<uint64_t> gridData(numCells);
+	std::vector<uint8_t> visibility(accumSize, 0);
 
-	for (int chunkIdx = 0; chunkIdx < _pointCloudSSBO.size(); ++chunkIdx)
-	{
-		std::vector<uint8_t> visibilityLocal(_pointCloudChunkSize[chunkIdx], 0);
-		visibility.push_back(visibilityLocal);
-	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, gridSSBO);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, gridData.size() * sizeof(uint64_t), gridData.data());
+
+	// Cells store the index of their lowest point in the order of the chunks, which is mapped back for the CPU mask
+	_visibilityMask.assign(_pointCloud->getNumberOfPoints(), 0);
 
 	for (int pointIdx = 0; pointIdx < numCells; ++pointIdx)
 	{
 		if (gridData[pointIdx] != 0xffffffffffffffff)
 		{
 			visiblePoint = gridData[pointIdx] & 0xffffffff;
-			chunk = std::floor(visiblePoint / maxChunkSize);
-			shift = visiblePoint % maxChunkSize;
-			visibility[chunk][shift] = uint8_t(1);
+			visibility[visiblePoint] = uint8_t(1);
+			_visibilityMask[_sourceIndex.empty() ? visiblePoint : _sourceIndex[visiblePoint]] = uint8_t(1);
 		}
 	}
 
@@ -154,52 +174,87 @@ void PointCloudAggregator::filterByHeight(const uvec2& subdivisions)
 	{
 		float minHeight = FLT_MAX, maxHeight = FLT_MIN;
 		std::vector<GLubyte> image(numCells * 4, 0);
-		std::vector<float> height;
-		std::vector<PointCloud::PointModel>* points = _pointCloud->getPoints();
+
+		_dtmHeight.assign(numCells, NAN);
+		_dtmSize = subdivisions;
 
 		for (int pointIdx = 0; pointIdx < numCells; ++pointIdx)
 		{
 			if (gridData[pointIdx] != 0xffffffffffffffff)
 			{
-				visiblePoint = gridData[pointIdx] & 0xffffffff;
-				height.push_back(points->at(visiblePoint)._point.z);
-				minHeight = (std::min)(minHeight, points->at(visiblePoint)._point.z);
-				maxHeight = (std::max)(maxHeight, points->at(visiblePoint)._point.z);
-			}
-			else
-			{
-				height.push_back(0);
+				// The upper half keeps the height above the minimum, so that reordered chunks need no lookup
+				_dtmHeight[pointIdx] = glm::uintBitsToFloat(unsigned(gridData[pointIdx] >> 32)) + aabb.min().z;
+				minHeight = (std::min)(minHeight, _dtmHeight[pointIdx]);
+				maxHeight = (std::max)(maxHeight, _dtmHeight[pointIdx]);
 			}
 		}
 
 		for (int pointIdx = 0; pointIdx < numCells; ++pointIdx)
 		{
-			image[pointIdx * 4 + 0] = glm::clamp((height[pointIdx] - minHeight) / (maxHeight - minHeight), .0f, 1.0f) * 255.0f;
+			if (std::isnan(_dtmHeight[pointIdx])) continue;
+
+			image[pointIdx * 4 + 0] = glm::clamp((_dtmHeight[pointIdx] - minHeight) / (maxHeight - minHeight), .0f, 1.0f) * 255.0f;
 			image[pointIdx * 4 + 1] = image[pointIdx * 4 + 0];
 			image[pointIdx * 4 + 2] = image[pointIdx * 4 + 0];
-			image[pointIdx * 4 + 3] = (height[pointIdx] > glm::epsilon<float>()) ? 255 : 0;
+			image[pointIdx * 4 + 3] = 255;
 		}
 
-		Image* imageWrapper = new Image(image.data(), subdivisions.x, subdivisions.y, 4);
-		imageWrapper->saveImage("DTM.png");
+		Image imageWrapper(image.data(), subdivisions.x, subdivisions.y, 4);
+		imageWrapper.saveImage("DTM.png");								// Written by a thread which owns a copy of the pixels
 	}
 
-	for (int chunkIdx = 0; chunkIdx < _pointCloudSSBO.size(); ++chunkIdx)
+	_visibilitySSBO = this->writeChunkBuffers(visibility);
+
+	ComputeShader::deleteBuffer(gridSSBO);
+	this->updateHostMemory();
+}
+
+void PointCloudAggregator::filterOutliers(const std::vector<uint8_t>& inliers)
+{
+	Profiler::ScopedZone zone("Upload inlier mask");
+
+	for (GLuint ssbo : _inlierSSBO)
 	{
-		_visibilitySSBO.push_back(ComputeShader::setReadBuffer(visibility[chunkIdx]));
+		ComputeShader::deleteBuffer(ssbo);
 	}
+	_inlierSSBO.clear();
+	_inlierMask.clear();
 
-	glDeleteBuffers(1, &gridSSBO);
+	if (inliers.size() != _pointCloud->getNumberOfPoints())
+	{
+		std::cout << "The inlier mask has " << inliers.size() << " values, but the point cloud has " << _pointCloud->getNumberOfPoints() << " points!" << std::endl;
+		this->updateHostMemory();
+		return;
+	}
+
+	_inlierMask = inliers;
+
+	// The mask follows the point cloud, whereas reduced or sorted chunks do not
+	MemoryTracker::ScopedTag tag("Point masks");
+	_inlierSSBO = this->writeChunkBuffers(this->toChunkOrder(inliers));
+
+	this->updateHostMemory();
 }
 
-void PointCloudAggregator::render(const mat4& projectionMatrix)
+void PointCloudAggregator::render(const mat4& projectionMatrix, const vec3& viewer)
 {
+	Profiler::ScopedZone zone("Point cloud rendering");
+
 	if (_changedWindowSize)
 	{
 		this->updateWindowBuffers();
 		_changedWindowSize = false;
 	}
 
+	if (PointCloudParameters::_cpuRendering || !_gpuRendering)
+	{
+		this->renderCPU(projectionMatrix);
+		return;
+	}
+
+	_pointCloudResidency->setBudget(size_t(PointCloudParameters::_gpuBudget) << 20);
+	_pointCloudResidency->update(projectionMatrix, viewer, _renderingParameters->_completeFrames);
+
 	if (PointCloudParameters::_enableHQR)
 	{
 		this->projectPointCloudHQR(projectionMatrix);
@@ -212,9 +267,37 @@ void PointCloudAggregator::render(const mat4& projectionMatrix)
 	}
 }
 
+void PointCloudAggregator::setDistances(const std::vector<float>& distances, const float maxDistance)
+{
+	for (GLuint ssbo : _distanceSSBO)
+	{
+		ComputeShader::deleteBuffer(ssbo);
+	}
+	_distanceSSBO.clear();
+	_distance.clear();
+
+	if (distances.size() != _pointCloud->getNumberOfPoints())
+	{
+		std::cout << "There are " << distances.size() << " distances, but the point cloud has " << _pointCloud->getNumberOfPoints() << " points!" << std::endl;
+		this->updateHostMemory();
+		return;
+	}
+
+	_distance = distances;
+
+	// As the inlier mask, distances are permuted into the order of the chunks
+	MemoryTracker::ScopedTag tag("Point distances");
+	_distanceSSBO = this->writeChunkBuffers(this->toChunkOrder(distances));
+
+	_maxDistance = maxDistance;
+	this->updateHostMemory();
+}
+
 void PointCloudAggregator::setPointCloud(PointCloud* pointCloud)
 {
 	_pointCloud = pointCloud;
+	_dtmHeight.clear();
+	_dtmSize = uvec2(0);
 
 	this->deletePointCloudBuffers();
 	this->writePointCloudGPU();
@@ -255,29 +338,48 @@ GLuint PointCloudAggregator::calculateMortonCodes(const GLuint pointsSSBO, unsig
 
 void PointCloudAggregator::deletePointCloudBuffers()
 {
+	for (GLuint ssbo : _distanceSSBO)
+	{
+		ComputeShader::deleteBuffer(ssbo);
+	}
+
 	for (GLuint ssbo : _groundSSBO)
 	{
-		glDeleteBuffers(1, &ssbo);
+		ComputeShader::deleteBuffer(ssbo);
 	}
 
-	for (GLuint ssbo : _pointCloudSSBO)
+	for (GLuint ssbo : _inlierSSBO)
 	{
-		glDeleteBuffers(1, &ssbo);
+		ComputeShader::deleteBuffer(ssbo);
 	}
 
 	for (GLuint ssbo : _visibilitySSBO)
 	{
-		glDeleteBuffers(1, &ssbo);
+		ComputeShader::deleteBuffer(ssbo);
 	}
 
-	_pointCloudSSBO.clear();
+	_distanceSSBO.clear();
+	_groundSSBO.clear();
+	_inlierSSBO.clear();
+	_pointCloudResidency->clear();
 	_pointCloudChunkSize.clear();
+	_sourceIndex.clear();
 	_visibilitySSBO.clear();
+
+	_distance.clear();
+	_groundMask.clear();
+	_inlierMask.clear();
+	_visibilityMask.clear();
+
+	this->updateHostMemory();
 }
 
 void PointCloudAggregator::projectPointCloud(const mat4& projectionMatrix)
 {
-	unsigned chunk = 0, accumSize = 0;
+	Profiler::ScopedZone zone("Point projection");
+	Profiler::GPUZone gpuZone("Point projection");
+
+	unsigned numRenderedPoints = 0;
 	const int numGroupsImage = ComputeShader::getNumGroups(_windowSize.x * _windowSize.y);
 	
 	// 1. Fill buffer of 64 bits with UINT64_MAX, i.e. the null index is UINT_MAX
@@ -286,8 +388,11 @@ void PointCloudAggregator::projectPointCloud(const mat4& projectionMatrix)
 	_resetDepthBufferShader->setUniform("windowSize", _windowSize);
 	_resetDepthBufferShader->execute(numGroupsImage, 1, 1, ComputeShader::getMaxGroupSize(), 1, 1);
 	
-	for (GLuint pointsSSBO: _pointCloudSSBO)
+	for (unsigned chunk = 0; chunk < _pointCloudChunkSize.size(); ++chunk)
 	{
+		const GLuint pointsSSBO = _pointCloudResidency->getRenderableBuffer(chunk);
+		if (!pointsSSBO) continue;											// Culled or still streaming
+
 		const unsigned numPoints = _pointCloudChunkSize[chunk];
 		const int numGroupsPoints = ComputeShader::getNumGroups(numPoints);
 
@@ -299,15 +404,22 @@ void PointCloudAggregator::projectPointCloud(const mat4& projectionMatrix)
 		_projectionShader->setUniform("windowSize", _windowSize);
 		_projectionShader->execute(numGroupsPoints, 1, 1, ComputeShader::getMaxGroupSize(), 1, 1);
 
-		accumSize += _pointCloudChunkSize[chunk++];
+		numRenderedPoints += numPoints;
 	}
+
+	_numProjectedPoints = numRenderedPoints;
 }
 
 void PointCloudAggregator::projectPointCloudHQR(const mat4& projectionMatrix)
 {
-	std::string colorUniform = "rgbColor", visibilityUniform = "visibilityCheck", groundUniform = "groundCheck";
-	unsigned chunk = 0, accumSize = 0;
+	Profiler::ScopedZone zone("HQR point projection");
+	Profiler::GPUZone gpuZone("HQR point projection");
+
+	unsigned numRenderedPoints = 0;
 	const int numGroupsImage = ComputeShader::getNumGroups(_windowSize.x * _windowSize.y);
+	const vec2 minMaxHeight = vec2(_pointCloud->getAABB().min().z, _pointCloud->getAABB().max().z);
+
+	this->updateShaderPermutations();
 
 	// 1. Fill buffer of 32 bits with UINT_MAX
 	_resetDepthBufferHQRShader->bindBuffers(std::vector<GLuint> { _rawDepthBufferSSBO, _color01SSBO, _color02SSBO });
@@ -315,47 +427,28 @@ void PointCloudAggregator::projectPointCloudHQR(const mat4& projectionMatrix)
 	_resetDepthBufferHQRShader->setUniform("windowSize", _windowSize);
 	_resetDepthBufferHQRShader->execute(numGroupsImage, 1, 1, ComputeShader::getMaxGroupSize(), 1, 1);
 
-	for (GLuint pointsSSBO : _pointCloudSSBO)
+	for (unsigned chunk = 0; chunk < _pointCloudChunkSize.size(); ++chunk)
 	{
-		const vec2 minMaxHeight = vec2(_pointCloud->getAABB().min().z, _pointCloud->getAABB().max().z);
+		const GLuint pointsSSBO = _pointCloudResidency->getRenderableBuffer(chunk);
+		if (!pointsSSBO) continue;
+
 		const unsigned numPoints = _pointCloudChunkSize[chunk];
 		const int numGroupsPoints = ComputeShader::getNumGroups(numPoints);
 
 		// 2. Transform points and use atomicMin to retrieve the nearest point
-
-		if (!_renderingParameters->_filterByHeight || _visibilitySSBO.empty())
-			visibilityUniform = "noVisibilityCheck";
-
-		if (!_renderingParameters->_filterByGround || _groundSSBO.empty())
-			groundUniform = "noGroundCheck";
-
-		if (chunk >= _visibilitySSBO.size())
-			if (chunk >= _groundSSBO.size())
-				_projectionHQRShader->bindBuffers(std::vector<GLuint> { _rawDepthBufferSSBO, pointsSSBO });
-			else
-				_projectionHQRShader->bindBuffers(std::vector<GLuint> { _rawDepthBufferSSBO, pointsSSBO, 0, _groundSSBO[chunk] });
-		else
-			if (chunk >= _groundSSBO.size())
-				_projectionHQRShader->bindBuffers(std::vector<GLuint> { _rawDepthBufferSSBO, pointsSSBO, _visibilitySSBO[chunk], 0 });
-			else
-				_projectionHQRShader->bindBuffers(std::vector<GLuint> { _rawDepthBufferSSBO, pointsSSBO, _visibilitySSBO[chunk], _groundSSBO[chunk] });
-
+		_projectionHQRShader->bindBuffers(std::vector<GLuint> { _rawDepthBufferSSBO, pointsSSBO,
+			chunk < _visibilitySSBO.size() ? _visibilitySSBO[chunk] : 0, chunk < _groundSSBO.size() ? _groundSSBO[chunk] : 0, chunk < _inlierSSBO.size() ? _inlierSSBO[chunk] : 0 });
 		_projectionHQRShader->use();
-		_projectionHQRShader->setUniform("calculatedGround", unsigned(!_groundSSBO.empty()));
-		_projectionHQRShader->setUniform("calculatedVisibility", unsigned(!_visibilitySSBO.empty()));
 		_projectionHQRShader->setUniform("cameraMatrix", projectionMatrix);
 		_projectionHQRShader->setUniform("classRange", _renderingParameters->_classRange);
 		//_projectionHQRShader->setUniform("maxReturns", _pointCloud->getMaxReturns());
 		_projectionHQRShader->setUniform("numPoints", numPoints);
 		_projectionHQRShader->setUniform("windowSize", _windowSize);
 		_projectionHQRShader->setUniform("returnFactor", _renderingParameters->_returnFactor);
-		_projectionHQRShader->setSubroutineUniform(GL_COMPUTE_SHADER, "visibilityUniform", visibilityUniform);
-		_projectionHQRShader->setSubroutineUniform(GL_COMPUTE_SHADER, "groundUniform", groundUniform);
-		_projectionHQRShader->applyActiveSubroutines();
 		_projectionHQRShader->execute(numGroupsPoints, 1, 1, ComputeShader::getMaxGroupSize(), 1, 1);
 
 		// 3. Accumulate colors once the minimum depth is defined
-		_addColorsHQRShader->bindBuffers(std::vector<GLuint> { _rawDepthBufferSSBO, _color01SSBO, _color02SSBO, pointsSSBO });
+		_addColorsHQRShader->bindBuffers(std::vector<GLuint> { _rawDepthBufferSSBO, _color01SSBO, _color02SSBO, pointsSSBO, chunk < _distanceSSBO.size() ? _distanceSSBO[chunk] : 0 });
 		_addColorsHQRShader->use();
 		_addColorsHQRShader->setUniform("cameraMatrix", projectionMatrix);
 		_addColorsHQRShader->setUniform("distanceThreshold", PointCloudParameters::_distanceThreshold);
@@ -368,38 +461,42 @@ void PointCloudAggregator::projectPointCloudHQR(const mat4& projectionMatrix)
 				if (_renderingParameters->_normalizedColor)
 				{
 					_addColorsHQRShader->setUniform("minMaxColor", vec2(_pointCloud->getMinColor(), _pointCloud->getMaxColor()));
-					colorUniform = "rgbNormalizedColor";
 				}
 			}
 			else if (_renderingParameters->_visualizationMode == RenderingParameters::HEIGHT)
 			{
 				_addColorsHQRShader->setUniform("minMaxHeight", minMaxHeight);
 				_inferno->applyTexture(_addColorsHQRShader, 0, "paletteTexture");
-				colorUniform = "heightColor";
 			}
 			else if (_renderingParameters->_visualizationMode == RenderingParameters::NORMAL)
 			{
 				_inferno->applyTexture(_addColorsHQRShader, 0, "paletteTexture");
-				colorUniform = "normalColor";
 			}
 			else if (_renderingParameters->_visualizationMode == RenderingParameters::CLASS)
 			{
 				_addColorsHQRShader->setUniform("maxClassId", _pointCloud->getMaxClassId());
 				_inferno->applyTexture(_addColorsHQRShader, 0, "paletteTexture");
-				colorUniform = "classColor";
+			}
+			else if (_renderingParameters->_visualizationMode == RenderingParameters::DISTANCE)
+			{
+				_addColorsHQRShader->setUniform("maxDistance", _maxDistance);
+				_inferno->applyTexture(_addColorsHQRShader, 0, "paletteTexture");
 			}
 		}
 
-		_addColorsHQRShader->setSubroutineUniform(GL_COMPUTE_SHADER, "colorUniform", colorUniform);
-		_addColorsHQRShader->applyActiveSubroutines();
 		_addColorsHQRShader->execute(numGroupsPoints, 1, 1, ComputeShader::getMaxGroupSize(), 1, 1);
 
-		accumSize += _pointCloudChunkSize[chunk++];
+		numRenderedPoints += numPoints;
 	}
+
+	_numProjectedPoints = numRenderedPoints;
 }
 
 void PointCloudAggregator::reducePointChunk(GLuint& pointsSSBO, const GLuint indexSSBO, unsigned& numPoints)
 {
+	Profiler::ScopedZone zone("Point reduction");
+	Profiler::GPUZone gpuZone("Point reduction");
+
 	ComputeShader* reduceShader			= ShaderList::getInstance()->getComputeShader(RendEnum::REDUCE_POINT_BUFFER_SHADER);
 	ComputeShader* iotaShader			= ShaderList::getInstance()->getComputeShader(RendEnum::IOTA_SHADER);
 	ComputeShader* transferPointsShader = ShaderList::getInstance()->getComputeShader(RendEnum::TRANSFER_POINTS_SHADER);
@@ -435,20 +532,80 @@ void PointCloudAggregator::reducePointChunk(GLuint& pointsSSBO, const GLuint ind
 	transferPointsShader->setUniform("arraySize", numPoints);
 	transferPointsShader->execute(numGroups, 1, 1, ComputeShader::getMaxGroupSize(), 1, 1);
 
-	glDeleteBuffers(1, &pointsSSBO);
-	glDeleteBuffers(1, &countPointSSBO);
-	glDeleteBuffers(1, &countPointAuxSSBO);
+	ComputeShader::deleteBuffer(pointsSSBO);
+	ComputeShader::deleteBuffer(countPointSSBO);
+	ComputeShader::deleteBuffer(countPointAuxSSBO);
 	pointsSSBO = pointAuxSSBO;
 }
 
-void PointCloudAggregator::sortPoints(const GLuint pointsSSBO, unsigned numPoints)
+void PointCloudAggregator::renderCPU(const mat4& projectionMatrix)
 {
+	Profiler::ScopedZone zone("CPU rasterization");
+
+	PointCloudRasterizer::Frame frame;
+	std::vector<PointCloud::PointModel>* points = _pointCloud->getPoints();
+
+	if (!_rasterizer) _rasterizer = new PointCloudRasterizer("Assets/Textures/Inferno.png");
+
+	frame._cameraMatrix			= projectionMatrix;
+	frame._windowSize			= _windowSize;
+	frame._backgroundColor		= _renderingParameters->_backgroundColor;
+	frame._hqr					= PointCloudParameters::_enableHQR;
+	frame._classRange			= _renderingParameters->_classRange;
+	frame._returnFactor			= _renderingParameters->_returnFactor;
+	frame._visibility			= _renderingParameters->_filterByHeight && !_visibilityMask.empty() ? _visibilityMask.data() : nullptr;
+	frame._ground				= _renderingParameters->_filterByGround && !_groundMask.empty() ? _groundMask.data() : nullptr;
+	frame._inlier				= _renderingParameters->_filterOutliers && !_inlierMask.empty() ? _inlierMask.data() : nullptr;
+	frame._distanceThreshold	= PointCloudParameters::_distanceThreshold;
+	frame._distance				= _distance.data();
+	frame._maxDistance			= _maxDistance;
+	frame._maxClassId			= _pointCloud->getMaxClassId();
+	frame._minMaxColor			= vec2(_pointCloud->getMinColor(), _pointCloud->getMaxColor());
+	frame._minMaxHeight			= vec2(_pointCloud->getAABB().min().z, _pointCloud->getAABB().max().z);
+
+	// Same selection as the shader permutations
+	switch (_renderingParameters->_visualizationMode)
+	{
+	case RenderingParameters::NORMAL:
+		frame._colorMode = PointCloudRasterizer::NORMAL;
+		break;
+	case RenderingParameters::HEIGHT:
+		frame._colorMode = PointCloudRasterizer::HEIGHT;
+		break;
+	case RenderingParameters::CLASS:
+		frame._colorMode = PointCloudRasterizer::CLASS;
+		break;
+	case RenderingParameters::DISTANCE:
+		frame._colorMode = _distance.empty() ? PointCloudRasterizer::RGB : PointCloudRasterizer::DISTANCE;
+		break;
+	default:
+		frame._colorMode = _renderingParameters->_normalizedColor ? PointCloudRasterizer::RGB_NORMALIZED : PointCloudRasterizer::RGB;
+		break;
+	}
+
+	_rasterizer->render(*points, frame);
+
+	glBindTexture(GL_TEXTURE_2D, _textureID);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, _windowSize.x, _windowSize.y, GL_RGBA, GL_UNSIGNED_BYTE, _rasterizer->getImage().data());
+
+	_numProjectedPoints = unsigned(points->size());
+}
+
+void PointCloudAggregator::sortPoints(const GLuint pointsSSBO, unsigned numPoints, const unsigned firstPoint, std::vector<unsigned>& sourceIndex)
+{
+	Profiler::ScopedZone zone("Morton sort");
+	Profiler::GPUZone gpuZone("Morton sort");
+	MemoryTracker::ScopedTag tag("Sorting scratch");
+
 	const GLuint pointCodeSSBO	= this->calculateMortonCodes(pointsSSBO, numPoints);
 
-	const GLuint indicesBufferSSBO = this->sortFacesByMortonCode(pointCodeSSBO, numPoints);
+	const GLuint indicesBufferSSBO = OpenGLUtilities::sortByMortonCode(pointCodeSSBO, numPoints);
 	GLuint* indices = ComputeShader::readData(indicesBufferSSBO, GLuint());
 	std::vector<GLuint> bufferIndices = std::vector<GLuint>(indices, indices + numPoints);
 
+	// Sized by the largest chunk rather than by the SSBO limit, and released once the upload finishes
+	if (_supportBuffer.size() < numPoints) _supportBuffer.resize(numPoints);
+
 	PointCloud::PointModel* previousPoints;
 	if (PointCloudParameters::_reducePointCloud)
 	{
@@ -456,116 +613,75 @@ void PointCloudAggregator::sortPoints(const GLuint pointsSSBO, unsigned numPoint
 	}
 	else
 	{
-		previousPoints = _pointCloud->getPoints()->data();
+		previousPoints = _pointCloud->getPoints()->data() + firstPoint;
 	}
 
+	const std::vector<unsigned> previousIndex = sourceIndex;
+
 	for (int pointIdx = 0; pointIdx < numPoints; ++pointIdx)
 	{
-		_supportBuffer.at(pointIdx) = previousPoints[indices[pointIdx]];
+		_supportBuffer.at(pointIdx) = previousPoints[bufferIndices[pointIdx]];
+		sourceIndex[pointIdx] = previousIndex[bufferIndices[pointIdx]];
 	}
 
 	ComputeShader::updateReadBuffer(pointsSSBO, _supportBuffer.data(), numPoints, GL_STATIC_DRAW);
 
-	glDeleteBuffers(1, &indicesBufferSSBO);
+	ComputeShader::deleteBuffer(pointCodeSSBO);
+	ComputeShader::deleteBuffer(indicesBufferSSBO);
 }
 
-GLuint PointCloudAggregator::sortFacesByMortonCode(const GLuint mortonCodes, unsigned numPoints)
+void PointCloudAggregator::updateHostMemory()
 {
-	ComputeShader* bitMaskShader = ShaderList::getInstance()->getComputeShader(RendEnum::BIT_MASK_RADIX_SORT);
-	ComputeShader* reduceShader = ShaderList::getInstance()->getComputeShader(RendEnum::REDUCE_PREFIX_SCAN);
-	ComputeShader* downSweepShader = ShaderList::getInstance()->getComputeShader(RendEnum::DOWN_SWEEP_PREFIX_SCAN);
-	ComputeShader* resetPositionShader = ShaderList::getInstance()->getComputeShader(RendEnum::RESET_LAST_POSITION_PREFIX_SCAN);
-	ComputeShader* reallocatePositionShader = ShaderList::getInstance()->getComputeShader(RendEnum::REALLOCATE_RADIX_SORT);
-
-	const unsigned numBits	= 30;			// 10 bits per coordinate (3D)
-	unsigned arraySize		= numPoints;
-	unsigned currentBits	= 0;
-	const int numGroups		= ComputeShader::getNumGroups(arraySize);
-	const int maxGroupSize	= ComputeShader::getMaxGroupSize();
-	GLuint* indices			= new GLuint[arraySize];
-
-	// Binary tree parameters
-	const unsigned startThreads = unsigned(std::ceil(arraySize / 2.0f));
-	const unsigned numExec = unsigned(std::ceil(std::log2(arraySize)));
-	const unsigned numGroups2Log = unsigned(ComputeShader::getNumGroups(startThreads));
-	unsigned numThreads = 0, iteration;
-
-	// Fill indices array from zero to arraySize - 1
-	for (int i = 0; i < arraySize; ++i) { indices[i] = i; }
-
-	GLuint indicesBufferID_1, indicesBufferID_2, pBitsBufferID, nBitsBufferID, positionBufferID;
-	indicesBufferID_1 = ComputeShader::setWriteBuffer(GLuint(), arraySize);
-	indicesBufferID_2 = ComputeShader::setReadBuffer(indices, arraySize);					// Substitutes indicesBufferID_1 for the next iteration
-	pBitsBufferID = ComputeShader::setWriteBuffer(GLuint(), arraySize);
-	nBitsBufferID = ComputeShader::setWriteBuffer(GLuint(), arraySize);
-	positionBufferID = ComputeShader::setWriteBuffer(GLuint(), arraySize);
-
-	while (currentBits < numBits)
-	{
-		std::vector<GLuint> threadCount{ startThreads };
-		threadCount.reserve(numExec);
-
-		std::swap(indicesBufferID_1, indicesBufferID_2);							// indicesBufferID_2 is initialized with indices cause it's swapped here
-
-		// FIRST STEP: BIT MASK, check if a morton code gives zero or one for a certain mask (iteration)
-		unsigned bitMask = 1 << currentBits++;
-
-		bitMaskShader->bindBuffers(std::vector<GLuint> { mortonCodes, indicesBufferID_1, pBitsBufferID, nBitsBufferID });
-		bitMaskShader->use();
-		bitMaskShader->setUniform("arraySize", arraySize);
-		bitMaskShader->setUniform("bitMask", bitMask);
-		bitMaskShader->execute(numGroups, 1, 1, maxGroupSize, 1, 1);
-
-		// SECOND STEP: build a binary tree with a summatory of the array
-		reduceShader->bindBuffers(std::vector<GLuint> { nBitsBufferID });
-		reduceShader->use();
-		reduceShader->setUniform("arraySize", arraySize);
-
-		iteration = 0;
-		while (iteration < numExec)
-		{
-			numThreads = threadCount[threadCount.size() - 1];
-
-			reduceShader->setUniform("iteration", iteration++);
-			reduceShader->setUniform("numThreads", numThreads);
-			reduceShader->execute(numGroups2Log, 1, 1, maxGroupSize, 1, 1);
-
-			threadCount.push_back(std::ceil(numThreads / 2.0f));
-		}
-
-		// THIRD STEP: set last position to zero, its faster to do it in GPU than retrieve the array in CPU, modify and write it again to GPU
-		resetPositionShader->bindBuffers(std::vector<GLuint> { nBitsBufferID });
-		resetPositionShader->use();
-		resetPositionShader->setUniform("arraySize", arraySize);
-		resetPositionShader->execute(1, 1, 1, 1, 1, 1);
+	MemoryTracker* memoryTracker = MemoryTracker::getInstance();
+
+	// Cleared vectors keep their capacity, which is what the process actually holds
+	memoryTracker->setHostAllocation(&_supportBuffer, "Sorting support buffer", _supportBuffer.capacity() * sizeof(PointCloud::PointModel));
+	memoryTracker->setHostAllocation(&_distance, "Point distances", _distance.capacity() * sizeof(float));
+	memoryTracker->setHostAllocation(&_groundMask, "Point masks", _groundMask.capacity());
+	memoryTracker->setHostAllocation(&_inlierMask, "Point masks", _inlierMask.capacity());
+	memoryTracker->setHostAllocation(&_sourceIndex, "Point order", _sourceIndex.capacity() * sizeof(unsigned));
+	memoryTracker->setHostAllocation(&_visibilityMask, "Point masks", _visibilityMask.capacity());
+	memoryTracker->setHostAllocation(_pointCloudResidency, "Chunk host copies", _pointCloudResidency->getHostCopyBytes());
+}
 
-		// FOURTH STEP: build tree back to first level and compute position of each bit
-		downSweepShader->bindBuffers(std::vector<GLuint> { nBitsBufferID });
-		downSweepShader->use();
-		downSweepShader->setUniform("arraySize", arraySize);
+void PointCloudAggregator::updateShaderPermutations()
+{
+	std::vector<std::string> projectionDefines, colorDefines;
 
-		iteration = unsigned(threadCount.size()) - 2;
-		while (iteration >= 0 && iteration < numExec)
-		{
-			downSweepShader->setUniform("iteration", iteration);
-			downSweepShader->setUniform("numThreads", threadCount[iteration--]);
-			downSweepShader->execute(numGroups2Log, 1, 1, maxGroupSize, 1, 1);
-		}
+	if (_renderingParameters->_filterByHeight && !_visibilitySSBO.empty()) projectionDefines.push_back("VISIBILITY_CHECK");
+	if (_renderingParameters->_filterByGround && !_groundSSBO.empty()) projectionDefines.push_back("GROUND_CHECK");
+	if (_renderingParameters->_filterOutliers && !_inlierSSBO.empty()) projectionDefines.push_back("INLIER_CHECK");
 
-		reallocatePositionShader->bindBuffers(std::vector<GLuint> { pBitsBufferID, nBitsBufferID, indicesBufferID_1, indicesBufferID_2 });
-		reallocatePositionShader->use();
-		reallocatePositionShader->setUniform("arraySize", arraySize);
-		reallocatePositionShader->execute(numGroups, 1, 1, maxGroupSize, 1, 1);
+	switch (_renderingParameters->_visualizationMode)
+	{
+	case RenderingParameters::RGB:
+		if (_renderingParameters->_normalizedColor) colorDefines.push_back("RGB_NORMALIZED_COLOR");
+		break;
+	case RenderingParameters::NORMAL:
+		colorDefines.push_back("NORMAL_COLOR");
+		break;
+	case RenderingParameters::HEIGHT:
+		colorDefines.push_back("HEIGHT_COLOR");
+		break;
+	case RenderingParameters::CLASS:
+		colorDefines.push_back("CLASS_COLOR");
+		break;
+	case RenderingParameters::DISTANCE:
+		if (!_distanceSSBO.empty()) colorDefines.push_back("DISTANCE_COLOR");
+		break;
 	}
 
-	glDeleteBuffers(1, &indicesBufferID_1);
-	glDeleteBuffers(1, &pBitsBufferID);
-	glDeleteBuffers(1, &nBitsBufferID);
-	glDeleteBuffers(1, &positionBufferID);
-
-	delete[] indices;
+	if (projectionDefines != _projectionHQRDefines)
+	{
+		_projectionHQRShader = ShaderList::getInstance()->getComputeShader(RendEnum::PROJECTION_HQR_SHADER, projectionDefines);
+		_projectionHQRDefines = projectionDefines;
+	}
 
-	return indicesBufferID_2;
+	if (colorDefines != _addColorsHQRDefines)
+	{
+		_addColorsHQRShader = ShaderList::getInstance()->getComputeShader(RendEnum::ADD_COLORS_HQR, colorDefines);
+		_addColorsHQRDefines = colorDefines;
+	}
 }
 
 void PointCloudAggregator::updateWindowBuffers()
@@ -583,6 +699,9 @@ void PointCloudAggregator::updateWindowBuffers()
 
 void PointCloudAggregator::writeColorsTexture()
 {
+	Profiler::ScopedZone zone("Color resolve");
+	Profiler::GPUZone gpuZone("Color resolve");
+
 	const int numGroupsImage = ComputeShader::getNumGroups(_windowSize.x * _windowSize.y);
 	
 	_storeTexture->bindBuffers(std::vector<GLuint> { _depthBufferSSBO });
@@ -596,6 +715,9 @@ void PointCloudAggregator::writeColorsTexture()
 
 void PointCloudAggregator::writeColorsTextureHQR()
 {
+	Profiler::ScopedZone zone("HQR color resolve");
+	Profiler::GPUZone gpuZone("HQR color resolve");
+
 	const int numGroupsImage = ComputeShader::getNumGroups(_windowSize.x * _windowSize.y);
 
 	_storeHQRTexture->bindBuffers(std::vector<GLuint> { _color01SSBO, _color02SSBO });
@@ -609,31 +731,92 @@ void PointCloudAggregator::writeColorsTextureHQR()
 
 void PointCloudAggregator::writePointCloudGPU()
 {
-	unsigned currentNumPoints, leftPoints = _pointCloud->getNumberOfPoints(), currentNumPointAux;
-	unsigned numPoints = std::min(this->getAllowedNumberOfPoints(), _pointCloud->getNumberOfPoints());
+	Profiler::ScopedZone zone("Point cloud upload");
+	MemoryTracker::ScopedTag tag("Point cloud");
+
+	unsigned currentNumPoints, leftPoints = _pointCloud->getNumberOfPoints(), currentNumPointAux, firstPoint;
+	unsigned numPoints = (std::min)({ this->getAllowedNumberOfPoints(), PointCloudParameters::_chunkSize, _pointCloud->getNumberOfPoints() });
 	std::vector<PointCloud::PointModel>* points = _pointCloud->getPoints();
-	GLuint indexSSBO = ComputeShader::setWriteBuffer(GLuint(), numPoints, GL_DYNAMIC_DRAW);
+	const bool processPoints = PointCloudParameters::_reducePointCloud || PointCloudParameters::_sortPointCloud;
+	GLuint indexSSBO;
+
+	_pointCloudResidency->setBudget(size_t(PointCloudParameters::_gpuBudget) << 20);
+
+	{
+		MemoryTracker::ScopedTag indexTag("Reduction scratch");
+		indexSSBO = ComputeShader::setWriteBuffer(GLuint(), numPoints, GL_DYNAMIC_DRAW);
+	}
 
 	while (leftPoints > 0)
 	{
 		currentNumPoints = std::min(numPoints, leftPoints), currentNumPointAux = currentNumPoints;
+		firstPoint = unsigned(points->size()) - leftPoints;
 
-		GLuint pointBufferSSBO = ComputeShader::setReadBuffer(&(points->at(points->size() - leftPoints)), currentNumPoints, GL_DYNAMIC_DRAW);
+		GLuint pointBufferSSBO = ComputeShader::setReadBuffer(&(points->at(firstPoint)), currentNumPoints, GL_DYNAMIC_DRAW);
+		std::vector<unsigned> sourceIndex;
 
 		if (PointCloudParameters::_reducePointCloud)
 		{
 			this->reducePointChunk(pointBufferSSBO, indexSSBO, currentNumPointAux);
+
+			// The index buffer keeps the chunk position of every surviving point
+			sourceIndex.resize(currentNumPointAux);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, indexSSBO);
+			glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sourceIndex.size() * sizeof(unsigned), sourceIndex.data());
+			for (unsigned& pointIdx : sourceIndex) pointIdx += firstPoint;
+		}
+		else if (processPoints)
+		{
+			sourceIndex.resize(currentNumPoints);
+			std::iota(sourceIndex.begin(), sourceIndex.end(), firstPoint);
 		}
 
 		if (PointCloudParameters::_sortPointCloud)
 		{
-			this->sortPoints(pointBufferSSBO, currentNumPointAux);
+			this->sortPoints(pointBufferSSBO, currentNumPointAux, firstPoint, sourceIndex);
+		}
+
+		_sourceIndex.insert(_sourceIndex.end(), sourceIndex.begin(), sourceIndex.end());
+
+		// Processed chunks differ from the point cloud, so they can only be streamed back from a copy of their own. Points which are
+		// going to be released cannot be referenced, which is only the case if they can be restored from the binary file
+		if (PointCloudParameters::_gpuResidentOnly && _pointCloud->canReleasePoints())
+		{
+			_pointCloudResidency->addChunk(pointBufferSSBO, currentNumPointAux, nullptr);
+		}
+		else if (!processPoints)
+		{
+			_pointCloudResidency->addChunk(pointBufferSSBO, currentNumPoints, &(points->at(firstPoint)));
+		}
+		else if (_pointCloudResidency->getBudget())
+		{
+			std::vector<PointCloud::PointModel> hostCopy(currentNumPointAux);
+
+			if (PointCloudParameters::_sortPointCloud)
+			{
+				std::copy(_supportBuffer.begin(), _supportBuffer.begin() + currentNumPointAux, hostCopy.begin());
+			}
+			else
+			{
+				glBindBuffer(GL_SHADER_STORAGE_BUFFER, pointBufferSSBO);
+				glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, hostCopy.size() * sizeof(PointCloud::PointModel), hostCopy.data());
+			}
+
+			_pointCloudResidency->addChunk(pointBufferSSBO, std::move(hostCopy));
+		}
+		else
+		{
+			_pointCloudResidency->addChunk(pointBufferSSBO, currentNumPointAux, nullptr);
 		}
 
-		_pointCloudSSBO.push_back(pointBufferSSBO);
 		_pointCloudChunkSize.push_back(currentNumPointAux);
+		_pointCloudResidency->enforceBudget();
 		leftPoints -= currentNumPoints;
 	}
 
-	glDeleteBuffers(1, &indexSSBO);
+	ComputeShader::deleteBuffer(indexSSBO);
+
+	_supportBuffer.clear();
+	_supportBuffer.shrink_to_fit();
+	this->updateHostMemory();
 }
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "Graphics/Core/PointCloud.h"
+#include "Graphics/Core/PointCloudRasterizer.h"
+#include "Graphics/Core/PointCloudResidency.h"
+#include "Utilities/ThreadPool.h"
 
 /**
 *	@file PointCloudAggregator.h
@@ -19,23 +22,43 @@ protected:
 	PointCloud*				_pointCloud;
 	
 	// SSBO
+	std::vector<GLuint>		_distanceSSBO;
 	std::vector<GLuint>		_groundSSBO;
-	std::vector<GLuint>		_pointCloudSSBO;
+	std::vector<GLuint>		_inlierSSBO;
 	std::vector<GLuint>		_pointCloudChunkSize;
+	std::vector<unsigned>	_sourceIndex;						//!< Index in the point cloud of every point of the chunks, empty if chunks keep its order
 	std::vector<GLuint>		_visibilitySSBO;
 	GLuint					_depthBufferSSBO, _rawDepthBufferSSBO, _color01SSBO, _color02SSBO;
 	std::vector<Point>		_supportBuffer;
+	PointCloudResidency*	_pointCloudResidency;				//!< Chunks of the point cloud in video memory
 
 	// OpenGL Texture
 	Texture*				_inferno;
 	GLuint					_textureID;
 
+	// Distance to mesh
+	float					_maxDistance;
+
+	// CPU rendering
+	bool					_gpuRendering;						//!< The GPU supports the extensions of the projection shaders
+	PointCloudRasterizer*	_rasterizer;						//!< Created the first time the CPU renders a frame
+	std::vector<float>		_distance;							//!< Per-point distance to a mesh, empty if not computed
+	std::vector<uint8_t>	_groundMask, _inlierMask, _visibilityMask;	//!< Per-point filters, empty if not computed
+
+	// Digital terrain model
+	std::vector<float>		_dtmHeight;							//!< Lowest height of every cell of the last height filter, NaN if empty
+	uvec2					_dtmSize;							//!< Cells of the last height filter
+
 	// Shaders
 	ComputeShader*			_addColorsHQRShader;
 	ComputeShader*			_projectionShader, *_projectionHQRShader;
 	ComputeShader*			_projectionFilterShader;
 	ComputeShader*			_resetDepthBufferShader, * _resetDepthBufferHQRShader;
 	ComputeShader*			_storeTexture, *_storeHQRTexture;
+	std::vector<std::string> _addColorsHQRDefines, _projectionHQRDefines;
+
+	// Statistics
+	unsigned				_numProjectedPoints;				//!< Points dispatched to the projection shaders in the last frame
 
 	// Window
 	RenderingParameters*	_renderingParameters;
@@ -59,16 +82,16 @@ protected:
 	*/
 	GLuint calculateMortonCodes(const GLuint pointsSSBO, unsigned numPoints);
 
-	/**
-	*	@brief  
-	*/
-	void deletePointCloudBuffers();
-	
 	/**
 	*	@brief Projects the point cloud SSBOs into a window plane. 
 	*/
 	void projectPointCloud(const mat4& projectionMatrix);
 
+	/**
+	*	@brief Renders the point cloud with the CPU rasterizer and uploads the result into the colors texture.
+	*/
+	void renderCPU(const mat4& projectionMatrix);
+
 	/**
 	*	@brief Projects the point cloud SSBOs into a window plane.
 	*/
@@ -81,14 +104,27 @@ protected:
 
 	/**
 	*	@brief
+	*	@param firstPoint Index of the first point of the chunk in the point cloud, used when points are not reduced.
+	*	@param sourceIndex Index in the point cloud of every point of the buffer, which is permuted as the points.
 	*/
-	void sortPoints(const GLuint pointsSSBO, unsigned numPoints);
+	void sortPoints(const GLuint pointsSSBO, unsigned numPoints, const unsigned firstPoint, std::vector<unsigned>& sourceIndex);
 
 	/**
-	*	@brief
+	*	@return Per-point values in the order of the chunks, from values in the order of the point cloud.
 	*/
-	GLuint sortFacesByMortonCode(const GLuint mortonCodes, unsigned numPoints);
-	
+	template<typename T>
+	std::vector<T> toChunkOrder(const std::vector<T>& values) const;
+
+	/**
+	*	@brief Reports the size of the host containers to the memory tracker.
+	*/
+	void updateHostMemory();
+
+	/**
+	*	@brief Selects the specialized HQR shaders for the current filters and color mode. Programs only change when settings do.
+	*/
+	void updateShaderPermutations();
+
 	/**
 	*	@brief  
 	*/
@@ -104,6 +140,12 @@ protected:
 	*/
 	void writeColorsTextureHQR();
 
+	/**
+	*	@brief Splits per-point values in the order of the chunks into one buffer per chunk.
+	*/
+	template<typename T>
+	std::vector<GLuint> writeChunkBuffers(const std::vector<T>& values) const;
+
 	/**
 	*	@brief Transfer point cloud information to GPU. 
 	*/
@@ -125,6 +167,11 @@ public:
 	*/
 	void changedSize(const uint16_t width, const uint16_t height);
 
+	/**
+	*	@brief Releases the buffers of the current point cloud, waiting for any pending chunk upload to finish.
+	*/
+	void deletePointCloudBuffers();
+
 	/**
 	*	@brief Filters point cloud following the CSF outcome.
 	*/
@@ -135,15 +182,52 @@ public:
 	*/
 	void filterByHeight(const uvec2& subdivisions);
 
+	/**
+	*	@brief Hides the points marked as outliers, i.e. zero values of the per-point mask.
+	*/
+	void filterOutliers(const std::vector<uint8_t>& inliers);
+
+	/**
+	*	@return Lowest height of every cell, row by row, from the last height filter which built a DTM.
+	*/
+	const std::vector<float>& getDTMHeights() const { return _dtmHeight; }
+
+	/**
+	*	@return Number of cells of the DTM along X and Y.
+	*/
+	uvec2 getDTMSize() const { return _dtmSize; }
+
+	/**
+	*	@return Number of points projected in the last frame, including those discarded by filters.
+	*/
+	unsigned getNumProjectedPoints() const { return _numProjectedPoints; }
+
+	/**
+	*	@return Manager of the point cloud chunks in video memory.
+	*/
+	const PointCloudResidency* getResidency() const { return _pointCloudResidency; }
+
 	/**
 	*	@return Identifier of image texture with point cloud colors. 
 	*/
 	GLuint getTexture() { return _textureID; }
 
+	/**
+	*	@return True if the GPU supports the extensions of the projection shaders. Otherwise, frames are rendered by the CPU.
+	*/
+	bool isGPURenderingSupported() const { return _gpuRendering; }
+
 	/**
 	*	@brief Triggers the rendering of a new frame. 
+	*	@param projectionMatrix Transformation from the space of the points to clip space.
+	*	@param viewer Camera position in the space of the points, which ranks chunks in video memory.
+	*/
+	void render(const mat4& projectionMatrix, const vec3& viewer);
+
+	/**
+	*	@brief Uploads the signed distance from every point to a mesh, mapped to the palette from -maxDistance to maxDistance.
 	*/
-	void render(const mat4& projectionMatrix);
+	void setDistances(const std::vector<float>& distances, const float maxDistance);
 
 	/**
 	*	@brief
@@ -151,3 +235,29 @@ public:
 	void setPointCloud(PointCloud* pointCloud);
 };
 
+template<typename T>
+inline std::vector<T> PointCloudAggregator::toChunkOrder(const std::vector<T>& values) const
+{
+	if (_sourceIndex.empty()) return values;
+
+	std::vector<T> chunkValues(_sourceIndex.size());
+	ThreadPool::getInstance()->parallelFor(0, _sourceIndex.size(), [&](const size_t pointIdx) { chunkValues[pointIdx] = values[_sourceIndex[pointIdx]]; });
+
+	return chunkValues;
+}
+
+template<typename T>
+inline std::vector<GLuint> PointCloudAggregator::writeChunkBuffers(const std::vector<T>& values) const
+{
+	std::vector<GLuint> ssbo;
+	size_t firstPoint = 0;
+
+	// Chunks may differ in size once reduced, so offsets are accumulated rather than derived from the first chunk
+	for (const GLuint chunkSize : _pointCloudChunkSize)
+	{
+		ssbo.push_back(ComputeShader::setReadBuffer(&values[firstPoint], chunkSize));
+		firstPoint += chunkSize;
+	}
+
+	return ssbo;
+}
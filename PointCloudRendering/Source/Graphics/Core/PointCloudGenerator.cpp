@@ -0,0 +1,258 @@
+#include "stdafx.h"
+#include "PointCloudGenerator.h"
+
+#include <future>
+#include "Utilities/ChronoUtilities.h"
+#include "Utilities/RandomUtilities.h"
+#include "Utilities/ThreadPool.h"
+
+// [Static members initialization]
+
+const uint64_t PointCloudGenerator::BLOCK_SIZE = 1 << 22;
+const float PointCloudGenerator::BUILDING_CELL_SIZE = 40.0f;
+const unsigned PointCloudGenerator::MAX_RETURNS = 4;
+const unsigned PointCloudGenerator::NUM_NOISE_SAMPLES = 4096;
+const float PointCloudGenerator::WALL_FRACTION = .15f;
+
+/// [Public methods]
+
+PointCloudGenerator::PointCloudGenerator(const Settings& settings) :
+	_settings(settings)
+{
+	_extent = std::sqrt(float(settings._numPoints) / (std::max)(settings._density, 1e-3f));
+
+	// Fractal noise concentrates around one half, so the coverage is turned into a threshold from the distribution of a noise sample
+	std::vector<float> noise(NUM_NOISE_SAMPLES);
+
+	for (unsigned sampleIdx = 0; sampleIdx < NUM_NOISE_SAMPLES; ++sampleIdx)
+	{
+		const vec4 random = RandomUtilities::getCounterBasedUniform(uvec4(sampleIdx, 0, 2, 0), uvec2(settings._seed, 0x5EED5EEDu));
+		noise[sampleIdx] = this->getNoise(vec2(random.x, random.y) * 1000.0f, 4, 1);
+	}
+
+	std::sort(noise.begin(), noise.end());
+	_vegetationThreshold = settings._vegetationCoverage <= .0f ? -1.0f : noise[unsigned(glm::clamp(settings._vegetationCoverage, .0f, 1.0f) * (NUM_NOISE_SAMPLES - 1))];
+}
+
+PointCloudGenerator::~PointCloudGenerator()
+{
+}
+
+bool PointCloudGenerator::write(const std::string& path) const
+{
+	std::ofstream fout(path + BINARY_EXTENSION, std::ios::out | std::ios::binary);
+	if (!fout.is_open()) return false;
+
+	ChronoUtilities::initChrono();
+
+	const size_t numPoints = size_t(_settings._numPoints);
+	const unsigned numBlocks = unsigned((_settings._numPoints + BLOCK_SIZE - 1) / BLOCK_SIZE);
+	std::vector<PointCloud::PointModel> block[2];
+	std::vector<Statistics> blockStatistics(numBlocks);
+	std::future<void> pendingWrite;
+
+	fout.write((char*)&numPoints, sizeof(size_t));
+
+	// Every block is generated while the previous one is being written
+	for (unsigned blockIdx = 0; blockIdx < numBlocks; ++blockIdx)
+	{
+		std::vector<PointCloud::PointModel>& points = block[blockIdx % 2];
+		const uint64_t first = blockIdx * BLOCK_SIZE;
+
+		points.resize(size_t((std::min)(BLOCK_SIZE, _settings._numPoints - first)));
+		this->generateBlock(first, points, blockStatistics[blockIdx]);
+
+		if (pendingWrite.valid()) pendingWrite.get();
+		pendingWrite = ThreadPool::getInstance()->submit([&fout, &points]() { fout.write((char*)points.data(), points.size() * sizeof(PointCloud::PointModel)); });
+	}
+
+	if (pendingWrite.valid()) pendingWrite.get();
+
+	// Same trailer as PointCloud::writeToBinary, without the spatial index
+	AABB aabb;
+	bool calculatedNormals = false;
+	float minColor = FLT_MAX, maxColor = FLT_MIN, maxReturns = float(MAX_RETURNS);
+	unsigned maxClassId = 0;
+
+	for (const Statistics& statistics : blockStatistics)
+	{
+		aabb.update(statistics._min);
+		aabb.update(statistics._max);
+		minColor = (std::min)(minColor, statistics._minColor);
+		maxColor = (std::max)(maxColor, statistics._maxColor);
+		maxClassId = (std::max)(maxClassId, statistics._maxClassId);
+	}
+
+	fout.write((char*)&aabb, sizeof(AABB));
+	fout.write((char*)&calculatedNormals, sizeof(bool));
+	fout.write((char*)&maxColor, sizeof(float));
+	fout.write((char*)&minColor, sizeof(float));
+	fout.write((char*)&maxClassId, sizeof(uint8_t));
+	fout.write((char*)&maxReturns, sizeof(float));
+	fout.close();
+
+	std::cout << _settings._numPoints << " synthetic points written into " << path + BINARY_EXTENSION << " (" << ChronoUtilities::getDuration() << " ms)" << std::endl;
+
+	return !fout.fail();
+}
+
+/// [Protected methods]
+
+void PointCloudGenerator::generateBlock(const uint64_t first, std::vector<PointCloud::PointModel>& points, Statistics& statistics) const
+{
+	const size_t numChunks = (std::max)(points.size() / 65536, size_t(1));
+	std::vector<Statistics> chunkStatistics(numChunks, Statistics{ vec3(FLT_MAX), vec3(-FLT_MAX), FLT_MAX, FLT_MIN, 0 });
+
+	ThreadPool::getInstance()->parallelFor(0, numChunks, [&](const size_t chunkIdx)
+		{
+			Statistics& chunk = chunkStatistics[chunkIdx];
+			const size_t begin = points.size() * chunkIdx / numChunks, end = points.size() * (chunkIdx + 1) / numChunks;
+
+			for (size_t pointIdx = begin; pointIdx < end; ++pointIdx)
+			{
+				unsigned classId;
+				const PointCloud::PointModel point = points[pointIdx] = this->generatePoint(first + pointIdx, classId);
+				const vec3 rgb = vec3(glm::unpackUnorm4x8(point._rgb)) * 255.0f;
+
+				chunk._min = glm::min(chunk._min, point._point);
+				chunk._max = glm::max(chunk._max, point._point);
+				chunk._minColor = (std::min)(chunk._minColor, (std::min)((std::min)(rgb.r, rgb.g), rgb.b));
+				chunk._maxColor = (std::max)(chunk._maxColor, (std::max)((std::max)(rgb.r, rgb.g), rgb.b));
+				chunk._maxClassId = (std::max)(chunk._maxClassId, classId);
+			}
+		}, 1);
+
+	statistics = chunkStatistics[0];
+
+	for (const Statistics& chunk : chunkStatistics)
+	{
+		statistics._min = glm::min(statistics._min, chunk._min);
+		statistics._max = glm::max(statistics._max, chunk._max);
+		statistics._minColor = (std::min)(statistics._minColor, chunk._minColor);
+		statistics._maxColor = (std::max)(statistics._maxColor, chunk._maxColor);
+		statistics._maxClassId = (std::max)(statistics._maxClassId, chunk._maxClassId);
+	}
+}
+
+PointCloud::PointModel PointCloudGenerator::generatePoint(const uint64_t pointIdx, unsigned& classId) const
+{
+	const uvec2 key = uvec2(_settings._seed, 0x5EED5EEDu);
+	const vec4 random = RandomUtilities::getCounterBasedUniform(uvec4(uint32_t(pointIdx), uint32_t(pointIdx >> 32), 0, 0), key);
+	const vec4 detail = RandomUtilities::getCounterBasedUniform(uvec4(uint32_t(pointIdx), uint32_t(pointIdx >> 32), 1, 0), key);
+
+	vec2 position = vec2(random.x, random.y) * _extent;
+	vec3 color;
+	float height = this->getGroundHeight(position), returnNumber = 1.0f, numReturns = 1.0f;
+
+	classId = GROUND;
+
+	// Buildings: every city block may hold a single box, whose footprint and height are hashed from the block
+	const ivec2 cell = ivec2(glm::floor(position / BUILDING_CELL_SIZE));
+	const vec4 building = RandomUtilities::getCounterBasedUniform(uvec4(uvec2(cell), 0, 1), key);
+	const vec4 footprint = RandomUtilities::getCounterBasedUniform(uvec4(uvec2(cell), 1, 1), key);
+	const vec2 cellMin = vec2(cell) * BUILDING_CELL_SIZE;
+	const vec2 buildingMin = cellMin + vec2(footprint.x, footprint.y) * BUILDING_CELL_SIZE * .3f + 2.0f;
+	const vec2 buildingMax = cellMin + BUILDING_CELL_SIZE - vec2(footprint.z, footprint.w) * BUILDING_CELL_SIZE * .3f - 2.0f;
+
+	if (building.x < _settings._buildingCoverage && glm::all(glm::greaterThanEqual(position, buildingMin)) && glm::all(glm::lessThan(position, buildingMax)))
+	{
+		const float base = this->getGroundHeight((buildingMin + buildingMax) * .5f), buildingHeight = 5.0f + building.y * 30.0f;
+
+		classId = BUILDING;
+
+		if (detail.x < WALL_FRACTION)
+		{
+			// Points are moved to the nearest wall, so that walls receive a fraction of the roof points
+			const vec2 toMin = position - buildingMin, toMax = buildingMax - position;
+			const float nearest = glm::min(glm::min(toMin.x, toMin.y), glm::min(toMax.x, toMax.y));
+
+			if (nearest == toMin.x) position.x = buildingMin.x;
+			else if (nearest == toMin.y) position.y = buildingMin.y;
+			else if (nearest == toMax.x) position.x = buildingMax.x;
+			else position.y = buildingMax.y;
+
+			height = base + detail.y * buildingHeight;
+			color = vec3(200.0f, 190.0f, 170.0f);
+		}
+		else
+		{
+			const vec3 roofColor[] = { vec3(150.0f, 60.0f, 50.0f), vec3(120.0f, 120.0f, 125.0f), vec3(90.0f, 90.0f, 95.0f) };
+
+			height = base + buildingHeight;
+			color = roofColor[unsigned(building.z * 3.0f)];
+		}
+	}
+	else if (this->getNoise(position / 60.0f, 4, 1) < _vegetationThreshold)
+	{
+		// Vegetation: pulses split into several returns through the canopy, the last one reaching the ground
+		const float canopyHeight = 1.0f + 19.0f * this->getNoise(position / 15.0f, 2, 2);
+
+		numReturns = 1.0f + glm::floor(random.z * MAX_RETURNS);
+		returnNumber = 1.0f + glm::floor(random.w * numReturns);
+
+		if (returnNumber < numReturns || numReturns == 1.0f)
+		{
+			const float heightAboveGround = canopyHeight * (1.0f - (returnNumber - 1.0f + detail.y) / numReturns);
+
+			height += heightAboveGround;
+			classId = heightAboveGround < .5f ? LOW_VEGETATION : (heightAboveGround < 2.0f ? MEDIUM_VEGETATION : HIGH_VEGETATION);
+			color = glm::mix(vec3(40.0f, 90.0f, 30.0f), vec3(90.0f, 140.0f, 50.0f), detail.z);
+		}
+		else
+		{
+			color = vec3(80.0f, 70.0f, 50.0f);
+		}
+	}
+	else
+	{
+		color = glm::mix(vec3(110.0f, 100.0f, 80.0f), vec3(90.0f, 120.0f, 70.0f), this->getNoise(position / 8.0f, 2, 3));
+	}
+
+	// Range noise of a few centimeters, and colors varying from point to point
+	height += (detail.w - .5f) * .04f;
+	color = glm::clamp(color * (.9f + .2f * detail.z), .0f, 255.0f);
+
+	return PointCloud::PointModel{ vec3(position - _extent * .5f, height), PointCloud::PointModel::getRGBColor(color), vec3(.0f),
+		PointCloud::PointModel::encodeReturnsClass(returnNumber / MAX_RETURNS, numReturns / MAX_RETURNS, classId / 256.0f) };
+}
+
+float PointCloudGenerator::getGroundHeight(const vec2& position) const
+{
+	return _settings._terrainRelief * this->getNoise(position / 400.0f, 5, 0);
+}
+
+float PointCloudGenerator::getNoise(const vec2& position, const unsigned octaves, const uint32_t layer) const
+{
+	float noise = .0f, amplitude = .5f, totalAmplitude = .0f;
+	vec2 octavePosition = position;
+
+	for (unsigned octave = 0; octave < octaves; ++octave)
+	{
+		const vec2 cellPosition = glm::floor(octavePosition), t = glm::smoothstep(vec2(.0f), vec2(1.0f), octavePosition - cellPosition);
+		const ivec2 cell = ivec2(cellPosition);
+		const uint32_t octaveLayer = layer * 16 + octave;
+
+		noise += amplitude * glm::mix(
+			glm::mix(this->hashLattice(cell, octaveLayer), this->hashLattice(cell + ivec2(1, 0), octaveLayer), t.x),
+			glm::mix(this->hashLattice(cell + ivec2(0, 1), octaveLayer), this->hashLattice(cell + ivec2(1, 1), octaveLayer), t.x), t.y);
+		totalAmplitude += amplitude;
+		amplitude *= .5f;
+		octavePosition *= 2.0f;
+	}
+
+	return noise / totalAmplitude;
+}
+
+float PointCloudGenerator::hashLattice(const ivec2& cell, const uint32_t layer) const
+{
+	// Lattice values are looked up many times per point, hence a cheap integer hash is used instead of the counter-based generator
+	uint32_t hash = uint32_t(cell.x) * 0x8DA6B343u ^ uint32_t(cell.y) * 0xD8163841u ^ (layer + _settings._seed * 0x9E3779B9u) * 0xCB1AB31Fu;
+
+	hash ^= hash >> 16;
+	hash *= 0x7FEB352Du;
+	hash ^= hash >> 15;
+	hash *= 0x846CA68Bu;
+	hash ^= hash >> 16;
+
+	return (hash >> 8) * (1.0f / float(1 << 24));
+}
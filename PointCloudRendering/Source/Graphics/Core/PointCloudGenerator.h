@@ -0,0 +1,104 @@
+#pragma once
+
+#include "Graphics/Core/PointCloud.h"
+
+/**
+*	@file PointCloudGenerator.h
+*	@authors Alfonso Lpez Ruiz (alr00048@red.ujaen.es)
+*	@date 19/10/2026
+*/
+
+/**
+*	@brief Generator of synthetic airborne LiDAR scenes for scaling benchmarks: a terrain heightfield with flat-roofed buildings and patches
+*	of vegetation, with ASPRS classes and multiple returns. Every point is drawn from its index with a counter-based generator, so a seed
+*	and a number of points define the same cloud on any machine, whatever the number of threads. Points are written in blocks straight into
+*	the binary cache of PointCloud, hence clouds larger than memory can be generated and loaded as any other cloud.
+*/
+class PointCloudGenerator
+{
+public:
+	struct Settings
+	{
+		uint64_t		_numPoints;										//!< Number of generated points
+		uint32_t		_seed;											//!< Key of the counter-based generator
+		float			_density;										//!< Points per square meter, which defines the extent of the scene
+		float			_terrainRelief;									//!< Maximum height difference of the terrain
+		float			_buildingCoverage;								//!< Probability of a city block having a building
+		float			_vegetationCoverage;							//!< Fraction of the ground covered by vegetation
+
+		/**
+		*	@brief Default constructor.
+		*/
+		Settings() : _numPoints(1000000), _seed(0), _density(16.0f), _terrainRelief(30.0f), _buildingCoverage(.35f), _vegetationCoverage(.3f) {}
+	};
+
+protected:
+	const static uint64_t	BLOCK_SIZE;									//!< Points generated while the previous block is written
+	const static float		BUILDING_CELL_SIZE;							//!< Side of the city blocks where a building may stand
+	const static unsigned	MAX_RETURNS;								//!< Maximum number of returns of a pulse
+	const static unsigned	NUM_NOISE_SAMPLES;							//!< Samples of the vegetation noise used to find its threshold
+	const static float		WALL_FRACTION;								//!< Fraction of building points lying on walls rather than on the roof
+
+	enum ASPRSClass : unsigned
+	{
+		GROUND = 2, LOW_VEGETATION = 3, MEDIUM_VEGETATION = 4, HIGH_VEGETATION = 5, BUILDING = 6
+	};
+
+	struct Statistics
+	{
+		vec3		_min, _max;											//!< Boundaries of the generated points
+		float		_minColor, _maxColor;								//!< Range of color channels
+		unsigned	_maxClassId;										//!< Highest class id
+	};
+
+protected:
+	Settings		_settings;											//!< Parameters of the scene
+	float			_extent;											//!< Side of the square scene
+	float			_vegetationThreshold;								//!< Noise value below which the ground is covered by vegetation
+
+protected:
+	/**
+	*	@brief Generates the points [first, first + points.size()).
+	*/
+	void generateBlock(const uint64_t first, std::vector<PointCloud::PointModel>& points, Statistics& statistics) const;
+
+	/**
+	*	@brief Generates a single point from its index.
+	*	@param classId ASPRS class of the point, also encoded in the point.
+	*/
+	PointCloud::PointModel generatePoint(const uint64_t pointIdx, unsigned& classId) const;
+
+	/**
+	*	@return Height of the terrain at a XY position.
+	*/
+	float getGroundHeight(const vec2& position) const;
+
+	/**
+	*	@return Fractal value noise in [0, 1] at a position, built from several octaves of a hashed lattice.
+	*/
+	float getNoise(const vec2& position, const unsigned octaves, const uint32_t layer) const;
+
+	/**
+	*	@return Uniform value in [0, 1) hashed from a lattice point, used by the noise.
+	*/
+	float hashLattice(const ivec2& cell, const uint32_t layer) const;
+
+public:
+	/**
+	*	@brief Constructor.
+	*/
+	PointCloudGenerator(const Settings& settings);
+
+	/**
+	*	@brief Destructor.
+	*/
+	virtual ~PointCloudGenerator();
+
+	/**
+	*	@brief Generates the scene into the binary file of a point cloud path, i.e. path + BINARY_EXTENSION, so that PointCloud loads it.
+	*	The spatial index is not written, hence it is built and cached the first time the point cloud is loaded.
+	*	@return False if the file could not be written.
+	*/
+	bool write(const std::string& path) const;
+};
+
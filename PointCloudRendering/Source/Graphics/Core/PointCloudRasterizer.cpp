@@ -0,0 +1,310 @@
+#include "stdafx.h"
+#include "PointCloudRasterizer.h"
+
+#include <atomic>
+#include <bit>
+#include "Utilities/ThreadPool.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+// [Static members initialization]
+
+const unsigned PointCloudRasterizer::BATCH_SIZE = 1 << 15;
+const uint64_t PointCloudRasterizer::EMPTY_PIXEL = UINT64_MAX;
+const unsigned PointCloudRasterizer::LANE_COUNT = 8;
+const unsigned PointCloudRasterizer::TILE_SIZE = 8;
+
+static_assert(sizeof(PointCloud::PointModel) == 8 * sizeof(float), "Points are gathered as eight floats");
+
+/// [Public methods]
+
+PointCloudRasterizer::PointCloudRasterizer(const std::string& paletteFilename) :
+	_numTiles(0), _windowSize(0)
+{
+	Image palette(paletteFilename);
+
+	if (palette.getWidth() && palette.getHeight())
+	{
+		// Palettes are sampled along their middle column, i.e. between two texels if the width is even
+		const float x = palette.getWidth() * .5f - .5f;
+		const unsigned column = unsigned(x), nextColumn = (std::min)(column + 1, unsigned(palette.getWidth()) - 1);
+		const unsigned char* bits = palette.bits();
+
+		_palette.resize(palette.getHeight());
+
+		for (int row = 0; row < palette.getHeight(); ++row)
+		{
+			const unsigned char* texel = &bits[(row * palette.getWidth() + column) * palette.getDepth()], *nextTexel = &bits[(row * palette.getWidth() + nextColumn) * palette.getDepth()];
+
+			_palette[row] = glm::mix(vec3(texel[0], texel[1], texel[2]), vec3(nextTexel[0], nextTexel[1], nextTexel[2]), x - column);
+		}
+	}
+	else
+	{
+		_palette.push_back(vec3(255.0f));
+	}
+}
+
+PointCloudRasterizer::~PointCloudRasterizer()
+{
+}
+
+void PointCloudRasterizer::render(const std::vector<PointCloud::PointModel>& points, const Frame& frame)
+{
+	const size_t numBatches = (points.size() + BATCH_SIZE - 1) / BATCH_SIZE;
+
+	if (!frame._windowSize.x || !frame._windowSize.y) return;
+
+	this->resize(frame._windowSize);
+
+	// 1. Clear framebuffer
+	std::fill(std::execution::par_unseq, _depthBuffer.begin(), _depthBuffer.end(), EMPTY_PIXEL);
+	if (frame._hqr)
+	{
+		std::fill(std::execution::par_unseq, _color01.begin(), _color01.end(), 0);
+		std::fill(std::execution::par_unseq, _color02.begin(), _color02.end(), 0);
+	}
+
+	// 2. Nearest depth, plus color if HQR is disabled
+	ThreadPool::getInstance()->parallelFor(0, numBatches, [&](const size_t batchIdx)
+		{
+			this->storeDepth(points, batchIdx * BATCH_SIZE, (std::min)((batchIdx + 1) * BATCH_SIZE, points.size()), frame);
+		}, 1);
+
+	// 3. Accumulate colors once the nearest depth is defined
+	if (frame._hqr)
+	{
+		ThreadPool::getInstance()->parallelFor(0, numBatches, [&](const size_t batchIdx)
+			{
+				this->accumulateColors(points, batchIdx * BATCH_SIZE, (std::min)((batchIdx + 1) * BATCH_SIZE, points.size()), frame);
+			}, 1);
+	}
+
+	this->storeImage(frame);
+}
+
+/// [Protected methods]
+
+void PointCloudRasterizer::accumulateColors(const std::vector<PointCloud::PointModel>& points, const size_t first, const size_t last, const Frame& frame)
+{
+	alignas(32) unsigned pixel[LANE_COUNT] = { 0 };
+	alignas(32) float depth[LANE_COUNT] = { .0f };
+
+	for (size_t pointIdx = first; pointIdx < last; pointIdx += LANE_COUNT)
+	{
+		const unsigned numPoints = unsigned((std::min)(size_t(LANE_COUNT), last - pointIdx));
+		unsigned mask = this->projectPoints(&points[pointIdx], numPoints, frame._cameraMatrix, pixel, depth);
+
+		// Same surface: depth < nearest depth * distanceThreshold. Depth bits are the high half of every framebuffer value
+#ifdef __AVX2__
+		if (mask)
+		{
+			const __m256i pixelIdx = _mm256_load_si256(reinterpret_cast<const __m256i*>(pixel));
+			const __m256i depthIdx = _mm256_add_epi32(_mm256_slli_epi32(pixelIdx, 1), _mm256_set1_epi32(1));
+			const __m256 laneMask = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_and_si256(_mm256_set1_epi32(int(mask)), _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128)), _mm256_setzero_si256()));
+			const __m256 nearestDepth = _mm256_mask_i32gather_ps(_mm256_setzero_ps(), reinterpret_cast<const float*>(_depthBuffer.data()), depthIdx, laneMask, 4);
+
+			mask &= unsigned(_mm256_movemask_ps(_mm256_cmp_ps(_mm256_load_ps(depth), _mm256_mul_ps(nearestDepth, _mm256_set1_ps(frame._distanceThreshold)), _CMP_LT_OQ)));
+		}
+#else
+		for (unsigned lane = 0; lane < numPoints; ++lane)
+		{
+			if (!(mask & (1u << lane))) continue;
+
+			const float nearestDepth = std::bit_cast<float>(uint32_t(_depthBuffer[pixel[lane]] >> 32));
+			if (!(depth[lane] < nearestDepth * frame._distanceThreshold)) mask &= ~(1u << lane);
+		}
+#endif
+
+		while (mask)
+		{
+			const unsigned lane = std::countr_zero(mask);
+			const uvec3 color = uvec3(glm::max(this->getColor(points[pointIdx + lane], pointIdx + lane, frame), .0f));
+
+			std::atomic_ref<uint64_t>(_color01[pixel[lane]]).fetch_add((uint64_t(color.r) << 32) | color.g, std::memory_order_relaxed);
+			std::atomic_ref<uint64_t>(_color02[pixel[lane]]).fetch_add((uint64_t(color.b) << 32) | 1, std::memory_order_relaxed);
+
+			mask &= mask - 1;
+		}
+	}
+}
+
+vec3 PointCloudRasterizer::getColor(const PointCloud::PointModel& point, const size_t pointIdx, const Frame& frame) const
+{
+	switch (frame._colorMode)
+	{
+	case RGB_NORMALIZED:
+		return vec3((point._rgb - frame._minMaxColor.x) / (frame._minMaxColor.y - frame._minMaxColor.x)) * 255.0f;
+	case NORMAL:
+		return this->samplePalette(glm::abs(glm::dot(vec3(.0f, 1.0f, .0f), point._normal)));
+	case HEIGHT:
+		return this->samplePalette((point._point.z - frame._minMaxHeight.x) / (frame._minMaxHeight.y - frame._minMaxHeight.x));
+	case CLASS:
+		return this->samplePalette(glm::unpackUnorm4x8(point._returnClass).z * 256.0f / frame._maxClassId);
+	case DISTANCE:
+		return this->samplePalette(glm::clamp(frame._distance[pointIdx] / frame._maxDistance, -1.0f, 1.0f) * .5f + .5f);
+	default:
+		return vec3(glm::unpackUnorm4x8(point._rgb)) * 255.0f;
+	}
+}
+
+bool PointCloudRasterizer::isFiltered(const PointCloud::PointModel& point, const size_t pointIdx, const Frame& frame)
+{
+	const vec4 returnClassId = glm::unpackUnorm4x8(point._returnClass);
+	const float pointReturnFactor = returnClassId.x / returnClassId.y;
+
+	return pointReturnFactor < frame._returnFactor || returnClassId.z * 256.0f < frame._classRange.x || returnClassId.z * 256.0f > frame._classRange.y ||
+		(frame._visibility && frame._visibility[pointIdx] == 0) || (frame._ground && frame._ground[pointIdx] != 1) || (frame._inlier && frame._inlier[pointIdx] != 1);
+}
+
+unsigned PointCloudRasterizer::projectPoints(const PointCloud::PointModel* points, const unsigned numPoints, const mat4& cameraMatrix, unsigned* pixel, float* depth) const
+{
+	const unsigned tileShift = std::countr_zero(TILE_SIZE);
+
+#ifdef __AVX2__
+	if (numPoints == LANE_COUNT)
+	{
+		const __m256i pointOffset = _mm256_setr_epi32(0, 8, 16, 24, 32, 40, 48, 56);
+		const float* base = &points->_point.x;
+		const __m256 x = _mm256_i32gather_ps(base, pointOffset, 4), y = _mm256_i32gather_ps(base + 1, pointOffset, 4), z = _mm256_i32gather_ps(base + 2, pointOffset, 4);
+
+		auto transform = [&](const int row)
+			{
+				return _mm256_fmadd_ps(_mm256_set1_ps(cameraMatrix[0][row]), x, _mm256_fmadd_ps(_mm256_set1_ps(cameraMatrix[1][row]), y,
+					_mm256_fmadd_ps(_mm256_set1_ps(cameraMatrix[2][row]), z, _mm256_set1_ps(cameraMatrix[3][row]))));
+			};
+
+		const __m256 w = transform(3), ndcX = _mm256_div_ps(transform(0), w), ndcY = _mm256_div_ps(transform(1), w);
+		const __m256 one = _mm256_set1_ps(1.0f), minusOne = _mm256_set1_ps(-1.0f), half = _mm256_set1_ps(.5f);
+
+		__m256 inside = _mm256_cmp_ps(w, _mm256_setzero_ps(), _CMP_GT_OQ);
+		inside = _mm256_and_ps(inside, _mm256_and_ps(_mm256_cmp_ps(ndcX, minusOne, _CMP_GE_OQ), _mm256_cmp_ps(ndcX, one, _CMP_LE_OQ)));
+		inside = _mm256_and_ps(inside, _mm256_and_ps(_mm256_cmp_ps(ndcY, minusOne, _CMP_GE_OQ), _mm256_cmp_ps(ndcY, one, _CMP_LE_OQ)));
+
+		const unsigned mask = unsigned(_mm256_movemask_ps(inside));
+		if (!mask) return 0;
+
+		// Points exactly on the right or top border are kept in the last column or row
+		const __m256i px = _mm256_min_epi32(_mm256_cvttps_epi32(_mm256_mul_ps(_mm256_fmadd_ps(ndcX, half, half), _mm256_set1_ps(float(_windowSize.x)))), _mm256_set1_epi32(int(_windowSize.x) - 1));
+		const __m256i py = _mm256_min_epi32(_mm256_cvttps_epi32(_mm256_mul_ps(_mm256_fmadd_ps(ndcY, half, half), _mm256_set1_ps(float(_windowSize.y)))), _mm256_set1_epi32(int(_windowSize.y) - 1));
+		const __m256i tile = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(py, tileShift), _mm256_set1_epi32(int(_numTiles.x))), _mm256_srli_epi32(px, tileShift));
+		const __m256i tileMask = _mm256_set1_epi32(int(TILE_SIZE - 1));
+		const __m256i local = _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(py, tileMask), tileShift), _mm256_and_si256(px, tileMask));
+
+		_mm256_store_si256(reinterpret_cast<__m256i*>(pixel), _mm256_and_si256(_mm256_or_si256(_mm256_slli_epi32(tile, 2 * tileShift), local), _mm256_castps_si256(inside)));
+		_mm256_store_ps(depth, w);
+
+		return mask;
+	}
+#endif
+
+	unsigned mask = 0;
+
+	for (unsigned lane = 0; lane < numPoints; ++lane)
+	{
+		const vec4 projectedPoint = cameraMatrix * vec4(points[lane]._point, 1.0f);
+		const vec2 ndc = vec2(projectedPoint) / projectedPoint.w;
+
+		pixel[lane] = 0;
+		if (projectedPoint.w <= .0f || ndc.x < -1.0f || ndc.x > 1.0f || ndc.y < -1.0f || ndc.y > 1.0f) continue;
+
+		const uvec2 windowPosition = glm::min(uvec2((ndc * .5f + .5f) * vec2(_windowSize)), _windowSize - uvec2(1));
+		const uvec2 tile = windowPosition >> tileShift, local = windowPosition & uvec2(TILE_SIZE - 1);
+
+		pixel[lane] = ((tile.y * _numTiles.x + tile.x) << (2 * tileShift)) | (local.y << tileShift) | local.x;
+		depth[lane] = projectedPoint.w;
+		mask |= 1u << lane;
+	}
+
+	return mask;
+}
+
+void PointCloudRasterizer::resize(const uvec2& windowSize)
+{
+	if (windowSize == _windowSize) return;
+
+	_windowSize = windowSize;
+	_numTiles = (windowSize + uvec2(TILE_SIZE - 1)) / TILE_SIZE;
+
+	const size_t numPixels = size_t(_numTiles.x) * _numTiles.y * TILE_SIZE * TILE_SIZE;
+
+	_depthBuffer.resize(numPixels);
+	_color01.resize(numPixels);
+	_color02.resize(numPixels);
+	_image.resize(size_t(windowSize.x) * windowSize.y * 4);
+}
+
+vec3 PointCloudRasterizer::samplePalette(const float v) const
+{
+	// Mirrored repeat, as the palette texture
+	const float mirrored = glm::mod(v, 2.0f), t = mirrored > 1.0f ? 2.0f - mirrored : mirrored;
+	const float y = t * _palette.size() - .5f, row = glm::floor(y);
+	const int lastRow = int(_palette.size()) - 1;
+
+	return glm::mix(_palette[glm::clamp(int(row), 0, lastRow)], _palette[glm::clamp(int(row) + 1, 0, lastRow)], y - row);
+}
+
+void PointCloudRasterizer::storeDepth(const std::vector<PointCloud::PointModel>& points, const size_t first, const size_t last, const Frame& frame)
+{
+	alignas(32) unsigned pixel[LANE_COUNT] = { 0 };
+	alignas(32) float depth[LANE_COUNT] = { .0f };
+
+	for (size_t pointIdx = first; pointIdx < last; pointIdx += LANE_COUNT)
+	{
+		const unsigned numPoints = unsigned((std::min)(size_t(LANE_COUNT), last - pointIdx));
+		unsigned mask = this->projectPoints(&points[pointIdx], numPoints, frame._cameraMatrix, pixel, depth);
+
+		while (mask)
+		{
+			const unsigned lane = std::countr_zero(mask);
+			const PointCloud::PointModel& point = points[pointIdx + lane];
+
+			mask &= mask - 1;
+			if (frame._hqr && isFiltered(point, pointIdx + lane, frame)) continue;
+
+			// Positive depths keep their order as unsigned integers, and ties are solved by the lowest color as in computeDepthBuffer
+			const uint64_t value = (uint64_t(std::bit_cast<uint32_t>(depth[lane])) << 32) | (frame._hqr ? 0 : point._rgb);
+			std::atomic_ref<uint64_t> nearest(_depthBuffer[pixel[lane]]);
+			uint64_t current = nearest.load(std::memory_order_relaxed);
+
+			while (value < current && !nearest.compare_exchange_weak(current, value, std::memory_order_relaxed));
+		}
+	}
+}
+
+void PointCloudRasterizer::storeImage(const Frame& frame)
+{
+	const unsigned tileShift = std::countr_zero(TILE_SIZE);
+	const glm::u8vec3 background = glm::u8vec3(glm::round(glm::clamp(frame._backgroundColor, .0f, 1.0f) * 255.0f));
+	std::vector<unsigned> rows(_windowSize.y);
+
+	std::iota(rows.begin(), rows.end(), 0);
+	std::for_each(std::execution::par_unseq, rows.begin(), rows.end(), [&](const unsigned y)
+		{
+			const unsigned tileRow = (y >> tileShift) * _numTiles.x, localRow = (y & (TILE_SIZE - 1)) << tileShift;
+
+			for (unsigned x = 0; x < _windowSize.x; ++x)
+			{
+				const size_t pixelIdx = (size_t(tileRow + (x >> tileShift)) << (2 * tileShift)) | localRow | (x & (TILE_SIZE - 1));
+				GLubyte* rgba = &_image[(size_t(y) * _windowSize.x + x) * 4];
+				glm::u8vec3 color = background;
+
+				if (frame._hqr)
+				{
+					const uint64_t rg = _color01[pixelIdx], ba = _color02[pixelIdx];
+					const uint32_t count = uint32_t(ba);
+
+					if (count) color = glm::u8vec3(uint32_t(rg >> 32) / count, uint32_t(rg) / count, uint32_t(ba >> 32) / count);
+				}
+				else if (_depthBuffer[pixelIdx] != EMPTY_PIXEL)
+				{
+					const uint32_t rgb = uint32_t(_depthBuffer[pixelIdx]);
+					color = glm::u8vec3(rgb & 0xff, (rgb >> 8) & 0xff, (rgb >> 16) & 0xff);
+				}
+
+				rgba[0] = color.r; rgba[1] = color.g; rgba[2] = color.b; rgba[3] = 255;
+			}
+		});
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "Graphics/Core/PointCloud.h"
+
+/**
+*	@file PointCloudRasterizer.h
+*	@authors Alfonso Lpez Ruiz (alr00048@red.ujaen.es)
+*	@date 19/10/2026
+*/
+
+/**
+*	@brief CPU counterpart of the compute shaders which render point clouds, for GPUs without 64-bit atomics and machines without GPU.
+*	Batches of points are projected by parallel tasks, eight at a time with AVX2, into a framebuffer split in tiles of TILE_SIZE x TILE_SIZE
+*	pixels. The nearest depth of every pixel is kept with 64-bit atomic minimum operations, and then, as in addColorsHQR, colors of points
+*	closer than the nearest depth times distanceThreshold are accumulated. Points are read in the order of the point cloud, so the result
+*	matches the GPU pipeline as long as points are neither reduced nor sorted.
+*/
+class PointCloudRasterizer
+{
+public:
+	enum ColorMode
+	{
+		RGB, RGB_NORMALIZED, NORMAL, HEIGHT, CLASS, DISTANCE
+	};
+
+	struct Frame
+	{
+		mat4			_cameraMatrix;										//!< Transformation from world to clip space
+		uvec2			_windowSize;										//!< Size of the image
+		vec3			_backgroundColor;									//!< Color of pixels without points
+		bool			_hqr;												//!< Averages the nearest surface instead of keeping the nearest point
+
+		// Filters, only applied by HQR rendering as in computeDepthBufferHQR
+		ivec2			_classRange;										//!< Range of rendered classes
+		float			_returnFactor;										//!< Minimum ratio of return number to number of returns
+		const uint8_t*	_visibility, *_ground, *_inlier;					//!< Per-point masks, nullptr if the filter is disabled
+
+		// Colors, only applied by HQR rendering as in addColorsHQR
+		ColorMode		_colorMode;											//!< Source of point colors
+		float			_distanceThreshold;									//!< Depth ratio of points belonging to the nearest surface
+		const float*	_distance;											//!< Per-point distance to a mesh, required by DISTANCE
+		float			_maxDistance;										//!< Distance mapped to both ends of the palette
+		unsigned		_maxClassId;										//!< Class mapped to the end of the palette
+		vec2			_minMaxColor, _minMaxHeight;						//!< Ranges of RGB_NORMALIZED and HEIGHT
+	};
+
+protected:
+	const static unsigned BATCH_SIZE;										//!< Points projected by every task
+	const static uint64_t EMPTY_PIXEL;										//!< Depth buffer value of pixels without points
+	const static unsigned LANE_COUNT;										//!< Points projected together, one per AVX2 lane
+	const static unsigned TILE_SIZE;										//!< Pixels per side of framebuffer tiles
+
+protected:
+	std::vector<uint64_t>	_depthBuffer;									//!< Depth bits (high) and color (low) of the nearest point, tiled
+	std::vector<uint64_t>	_color01, _color02;								//!< Accumulated R and G, and B and count of points, tiled
+	std::vector<GLubyte>	_image;											//!< RGBA image, row by row
+	uvec2					_numTiles;										//!< Tiles along X and Y
+	std::vector<vec3>		_palette;										//!< Rows of the palette along the middle column, in [0, 255]
+	uvec2					_windowSize;									//!< Size of the image
+
+protected:
+	/**
+	*	@brief Accumulates the colors of the points of a batch that belong to the nearest surface of their pixel.
+	*/
+	void accumulateColors(const std::vector<PointCloud::PointModel>& points, const size_t first, const size_t last, const Frame& frame);
+
+	/**
+	*	@return Color of a point in [0, 255], following the color mode of the frame.
+	*/
+	vec3 getColor(const PointCloud::PointModel& point, const size_t pointIdx, const Frame& frame) const;
+
+	/**
+	*	@return True if a point is discarded by the filters of the frame.
+	*/
+	static bool isFiltered(const PointCloud::PointModel& point, const size_t pointIdx, const Frame& frame);
+
+	/**
+	*	@brief Projects up to LANE_COUNT consecutive points into the tiled framebuffer.
+	*	@return Mask of the points which fall inside the view, whose tiled pixel and depth are written.
+	*/
+	unsigned projectPoints(const PointCloud::PointModel* points, const unsigned numPoints, const mat4& cameraMatrix, unsigned* pixel, float* depth) const;
+
+	/**
+	*	@brief Resizes the framebuffer and the image.
+	*/
+	void resize(const uvec2& windowSize);
+
+	/**
+	*	@return Palette color in [0, 255], linearly interpolated and mirrored out of [0, 1] as the palette texture.
+	*/
+	vec3 samplePalette(const float v) const;
+
+	/**
+	*	@brief Writes the depth of the nearest point of every pixel of a batch.
+	*/
+	void storeDepth(const std::vector<PointCloud::PointModel>& points, const size_t first, const size_t last, const Frame& frame);
+
+	/**
+	*	@brief Resolves the framebuffer into the RGBA image, as storeTexture and storeTextureHQR.
+	*/
+	void storeImage(const Frame& frame);
+
+public:
+	/**
+	*	@brief Constructor.
+	*	@param paletteFilename Image of the palette used by the color modes other than RGB.
+	*/
+	PointCloudRasterizer(const std::string& paletteFilename);
+
+	/**
+	*	@brief Destructor.
+	*/
+	virtual ~PointCloudRasterizer();
+
+	/**
+	*	@return RGBA image of the last frame, row by row from the bottom.
+	*/
+	const std::vector<GLubyte>& getImage() const { return _image; }
+
+	/**
+	*	@brief Renders a point cloud into the RGBA image.
+	*/
+	void render(const std::vector<PointCloud::PointModel>& points, const Frame& frame);
+};
+
@@ -0,0 +1,380 @@
+#include "stdafx.h"
+#include "PointCloudResidency.h"
+
+#include "Graphics/Core/ComputeShader.h"
+#include "Utilities/MemoryTracker.h"
+
+// [Static members initialization]
+
+const unsigned PointCloudResidency::NUM_STAGING_BUFFERS = 4;
+const size_t PointCloudResidency::STAGING_BUFFER_SIZE = size_t(32) << 20;
+
+/// [Public methods]
+
+PointCloudResidency::PointCloudResidency() :
+	_budget(0), _residentBytes(0), _frame(0)
+{
+}
+
+PointCloudResidency::~PointCloudResidency()
+{
+	this->clear();
+
+	for (std::unique_ptr<StagingBuffer>& staging : _staging)
+	{
+		glBindBuffer(GL_COPY_READ_BUFFER, staging->_buffer);
+		glUnmapBuffer(GL_COPY_READ_BUFFER);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glDeleteBuffers(1, &staging->_buffer);
+		MemoryTracker::getInstance()->releaseBuffer(staging->_buffer);
+	}
+}
+
+GLuint PointCloudResidency::acquireBuffer(const unsigned chunkIdx)
+{
+	Chunk& chunk = _chunk[chunkIdx];
+	if (chunk.isResident() || !chunk._hostPoints) return chunk._ssbo;
+
+	if (!chunk._ssbo)
+	{
+		MemoryTracker::ScopedTag tag("Point cloud");
+
+		chunk._ssbo = ComputeShader::setWriteBuffer(PointCloud::PointModel(), chunk._numPoints, GL_STATIC_DRAW);
+		_residentBytes += chunk.getBytes();
+	}
+
+	// Ranges still in flight write the same points again, so they are harmless
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, chunk._ssbo);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, chunk.getBytes(), chunk._hostPoints);
+
+	chunk._requestedBytes = chunk._uploadedBytes = chunk.getBytes();
+	chunk._lastUsedFrame = _frame;
+
+	return chunk._ssbo;
+}
+
+void PointCloudResidency::addChunk(const GLuint ssbo, const unsigned numPoints, const PointCloud::PointModel* hostPoints)
+{
+	Chunk chunk;
+	chunk._hostPoints = hostPoints;
+	chunk._numPoints = numPoints;
+	chunk._ssbo = ssbo;
+	chunk._requestedBytes = chunk._uploadedBytes = chunk.getBytes();
+	chunk._pendingTransfers = 0;
+	chunk._lastUsedFrame = _frame;
+	chunk._distance = .0f;
+	chunk._visible = false;
+
+	if (hostPoints)
+	{
+		// Every range of points is bounded by a task of the pool, and ranges are merged afterwards
+		const size_t numRanges = size_t(ThreadPool::getInstance()->getNumThreads()) * 4 + 1, rangeSize = (size_t(numPoints) + numRanges - 1) / numRanges;
+		std::vector<AABB> rangeAABB(numRanges);
+
+		ThreadPool::getInstance()->parallelFor(0, numRanges, [&](const size_t rangeIdx)
+			{
+				const size_t lastPoint = (std::min)((rangeIdx + 1) * rangeSize, size_t(numPoints));
+				for (size_t pointIdx = rangeIdx * rangeSize; pointIdx < lastPoint; ++pointIdx) rangeAABB[rangeIdx].update(hostPoints[pointIdx]._point);
+			}, 1);
+
+		for (size_t rangeIdx = 0; rangeIdx * rangeSize < numPoints; ++rangeIdx) chunk._aabb.update(rangeAABB[rangeIdx]);		// Empty ranges would invert the box
+	}
+	else
+	{
+		// Not culled, as its boundaries are unknown
+		chunk._aabb = AABB(vec3(-FLT_MAX), vec3(FLT_MAX));
+	}
+
+	_chunk.push_back(std::move(chunk));
+	_residentBytes += _chunk.back().getBytes();
+}
+
+void PointCloudResidency::addChunk(const GLuint ssbo, std::vector<PointCloud::PointModel>&& hostCopy)
+{
+	const unsigned numPoints = unsigned(hostCopy.size());
+
+	this->addChunk(ssbo, numPoints, hostCopy.data());
+	_chunk.back()._hostCopy = std::move(hostCopy);							// Moving keeps the storage the chunk points to
+}
+
+void PointCloudResidency::clear()
+{
+	_fillTasks.wait();
+
+	for (std::unique_ptr<StagingBuffer>& staging : _staging)
+	{
+		if (staging->_fence) glDeleteSync(staging->_fence);
+
+		staging->_fence = nullptr;
+		staging->_state = FREE;
+	}
+
+	for (Chunk& chunk : _chunk)
+	{
+		if (chunk._ssbo) ComputeShader::deleteBuffer(chunk._ssbo);
+	}
+
+	_chunk.clear();
+	_residentBytes = 0;
+}
+
+void PointCloudResidency::enforceBudget()
+{
+	this->makeRoom(0, std::vector<uint8_t>(_chunk.size(), 0));
+}
+
+size_t PointCloudResidency::getHostCopyBytes() const
+{
+	size_t bytes = 0;
+	for (const Chunk& chunk : _chunk) bytes += chunk._hostCopy.capacity() * sizeof(PointCloud::PointModel);
+
+	return bytes;
+}
+
+unsigned PointCloudResidency::getNumResidentChunks() const
+{
+	return unsigned(std::count_if(_chunk.begin(), _chunk.end(), [](const Chunk& chunk) { return chunk.isResident(); }));
+}
+
+GLuint PointCloudResidency::getRenderableBuffer(const unsigned chunkIdx) const
+{
+	const Chunk& chunk = _chunk[chunkIdx];
+
+	return chunk._visible && chunk.isResident() ? chunk._ssbo : 0;
+}
+
+void PointCloudResidency::update(const mat4& viewProjection, const vec3& viewer, const bool complete)
+{
+	++_frame;
+	this->processStagingBuffers();
+
+	// 1. Visible chunks come first, the nearest ones before
+	std::vector<unsigned> order(_chunk.size());
+	std::vector<uint8_t> visible(_chunk.size(), 0);
+	std::iota(order.begin(), order.end(), 0);
+
+	for (unsigned chunkIdx = 0; chunkIdx < _chunk.size(); ++chunkIdx)
+	{
+		Chunk& chunk = _chunk[chunkIdx];
+		chunk._visible = !chunk._hostPoints || intersectsFrustum(chunk._aabb, viewProjection);
+		chunk._distance = glm::distance(viewer, glm::clamp(viewer, chunk._aabb.min(), chunk._aabb.max()));
+
+		if (chunk._visible) chunk._lastUsedFrame = _frame;
+		visible[chunkIdx] = chunk._visible;
+	}
+
+	std::sort(order.begin(), order.end(), [this](const unsigned chunkIdx1, const unsigned chunkIdx2)
+		{
+			const Chunk& chunk1 = _chunk[chunkIdx1], & chunk2 = _chunk[chunkIdx2];
+			return chunk1._visible != chunk2._visible ? chunk1._visible : chunk1._distance < chunk2._distance;
+		});
+
+	// 2. Chunks are wanted by rank while they fit in the budget, after those which cannot be evicted
+	std::vector<uint8_t> wanted(_chunk.size(), 0);
+	size_t wantedBytes = 0;
+
+	for (unsigned chunkIdx = 0; chunkIdx < _chunk.size(); ++chunkIdx)
+	{
+		if (!_chunk[chunkIdx]._hostPoints)
+		{
+			wanted[chunkIdx] = 1;
+			wantedBytes += _chunk[chunkIdx].getBytes();
+		}
+	}
+
+	for (const unsigned chunkIdx : order)
+	{
+		if (wanted[chunkIdx]) continue;
+		if (_budget && wantedBytes + _chunk[chunkIdx].getBytes() > _budget) break;
+
+		wanted[chunkIdx] = 1;
+		wantedBytes += _chunk[chunkIdx].getBytes();
+	}
+
+	this->makeRoom(0, wanted);													// Trims the excess of complete frames
+
+	// 3. Complete frames upload their visible chunks right away, so that they are never skipped
+	if (complete)
+	{
+		for (const unsigned chunkIdx : order)
+		{
+			if (!_chunk[chunkIdx]._visible) break;
+			if (_chunk[chunkIdx].isResident()) continue;
+
+			if (!_chunk[chunkIdx]._ssbo) this->makeRoom(_chunk[chunkIdx].getBytes(), visible);
+			this->acquireBuffer(chunkIdx);
+		}
+	}
+
+	// 4. Missing ranges of wanted chunks are handed to free staging buffers, by rank
+	for (const unsigned chunkIdx : order)
+	{
+		Chunk& chunk = _chunk[chunkIdx];
+		if (!wanted[chunkIdx] || chunk._requestedBytes == chunk.getBytes()) continue;
+
+		if (!chunk._ssbo)
+		{
+			if (!this->makeRoom(chunk.getBytes(), wanted)) break;
+
+			MemoryTracker::ScopedTag tag("Point cloud");
+
+			chunk._ssbo = ComputeShader::setWriteBuffer(PointCloud::PointModel(), chunk._numPoints, GL_STATIC_DRAW);
+			chunk._requestedBytes = chunk._uploadedBytes = 0;
+			_residentBytes += chunk.getBytes();
+		}
+
+		if (_staging.empty()) this->createStagingBuffers();
+
+		for (std::unique_ptr<StagingBuffer>& staging : _staging)
+		{
+			if (chunk._requestedBytes == chunk.getBytes()) break;
+			if (staging->_state.load(std::memory_order_acquire) == FREE) this->requestRange(chunkIdx, *staging);
+		}
+
+		if (chunk._requestedBytes < chunk.getBytes()) break;					// Every staging buffer is busy
+	}
+}
+
+/// [Protected methods]
+
+void PointCloudResidency::createStagingBuffers()
+{
+	const GLbitfield mapFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	MemoryTracker::ScopedTag tag("Streaming staging");
+
+	for (unsigned stagingIdx = 0; stagingIdx < NUM_STAGING_BUFFERS; ++stagingIdx)
+	{
+		std::unique_ptr<StagingBuffer> staging = std::make_unique<StagingBuffer>();
+
+		glGenBuffers(1, &staging->_buffer);
+		glBindBuffer(GL_COPY_READ_BUFFER, staging->_buffer);
+		glBufferStorage(GL_COPY_READ_BUFFER, STAGING_BUFFER_SIZE, nullptr, mapFlags);
+		staging->_memory = static_cast<GLubyte*>(glMapBufferRange(GL_COPY_READ_BUFFER, 0, STAGING_BUFFER_SIZE, mapFlags));
+		staging->_fence = nullptr;
+		staging->_state = FREE;
+		staging->_chunkIdx = 0;
+		staging->_offset = staging->_bytes = 0;
+
+		MemoryTracker::getInstance()->registerBuffer(staging->_buffer, STAGING_BUFFER_SIZE);
+		_staging.push_back(std::move(staging));
+	}
+
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+void PointCloudResidency::evict(const unsigned chunkIdx)
+{
+	Chunk& chunk = _chunk[chunkIdx];
+
+	ComputeShader::deleteBuffer(chunk._ssbo);
+	_residentBytes -= chunk.getBytes();
+
+	chunk._ssbo = 0;
+	chunk._requestedBytes = chunk._uploadedBytes = 0;
+}
+
+bool PointCloudResidency::intersectsFrustum(const AABB& aabb, const mat4& viewProjection)
+{
+	const vec3 min = aabb.min(), max = aabb.max();
+	unsigned outside[6] = { 0, 0, 0, 0, 0, 0 };
+
+	// The box is culled only if all its corners lie beyond the same clipping plane
+	for (unsigned cornerIdx = 0; cornerIdx < 8; ++cornerIdx)
+	{
+		const vec4 corner = viewProjection * vec4(cornerIdx & 1 ? max.x : min.x, cornerIdx & 2 ? max.y : min.y, cornerIdx & 4 ? max.z : min.z, 1.0f);
+
+		outside[0] += corner.x < -corner.w;
+		outside[1] += corner.x > corner.w;
+		outside[2] += corner.y < -corner.w;
+		outside[3] += corner.y > corner.w;
+		outside[4] += corner.z < -corner.w;
+		outside[5] += corner.z > corner.w;
+	}
+
+	return std::none_of(outside, outside + 6, [](const unsigned numOutside) { return numOutside == 8; });
+}
+
+bool PointCloudResidency::makeRoom(const size_t bytes, const std::vector<uint8_t>& wanted)
+{
+	if (!_budget) return true;
+
+	while (_residentBytes + bytes > _budget)
+	{
+		unsigned victimIdx = unsigned(_chunk.size());
+
+		for (unsigned chunkIdx = 0; chunkIdx < _chunk.size(); ++chunkIdx)
+		{
+			const Chunk& chunk = _chunk[chunkIdx];
+			if (!chunk._ssbo || wanted[chunkIdx] || !chunk._hostPoints || chunk._pendingTransfers) continue;
+
+			if (victimIdx == _chunk.size() || chunk._lastUsedFrame < _chunk[victimIdx]._lastUsedFrame ||
+				(chunk._lastUsedFrame == _chunk[victimIdx]._lastUsedFrame && chunk._distance > _chunk[victimIdx]._distance))
+			{
+				victimIdx = chunkIdx;
+			}
+		}
+
+		if (victimIdx == _chunk.size()) return false;
+
+		this->evict(victimIdx);
+	}
+
+	return true;
+}
+
+void PointCloudResidency::processStagingBuffers()
+{
+	for (std::unique_ptr<StagingBuffer>& staging : _staging)
+	{
+		const StagingState state = staging->_state.load(std::memory_order_acquire);
+
+		if (state == FILLED)
+		{
+			Chunk& chunk = _chunk[staging->_chunkIdx];
+
+			glBindBuffer(GL_COPY_READ_BUFFER, staging->_buffer);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, chunk._ssbo);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, staging->_offset, staging->_bytes);
+			glBindBuffer(GL_COPY_READ_BUFFER, 0);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+			staging->_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			staging->_state = COPYING;
+
+			chunk._uploadedBytes = (std::min)(chunk._uploadedBytes + staging->_bytes, chunk.getBytes());
+			--chunk._pendingTransfers;
+		}
+		else if (state == COPYING)
+		{
+			const GLenum status = glClientWaitSync(staging->_fence, 0, 0);
+
+			if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED)
+			{
+				glDeleteSync(staging->_fence);
+				staging->_fence = nullptr;
+				staging->_state = FREE;
+			}
+		}
+	}
+}
+
+void PointCloudResidency::requestRange(const unsigned chunkIdx, StagingBuffer& staging)
+{
+	Chunk& chunk = _chunk[chunkIdx];
+
+	staging._chunkIdx = chunkIdx;
+	staging._offset = chunk._requestedBytes;
+	staging._bytes = (std::min)(STAGING_BUFFER_SIZE, chunk.getBytes() - chunk._requestedBytes);
+	staging._state = FILLING;
+
+	chunk._requestedBytes += staging._bytes;
+	++chunk._pendingTransfers;
+
+	const GLubyte* source = reinterpret_cast<const GLubyte*>(chunk._hostPoints) + staging._offset;
+
+	_fillTasks.run([source, &staging]()
+		{
+			std::memcpy(staging._memory, source, staging._bytes);
+			staging._state.store(FILLED, std::memory_order_release);
+		});
+}
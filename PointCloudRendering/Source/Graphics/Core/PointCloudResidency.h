@@ -0,0 +1,199 @@
+#pragma once
+
+#include <atomic>
+
+#include "Geometry/3D/AABB.h"
+#include "Graphics/Core/PointCloud.h"
+#include "Utilities/ThreadPool.h"
+
+/**
+*	@file PointCloudResidency.h
+*	@authors Alfonso Lpez Ruiz (alr00048@red.ujaen.es)
+*	@date 19/10/2026
+*/
+
+/**
+*	@brief Keeps the chunks of a point cloud in video memory within a budget. Every frame, chunks are ranked by visibility and distance to
+*	the viewer, so that the nearest visible ones are wanted first. Chunks which are not wanted are evicted in least-recently-used order when
+*	room is needed, and missing chunks are streamed back from host memory through a ring of persistently mapped staging buffers: workers of
+*	the thread pool copy the points into the staging memory and the context thread transfers them into the chunk buffer, so that rendering
+*	never waits for an upload. Chunks without a host copy cannot be streamed back and are never evicted. Every OpenGL call must be issued from
+*	the thread which owns the context.
+*/
+class PointCloudResidency
+{
+protected:
+	const static unsigned	NUM_STAGING_BUFFERS;							//!< Transfers which can be in flight at the same time
+	const static size_t		STAGING_BUFFER_SIZE;							//!< Bytes of every staging buffer
+
+protected:
+	enum StagingState
+	{
+		FREE, FILLING, FILLED, COPYING
+	};
+
+	struct Chunk
+	{
+		const PointCloud::PointModel*		_hostPoints;					//!< Source of uploads, null if the chunk cannot be evicted
+		std::vector<PointCloud::PointModel>	_hostCopy;						//!< Processed points which differ from the point cloud, if any
+		unsigned							_numPoints;						//!< Points of the chunk
+		AABB								_aabb;							//!< Boundaries of the points
+		GLuint								_ssbo;							//!< Buffer in video memory, zero if evicted
+		size_t								_requestedBytes;				//!< Bytes given to staging buffers since the buffer was created
+		size_t								_uploadedBytes;					//!< Bytes transferred into the buffer
+		unsigned							_pendingTransfers;				//!< Staging buffers which are filling the chunk
+		uint64_t							_lastUsedFrame;					//!< Last frame where the chunk was visible
+		float								_distance;						//!< Distance from the viewer to the boundaries
+		bool								_visible;						//!< Intersects the view frustum of the current frame
+
+		/**
+		*	@return Size of the chunk in video memory.
+		*/
+		size_t getBytes() const { return size_t(_numPoints) * sizeof(PointCloud::PointModel); }
+
+		/**
+		*	@return True if every point of the chunk has been transferred.
+		*/
+		bool isResident() const { return _ssbo && _uploadedBytes == this->getBytes(); }
+	};
+
+	struct StagingBuffer
+	{
+		GLuint						_buffer;								//!< Persistently mapped buffer
+		GLubyte*					_memory;								//!< Mapping of the buffer
+		GLsync						_fence;									//!< Signalled once the GPU has consumed the staged points
+		std::atomic<StagingState>	_state;									//!< Stage of the transfer, written by workers when filled
+		unsigned					_chunkIdx;								//!< Chunk which receives the points
+		size_t						_offset, _bytes;						//!< Range of the chunk buffer
+	};
+
+protected:
+	std::vector<Chunk>							_chunk;						//!< Chunks of the point cloud, in order
+	std::vector<std::unique_ptr<StagingBuffer>>	_staging;					//!< Ring of staging buffers, created on the first upload
+	ThreadPool::TaskGroup						_fillTasks;					//!< Copies into staging memory
+	size_t										_budget;					//!< Maximum bytes of chunk buffers, zero for no limit
+	size_t										_residentBytes;				//!< Bytes of chunk buffers, including partial ones
+	uint64_t									_frame;						//!< Number of updates
+
+protected:
+	/**
+	*	@brief Creates the staging buffers.
+	*/
+	void createStagingBuffers();
+
+	/**
+	*	@brief Deletes the buffer of a chunk.
+	*/
+	void evict(const unsigned chunkIdx);
+
+	/**
+	*	@return False if the box lies completely outside the view frustum of the matrix.
+	*/
+	static bool intersectsFrustum(const AABB& aabb, const mat4& viewProjection);
+
+	/**
+	*	@brief Evicts unwanted chunks, least recently used first, until the given bytes fit in the budget.
+	*	@param wanted Chunks which must not be evicted, indexed as the chunks.
+	*	@return False if the bytes cannot fit.
+	*/
+	bool makeRoom(const size_t bytes, const std::vector<uint8_t>& wanted);
+
+	/**
+	*	@brief Issues the transfers of filled staging buffers and releases those already consumed by the GPU.
+	*/
+	void processStagingBuffers();
+
+	/**
+	*	@brief Gives the next range of a chunk to a free staging buffer, whose memory is filled by the thread pool.
+	*/
+	void requestRange(const unsigned chunkIdx, StagingBuffer& staging);
+
+public:
+	/**
+	*	@brief Constructor.
+	*/
+	PointCloudResidency();
+
+	/**
+	*	@brief Destructor. Waits for pending copies and deletes every buffer.
+	*/
+	virtual ~PointCloudResidency();
+
+	/**
+	*	@brief Returns the buffer of a chunk, uploading it synchronously if it is not resident. Used by passes over the whole point cloud,
+	*	which should call enforceBudget() once the buffer is no longer needed.
+	*/
+	GLuint acquireBuffer(const unsigned chunkIdx);
+
+	/**
+	*	@brief Appends a chunk which is already resident.
+	*	@param hostPoints Points of the buffer in host memory, which must outlive the chunk. Null if they are not available, in which case
+	*	the chunk is never evicted.
+	*/
+	void addChunk(const GLuint ssbo, const unsigned numPoints, const PointCloud::PointModel* hostPoints);
+
+	/**
+	*	@brief Appends a chunk which is already resident and whose processed points are kept in host memory.
+	*/
+	void addChunk(const GLuint ssbo, std::vector<PointCloud::PointModel>&& hostCopy);
+
+	/**
+	*	@brief Deletes every chunk.
+	*/
+	void clear();
+
+	/**
+	*	@brief Evicts chunks, least recently used first, until the resident ones fit in the budget.
+	*/
+	void enforceBudget();
+
+	/**
+	*	@return Maximum bytes of chunk buffers, zero for no limit.
+	*/
+	size_t getBudget() const { return _budget; }
+
+	/**
+	*	@return Host memory of the processed copies.
+	*/
+	size_t getHostCopyBytes() const;
+
+	/**
+	*	@return Number of chunks.
+	*/
+	unsigned getNumChunks() const { return unsigned(_chunk.size()); }
+
+	/**
+	*	@return Number of chunks whose points are completely in video memory.
+	*/
+	unsigned getNumResidentChunks() const;
+
+	/**
+	*	@return Points of a chunk.
+	*/
+	unsigned getNumPoints(const unsigned chunkIdx) const { return _chunk[chunkIdx]._numPoints; }
+
+	/**
+	*	@return Buffer of a chunk if it is resident and visible in the current frame, zero otherwise.
+	*/
+	GLuint getRenderableBuffer(const unsigned chunkIdx) const;
+
+	/**
+	*	@return Bytes of chunk buffers.
+	*/
+	size_t getResidentBytes() const { return _residentBytes; }
+
+	/**
+	*	@brief Sets the maximum bytes of chunk buffers, which is enforced from the next update on.
+	*/
+	void setBudget(const size_t budget) { _budget = budget; }
+
+	/**
+	*	@brief Ranks the chunks for a new frame, evicts those which are not needed and streams the missing ones.
+	*	@param viewProjection Matrix of the frame, whose frustum decides the visible chunks.
+	*	@param viewer Position the distance of chunks is measured from.
+	*	@param complete Uploads every visible chunk before returning, even beyond the budget, instead of skipping those still streaming.
+	*	The excess is evicted by the next update.
+	*/
+	void update(const mat4& viewProjection, const vec3& viewer, const bool complete = false);
+};
+
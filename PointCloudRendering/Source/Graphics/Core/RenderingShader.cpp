@@ -29,61 +29,57 @@ GLuint RenderingShader::createShaderProgram(const char* filename)
 		}
 	}
 
-	// [Vertex shader]
-	char fileNameComplete[256];
-	strcpy_s(fileNameComplete, filename);
-	strcat_s(fileNameComplete, "-vert.glsl");
-
-	const GLuint vertexShaderObject = compileShader(fileNameComplete, GL_VERTEX_SHADER);
-	if (vertexShaderObject == 0) {
-		return 0;
-	}
-
-	// [Fragment shader]
-	strcpy_s(fileNameComplete, filename);
-	strcat_s(fileNameComplete, "-frag.glsl");
+	_name = filename;
 
-	const GLuint fragmentShaderObject = compileShader(fileNameComplete, GL_FRAGMENT_SHADER);
-	if (fragmentShaderObject == 0) {
-		return 0;
-	}
+	const GLenum shaderTypes[] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, GL_GEOMETRY_SHADER };
+	const char* shaderSuffixes[] = { "-vert.glsl", "-frag.glsl", "-geo.glsl" };
+	std::vector<std::string> shaderSources(3);
 
-	// [Geometry shader, optional]
-	strcpy_s(fileNameComplete, filename);
-	strcat_s(fileNameComplete, "-geo.glsl");
-	const GLuint geometryShaderObject = compileShader(fileNameComplete, GL_GEOMETRY_SHADER);
+	for (int shaderIdx = 0; shaderIdx < 3; ++shaderIdx)
+	{
+		char fileNameComplete[256];
+		strcpy_s(fileNameComplete, filename);
+		strcat_s(fileNameComplete, shaderSuffixes[shaderIdx]);
 
-	glAttachShader(_handler, vertexShaderObject);						// Associate shaders with shader program
-	glAttachShader(_handler, fragmentShaderObject);
-	if (geometryShaderObject != 0) glAttachShader(_handler, geometryShaderObject);
+		if (shaderTypes[shaderIdx] == GL_GEOMETRY_SHADER && !fileExists(fileNameComplete)) continue;			// Geometry shader is optional
 
-	glLinkProgram(_handler);											// Link shader program to check errors
-	GLint linkSuccess = 0;
-	glGetProgramiv(_handler, GL_LINK_STATUS, &linkSuccess);
+		if (!this->preprocessShader(fileNameComplete, shaderSources[shaderIdx]))
+		{
+			return 0;
+		}
+	}
 
-	if (linkSuccess == GL_FALSE)
+	this->computeBinaryKey(shaderSources);
+	if (this->loadProgramBinary())								// Warm start: no GLSL compilation at all
 	{
-		GLint logLen = 0;
-		glGetProgramiv(_handler, GL_INFO_LOG_LENGTH, &logLen);
+		_linked = true;
+		this->reserveSubroutines();
 
-		if (logLen > 0) {
-			char* cLogString = new char[logLen];
-			GLint written = 0;
-			glGetProgramInfoLog(_handler, logLen, &written, cLogString);
-			_logString.assign(cLogString);
-			delete[] cLogString;
+		return _handler;
+	}
+
+	std::vector<GLuint> shaderObjects;
+	for (int shaderIdx = 0; shaderIdx < 3; ++shaderIdx)
+	{
+		if (shaderSources[shaderIdx].empty()) continue;
 
-			std::cout << "Cannot link shader " << filename << ":" << std::endl << _logString << std::endl;
+		const GLuint shaderObject = this->compileShaderSource(shaderSources[shaderIdx], shaderTypes[shaderIdx]);
+		if (shaderObject == 0) {
+			return 0;
 		}
 
-		return 0;
-	}
-	else
-	{
-		_linked = true;
+		shaderObjects.push_back(shaderObject);
 	}
 
-	// Reserve space for subroutines
+	this->linkProgram(shaderObjects);							// Associate shaders with shader program
+
+	return (_linked || _pendingLink) ? _handler : 0;
+}
+
+/// [Protected methods]
+
+void RenderingShader::reserveSubroutines()
+{
 	GLint numSubroutines;
 	glGetProgramStageiv(_handler, GL_VERTEX_SHADER, GL_ACTIVE_SUBROUTINE_UNIFORMS, &numSubroutines);
 	_activeSubroutineUniform[VERTEX_SHADER].resize(numSubroutines);
@@ -96,6 +92,4 @@ GLuint RenderingShader::createShaderProgram(const char* filename)
 	glGetProgramStageiv(_handler, GL_GEOMETRY_SHADER, GL_ACTIVE_SUBROUTINE_UNIFORMS, &numSubroutines);
 	_activeSubroutineUniform[GEOMETRY_SHADER].resize(numSubroutines);
 	std::fill(_activeSubroutineUniform[GEOMETRY_SHADER].begin(), _activeSubroutineUniform[GEOMETRY_SHADER].end(), -1);
-
-	return _handler;
 }
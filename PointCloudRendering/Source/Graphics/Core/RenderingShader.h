@@ -13,6 +13,12 @@
 */
 class RenderingShader: public ShaderProgram
 {
+protected:
+	/**
+	*	@brief Reserves space for the subroutine uniforms of vertex, fragment and geometry stages.
+	*/
+	virtual void reserveSubroutines();
+
 public:			
 	/**
 	*	@brief Default constructor.
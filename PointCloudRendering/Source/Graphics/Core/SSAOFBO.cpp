@@ -234,26 +234,5 @@ void SSAOFBO::writeGBuffer(const unsigned index)
 	glBindFramebuffer(GL_READ_FRAMEBUFFER, _multisampledFBO);
 	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _gBufferFBO[index]);
 	glBlitFramebuffer(0, 0, _size.x, _size.y, 0, 0, _size.x, _size.y, GL_COLOR_BUFFER_BIT, GL_LINEAR);
-	//glBindFramebuffer(GL_FRAMEBUFFER, _gBufferFBO[index]);
-
-	//std::vector<GLubyte>* pixels = new std::vector<GLubyte>((int)_size.x * (int)_size.y * 4);
-	//glReadPixels(0, 0, _size.x, _size.y, GL_RGBA, GL_UNSIGNED_BYTE, pixels->data());
-
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-	//// Correct image orientation
-	//Image::flipImageVertically(*pixels, _size.x, _size.y, 4);
-
-	//// Launch image writing in a thread
-	//std::thread writeImageThread(&SSAOFBO::threadedWriteImage, this, pixels, "Prueba.png", _size.x, _size.y);
-	//writeImageThread.detach();
-}
-
-/// Protected methods
-
-void SSAOFBO::threadedWriteImage(std::vector<GLubyte>* pixels, const std::string& filename, const uint16_t width, const uint16_t height)
-{
-	FileManagement::saveImage(filename, pixels, width, height);
-
-	delete pixels;
 }
\ No newline at end of file
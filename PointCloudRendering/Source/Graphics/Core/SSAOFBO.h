@@ -32,16 +32,6 @@ protected:
 
 	RenderingParameters*	_rendParams;
 
-protected:
-	/**
-	*	@brief Writes an image in file system in an isolated thread, so the application doesn't get stuck.
-	*	@param pixels Pixels of image to be written.
-	*	@param filename Path where the image must be written.
-	*	@param width Width of image.
-	*	@param height Height of image.
-	*/
-	void threadedWriteImage(std::vector<GLubyte>* pixels, const std::string& filename, const uint16_t width, const uint16_t height);
-
 public:
 	/**
 	*	@brief Constructor.
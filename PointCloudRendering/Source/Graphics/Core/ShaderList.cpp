@@ -48,6 +48,7 @@ std::unordered_map<uint8_t, std::string> ShaderList::REND_SHADER_SOURCE {
 
 std::vector<std::unique_ptr<ComputeShader>> ShaderList::_computeShader (RendEnum::numComputeShaderTypes());
 std::vector<std::unique_ptr<RenderingShader>> ShaderList::_renderingShader (RendEnum::numRenderingShaderTypes());
+std::unordered_map<std::string, std::unique_ptr<ComputeShader>> ShaderList::_computeShaderPermutation;
 
 /// [Protected methods]
 
@@ -57,6 +58,20 @@ ShaderList::ShaderList()
 
 /// [Public methods]
 
+void ShaderList::compileComputeShaders(const std::vector<RendEnum::CompShaderTypes>& shaders)
+{
+	for (const RendEnum::CompShaderTypes shader : shaders)						// Programs are linked by the driver meanwhile, see getComputeShader()
+	{
+		if (!_computeShader[shader].get())
+		{
+			ComputeShader* computeShader = new ComputeShader();
+			computeShader->createShaderProgram(COMP_SHADER_SOURCE.at(shader).c_str());
+
+			_computeShader[shader].reset(computeShader);
+		}
+	}
+}
+
 ComputeShader* ShaderList::getComputeShader(const RendEnum::CompShaderTypes shader)
 {
 	const int shaderID = shader;
@@ -69,9 +84,38 @@ ComputeShader* ShaderList::getComputeShader(const RendEnum::CompShaderTypes shad
 		_computeShader[shaderID].reset(shader);
 	}
 
+	_computeShader[shaderID]->finishLinking();
+
 	return _computeShader[shaderID].get();
 }
 
+ComputeShader* ShaderList::getComputeShader(const RendEnum::CompShaderTypes shader, const std::vector<std::string>& defines)
+{
+	if (defines.empty()) return this->getComputeShader(shader);
+
+	// Order of definitions is irrelevant for the key
+	std::vector<std::string> sortedDefines = defines;
+	std::sort(sortedDefines.begin(), sortedDefines.end());
+
+	std::string key = std::to_string(int(shader));
+	for (const std::string& define : sortedDefines) key += "#" + define;
+
+	std::unique_ptr<ComputeShader>& permutation = _computeShaderPermutation[key];
+
+	if (!permutation.get())
+	{
+		ComputeShader* computeShader = new ComputeShader();
+		computeShader->setDefines(sortedDefines);
+		computeShader->createShaderProgram(COMP_SHADER_SOURCE.at(shader).c_str());
+
+		permutation.reset(computeShader);
+	}
+
+	permutation->finishLinking();
+
+	return permutation.get();
+}
+
 RenderingShader* ShaderList::getRenderingShader(const RendEnum::RendShaderTypes shader)
 {
 	const int shaderID = shader;
@@ -84,5 +128,7 @@ RenderingShader* ShaderList::getRenderingShader(const RendEnum::RendShaderTypes
 		_renderingShader[shaderID].reset(shader);
 	}
 
+	_renderingShader[shaderID]->finishLinking();
+
 	return _renderingShader[shader].get();
 }
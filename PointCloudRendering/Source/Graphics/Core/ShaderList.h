@@ -26,6 +26,8 @@ protected:
 	static std::vector<std::unique_ptr<ComputeShader>>		_computeShader;				//!< Already loaded compute shaders
 	static std::vector<std::unique_ptr<RenderingShader>>	_renderingShader;			//!< Already loaded rendering shader
 
+	static std::unordered_map<std::string, std::unique_ptr<ComputeShader>> _computeShaderPermutation;		//!< Compute shaders specialized with preprocessor definitions
+
 protected:
 	/**
 	*	@brief Default constructor.
@@ -34,10 +36,21 @@ protected:
 
 public:
 	/**
-	*	@return Compute shader defined by the identifier.
+	*	@brief Requests the compilation of several compute shaders at once, without waiting for them. With parallel compilation, the driver
+	*	compiles them in its own threads while the application keeps preparing other resources.
+	*/
+	void compileComputeShaders(const std::vector<RendEnum::CompShaderTypes>& shaders);
+
+	/**
+	*	@return Compute shader defined by the identifier. It is compiled on first request (or loaded from the binary cache).
 	*/
 	ComputeShader* getComputeShader(const RendEnum::CompShaderTypes shader);
 
+	/**
+	*	@return Compute shader compiled with the given preprocessor definitions. Each combination is compiled once and then reused.
+	*/
+	ComputeShader* getComputeShader(const RendEnum::CompShaderTypes shader, const std::vector<std::string>& defines);
+
 	/**
 	*	@return Rendering shader defined by the identifier.
 	*/
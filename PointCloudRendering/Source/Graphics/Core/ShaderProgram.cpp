@@ -1,18 +1,25 @@
 #include "stdafx.h"
 #include "ShaderProgram.h"
 
+#include <filesystem>
+
 // [Static variables initialization]
 
 const std::string ShaderProgram::MODULE_HEADER = "#include";
 const std::string ShaderProgram::MODULE_FILE_CHAR_1 = "<";
 const std::string ShaderProgram::MODULE_FILE_CHAR_2 = ">";
+const std::string ShaderProgram::BINARY_CACHE_FOLDER = "Assets/Shaders/Cache/";
+
+bool ShaderProgram::_binaryCache = false;
+std::string ShaderProgram::_driverSignature = "";
+bool ShaderProgram::_parallelCompilation = false;
 
 std::unordered_map<std::string, std::string> ShaderProgram::_moduleCode;
 
 /// [Public methods]
 
 ShaderProgram::ShaderProgram()
-	: _handler(0), _linked(false), _logString("")
+	: _handler(0), _linked(false), _logString(""), _pendingLink(false)
 {
 }
 
@@ -20,6 +27,105 @@ ShaderProgram::~ShaderProgram()
 {
 }
 
+bool ShaderProgram::finishLinking()
+{
+	if (!_pendingLink) return _linked;
+
+	_pendingLink = false;
+
+	GLint linkSuccess = 0;
+	glGetProgramiv(_handler, GL_LINK_STATUS, &linkSuccess);						// Blocks until the driver is done
+
+	if (linkSuccess == GL_FALSE)
+	{
+		if (_parallelCompilation)												// Compilation errors were not checked yet
+		{
+			for (const GLuint shaderObject : _shaderObjects) this->checkCompileStatus(shaderObject);
+		}
+
+		GLint logLen = 0;
+		glGetProgramiv(_handler, GL_INFO_LOG_LENGTH, &logLen);
+
+		if (logLen > 0)
+		{
+			char* cLogString = new char[logLen];
+			GLint written = 0;
+
+			glGetProgramInfoLog(_handler, logLen, &written, cLogString);
+			_logString.assign(cLogString);
+			delete[] cLogString;
+
+			std::cout << "Cannot link shader " << _name << ":" << std::endl << _logString << std::endl;
+		}
+	}
+	else
+	{
+		_linked = true;
+
+		this->reserveSubroutines();
+		this->saveProgramBinary();
+	}
+
+	for (const GLuint shaderObject : _shaderObjects)								// Program keeps its own copy once linked
+	{
+		glDetachShader(_handler, shaderObject);
+		glDeleteShader(shaderObject);
+	}
+	_shaderObjects.clear();
+
+	return _linked;
+}
+
+void ShaderProgram::initializeCompilation()
+{
+	const GLubyte* vendor = glGetString(GL_VENDOR);
+	const GLubyte* renderer = glGetString(GL_RENDERER);
+	const GLubyte* version = glGetString(GL_VERSION);
+
+	_driverSignature = std::string(vendor ? (const char*) vendor : "") + "|" + (renderer ? (const char*) renderer : "") + "|" + (version ? (const char*) version : "");
+
+	GLint numBinaryFormats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numBinaryFormats);
+	_binaryCache = numBinaryFormats > 0;
+
+	if (_binaryCache)
+	{
+		std::error_code error;
+		std::filesystem::create_directories(BINARY_CACHE_FOLDER, error);
+		_binaryCache = !error;
+	}
+
+#ifdef GL_KHR_parallel_shader_compile
+	if (GLEW_KHR_parallel_shader_compile)
+	{
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);								// Let the driver choose the number of threads
+		_parallelCompilation = true;
+	}
+#endif
+
+#ifdef GL_ARB_parallel_shader_compile
+	if (!_parallelCompilation && GLEW_ARB_parallel_shader_compile)
+	{
+		glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+		_parallelCompilation = true;
+	}
+#endif
+}
+
+bool ShaderProgram::isCompilationComplete()
+{
+	if (!_pendingLink) return true;
+
+#ifdef GL_COMPLETION_STATUS_KHR
+	GLint completed = GL_FALSE;
+	glGetProgramiv(_handler, GL_COMPLETION_STATUS_KHR, &completed);				// Same value as GL_COMPLETION_STATUS_ARB
+
+	return completed == GL_TRUE;
+#else
+	return false;
+#endif
+}
+
 bool ShaderProgram::setSubroutineUniform(const GLenum shaderType, const std::string& subroutine, const std::string& functionName)
 {
 	GLint subroutineID	= glGetSubroutineUniformLocation(_handler, shaderType, subroutine.c_str());
@@ -182,6 +288,8 @@ bool ShaderProgram::setUniform(const std::string& name, const vec4& value)
 
 bool ShaderProgram::use()
 {
+	if (_pendingLink) this->finishLinking();
+
 	if ((_handler > 0) && (_linked))			// Is the program created and linked?
 	{
 		glUseProgram(_handler);
@@ -196,29 +304,38 @@ bool ShaderProgram::use()
 
 /// [Protected methods]
 
-GLuint ShaderProgram::compileShader(const char* filename, const GLenum shaderType)
+bool ShaderProgram::checkCompileStatus(const GLuint shaderObject)
 {
-	if (!fileExists(filename))
+	GLint compileResult;
+	glGetShaderiv(shaderObject, GL_COMPILE_STATUS, &compileResult);					// Result
+
+	if (compileResult == GL_FALSE)
 	{
-		if (shaderType != GL_GEOMETRY_SHADER)
-			fprintf(stderr, "Shader source file %s not found.\n", filename);
+		GLint logLen = 0, shaderType = 0;
+		_logString = "";
+		glGetShaderiv(shaderObject, GL_INFO_LOG_LENGTH, &logLen);
+		glGetShaderiv(shaderObject, GL_SHADER_TYPE, &shaderType);
 
-		return 0;
-	}
+		if (logLen > 0)
+		{
+			char* cLogString = new char[logLen];
+			GLint written = 0;
 
-	std::string shaderSourceString;
-	if (!loadFileContent(std::string(filename), shaderSourceString))						// Read shader code
-	{
-		fprintf(stderr, "Cannot open shader source file.\n");
-		return 0;
-	}
+			glGetShaderInfoLog(shaderObject, logLen, &written, cLogString);
+			_logString.assign(cLogString);
 
-	if (!includeLibraries(shaderSourceString))												// Libraries code not found 
-	{
-		fprintf(stderr, "Cannot include the specified modules.\n");
-		return 0;
+			delete[] cLogString;
+			std::cout << "Cannot compile shader " << _name << " (" << shaderType << ")" << std::endl << _logString << std::endl;
+		}
+
+		return false;
 	}
 
+	return true;
+}
+
+GLuint ShaderProgram::compileShaderSource(const std::string& shaderSource, const GLenum shaderType)
+{
 	GLuint shaderHandler = glCreateShader(shaderType);
 	if (shaderHandler == 0)
 	{
@@ -226,33 +343,27 @@ GLuint ShaderProgram::compileShader(const char* filename, const GLenum shaderTyp
 		return 0;
 	}
 
-	const char* shaderSourceCString = shaderSourceString.c_str();							// Compile shader code
+	const char* shaderSourceCString = shaderSource.c_str();								// Compile shader code
 	glShaderSource(shaderHandler, 1, &shaderSourceCString, NULL);
 	glCompileShader(shaderHandler);
 
-	GLint compileResult;
-	glGetShaderiv(shaderHandler, GL_COMPILE_STATUS, &compileResult);					// Result
-
-	if (compileResult == GL_FALSE)
+	if (!_parallelCompilation)															// Otherwise querying the status would wait for the driver threads
 	{
-		GLint logLen = 0;
-		_logString = "";
-		glGetShaderiv(shaderHandler, GL_INFO_LOG_LENGTH, &logLen);
+		this->checkCompileStatus(shaderHandler);
+	}
 
-		if (logLen > 0)
-		{
-			char* cLogString = new char[logLen];
-			GLint written = 0;
+	return shaderHandler;
+}
 
-			glGetShaderInfoLog(shaderHandler, logLen, &written, cLogString);
-			_logString.assign(cLogString);
+void ShaderProgram::computeBinaryKey(const std::vector<std::string>& shaderSources)
+{
+	std::string signature = _driverSignature;
+	for (const std::string& shaderSource : shaderSources) signature += "|" + shaderSource;
 
-			delete[] cLogString;
-			std::cout << "Cannot compile shader " << shaderType << std::endl << _logString << std::endl;
-		}
-	}
+	std::stringstream stream;
+	stream << std::hex << std::hash<std::string>()(signature);
 
-	return shaderHandler;
+	_binaryKey = stream.str();
 }
 
 bool ShaderProgram::fileExists(const std::string& fileName)
@@ -280,6 +391,21 @@ ShaderProgram::ShaderTypes ShaderProgram::fromOpenGLToShaderTypes(const GLenum s
 	return VERTEX_SHADER;
 }
 
+void ShaderProgram::includeDefines(std::string& shaderContent)
+{
+	if (_defines.empty()) return;
+
+	std::string defines;
+	for (const std::string& define : _defines) defines += "#define " + define + "\n";
+
+	// #version must remain the first directive
+	size_t pos = shaderContent.find("#version");
+	pos = pos == std::string::npos ? 0 : shaderContent.find('\n', pos);
+	pos = pos == std::string::npos ? shaderContent.size() : pos + 1;
+
+	shaderContent.insert(pos, defines);
+}
+
 bool ShaderProgram::includeLibraries(std::string& shaderContent)
 {
 	size_t pos = shaderContent.find(MODULE_HEADER);
@@ -295,35 +421,40 @@ bool ShaderProgram::includeLibraries(std::string& shaderContent)
 		}
 
 		const std::string module = shaderContent.substr(char_1 + 1, char_2 - char_1 - 1);
-		if (!fileExists(module))														// Library refers to a new file, does it exist?
-		{
-			return false;
-		}
+		auto moduleCode = _moduleCode.find(module);										// If file is already read we can just retrieve the string
 
-		const auto moduleCode = _moduleCode.find(module);								// If file is already read we can just retrieve the string
-		std::string moduleCodeStr;
 		if (moduleCode == _moduleCode.end())
 		{
-			if (!loadFileContent(module, moduleCodeStr))
+			std::string moduleCodeStr;
+
+			if (!fileExists(module) || !loadFileContent(module, moduleCodeStr))			// Library refers to a new file, does it exist?
 			{
 				return false;
 			}
 
-			_moduleCode[module] = moduleCodeStr;
-		}
-		else
-		{
-			moduleCodeStr = moduleCode->second;
+			moduleCode = _moduleCode.insert(std::make_pair(module, std::move(moduleCodeStr))).first;
 		}
-				
-		shaderContent.erase(shaderContent.begin() + pos, shaderContent.begin() + char_2 + 1);			// Replace string in shader code
-		shaderContent.insert(pos, moduleCodeStr.c_str());
-		pos = shaderContent.find(MODULE_HEADER);
+
+		shaderContent.replace(pos, char_2 + 1 - pos, moduleCode->second);				// Replace string in shader code
+		pos = shaderContent.find(MODULE_HEADER, pos);									// Code before pos is solved, but nested modules start at pos
 	}
 
 	return true;
 }
 
+void ShaderProgram::linkProgram(const std::vector<GLuint>& shaderObjects)
+{
+	if (_binaryCache) glProgramParameteri(_handler, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+	for (const GLuint shaderObject : shaderObjects) glAttachShader(_handler, shaderObject);
+
+	glLinkProgram(_handler);
+	_shaderObjects = shaderObjects;
+	_pendingLink = true;
+
+	if (!_parallelCompilation) this->finishLinking();
+}
+
 bool ShaderProgram::loadFileContent(const std::string& filename, std::string& content)
 {
 	std::ifstream shaderSourceFile;
@@ -341,3 +472,77 @@ bool ShaderProgram::loadFileContent(const std::string& filename, std::string& co
 
 	return true;
 }
+
+bool ShaderProgram::loadProgramBinary()
+{
+	if (!_binaryCache || _binaryKey.empty()) return false;
+
+	std::ifstream fin(BINARY_CACHE_FOLDER + _binaryKey + ".bin", std::ios::in | std::ios::binary);
+	if (!fin.is_open()) return false;
+
+	GLenum format;
+	size_t length;
+
+	fin.read((char*)&format, sizeof(GLenum));
+	fin.read((char*)&length, sizeof(size_t));
+	if (!fin || length == 0) return false;
+
+	std::vector<char> binary(length);
+	fin.read(binary.data(), length);
+	fin.close();
+	if (!fin) return false;
+
+	glProgramBinary(_handler, format, binary.data(), (GLsizei) length);
+
+	GLint linkSuccess = 0;
+	glGetProgramiv(_handler, GL_LINK_STATUS, &linkSuccess);							// Drivers reject binaries from other versions, then we compile again
+
+	return linkSuccess == GL_TRUE;
+}
+
+bool ShaderProgram::preprocessShader(const char* filename, std::string& shaderSource)
+{
+	if (!fileExists(filename))
+	{
+		fprintf(stderr, "Shader source file %s not found.\n", filename);
+		return false;
+	}
+
+	if (!loadFileContent(std::string(filename), shaderSource))								// Read shader code
+	{
+		fprintf(stderr, "Cannot open shader source file.\n");
+		return false;
+	}
+
+	if (!includeLibraries(shaderSource))													// Libraries code not found 
+	{
+		fprintf(stderr, "Cannot include the specified modules.\n");
+		return false;
+	}
+
+	this->includeDefines(shaderSource);
+
+	return true;
+}
+
+void ShaderProgram::saveProgramBinary()
+{
+	if (!_binaryCache || _binaryKey.empty()) return;
+
+	GLint length = 0;
+	glGetProgramiv(_handler, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) return;
+
+	std::vector<char> binary(length);
+	GLenum format;
+	glGetProgramBinary(_handler, length, nullptr, &format, binary.data());
+
+	std::ofstream fout(BINARY_CACHE_FOLDER + _binaryKey + ".bin", std::ios::out | std::ios::binary);
+	if (!fout.is_open()) return;
+
+	const size_t binaryLength = binary.size();
+	fout.write((char*)&format, sizeof(GLenum));
+	fout.write((char*)&binaryLength, sizeof(size_t));
+	fout.write(binary.data(), binaryLength);
+	fout.close();
+}
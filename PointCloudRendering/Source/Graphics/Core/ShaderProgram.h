@@ -27,6 +27,7 @@ protected:
 	const static std::string MODULE_HEADER;
 	const static std::string MODULE_FILE_CHAR_1;
 	const static std::string MODULE_FILE_CHAR_2;
+	const static std::string BINARY_CACHE_FOLDER;								//!< Folder where linked programs are stored as driver-specific binaries
 
 protected:
 	GLuint				_handler;												//!< Shader program id in GPU
@@ -36,17 +37,69 @@ protected:
 	// [Subroutines]
 	std::vector<GLuint> _activeSubroutineUniform[COMPUTE_SHADER + 1];			//!< Active uniform for each subroutine for each shader type
 
+	// [Preprocessor]
+	std::vector<std::string> _defines;											//!< Definitions injected after the #version directive
+
+	// [Compilation]
+	std::string			_binaryKey;												//!< Hash of the preprocessed sources and driver, identifies the cached binary
+	std::string			_name;													//!< Shader program name, used for error messages
+	bool				_pendingLink;											//!< Link has been requested but its status has not been checked yet
+	std::vector<GLuint>	_shaderObjects;											//!< Shader objects attached to the program until linking finishes
+
+	static bool			_binaryCache;											//!< The driver supports at least one program binary format
+	static std::string	_driverSignature;										//!< Vendor, renderer and version; binaries from other drivers are not valid
+	static bool			_parallelCompilation;									//!< Compilation and linking run in driver threads (GL_KHR_parallel_shader_compile)
+
 	// [Libraries]
 	static std::unordered_map<std::string, std::string> _moduleCode;			//!< Modules that are already loaded
 
 protected:
 	/**
-	*	@brief Tries to compile a shader at a certain path.
-	*	@param filename Path of the shader we need to compile.
+	*	@brief Checks the compilation result of a shader object and prints its log if it failed.
+	*/
+	bool checkCompileStatus(const GLuint shaderObject);
+
+	/**
+	*	@brief Compiles an already preprocessed shader code. Compilation errors are checked right away unless the driver compiles in parallel.
+	*	@param shaderSource Shader code, see preprocessShader().
 	*	@param shaderType Type of shader to be compiled: VERTEX, FRAGMENT, GEOMETRY or COMPUTE.
 	*	@return Assigned ID for the shader.
 	*/
-	virtual GLuint compileShader(const char* filename, const GLenum shaderType);
+	GLuint compileShaderSource(const std::string& shaderSource, const GLenum shaderType);
+
+	/**
+	*	@brief Computes the key of the cached binary from the preprocessed sources of every stage.
+	*/
+	void computeBinaryKey(const std::vector<std::string>& shaderSources);
+
+	/**
+	*	@brief Attaches the compiled shader objects and requests the program to be linked. Link status is checked by finishLinking().
+	*/
+	void linkProgram(const std::vector<GLuint>& shaderObjects);
+
+	/**
+	*	@brief Tries to load the program from the binary cache, so that compilation is skipped.
+	*	@return True if the cached binary exists and the driver accepted it.
+	*/
+	bool loadProgramBinary();
+
+	/**
+	*	@brief Reads a shader and solves its modules and definitions.
+	*	@param filename Path of the shader.
+	*	@param shaderSource Preprocessed code.
+	*	@return False if the file or any of its modules cannot be read.
+	*/
+	bool preprocessShader(const char* filename, std::string& shaderSource);
+
+	/**
+	*	@brief Reserves space for the subroutine uniforms of each stage. Called once the program is linked.
+	*/
+	virtual void reserveSubroutines() = 0;
+
+	/**
+	*	@brief Stores the linked program in the binary cache.
+	*/
+	void saveProgramBinary();
 
 	/**
 	*	@brief Checks if the file exists in the system.
@@ -61,7 +114,13 @@ protected:
 	ShaderTypes fromOpenGLToShaderTypes(const GLenum shaderType);
 
 	/**
-	*	@brief Substitutes the libraries references by its code.
+	*	@brief Inserts the preprocessor definitions of this program right after the #version directive.
+	*	@param shaderContent Shader code to be modified.
+	*/
+	void includeDefines(std::string& shaderContent);
+
+	/**
+	*	@brief Substitutes the libraries references by its code. Modules are read once and scanned in a single pass, including nested ones.
 	*	@param shaderContent Shader code to be modified.
 	*/
 	bool includeLibraries(std::string& shaderContent);
@@ -95,6 +154,27 @@ public:
 	*/
 	virtual GLuint createShaderProgram(const char* filename) = 0;
 
+	/**
+	*	@brief Checks the link status of the program, waiting for the driver if it is still compiling. Stores the result in the binary cache.
+	*	@return True if the program is ready to be used.
+	*/
+	bool finishLinking();
+
+	/**
+	*	@brief Queries the driver capabilities for binary caching and parallel compilation. Requires an OpenGL context.
+	*/
+	static void initializeCompilation();
+
+	/**
+	*	@return True if compilation has finished, so that finishLinking() does not block.
+	*/
+	bool isCompilationComplete();
+
+	/**
+	*	@brief Defines preprocessor symbols for the following compilation, so that a single source produces specialized programs.
+	*/
+	void setDefines(const std::vector<std::string>& defines) { _defines = defines; }
+
 	/**
 	*	@brief Modifies the active uniform on a subroutine.
 	*	@param shaderType Shader type where we desire to modify the subroutine uniform.
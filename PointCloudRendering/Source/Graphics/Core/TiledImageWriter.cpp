@@ -0,0 +1,166 @@
+#include "stdafx.h"
+#include "TiledImageWriter.h"
+
+// [Static members initialization]
+
+const uint64_t TiledImageWriter::MAX_CLASSIC_SIZE = 0xFFFFFFFFull;
+const unsigned TiledImageWriter::TILE_ALIGNMENT = 16;
+
+/// [Public methods]
+
+TiledImageWriter::TiledImageWriter() :
+	_size(0), _tileSize(0), _numTiles(0), _bigTIFF(false), _sampleType(RGB8)
+{
+}
+
+TiledImageWriter::~TiledImageWriter()
+{
+	if (_file.is_open()) this->close();
+}
+
+bool TiledImageWriter::close()
+{
+	if (!_file.is_open())
+	{
+		return false;
+	}
+
+	// Missing tiles share a single black tile
+	const uint64_t tileBytes = uint64_t(_tileSize.x) * _tileSize.y * this->getPixelBytes();
+	uint64_t blankOffset = 0;
+
+	for (uint64_t& offset : _tileOffset)
+	{
+		if (!offset)
+		{
+			if (!blankOffset)
+			{
+				const std::vector<char> blank(tileBytes, 0);
+
+				blankOffset = uint64_t(_file.tellp());
+				_file.write(blank.data(), blank.size());
+			}
+
+			offset = blankOffset;
+		}
+	}
+
+	const bool success = this->writeDirectory();
+	_file.close();
+
+	return success;
+}
+
+bool TiledImageWriter::open(const std::string& filename, const uvec2& size, const uvec2& tileSize, const SampleType sampleType)
+{
+	if (_file.is_open()) this->close();
+
+	if (!size.x || !size.y || !tileSize.x || !tileSize.y || tileSize.x % TILE_ALIGNMENT || tileSize.y % TILE_ALIGNMENT)
+	{
+		std::cout << "Tiles of " << tileSize.x << "x" << tileSize.y << " pixels are not valid for a " << size.x << "x" << size.y << " image!" << std::endl;
+		return false;
+	}
+
+	_file.open(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!_file.is_open())
+	{
+		return false;
+	}
+
+	_size = size;
+	_tileSize = tileSize;
+	_sampleType = sampleType;
+	_numTiles = (size + tileSize - 1u) / tileSize;
+	_tileOffset = std::vector<uint64_t>(size_t(_numTiles.x) * _numTiles.y, 0);
+
+	// Tiles exceeding the image are stored whole, and the directory needs two offsets per tile
+	const uint64_t tileBytes = uint64_t(_tileSize.x) * _tileSize.y * this->getPixelBytes();
+	_bigTIFF = (tileBytes + 8) * (_tileOffset.size() + 1) + 1024 > MAX_CLASSIC_SIZE;
+
+	// Header (little endian) with a placeholder for the directory offset
+	const char header[] = { 'I', 'I', char(_bigTIFF ? 43 : 42), 0, 8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+	_file.write(header, _bigTIFF ? 16 : 8);
+
+	return _file.good();
+}
+
+bool TiledImageWriter::writeTile(const uvec2& tile, const GLubyte* pixels)
+{
+	if (!_file.is_open() || tile.x >= _numTiles.x || tile.y >= _numTiles.y)
+	{
+		return false;
+	}
+
+	_tileOffset[size_t(tile.y) * _numTiles.x + tile.x] = uint64_t(_file.tellp());
+	_file.write((const char*)pixels, std::streamsize(_tileSize.x) * _tileSize.y * this->getPixelBytes());
+
+	return _file.good();
+}
+
+/// [Protected methods]
+
+bool TiledImageWriter::writeDirectory()
+{
+	enum FieldType : uint16_t { ASCII = 2, SHORT = 3, LONG = 4, LONG8 = 16 };
+
+	const bool rgb = _sampleType == RGB8;
+	const unsigned offsetBytes = _bigTIFF ? 8 : 4, entryBytes = _bigTIFF ? 20 : 12, numEntries = rgb ? 12 : 13;
+	const uint64_t tileBytes = uint64_t(_tileSize.x) * _tileSize.y * this->getPixelBytes();
+	const uint64_t directoryOffset = uint64_t(_file.tellp());
+	const uint64_t valuesOffset = directoryOffset + (_bigTIFF ? 8 : 2) + numEntries * entryBytes + offsetBytes;
+
+	std::vector<char> directory, values;															// Values which do not fit in their entry follow the directory
+
+	auto append = [](std::vector<char>& buffer, const uint64_t value, const unsigned bytes)
+	{
+		for (unsigned byteIdx = 0; byteIdx < bytes; ++byteIdx) buffer.push_back(char(value >> (byteIdx * 8)));
+	};
+
+	auto appendEntry = [&](const uint16_t tag, const FieldType type, const std::vector<uint64_t>& fieldValues)
+	{
+		const unsigned valueBytes = type == ASCII ? 1 : (type == SHORT ? 2 : (type == LONG ? 4 : 8));
+
+		append(directory, tag, 2);
+		append(directory, type, 2);
+		append(directory, fieldValues.size(), offsetBytes);
+
+		if (fieldValues.size() * valueBytes <= offsetBytes)
+		{
+			for (const uint64_t value : fieldValues) append(directory, value, valueBytes);
+			append(directory, 0, unsigned(offsetBytes - fieldValues.size() * valueBytes));
+		}
+		else
+		{
+			append(directory, valuesOffset + values.size(), offsetBytes);
+			for (const uint64_t value : fieldValues) append(values, value, valueBytes);
+		}
+	};
+
+	append(directory, numEntries, _bigTIFF ? 8 : 2);
+	appendEntry(256, LONG, { _size.x });												// Image width
+	appendEntry(257, LONG, { _size.y });												// Image length
+	appendEntry(258, SHORT, rgb ? std::vector<uint64_t>{ 8, 8, 8 } : std::vector<uint64_t>{ 32 });		// Bits per sample
+	appendEntry(259, SHORT, { 1 });														// No compression
+	appendEntry(262, SHORT, { rgb ? 2u : 1u });											// RGB or grayscale
+	appendEntry(277, SHORT, { rgb ? 3u : 1u });											// Samples per pixel
+	appendEntry(284, SHORT, { 1 });														// Interleaved channels
+	appendEntry(322, LONG, { _tileSize.x });											// Tile width
+	appendEntry(323, LONG, { _tileSize.y });											// Tile length
+	appendEntry(324, _bigTIFF ? LONG8 : LONG, _tileOffset);								// Tile offsets
+	appendEntry(325, _bigTIFF ? LONG8 : LONG, std::vector<uint64_t>(_tileOffset.size(), tileBytes));
+	appendEntry(339, SHORT, rgb ? std::vector<uint64_t>{ 1, 1, 1 } : std::vector<uint64_t>{ 3 });		// Unsigned integers or floats
+	if (!rgb) appendEntry(42113, ASCII, { 'n', 'a', 'n', 0 });							// No-data value, as read by GDAL
+	append(directory, 0, offsetBytes);													// No more images
+
+	_file.write(directory.data(), directory.size());
+	_file.write(values.data(), values.size());
+
+	// Header offset of the directory
+	std::vector<char> offset;
+	append(offset, directoryOffset, offsetBytes);
+
+	_file.seekp(_bigTIFF ? 8 : 4);
+	_file.write(offset.data(), offset.size());
+
+	return _file.good();
+}
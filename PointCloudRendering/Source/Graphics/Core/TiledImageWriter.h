@@ -0,0 +1,90 @@
+#pragma once
+
+/**
+*	@file TiledImageWriter.h
+*	@authors Alfonso Lpez Ruiz (alr00048@red.ujaen.es)
+*	@date 19/10/2026
+*/
+
+/**
+*	@brief Writer of tiled TIFF images, either RGB or single-channel float rasters, which streams every tile to disk as soon as it is received,
+*	so that only the tile directory is kept in memory whatever the size of the image. Images which do not fit the 32-bit offsets of TIFF are
+*	written as BigTIFF.
+*/
+class TiledImageWriter
+{
+public:
+	enum SampleType
+	{
+		RGB8, FLOAT32
+	};
+
+protected:
+	const static uint64_t	MAX_CLASSIC_SIZE;									//!< Bytes addressable by a classic TIFF file
+	const static unsigned	TILE_ALIGNMENT;										//!< Tile sizes must be multiple of this value
+
+protected:
+	std::ofstream			_file;												//!< Output stream, open between open() and close()
+	uvec2					_size;												//!< Size of the whole image
+	uvec2					_tileSize;											//!< Size of every tile, including those which exceed the image
+	uvec2					_numTiles;											//!< Tiles in each axis
+	bool					_bigTIFF;											//!< 64-bit offsets
+	SampleType				_sampleType;										//!< Content of every pixel
+	std::vector<uint64_t>	_tileOffset;										//!< Position of every tile in the file, zero if not written yet
+
+protected:
+	/**
+	*	@brief Writes the image directory and the header offset which points to it.
+	*/
+	bool writeDirectory();
+
+public:
+	/**
+	*	@brief Constructor.
+	*/
+	TiledImageWriter();
+
+	/**
+	*	@brief Destructor. Closes the file if it is still open.
+	*/
+	virtual ~TiledImageWriter();
+
+	/**
+	*	@brief Completes the file. Tiles which were never written are left black.
+	*	@return False if the file could not be written.
+	*/
+	bool close();
+
+	/**
+	*	@brief Creates the file and writes its header.
+	*	@param tileSize Size of every tile, which must be multiple of 16.
+	*	@param sampleType Content of every pixel. Float rasters flag NaN as no data.
+	*	@return False if the file could not be created or the tile size is not valid.
+	*/
+	bool open(const std::string& filename, const uvec2& size, const uvec2& tileSize, const SampleType sampleType = RGB8);
+
+	/**
+	*	@brief Appends a tile to the file.
+	*	@param tile Column and row of the tile, starting from the top left corner.
+	*	@param pixels Pixels of the whole tile, top row first and tightly packed.
+	*/
+	bool writeTile(const uvec2& tile, const GLubyte* pixels);
+
+	// ------------- Getters --------------
+
+	/**
+	*	@return Tiles in each axis.
+	*/
+	uvec2 getNumTiles() const { return _numTiles; }
+
+	/**
+	*	@return Bytes of every pixel.
+	*/
+	unsigned getPixelBytes() const { return _sampleType == RGB8 ? 3 : 4; }
+
+	/**
+	*	@return Size of every tile.
+	*/
+	uvec2 getTileSize() const { return _tileSize; }
+};
+
@@ -1,18 +1,23 @@
 #include "stdafx.h"
 #include "GUI.h"
 
+#include <filesystem>
+#include "Graphics/Application/FlythroughBenchmark.h"
 #include "Graphics/Application/PointCloudParameters.h"
 #include "Graphics/Application/Renderer.h"
+#include "Graphics/Core/ImageEncoder.h"
 #include "Interface/Fonts/font_awesome.hpp"
 #include "Interface/Fonts/lato.hpp"
 #include "Interface/Fonts/IconsFontAwesome5.h"
+#include "Utilities/MemoryTracker.h"
+#include "Utilities/Profiler.h"
 #include "imfiledialog/ImGuiFileDialog.h"
 
 /// [Protected methods]
 
 GUI::GUI() :
-	_pointCloudPath(""), _showRenderingSettings(false), _showScreenshotSettings(false), _showAboutUs(false),
-	_showControls(false), _showFileDialog(false), _showPointCloudDialog(false)
+	_benchmarkResultBuffer("benchmark.json"), _benchmarkWaypointBuffer(""), _loadClassesBuffer(""), _meshFilenameBuffer(""), _pointCloudPath(""), _showRenderingSettings(false), _showScreenshotSettings(false), _showAboutUs(false),
+	_showControls(false), _showFileDialog(false), _showMemoryUsage(false), _showPointCloudDialog(false), _showProfiler(false), _traceFilenameBuffer("trace.json")
 {
 	_renderer			= Renderer::getInstance();	
 	_renderingParams	= Renderer::getInstance()->getRenderingParameters();
@@ -29,6 +34,8 @@ void GUI::createMenu()
 	if (_showControls)				showControls();
 	if (_showFileDialog)			showFileDialog();
 	if (_showPointCloudDialog)		showPointCloudDialog();
+	if (_showProfiler)				showProfiler();
+	if (_showMemoryUsage)			showMemoryUsage();
 
 	if (ImGui::BeginMainMenuBar())
 	{
@@ -37,6 +44,8 @@ void GUI::createMenu()
 			ImGui::MenuItem(ICON_FA_CUBE "Rendering", NULL, &_showRenderingSettings);
 			ImGui::MenuItem(ICON_FA_IMAGE "Screenshot", NULL, &_showScreenshotSettings);
 			ImGui::MenuItem(ICON_FA_SAVE "Open Point Cloud", NULL, &_showFileDialog);
+			ImGui::MenuItem(ICON_FA_CLOCK "Profiler", NULL, &_showProfiler);
+			ImGui::MenuItem(ICON_FA_MEMORY "Memory usage", NULL, &_showMemoryUsage);
 			ImGui::EndMenu();
 		}
 
@@ -137,6 +146,50 @@ void GUI::showFileDialog()
 	}
 }
 
+void GUI::showMemoryUsage()
+{
+	if (ImGui::Begin("Memory usage", &_showMemoryUsage))
+	{
+		const float MB = 1024.0f * 1024.0f;
+		MemoryTracker* memoryTracker = MemoryTracker::getInstance();
+		size_t freeVideoMemory, totalVideoMemory;
+
+		ImGui::Text("GPU: %.1f MB (peak %.1f MB)", memoryTracker->getBytes(MemoryTracker::GPU) / MB, memoryTracker->getPeakBytes(MemoryTracker::GPU) / MB);
+		ImGui::Text("Host: %.1f MB (peak %.1f MB)", memoryTracker->getBytes(MemoryTracker::HOST) / MB, memoryTracker->getPeakBytes(MemoryTracker::HOST) / MB);
+
+		if (MemoryTracker::getVideoMemory(freeVideoMemory, totalVideoMemory))
+		{
+			if (totalVideoMemory) ImGui::Text("Free video memory: %.1f of %.1f MB", freeVideoMemory / MB, totalVideoMemory / MB);
+			else ImGui::Text("Free video memory: %.1f MB", freeVideoMemory / MB);
+		}
+
+		this->leaveSpace(2);
+
+		ImGui::Columns(5, "MemoryColumns");
+		ImGui::Separator();
+		ImGui::Text("Device"); ImGui::NextColumn();
+		ImGui::Text("Subsystem"); ImGui::NextColumn();
+		ImGui::Text("Current (MB)"); ImGui::NextColumn();
+		ImGui::Text("Peak (MB)"); ImGui::NextColumn();
+		ImGui::Text("Allocations"); ImGui::NextColumn();
+		ImGui::Separator();
+
+		for (const MemoryTracker::Usage& usage : memoryTracker->getUsage())
+		{
+			ImGui::Text(MemoryTracker::DEVICE_NAME[usage._device].c_str()); ImGui::NextColumn();
+			ImGui::Text(usage._tag.c_str()); ImGui::NextColumn();
+			ImGui::Text("%.2f", usage._bytes / MB); ImGui::NextColumn();
+			ImGui::Text("%.2f", usage._peakBytes / MB); ImGui::NextColumn();
+			ImGui::Text("%u", usage._numAllocations); ImGui::NextColumn();
+		}
+
+		ImGui::Columns(1);
+		ImGui::Separator();
+	}
+
+	ImGui::End();
+}
+
 void GUI::showPointCloudDialog()
 {
 	if (ImGui::Begin("Open Point Cloud Dialog", &_showPointCloudDialog))
@@ -156,6 +209,22 @@ void GUI::showPointCloudDialog()
 		ImGui::SliderScalar("Iterations", ImGuiDataType_U16, &PointCloudParameters::_reduceIterations, &minIterations, &maxIterations);
 		ImGui::Checkbox("Update camera", &_renderingParams->_updateCamera);
 		ImGui::Checkbox("Compute normals", &PointCloudParameters::_computeNormal); ImGui::SameLine(0, 20); ImGui::SliderInt("KNN Neighbors", &PointCloudParameters::_knn, 3, 50);
+		ImGui::InputScalar("Points per chunk", ImGuiDataType_U32, &PointCloudParameters::_chunkSize); ImGui::SameLine(); this->renderHelpMarker("Chunks are the unit of culling and streaming in video memory.");
+		PointCloudParameters::_chunkSize = (std::max)(PointCloudParameters::_chunkSize, GLuint(1024));
+		ImGui::Checkbox("GPU-resident only", &PointCloudParameters::_gpuResidentOnly); ImGui::SameLine(); this->renderHelpMarker("Frees the points in host memory once uploaded. Filters and exports read them again from the binary file. Chunks are never evicted.");
+		ImGui::PopItemWidth();
+
+		this->leaveSpace(2);
+		ImGui::Text("Load filter");
+		ImGui::Separator();
+		this->leaveSpace(1);
+
+		ImGui::PushItemWidth(300.0f);
+		ImGui::InputText("Classes", _loadClassesBuffer, IM_ARRAYSIZE(_loadClassesBuffer)); ImGui::SameLine(); this->renderHelpMarker("Comma-separated class ids. Empty means every class.");
+		ImGui::InputScalarN("Return Range", ImGuiDataType_U32, &_loadFilter._returnRange[0], 2);
+		ImGui::InputScalarN("Minimum XY", ImGuiDataType_Double, &_loadFilter._minXY[0], 2);
+		ImGui::InputScalarN("Maximum XY", ImGuiDataType_Double, &_loadFilter._maxXY[0], 2);
+		ImGui::InputScalar("Decimation", ImGuiDataType_U32, &_loadFilter._decimation); ImGui::SameLine(); this->renderHelpMarker("Only one out of every n accepted points is loaded.");
 		ImGui::PopItemWidth();
 
 		ImGui::PushID(0);
@@ -167,7 +236,24 @@ void GUI::showPointCloudDialog()
 
 		if (ImGui::Button("Open Point Cloud"))
 		{
-			_pointCloudScene->loadPointCloud(_pointCloudPath);
+			std::stringstream classStream(_loadClassesBuffer);
+			std::string classId;
+
+			if (classStream.str().find_first_not_of(" ,") == std::string::npos)
+			{
+				_loadFilter._classes.set();
+			}
+			else
+			{
+				_loadFilter._classes.reset();
+				while (std::getline(classStream, classId, ','))
+				{
+					try { _loadFilter._classes.set(std::stoi(classId) & 255); }
+					catch (const std::exception&) {}
+				}
+			}
+
+			_pointCloudScene->loadPointCloud(_pointCloudPath, _loadFilter);
 			_showPointCloudDialog = false;
 		}
 
@@ -178,6 +264,93 @@ void GUI::showPointCloudDialog()
 	ImGui::End();
 }
 
+void GUI::showProfiler()
+{
+	if (ImGui::Begin("Profiler", &_showProfiler))
+	{
+		Profiler* profiler = Profiler::getInstance();
+
+		bool enabled = Profiler::isEnabled();
+		if (ImGui::Checkbox("Enabled", &enabled)) Profiler::setEnabled(enabled);
+
+		ImGui::SameLine(0, 20);
+		if (!profiler->isRecording())
+		{
+			if (ImGui::Button("Record")) profiler->startRecording();
+		}
+		else if (ImGui::Button("Stop and save"))
+		{
+			profiler->stopRecording(_traceFilenameBuffer);
+		}
+
+		ImGui::SameLine();
+		ImGui::PushItemWidth(200.0f);
+		ImGui::InputText("Trace", _traceFilenameBuffer, IM_ARRAYSIZE(_traceFilenameBuffer)); ImGui::SameLine(); this->renderHelpMarker("Chrome trace file, which can be opened with chrome://tracing or Perfetto.");
+		ImGui::PopItemWidth();
+
+		this->leaveSpace(2);
+
+		std::vector<Profiler::Zone> zones;
+		std::vector<std::string> timelineName;
+		const std::pair<uint64_t, uint64_t> frame = profiler->getLastFrame(zones, timelineName);
+
+		if (frame.second <= frame.first)
+		{
+			ImGui::Text("No frame has been measured yet.");
+			ImGui::End();
+
+			return;
+		}
+
+		ImGui::Text("Frame: %.3f ms", (frame.second - frame.first) / 1e6);
+
+		// Flame view: a band per timeline, where nested zones are stacked below the enclosing ones
+		const float rowHeight = ImGui::GetTextLineHeight() + 4.0f, labelWidth = 90.0f;
+		std::vector<unsigned> numRows(timelineName.size(), 0);
+		for (const Profiler::Zone& zone : zones) numRows[zone._timelineIdx] = (std::max)(numRows[zone._timelineIdx], zone._depth + 1);
+
+		ImDrawList* drawList = ImGui::GetWindowDrawList();
+		const ImVec2 origin = ImGui::GetCursorScreenPos();
+		const float width = (std::max)(ImGui::GetContentRegionAvail().x - labelWidth, 1.0f);
+		const double nsPerPixel = double(frame.second - frame.first) / width;
+		const ImVec2 mouse = ImGui::GetIO().MousePos;
+		std::vector<float> timelineY(timelineName.size());
+		float y = origin.y;
+
+		for (unsigned timelineIdx = 0; timelineIdx < timelineName.size(); ++timelineIdx)
+		{
+			timelineY[timelineIdx] = y;
+			if (!numRows[timelineIdx]) continue;
+
+			drawList->AddText(ImVec2(origin.x, y + 2.0f), ImGui::GetColorU32(ImGuiCol_Text), timelineName[timelineIdx].c_str());
+			y += numRows[timelineIdx] * rowHeight + 4.0f;
+		}
+
+		for (const Profiler::Zone& zone : zones)
+		{
+			const uint64_t start = (std::max)(zone._start, frame.first), end = (std::min)(zone._end, frame.second);
+			const ImVec2 min(origin.x + labelWidth + float((start - frame.first) / nsPerPixel), timelineY[zone._timelineIdx] + zone._depth * rowHeight);
+			const ImVec2 max((std::max)(origin.x + labelWidth + float((end - frame.first) / nsPerPixel), min.x + 1.0f), min.y + rowHeight - 1.0f);
+			const ImU32 color = ImColor::HSV(float(std::hash<std::string>()(zone._name) % 360) / 360.0f, 0.5f, 0.7f);
+
+			drawList->AddRectFilled(min, max, color);
+			if (max.x - min.x > ImGui::CalcTextSize(zone._name).x + 4.0f)
+			{
+				drawList->AddText(ImVec2(min.x + 2.0f, min.y + 2.0f), IM_COL32_WHITE, zone._name);
+			}
+
+			if (ImGui::IsWindowHovered() && mouse.x >= min.x && mouse.x < max.x && mouse.y >= min.y && mouse.y < max.y)
+			{
+				ImGui::SetTooltip("%s\n%.3f ms", zone._name, (zone._end - zone._start) / 1e6);
+			}
+		}
+
+		ImGui::Dummy(ImVec2(labelWidth + width, y - origin.y));
+	}
+
+	ImGui::End();
+}
+
 void GUI::showRenderingSettings()
 {
 	if (ImGui::Begin("Rendering Settings", &_showRenderingSettings))
@@ -237,6 +410,14 @@ void GUI::showRenderingSettings()
 				ImGui::SliderFloat("Point Size", &_renderingParams->_scenePointSize, 0.1f, 50.0f);
 				ImGui::ColorEdit3("Point Cloud Color", &_renderingParams->_scenePointCloudColor[0]);
 				ImGui::Checkbox("HQR Rendering Optimization", &PointCloudParameters::_enableHQR);
+				ImGui::Checkbox("CPU Rendering", &PointCloudParameters::_cpuRendering); ImGui::SameLine(); this->renderHelpMarker("Multithreaded rasterizer, used anyway if the GPU lacks 64-bit atomics. Reduced or sorted point clouds are rendered as loaded.");
+				ImGui::InputInt("Video Memory Budget (MB)", &PointCloudParameters::_gpuBudget, 256); ImGui::SameLine(); this->renderHelpMarker("Zero keeps every chunk resident. Otherwise, the nearest visible chunks are kept and the rest are streamed back when needed. Reduced or sorted point clouds must be reloaded for the budget to evict them.");
+				PointCloudParameters::_gpuBudget = (std::max)(PointCloudParameters::_gpuBudget, 0);
+
+				if (const PointCloudResidency* residency = _pointCloudScene->getPointCloudResidency())
+				{
+					ImGui::Text("Resident chunks: %u / %u (%.1f MB)", residency->getNumResidentChunks(), residency->getNumChunks(), residency->getResidentBytes() / (1024.0 * 1024.0));
+				}
 				ImGui::SliderFloat("Depth Threshold", &PointCloudParameters::_distanceThreshold, 1.0f, 1.2f, "%.6f");
 				ImGui::SliderFloat("Return Factor", &_renderingParams->_returnFactor, .0f, 1.1f, "%.3f");
 				ImGui::InputInt("Maximum Class", &_renderingParams->_classRange[1], 0);
@@ -251,8 +432,10 @@ void GUI::showRenderingSettings()
 				ImGui::RadioButton("Normal Vector", &_renderingParams->_visualizationMode, RenderingParameters::NORMAL);
 				ImGui::RadioButton("Height", &_renderingParams->_visualizationMode, RenderingParameters::HEIGHT);
 				ImGui::RadioButton("Class", &_renderingParams->_visualizationMode, RenderingParameters::CLASS);
+				ImGui::RadioButton("Distance to Mesh", &_renderingParams->_visualizationMode, RenderingParameters::DISTANCE);
 				ImGui::Checkbox("Filter by Height", &_renderingParams->_filterByHeight);
 				ImGui::Checkbox("Filter by Ground", &_renderingParams->_filterByGround);
+				ImGui::Checkbox("Filter Outliers", &_renderingParams->_filterOutliers);
 
 				this->leaveSpace(2);
 				ImGui::Text("CSF");
@@ -283,7 +466,79 @@ void GUI::showRenderingSettings()
 				ImGui::SameLine(0, 10);
 				ImGui::Checkbox("Build DTM", &PointCloudParameters::_buildDTM);
 
+				ImGui::SliderFloat("Maximum Vertical Error", &PointCloudParameters::_terrainMaxError, .0f, 5.0f, "%.3f");
+				if (ImGui::Button("Build Terrain Mesh"))
+					_renderingParams->_showTerrain = _pointCloudScene->buildTerrainMesh(PointCloudParameters::_terrainMaxError);
+				ImGui::SameLine(0, 10);
+				ImGui::Checkbox("Show Terrain Mesh", &_renderingParams->_showTerrain);
+				ImGui::SameLine(0, 10);
+				if (ImGui::Button("Export DTM Heights"))
+					_pointCloudScene->exportDTM("DTM.tif");
+
 				ImGui::PopItemWidth();
+
+				this->leaveSpace(2);
+				ImGui::Text("Outliers");
+				ImGui::Separator();
+				this->leaveSpace(1);
+
+				ImGui::SliderInt("Neighbours", &PointCloudParameters::_outlierKnn, 1, 64);
+				ImGui::SliderFloat("Standard Deviation Multiplier", &PointCloudParameters::_outlierStdMultiplier, .0f, 5.0f, "%.3f");
+				if (ImGui::Button("Statistical Outlier Removal"))
+				{
+					_pointCloudScene->filterStatisticalOutliers(PointCloudParameters::_outlierKnn, PointCloudParameters::_outlierStdMultiplier);
+					_renderingParams->_filterOutliers = true;
+				}
+
+				ImGui::SliderFloat("Radius", &PointCloudParameters::_outlierRadius, .0f, 10.0f, "%.3f");
+				ImGui::SliderInt("Minimum Neighbours", &PointCloudParameters::_outlierMinNeighbours, 1, 64);
+				if (ImGui::Button("Radius Outlier Removal"))
+				{
+					_pointCloudScene->filterRadiusOutliers(PointCloudParameters::_outlierRadius, PointCloudParameters::_outlierMinNeighbours);
+					_renderingParams->_filterOutliers = true;
+				}
+
+				this->leaveSpace(2);
+				ImGui::Text("Distance to Mesh");
+				ImGui::Separator();
+				this->leaveSpace(1);
+
+				ImGui::InputText("Mesh", _meshFilenameBuffer, IM_ARRAYSIZE(_meshFilenameBuffer)); ImGui::SameLine(); this->renderHelpMarker("OBJ file in the coordinates of the point cloud, i.e. without the LAS offset.");
+				ImGui::SliderFloat("Maximum Distance", &PointCloudParameters::_meshMaxDistance, .01f, 10.0f, "%.3f");
+				if (ImGui::Button("Compute Distance"))
+				{
+					if (_pointCloudScene->computeMeshDistance(_meshFilenameBuffer, PointCloudParameters::_meshMaxDistance))
+						_renderingParams->_visualizationMode = RenderingParameters::DISTANCE;
+				}
+
+				this->leaveSpace(1);
+				ImGui::InputFloat3("Slicing Axis", &PointCloudParameters::_sectionNormal[0]);
+				ImGui::SliderFloat("Section Spacing", &PointCloudParameters::_sectionSpacing, .0f, 10.0f, "%.3f"); ImGui::SameLine(); this->renderHelpMarker("Zero cuts the mesh once through its center. Sections are written next to the mesh as OBJ polylines.");
+				if (ImGui::Button("Export Mesh Sections"))
+					_pointCloudScene->exportMeshSections(_meshFilenameBuffer, PointCloudParameters::_sectionNormal, PointCloudParameters::_sectionSpacing);
+
+				this->leaveSpace(1);
+				ImGui::SliderFloat("Voxel Size", &PointCloudParameters::_voxelSize, .01f, 1.0f, "%.3f");
+				if (ImGui::Button("Compare Occupancy"))
+					_pointCloudScene->compareMeshOccupancy(_meshFilenameBuffer, PointCloudParameters::_voxelSize);
+
+				this->leaveSpace(2);
+				ImGui::Text("Flythrough Benchmark");
+				ImGui::Separator();
+				this->leaveSpace(1);
+
+				ImGui::InputText("Waypoints", _benchmarkWaypointBuffer, IM_ARRAYSIZE(_benchmarkWaypointBuffer)); ImGui::SameLine(); this->renderHelpMarker("Every line is the camera position and look-at point: px py pz lx ly lz.");
+				ImGui::InputText("Results", _benchmarkResultBuffer, IM_ARRAYSIZE(_benchmarkResultBuffer));
+				ImGui::SliderInt("Frames", &PointCloudParameters::_benchmarkFrames, 10, 10000);
+				if (ImGui::Button("Run Benchmark"))
+				{
+					FlythroughBenchmark benchmark;
+
+					if (!benchmark.loadWaypoints(_benchmarkWaypointBuffer))
+						std::cout << "Waypoints could not be read from " << _benchmarkWaypointBuffer << "!" << std::endl;
+					else if (!benchmark.run(PointCloudParameters::_benchmarkFrames) || !benchmark.writeJSON(_benchmarkResultBuffer))
+						std::cout << "Benchmark results could not be written!" << std::endl;
+				}
 				
 				ImGui::EndTabItem();
 			}
@@ -299,7 +554,10 @@ void GUI::showScreenshotSettings()
 {
 	if (ImGui::Begin("Screenshot Settings", &_showScreenshotSettings, ImGuiWindowFlags_AlwaysAutoResize))
 	{
-		ImGui::SliderFloat("Size multiplier", &_renderingParams->_screenshotMultiplier, 1.0f, 10.0f);
+		ImGui::SliderFloat("Size multiplier", &_renderingParams->_screenshotMultiplier, 1.0f, _renderingParams->_screenshotTiled ? 64.0f : 10.0f);
+		ImGui::Checkbox("Tiled TIFF (print size)", &_renderingParams->_screenshotTiled);
+		if (!_renderingParams->_screenshotTiled)
+			ImGui::Combo("Format", &_renderingParams->_screenshotFormat, ImageEncoder::FORMAT_STR, ImageEncoder::NUM_FORMATS);
 		ImGui::InputText("Filename", _renderingParams->_screenshotFilenameBuffer, IM_ARRAYSIZE(_renderingParams->_screenshotFilenameBuffer));
 
 		this->leaveSpace(2);
@@ -312,17 +570,25 @@ void GUI::showScreenshotSettings()
 		if (ImGui::Button("Take screenshot"))
 		{
 			std::string filename = _renderingParams->_screenshotFilenameBuffer;
+			const std::string extension = ImageEncoder::FORMAT_EXTENSION[_renderingParams->_screenshotTiled ? ImageEncoder::TIFF : _renderingParams->_screenshotFormat];
 
 			if (filename.empty())
 			{
-				filename = "Screenshot.png";
+				filename = "Screenshot" + extension;
 			}
-			else if (filename.find(".png") == std::string::npos)
+			else
 			{
-				filename += ".png";
+				filename = std::filesystem::path(filename).replace_extension(extension).string();
 			}
 
-			Renderer::getInstance()->getScreenshot(filename);
+			if (_renderingParams->_screenshotTiled)
+			{
+				if (!Renderer::getInstance()->getTiledScreenshot(filename)) std::cout << "Tiled screenshot " << filename << " could not be written!" << std::endl;
+			}
+			else
+			{
+				Renderer::getInstance()->getScreenshot(filename);
+			}
 		}
 
 		ImGui::PopStyleColor(3);
@@ -354,6 +620,9 @@ void GUI::initialize(GLFWwindow* window, const int openGLMinorVersion)
 
 void GUI::render()
 {
+	Profiler::ScopedZone zone("Interface");
+	Profiler::GPUZone gpuZone("Interface");
+
 	bool show_demo_window = true;
 
 	ImGui_ImplOpenGL3_NewFrame();
@@ -28,13 +28,21 @@ protected:
 	RenderingParameters*			_renderingParams;					//!< Reference to rendering parameters
 
 	// GUI state
+	char							_benchmarkResultBuffer[256];		//!< JSON file where flythrough benchmark results are written
+	char							_benchmarkWaypointBuffer[256];		//!< Waypoint file of the flythrough benchmark
+	char							_loadClassesBuffer[64];				//!< Comma-separated class ids accepted when loading a point cloud
+	PointCloud::LoadFilter			_loadFilter;						//!< Predicates applied while loading a point cloud
+	char							_meshFilenameBuffer[256];			//!< OBJ mesh the point cloud is compared with
 	std::string						_pointCloudPath;					//!<
 	bool							_showAboutUs;						//!< About us window
 	bool							_showControls;						//!< Shows application controls
 	bool							_showFileDialog;					//!< Shows a file dialog that allows opening a point cloud in .ply format
+	bool							_showMemoryUsage;					//!< Shows the memory held by every subsystem
 	bool							_showPointCloudDialog;				//!< 
+	bool							_showProfiler;						//!< Shows the live flame view of the last frame and records traces
 	bool							_showRenderingSettings;				//!< Displays a window which allows the user to modify the rendering parameters
 	bool							_showScreenshotSettings;			//!< Shows a window which allows to take an screenshot at any size
+	char							_traceFilenameBuffer[256];			//!< Chrome trace file written when a recording is stopped
 
 protected:
 	/**
@@ -82,11 +90,21 @@ protected:
 	*/
 	void showFileDialog();
 
+	/**
+	*	@brief Shows a window with the current and peak memory of every subsystem, on the GPU and on the host.
+	*/
+	void showMemoryUsage();
+
 	/**
 	*	@brief  
 	*/
 	void showPointCloudDialog();
 
+	/**
+	*	@brief Shows a window with the zones of the last profiled frame and the trace recording.
+	*/
+	void showProfiler();
+
 	/**
 	*	@brief Shows a window with general rendering configuration.
 	*/
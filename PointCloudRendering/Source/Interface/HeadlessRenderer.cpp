@@ -0,0 +1,350 @@
+#include "stdafx.h"
+#include "HeadlessRenderer.h"
+
+#include <filesystem>
+#include "Geometry/3D/TriangleMesh.h"
+#include "Graphics/Application/FlythroughBenchmark.h"
+#include "Graphics/Application/PointCloudParameters.h"
+#include "Graphics/Application/PointCloudScene.h"
+#include "Graphics/Application/Renderer.h"
+#include "Graphics/Core/PointCloudGenerator.h"
+#include "Interface/Window.h"
+#include "Utilities/ChronoUtilities.h"
+#include "Utilities/Profiler.h"
+#include "Utilities/ThreadPool.h"
+
+/// [Public methods]
+
+bool HeadlessRenderer::isRequested(int argc, char* argv[])
+{
+	static const std::vector<std::string> headlessArguments = { "--help", "--cloud", "--cameras", "--generate", "--benchmark", "--bvh-benchmark" };
+
+	for (int argIdx = 1; argIdx < argc; ++argIdx)
+	{
+		if (std::find(headlessArguments.begin(), headlessArguments.end(), argv[argIdx]) != headlessArguments.end()) return true;
+	}
+
+	return false;
+}
+
+bool HeadlessRenderer::parseArguments(int argc, char* argv[], Settings& settings)
+{
+	for (int argIdx = 1; argIdx < argc; ++argIdx)
+	{
+		const std::string argument = argv[argIdx];
+
+		if (argument == "--help" || argIdx + 1 >= argc)
+		{
+			printUsage(argv[0]);
+			return false;
+		}
+
+		const std::string value = argv[++argIdx];
+
+		try
+		{
+			if (argument == "--cloud") settings._pointCloudPath = value;
+			else if (argument == "--cameras") settings._cameraPath = value;
+			else if (argument == "--output") settings._outputFolder = value;
+			else if (argument == "--format" && (value == "png" || value == "qoi" || value == "tiff")) settings._imageFormat = ImageEncoder::getFormat("." + value);
+			else if (argument == "--width") settings._size.x = std::stoul(value);
+			else if (argument == "--height") settings._size.y = std::stoul(value);
+			else if (argument == "--point-size") settings._pointSize = std::stof(value);
+			else if (argument == "--renderer" && (value == "gpu" || value == "cpu" || value == "compare"))
+			{
+				settings._cpuRendering = value == "cpu";
+				settings._compareRenderers = value == "compare";
+			}
+			else if (argument == "--tolerance") settings._compareTolerance = std::stoul(value);
+			else if (argument == "--threads") settings._numThreads = std::stoul(value);
+			else if (argument == "--trace") settings._tracePath = value;
+			else if (argument == "--generate") settings._syntheticPoints = std::stoull(value);
+			else if (argument == "--seed") settings._syntheticSeed = std::stoul(value);
+			else if (argument == "--benchmark") settings._benchmarkPath = value;
+			else if (argument == "--frames") settings._benchmarkFrames = std::stoul(value);
+			else if (argument == "--results") settings._benchmarkResultPath = value;
+			else if (argument == "--bvh-benchmark") settings._bvhBenchmarkPath = value;
+			else
+			{
+				std::cout << "Unknown argument " << argument << std::endl;
+				printUsage(argv[0]);
+				return false;
+			}
+		}
+		catch (std::exception& exception)
+		{
+			std::cout << "Invalid value " << value << " for " << argument << std::endl;
+			return false;
+		}
+	}
+
+	const bool meshOnly = !settings._bvhBenchmarkPath.empty() && settings._pointCloudPath.empty() && settings._cameraPath.empty() && settings._benchmarkPath.empty();
+
+	if ((!meshOnly && (settings._pointCloudPath.empty() || (settings._cameraPath.empty() && settings._benchmarkPath.empty()))) || !settings._benchmarkFrames || !settings._size.x || !settings._size.y || settings._size.x > UINT16_MAX || settings._size.y > UINT16_MAX)
+	{
+		printUsage(argv[0]);
+		return false;
+	}
+
+	return true;
+}
+
+int HeadlessRenderer::run(const Settings& settings)
+{
+	std::vector<View> views;
+	if (!settings._cameraPath.empty() && !loadViews(settings._cameraPath, views))
+	{
+		std::cout << "Views could not be read from " << settings._cameraPath << "!" << std::endl;
+		return 1;
+	}
+
+	FlythroughBenchmark benchmark;
+	if (!settings._benchmarkPath.empty() && !benchmark.loadWaypoints(settings._benchmarkPath))
+	{
+		std::cout << "Waypoints could not be read from " << settings._benchmarkPath << "!" << std::endl;
+		return 1;
+	}
+
+	std::error_code errorCode;
+	std::filesystem::create_directories(settings._outputFolder, errorCode);
+
+	ThreadPool::getInstance()->setNumThreads(settings._numThreads);
+
+	// Ray queries do not need any context, so they are measured before anything else is loaded
+	if (!settings._bvhBenchmarkPath.empty())
+	{
+		TriangleMesh mesh(settings._bvhBenchmarkPath);
+		if (!mesh.getNumTriangles())
+		{
+			std::cout << "Mesh " << settings._bvhBenchmarkPath << " could not be loaded!" << std::endl;
+			return 1;
+		}
+
+		mesh.getBVH()->benchmark();
+		if (settings._pointCloudPath.empty()) return 0;
+	}
+
+	if (!settings._tracePath.empty()) Profiler::getInstance()->startRecording();
+
+	// Synthetic scenes are written as the binary file of the point cloud, which is then loaded as usual
+	if (settings._syntheticPoints)
+	{
+		PointCloudGenerator::Settings generatorSettings;
+		generatorSettings._numPoints = settings._syntheticPoints;
+		generatorSettings._seed = settings._syntheticSeed;
+
+		if (!PointCloudGenerator(generatorSettings).write(settings._pointCloudPath))
+		{
+			std::cout << "Synthetic point cloud " << settings._pointCloudPath << " could not be written!" << std::endl;
+			return 1;
+		}
+	}
+
+	Window* window = Window::getInstance();
+	if (!window->loadHeadless(settings._size.x, settings._size.y))
+	{
+		std::cout << "__ Failed to create an offscreen OpenGL context __" << std::endl;
+		return 1;
+	}
+
+	Renderer* renderer = Renderer::getInstance();
+	RenderingParameters* rendParams = renderer->getRenderingParameters();
+	PointCloudScene* scene = dynamic_cast<PointCloudScene*>(renderer->getCurrentScene());
+	int failedViews = 0;
+	size_t renderedViews = 0;
+
+	rendParams->_scenePointSize = settings._pointSize;
+	PointCloudParameters::_cpuRendering = settings._cpuRendering;
+	rendParams->_screenshotMultiplier = 1.0f;
+
+	ChronoUtilities::initChrono();
+	if (!scene || !scene->loadPointCloud(settings._pointCloudPath))
+	{
+		std::cout << "Point cloud " << settings._pointCloudPath << " could not be loaded!" << std::endl;
+		window->close();
+		return 1;
+	}
+	std::cout << "Point cloud loaded (" << ChronoUtilities::getDuration() << " ms)" << std::endl;
+
+	Camera* camera = renderer->getActiveCamera();
+	ChronoUtilities::initChrono();
+
+	for (const View& view : views)
+	{
+		camera->setPosition(view._position);
+		camera->setLookAt(view._lookAt);
+		camera->setCameraType(view._orthoHeight > .0f ? Camera::ORTHO_PROJ : Camera::PERSPECTIVE_PROJ);
+
+		if (view._orthoHeight > .0f)
+			camera->setBottomLeftCorner(-vec2(view._orthoHeight * camera->getAspect(), view._orthoHeight));
+		else
+			camera->setFovX(glm::radians(view._fovX));
+
+		if (!settings._tracePath.empty()) Profiler::getInstance()->beginFrame();
+
+		const int previousFailures = failedViews;
+
+		// Written before the next view, so that a single image is kept in memory
+		Image* image = renderer->captureScreenshot();
+
+		if (settings._compareRenderers)
+		{
+			const bool cpuRendering = PointCloudParameters::_cpuRendering;
+
+			PointCloudParameters::_cpuRendering = true;
+			Image* cpuImage = renderer->captureScreenshot();
+			PointCloudParameters::_cpuRendering = cpuRendering;
+
+			size_t numDifferent = 0;
+			unsigned maxDifference = 0;
+			const bool compared = image && cpuImage && compareImages(image, cpuImage, settings._compareTolerance, numDifferent, maxDifference);
+
+			if (compared) std::cout << "View " << view._name << ": " << numDifferent << " pixels differ between GPU and CPU renders (maximum difference " << maxDifference << ")" << std::endl;
+			if (!compared || numDifferent) ++failedViews;
+
+			if (!writeImage(cpuImage, settings, view._name + "_cpu"))
+			{
+				std::cout << "CPU render of view " << view._name << " could not be written!" << std::endl;
+				++failedViews;
+			}
+		}
+
+		if (!writeImage(image, settings, view._name))
+		{
+			std::cout << "View " << view._name << " could not be written!" << std::endl;
+			++failedViews;
+		}
+
+		if (failedViews == previousFailures) ++renderedViews;
+	}
+
+	const long long duration = ChronoUtilities::getDuration();
+	if (!views.empty()) std::cout << renderedViews << " views rendered into " << settings._outputFolder << " (" << duration << " ms, " << duration / views.size() << " ms per view)" << std::endl;
+
+	if (!settings._benchmarkPath.empty())
+	{
+		if (benchmark.run(settings._benchmarkFrames) && benchmark.writeJSON(settings._benchmarkResultPath))
+		{
+			std::cout << "Benchmark results written into " << settings._benchmarkResultPath << std::endl;
+		}
+		else
+		{
+			std::cout << "Benchmark results could not be written!" << std::endl;
+			++failedViews;
+		}
+	}
+
+	if (!settings._tracePath.empty())
+	{
+		if (Profiler::getInstance()->stopRecording(settings._tracePath))
+		{
+			std::cout << "Trace written into " << settings._tracePath << std::endl;
+		}
+		else
+		{
+			++failedViews;
+		}
+	}
+
+	window->close();
+
+	return failedViews ? 1 : 0;
+}
+
+/// [Protected methods]
+
+bool HeadlessRenderer::compareImages(Image* image1, Image* image2, const unsigned tolerance, size_t& numDifferent, unsigned& maxDifference)
+{
+	numDifferent = 0;
+	maxDifference = 0;
+
+	if (image1->getWidth() != image2->getWidth() || image1->getHeight() != image2->getHeight() || image1->getDepth() != image2->getDepth()) return false;
+
+	const size_t numPixels = size_t(image1->getWidth()) * image1->getHeight(), depth = image1->getDepth();
+	const unsigned char* pixels1 = image1->bits(), * pixels2 = image2->bits();
+
+	for (size_t pixelIdx = 0; pixelIdx < numPixels; ++pixelIdx)
+	{
+		unsigned pixelDifference = 0;
+
+		for (size_t channel = 0; channel < depth; ++channel)
+		{
+			const size_t byteIdx = pixelIdx * depth + channel;
+			pixelDifference = (std::max)(pixelDifference, unsigned(std::abs(int(pixels1[byteIdx]) - int(pixels2[byteIdx]))));
+		}
+
+		maxDifference = (std::max)(maxDifference, pixelDifference);
+		if (pixelDifference > tolerance) ++numDifferent;
+	}
+
+	return true;
+}
+
+bool HeadlessRenderer::loadViews(const std::string& filename, std::vector<View>& views)
+{
+	std::ifstream file(filename);
+	std::string line;
+
+	if (!file.is_open()) return false;
+
+	while (std::getline(file, line))
+	{
+		std::stringstream stream(line);
+		std::string projection;
+		View view{ "", vec3(.0f), vec3(.0f), 80.0f, .0f };
+
+		if (!(stream >> view._name) || view._name[0] == '#') continue;
+
+		if (!(stream >> view._position.x >> view._position.y >> view._position.z >> view._lookAt.x >> view._lookAt.y >> view._lookAt.z))
+		{
+			std::cout << "Malformed view: " << line << std::endl;
+			return false;
+		}
+
+		if (stream >> projection)
+		{
+			try
+			{
+				if (projection == "ortho")
+				{
+					if (!(stream >> view._orthoHeight) || view._orthoHeight <= .0f) throw std::invalid_argument(projection);
+				}
+				else
+				{
+					view._fovX = std::stof(projection);
+				}
+			}
+			catch (std::exception& exception)
+			{
+				std::cout << "Malformed view: " << line << std::endl;
+				return false;
+			}
+		}
+
+		views.push_back(view);
+	}
+
+	return !views.empty();
+}
+
+void HeadlessRenderer::printUsage(const std::string& executable)
+{
+	std::cout << "Usage: " << executable << " --cloud <point cloud> --cameras <views file> [--output <folder>] [--format png|qoi|tiff] [--width <pixels>] [--height <pixels>] [--point-size <pixels>] [--renderer gpu|cpu|compare [--tolerance <value>]] [--threads <count>] [--trace <json>] [--generate <points> [--seed <seed>]] [--benchmark <waypoints> [--frames <count>] [--results <json>]] [--bvh-benchmark <obj>]" << std::endl;
+	std::cout << "Comparisons render every view with both renderers; views whose pixels differ by more than the tolerance fail" << std::endl;
+	std::cout << "Every line of the views file is: name px py pz lx ly lz [fovX | ortho halfHeight]" << std::endl;
+	std::cout << "Every line of the waypoints file is: px py pz lx ly lz" << std::endl;
+}
+
+bool HeadlessRenderer::writeImage(Image* image, const Settings& settings, const std::string& name)
+{
+	if (!image) return false;
+
+	const std::string filename = (std::filesystem::path(settings._outputFolder) / (name + ImageEncoder::FORMAT_EXTENSION[settings._imageFormat])).string();
+
+	image->flipImageVertically();
+	const bool written = ImageEncoder::saveImage(filename, image->bits(), uvec2(image->getWidth(), image->getHeight()), 4);
+
+	delete image;
+
+	return written;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "Graphics/Core/Image.h"
+#include "Graphics/Core/ImageEncoder.h"
+
+/**
+*	@file HeadlessRenderer.h
+*	@authors Alfonso Lpez Ruiz (alr00048@red.ujaen.es)
+*	@date 19/10/2026
+*/
+
+/**
+*	@brief Command-line entry point for batch renders. A point cloud is loaded once into an offscreen context and rendered from a
+*	list of views, writing one image per view, and/or flown through along a waypoint path to benchmark it. Neither GUI nor input
+*	management are created.
+*/
+class HeadlessRenderer
+{
+public:
+	struct Settings
+	{
+		std::string		_pointCloudPath;								//!< Point cloud which stays resident for every view
+		std::string		_cameraPath;									//!< Text file with a view per line
+		std::string		_outputFolder;									//!< Folder of rendered images, created if needed
+		ImageEncoder::Format _imageFormat;								//!< Format of rendered images
+		uvec2			_size;											//!< Resolution of every image
+		float			_pointSize;										//!< Size of points, in pixels
+		bool			_cpuRendering;									//!< Renders with the CPU rasterizer, so that images do not depend on the GPU
+		bool			_compareRenderers;								//!< Renders every view with both the GPU and CPU paths and compares their images
+		unsigned		_compareTolerance;								//!< Largest difference of a channel for two pixels to be considered equal
+		uint64_t		_syntheticPoints;								//!< Points of a synthetic scene written as the point cloud, zero to load it
+		uint32_t		_syntheticSeed;									//!< Seed of the synthetic scene
+		std::string		_benchmarkPath;									//!< Waypoint file of the flythrough benchmark, if any
+		std::string		_benchmarkResultPath;							//!< JSON file where benchmark results are written
+		unsigned		_benchmarkFrames;								//!< Recorded frames of the flythrough
+		unsigned		_numThreads;									//!< Workers of the thread pool, zero for as many as hardware threads
+		std::string		_tracePath;										//!< Chrome trace of the whole run, if any
+		std::string		_bvhBenchmarkPath;								//!< OBJ mesh whose ray throughput is measured, if any
+
+		/**
+		*	@brief Default constructor.
+		*/
+		Settings() : _outputFolder("."), _imageFormat(ImageEncoder::PNG), _size(1920, 1080), _pointSize(2.0f), _cpuRendering(false), _compareRenderers(false), _compareTolerance(0), _syntheticPoints(0), _syntheticSeed(0), _benchmarkResultPath("benchmark.json"), _benchmarkFrames(1000), _numThreads(0) {}
+	};
+
+protected:
+	struct View
+	{
+		std::string		_name;											//!< Name of the image file, without extension
+		vec3			_position, _lookAt;								//!< Camera placement
+		float			_fovX;											//!< Horizontal aperture (degrees) of perspective views
+		float			_orthoHeight;									//!< Half height of orthographic views, zero for perspective views
+	};
+
+protected:
+	/**
+	*	@brief Compares two images of the same size, pixel by pixel.
+	*	@param tolerance Largest difference of a channel for two pixels to be considered equal.
+	*	@param numDifferent Number of pixels which differ by more than the tolerance.
+	*	@param maxDifference Largest difference of any channel.
+	*	@return False if the images do not share size and depth.
+	*/
+	static bool compareImages(Image* image1, Image* image2, const unsigned tolerance, size_t& numDifferent, unsigned& maxDifference);
+
+	/**
+	*	@brief Reads the views of a camera file. Every line is "name px py pz lx ly lz", optionally followed either by the horizontal
+	*	field of view in degrees or by "ortho" and the half height of the view volume. Empty lines and lines starting with # are skipped.
+	*	@return False if the file could not be opened or any line is malformed.
+	*/
+	static bool loadViews(const std::string& filename, std::vector<View>& views);
+
+	/**
+	*	@brief Prints the accepted arguments.
+	*/
+	static void printUsage(const std::string& executable);
+
+	/**
+	*	@brief Writes a screenshot with the format of the settings and releases it.
+	*	@return False if there was no screenshot or it could not be written.
+	*/
+	static bool writeImage(Image* image, const Settings& settings, const std::string& name);
+
+public:
+	/**
+	*	@return True if the command line asks for batch rendering, i.e. it contains --help or any argument giving the data to be processed.
+	*	Other arguments, such as those added by the operating system or a debugger, start the interactive application.
+	*/
+	static bool isRequested(int argc, char* argv[]);
+
+	/**
+	*	@brief Reads the command-line arguments: --cloud <path> --cameras <path> [--output <folder>] [--format png|qoi|tiff] [--width <pixels>]
+	*	[--height <pixels>] [--point-size <pixels>] [--renderer gpu|cpu|compare [--tolerance <value>]] [--threads <count>] [--trace <json>] [--generate <points> [--seed <seed>]] [--benchmark <waypoints>
+	*	[--frames <count>] [--results <json>]] [--bvh-benchmark <obj>]. Views are optional if a benchmark is given, and the point cloud is
+	*	optional if only the ray throughput of a mesh is measured.
+	*	@return False if the arguments are not valid, after printing the usage.
+	*/
+	static bool parseArguments(int argc, char* argv[], Settings& settings);
+
+	/**
+	*	@brief Measures the ray throughput of a mesh, renders every view of the camera file and runs the flythrough benchmark, if requested. Comparisons render every view with
+	*	the GPU and CPU paths, writing both images, and views whose images differ count as failed.
+	*	@return Process exit code, zero if every image and the benchmark results were written.
+	*/
+	static int run(const Settings& settings);
+};
+
@@ -6,6 +6,7 @@
 #include "Graphics/Core/Camera.h"
 #include "Interface/GUI.h"
 #include "Interface/Window.h"
+#include "Utilities/Profiler.h"
 
 // [Static members initialization]
 
@@ -288,6 +289,8 @@ void InputManager::resizeEvent(GLFWwindow* window, int width, int height)
 
 void InputManager::windowRefresh(GLFWwindow* window)
 {
+	Profiler::getInstance()->beginFrame();
+
 	Renderer::getInstance()->render();
 	GUI::getInstance()->render();
 
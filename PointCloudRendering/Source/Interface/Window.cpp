@@ -6,32 +6,69 @@
 
 /// [Protected methods]
 
-Window::Window(): Singleton(), _size(1, 1), _window(nullptr), _windowState(NOT_LOADED)
+Window::Window(): Singleton(), _headless(false), _size(1, 1), _window(nullptr), _windowState(NOT_LOADED)
 {
 }
 
-/// [Public methods]
-
-void Window::changedSize(const uint16_t width, const uint16_t height)
+bool Window::createContext(const std::string& title, const uint16_t width, const uint16_t height, const uint8_t openGL4Version, const bool headless)
 {
 	_size = ivec2(width, height);
-}
+	_headless = headless;
 
-bool Window::load(const std::string& title, const uint16_t width, const uint16_t height, const uint8_t openGL4Version)
-{
-	_size = ivec2(width, height);
+#if !defined(_WIN32) && (GLFW_VERSION_MAJOR > 3 || (GLFW_VERSION_MAJOR == 3 && GLFW_VERSION_MINOR >= 4))
+	if (headless) glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);		// No display server is needed
+#endif
 
 	if (glfwInit() != GLFW_TRUE)
 	{
 		return false;
 	}
 
-	glfwWindowHint(GLFW_SAMPLES, 4);										// Antialiasing
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);			// OpenGL Core Profile 4.5
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, glm::clamp((int) openGL4Version, 1, 6));
+	// Hints are reset whenever GLFW is initialized
+	auto setWindowHints = [openGL4Version, headless]()
+		{
+			glfwWindowHint(GLFW_SAMPLES, 4);										// Antialiasing
+			glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);			// OpenGL Core Profile 4.5
+			glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+			glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, glm::clamp((int) openGL4Version, 1, 6));
+
+			if (headless) glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);				// Everything is rendered into framebuffer objects
+		};
+
+	setWindowHints();
+
+#if GLFW_VERSION_MAJOR > 3 || (GLFW_VERSION_MAJOR == 3 && GLFW_VERSION_MINOR >= 4)
+	if (headless)
+	{
+		// GPU drivers without display, otherwise software rendering
+		for (const int contextAPI : { GLFW_EGL_CONTEXT_API, GLFW_OSMESA_CONTEXT_API })
+		{
+			glfwWindowHint(GLFW_CONTEXT_CREATION_API, contextAPI);
+			_window = glfwCreateWindow(width, height, title.c_str(), nullptr, nullptr);
+
+			if (_window != nullptr) break;
+		}
+
+		// Otherwise, a hidden window of the native platform, which does need a display server
+		if (_window == nullptr)
+		{
+			glfwTerminate();
+			glfwInitHint(GLFW_PLATFORM, GLFW_ANY_PLATFORM);
+
+			if (glfwInit() != GLFW_TRUE)
+			{
+				return false;
+			}
+
+			setWindowHints();
+		}
+	}
+#endif
 
-	_window = glfwCreateWindow(width, height, title.c_str(), nullptr, nullptr);
+	if (_window == nullptr)
+	{
+		_window = glfwCreateWindow(width, height, title.c_str(), nullptr, nullptr);
+	}
 
 	if (_window == nullptr) {												// Window initialization could fail in case the computer doesn't meet the required specs
 		glfwTerminate();
@@ -40,11 +77,17 @@ bool Window::load(const std::string& title, const uint16_t width, const uint16_t
 	}
 
 	glfwMakeContextCurrent(_window);										// From now on the window uses the context with the properties cited previously
-	glfwSwapInterval(1);
+	glfwSwapInterval(headless ? 0 : 1);
 
 	glewExperimental = true;			// !! GLFW -> GLEW; order matters
-	if (glewInit() != GLEW_OK) {
-		glfwTerminate();	
+	const GLenum glewState = glewInit();
+
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+	if (glewState != GLEW_OK && !(headless && glewState == GLEW_ERROR_NO_GLX_DISPLAY)) {		// GLX extensions are not available for EGL contexts
+#else
+	if (glewState != GLEW_OK) {
+#endif
+		this->close();
 
 		return false;
 	}
@@ -54,6 +97,35 @@ bool Window::load(const std::string& title, const uint16_t width, const uint16_t
 	std::cout << glGetString(GL_VERSION) << std::endl;
 	std::cout << glGetString(GL_SHADING_LANGUAGE_VERSION) << std::endl;
 
+	return true;
+}
+
+/// [Public methods]
+
+void Window::changedSize(const uint16_t width, const uint16_t height)
+{
+	_size = ivec2(width, height);
+}
+
+void Window::close()
+{
+	if (_window)
+	{
+		glfwDestroyWindow(_window);
+		glfwTerminate();
+	}
+
+	_window = nullptr;
+	_windowState = NOT_LOADED;
+}
+
+bool Window::load(const std::string& title, const uint16_t width, const uint16_t height, const uint8_t openGL4Version)
+{
+	if (!this->createContext(title, width, height, openGL4Version, false))
+	{
+		return false;
+	}
+
 	// Callbacks to main events
 	glfwSetWindowRefreshCallback(_window, InputManager::windowRefresh);
 	glfwSetFramebufferSizeCallback(_window, InputManager::resizeEvent);
@@ -72,9 +144,23 @@ bool Window::load(const std::string& title, const uint16_t width, const uint16_t
 	return true;
 }
 
+bool Window::loadHeadless(const uint16_t width, const uint16_t height, const uint8_t openGL4Version)
+{
+	if (!this->createContext("", width, height, openGL4Version, true))
+	{
+		return false;
+	}
+
+	Renderer::getInstance()->prepareOpenGL(width, height);
+
+	_windowState = SUCCESSFUL_LOAD;
+
+	return true;
+}
+
 void Window::startRenderingCycle()
 {
-	if (_windowState != SUCCESSFUL_LOAD) return;
+	if (_windowState != SUCCESSFUL_LOAD || _headless) return;
 
 	InputManager* inputManager = InputManager::getInstance();
 
@@ -83,6 +169,6 @@ void Window::startRenderingCycle()
 		InputManager::getInstance()->windowRefresh(_window);
 	}
 
-	glfwDestroyWindow(_window);							// Free GLFW resources
-	glfwTerminate();
+	Renderer::getInstance()->flushScreenshots();		// Pending screenshots need the context to finish their readback
+	this->close();										// Free GLFW resources
 }
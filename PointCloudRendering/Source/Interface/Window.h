@@ -20,6 +20,7 @@ class Window: public Singleton<Window>
 protected:
 	enum Codes { NOT_LOADED, SUCCESSFUL_LOAD, UNSUCCESSFUL_LOAD};
 
+	bool		_headless;								//!< The context has no visible surface, neither GUI nor input
 	ivec2		_size;									//!< Dimensions of window
 	GLFWwindow* _window;								//!< Loaded GLFW window, if any
 	uint8_t		_windowState;							//!< Code of window state as a reference for event cycle petitions
@@ -30,6 +31,13 @@ protected:
 	*/
 	Window();
 
+	/**
+	*	@brief Creates the GLFW window and makes its OpenGL context current, loading GLEW afterwards.
+	*	@param headless The window is never shown. If supported by GLFW, no display server is required either.
+	*	@return Success of initialization.
+	*/
+	bool createContext(const std::string& title, const uint16_t width, const uint16_t height, const uint8_t openGL4Version, const bool headless);
+
 public:
 	/**
 	*	@brief Window resized event.
@@ -38,11 +46,21 @@ public:
 	*/
 	void changedSize(const uint16_t width, const uint16_t height);
 
+	/**
+	*	@brief Releases the window and the GLFW resources.
+	*/
+	void close();
+
 	/**
 	*	@return Size of window.	First coordinate: width, second coordinate: height.
 	*/
 	ivec2 getSize() { return _size; }
 
+	/**
+	*	@return True if the context was created without a visible window.
+	*/
+	bool isHeadless() const { return _headless; }
+
 	/**
 	*	@brief Initializes the window resources and the GLFW context. Note: it is not needed to ensure this method is called just once
 	*		   as the application enters a loop in here.
@@ -54,6 +72,17 @@ public:
 	*/
 	bool load(const std::string& title, const uint16_t width, const uint16_t height, const uint8_t openGL4Version = 6);
 
+	/**
+	*	@brief Initializes an offscreen OpenGL context for batch rendering, without GUI nor input management. The context is requested
+	*		   through EGL or OSMesa on the null platform of GLFW 3.4, so that it also works on servers without display. Older GLFW
+	*		   versions fall back to a hidden window.
+	*	@param width Initial width of the canvas.
+	*	@param height Initial height of the canvas.
+	*	@param openGL4Version Version of OpenGL 4 which is required for this application [0, 6].
+	*	@return Success of initialization.
+	*/
+	bool loadHeadless(const uint16_t width, const uint16_t height, const uint8_t openGL4Version = 6);
+
 	/**
 	*	@brief Start the event and rendering cycle if possible (window must have been successfully loaded).
 	*/
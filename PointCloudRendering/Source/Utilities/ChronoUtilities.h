@@ -21,11 +21,8 @@ namespace ChronoUtilities
 		SECONDS = 1000000000, MILLISECONDS = 1000000, MICROSECONDS = 1000, NANOSECONDS = 1
 	};
 
-	//!< Private members
-	namespace
-	{
-		std::chrono::high_resolution_clock::time_point _initTime;
-	}
+	//!< Start of the clock, shared by every translation unit and separate for every thread
+	inline thread_local std::chrono::high_resolution_clock::time_point _initTime;
 
 	/**
 	*	@return Measured time in the selected time unit since the clock was started. By default the time unit is milliseconds.
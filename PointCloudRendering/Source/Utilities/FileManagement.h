@@ -4,6 +4,7 @@
 
 #include "tinyply//tinyply.h"
 #include "Graphics/Core/Group3D.h"
+#include "Graphics/Core/ImageEncoder.h"
 
 /**
 *	@file FileManagement.h
@@ -32,7 +33,7 @@ namespace FileManagement
 	void readTokens(const std::string& line, const char delimiter, std::vector<std::string>& stringTokens, std::vector<float>& floatTokens);
 
 	/**
-	*	@brief Saves an image (array of bytes) in a system file, given the string filename.
+	*	@brief Saves an RGBA image (array of bytes) in a system file, given the string filename. The format follows the extension of the file.
 	*/
 	bool saveImage(const std::string& filename, std::vector<GLubyte>* image, const unsigned int width, const unsigned int height);
 };
@@ -72,15 +73,5 @@ inline void FileManagement::readTokens(const std::string& line, const char delim
 
 inline bool FileManagement::saveImage(const std::string& filename, std::vector<GLubyte>* image, const unsigned int width, const unsigned int height)
 {
-	std::vector<unsigned char> result;
-	unsigned error = lodepng::encode(result, *image, width, height);
-
-	if (!error)
-	{
-		lodepng::save_file(result, filename);
-
-		return true;
-	}
-
-	return false;
+	return ImageEncoder::saveImage(filename, image->data(), uvec2(width, height), 4);
 }
\ No newline at end of file
@@ -0,0 +1,99 @@
+#include "stdafx.h"
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/// [Public methods]
+
+MappedFile::MappedFile() :
+	_data(nullptr), _size(0)
+#ifdef _WIN32
+	, _fileHandle(INVALID_HANDLE_VALUE), _mappingHandle(nullptr)
+#else
+	, _fileDescriptor(-1)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+	this->close();
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+	if (_data) UnmapViewOfFile(_data);
+	if (_mappingHandle) CloseHandle(_mappingHandle);
+	if (_fileHandle != INVALID_HANDLE_VALUE) CloseHandle(_fileHandle);
+
+	_fileHandle = INVALID_HANDLE_VALUE;
+	_mappingHandle = nullptr;
+#else
+	if (_data) munmap(const_cast<char*>(_data), _size);
+	if (_fileDescriptor >= 0) ::close(_fileDescriptor);
+
+	_fileDescriptor = -1;
+#endif
+
+	_data = nullptr;
+	_size = 0;
+}
+
+bool MappedFile::open(const std::string& filename)
+{
+	this->close();
+
+#ifdef _WIN32
+	_fileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (_fileHandle == INVALID_HANDLE_VALUE) return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(_fileHandle, &fileSize) || !fileSize.QuadPart)
+	{
+		this->close();
+		return false;
+	}
+
+	_mappingHandle = CreateFileMappingA(_fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!_mappingHandle)
+	{
+		this->close();
+		return false;
+	}
+
+	_data = static_cast<const char*>(MapViewOfFile(_mappingHandle, FILE_MAP_READ, 0, 0, 0));
+	_size = size_t(fileSize.QuadPart);
+#else
+	_fileDescriptor = ::open(filename.c_str(), O_RDONLY);
+	if (_fileDescriptor < 0) return false;
+
+	struct stat fileStatus;
+	if (fstat(_fileDescriptor, &fileStatus) != 0 || !fileStatus.st_size)
+	{
+		this->close();
+		return false;
+	}
+
+	void* data = mmap(nullptr, size_t(fileStatus.st_size), PROT_READ, MAP_PRIVATE, _fileDescriptor, 0);
+	if (data == MAP_FAILED)
+	{
+		this->close();
+		return false;
+	}
+
+	_data = static_cast<const char*>(data);
+	_size = size_t(fileStatus.st_size);
+#endif
+
+	if (!_data) this->close();
+
+	return _data != nullptr;
+}
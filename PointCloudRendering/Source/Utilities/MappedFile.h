@@ -0,0 +1,64 @@
+#pragma once
+
+/**
+*	@file MappedFile.h
+*	@authors Alfonso Lpez Ruiz (alr00048@red.ujaen.es)
+*	@date 19/10/2026
+*/
+
+/**
+*	@brief Read-only view of a whole file mapped into memory, so that it can be parsed by several threads without copying it.
+*/
+class MappedFile
+{
+protected:
+	const char*		_data;														//!< First byte of the file
+	size_t			_size;														//!< Number of bytes
+
+#ifdef _WIN32
+	void*			_fileHandle;												//!< File opened for reading
+	void*			_mappingHandle;												//!< Mapping object of the file
+#else
+	int				_fileDescriptor;											//!< File opened for reading
+#endif
+
+public:
+	/**
+	*	@brief Constructor. No file is mapped until open() is called.
+	*/
+	MappedFile();
+
+	/**
+	*	@brief Destructor. Unmaps the file, if any.
+	*/
+	virtual ~MappedFile();
+
+	/**
+	*	@brief Unmaps the current file.
+	*/
+	void close();
+
+	/**
+	*	@brief Maps a file into memory, closing the previous one.
+	*	@return False if the file could not be opened or is empty.
+	*/
+	bool open(const std::string& filename);
+
+	// ------------ Getters ------------
+
+	/**
+	*	@return First byte of the file.
+	*/
+	const char* getData() const { return _data; }
+
+	/**
+	*	@return Number of bytes of the file.
+	*/
+	size_t getSize() const { return _size; }
+
+	/**
+	*	@return True if a file is currently mapped.
+	*/
+	bool isOpen() const { return _data != nullptr; }
+};
+
@@ -0,0 +1,175 @@
+#include "stdafx.h"
+#include "MemoryTracker.h"
+
+// [Static members initialization]
+
+const std::string MemoryTracker::DEVICE_NAME[NUM_DEVICES] = { "gpu", "host" };
+const char* MemoryTracker::DEFAULT_TAG = "Other";
+
+thread_local const char* MemoryTracker::_currentTag = nullptr;
+
+/// [Public methods]
+
+MemoryTracker::ScopedTag::ScopedTag(const char* tag) :
+	_previousTag(_currentTag)
+{
+	_currentTag = tag;
+}
+
+MemoryTracker::ScopedTag::~ScopedTag()
+{
+	_currentTag = _previousTag;
+}
+
+MemoryTracker::~MemoryTracker()
+{
+}
+
+size_t MemoryTracker::getBytes(const Device device) const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _bytes[device];
+}
+
+size_t MemoryTracker::getPeakBytes(const Device device) const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _peakBytes[device];
+}
+
+std::vector<MemoryTracker::Usage> MemoryTracker::getUsage() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _usage;
+}
+
+bool MemoryTracker::getVideoMemory(size_t& freeBytes, size_t& totalBytes)
+{
+	// Both extensions report kilobytes
+	if (GLEW_NVX_gpu_memory_info)
+	{
+		GLint freeKB, totalKB;
+		glGetIntegerv(GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX, &freeKB);
+		glGetIntegerv(GL_GPU_MEMORY_INFO_DEDICATED_VIDMEM_NVX, &totalKB);
+
+		freeBytes = size_t(freeKB) * 1024;
+		totalBytes = size_t(totalKB) * 1024;
+
+		return true;
+	}
+
+	if (GLEW_ATI_meminfo)
+	{
+		GLint freeKB[4];
+		glGetIntegerv(GL_VBO_FREE_MEMORY_ATI, freeKB);
+
+		freeBytes = size_t(freeKB[0]) * 1024;
+		totalBytes = 0;														// Not exposed by the extension
+
+		return true;
+	}
+
+	return false;
+}
+
+void MemoryTracker::registerBuffer(const GLuint id, const size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	auto buffer = _buffer.find(id);
+	if (buffer == _buffer.end())
+	{
+		buffer = _buffer.insert(std::make_pair(id, Allocation{ this->getUsageIdx(GPU, _currentTag ? _currentTag : DEFAULT_TAG), 0 })).first;
+		++_usage[buffer->second._usageIdx]._numAllocations;
+	}
+
+	this->resize(buffer->second, bytes);
+}
+
+void MemoryTracker::releaseBuffer(const GLuint id)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	auto buffer = _buffer.find(id);
+	if (buffer == _buffer.end()) return;
+
+	this->resize(buffer->second, 0);
+	--_usage[buffer->second._usageIdx]._numAllocations;
+	_buffer.erase(buffer);
+}
+
+void MemoryTracker::setHostAllocation(const void* owner, const std::string& tag, const size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	auto allocation = _hostAllocation.find(owner);
+	if (allocation == _hostAllocation.end())
+	{
+		if (!bytes) return;
+
+		allocation = _hostAllocation.insert(std::make_pair(owner, Allocation{ this->getUsageIdx(HOST, tag), 0 })).first;
+		++_usage[allocation->second._usageIdx]._numAllocations;
+	}
+
+	this->resize(allocation->second, bytes);
+
+	if (!bytes)
+	{
+		--_usage[allocation->second._usageIdx]._numAllocations;
+		_hostAllocation.erase(allocation);
+	}
+}
+
+void MemoryTracker::writeJSON(std::ostream& stream, const std::string& indentation) const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	for (int device = 0; device < NUM_DEVICES; ++device)
+	{
+		stream << indentation << "\"" << DEVICE_NAME[device] << "Bytes\": " << _bytes[device] << "," << std::endl;
+		stream << indentation << "\"" << DEVICE_NAME[device] << "PeakBytes\": " << _peakBytes[device] << "," << std::endl;
+	}
+
+	stream << indentation << "\"subsystems\": [" << std::endl;
+	for (size_t usageIdx = 0; usageIdx < _usage.size(); ++usageIdx)
+	{
+		const Usage& usage = _usage[usageIdx];
+
+		stream << indentation << "\t{ \"device\": \"" << DEVICE_NAME[usage._device] << "\", \"tag\": \"" << usage._tag << "\", \"bytes\": " << usage._bytes
+			<< ", \"peakBytes\": " << usage._peakBytes << ", \"allocations\": " << usage._numAllocations << " }";
+		stream << (usageIdx + 1 < _usage.size() ? "," : "") << std::endl;
+	}
+	stream << indentation << "]" << std::endl;
+}
+
+/// [Protected methods]
+
+MemoryTracker::MemoryTracker() :
+	_bytes{ 0, 0 }, _peakBytes{ 0, 0 }
+{
+}
+
+size_t MemoryTracker::getUsageIdx(const Device device, const std::string& tag)
+{
+	for (size_t usageIdx = 0; usageIdx < _usage.size(); ++usageIdx)
+	{
+		if (_usage[usageIdx]._device == device && _usage[usageIdx]._tag == tag) return usageIdx;
+	}
+
+	_usage.push_back(Usage{ device, tag, 0, 0, 0 });
+
+	return _usage.size() - 1;
+}
+
+void MemoryTracker::resize(Allocation& allocation, const size_t bytes)
+{
+	Usage& usage = _usage[allocation._usageIdx];
+
+	usage._bytes = usage._bytes - allocation._bytes + bytes;
+	usage._peakBytes = (std::max)(usage._peakBytes, usage._bytes);
+
+	_bytes[usage._device] = _bytes[usage._device] - allocation._bytes + bytes;
+	_peakBytes[usage._device] = (std::max)(_peakBytes[usage._device], _bytes[usage._device]);
+
+	allocation._bytes = bytes;
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <mutex>
+
+#include "Utilities/Singleton.h"
+
+/**
+*	@file MemoryTracker.h
+*	@authors Alfonso Lpez Ruiz (alr00048@red.ujaen.es)
+*	@date 19/10/2026
+*/
+
+/**
+*	@brief Accounting of GPU buffers and large host containers, grouped by the subsystem which owns them. GPU buffers are registered by the
+*	helpers of ComputeShader under the tag of the enclosing ScopedTag, whereas host containers report their size explicitly. Current and peak
+*	sizes are kept for every tag and for every device, so that out-of-memory failures can be traced back to their origin.
+*/
+class MemoryTracker: public Singleton<MemoryTracker>
+{
+	friend class Singleton<MemoryTracker>;
+
+public:
+	enum Device { GPU, HOST, NUM_DEVICES };
+
+	struct Usage
+	{
+		Device			_device;											//!< Memory where the allocations live
+		std::string		_tag;												//!< Subsystem which owns the allocations
+		size_t			_bytes;												//!< Current size
+		size_t			_peakBytes;											//!< Largest size reached
+		unsigned		_numAllocations;									//!< Live allocations
+	};
+
+	/**
+	*	@brief Tag given to the GPU buffers created by the calling thread until the end of its scope.
+	*/
+	class ScopedTag
+	{
+	protected:
+		const char*		_previousTag;										//!< Tag restored on destruction
+
+	public:
+		/**
+		*	@brief Replaces the tag of the calling thread.
+		*	@param tag String which must outlive the scope, usually a literal.
+		*/
+		ScopedTag(const char* tag);
+
+		/**
+		*	@brief Restores the previous tag.
+		*/
+		virtual ~ScopedTag();
+	};
+
+public:
+	const static std::string DEVICE_NAME[NUM_DEVICES];						//!< Name of every device in reports
+
+protected:
+	const static char* DEFAULT_TAG;											//!< Tag of buffers created outside of any scope
+
+protected:
+	struct Allocation
+	{
+		size_t			_usageIdx;											//!< Tag of the allocation
+		size_t			_bytes;												//!< Size of the allocation
+	};
+
+protected:
+	static thread_local const char*			_currentTag;					//!< Tag of the buffers created by the calling thread, null for the default one
+
+	std::vector<Usage>						_usage;							//!< Usage of every tag seen so far
+	std::unordered_map<GLuint, Allocation>	_buffer;						//!< Live GPU buffers
+	std::unordered_map<const void*, Allocation> _hostAllocation;			//!< Live host containers, indexed by their address
+	size_t									_bytes[NUM_DEVICES];			//!< Current size of every device
+	size_t									_peakBytes[NUM_DEVICES];		//!< Largest size of every device
+	mutable std::mutex						_mutex;							//!< Guards every counter, as host containers are updated from any thread
+
+protected:
+	/**
+	*	@brief Constructor.
+	*/
+	MemoryTracker();
+
+	/**
+	*	@return Index of the usage of a tag, which is created if needed.
+	*/
+	size_t getUsageIdx(const Device device, const std::string& tag);
+
+	/**
+	*	@brief Replaces the size of an allocation, updating the counters of its tag and device.
+	*/
+	void resize(Allocation& allocation, const size_t bytes);
+
+public:
+	/**
+	*	@brief Destructor.
+	*/
+	virtual ~MemoryTracker();
+
+	/**
+	*	@return Current size of the allocations of a device, in bytes.
+	*/
+	size_t getBytes(const Device device) const;
+
+	/**
+	*	@return Largest size reached by the allocations of a device, in bytes.
+	*/
+	size_t getPeakBytes(const Device device) const;
+
+	/**
+	*	@return Usage of every tag seen so far, including those without live allocations.
+	*/
+	std::vector<Usage> getUsage() const;
+
+	/**
+	*	@brief Reads the free and total dedicated memory reported by the driver, if it exposes them (NVX_gpu_memory_info or ATI_meminfo).
+	*	Must be called from the thread which owns the context.
+	*	@return False if the driver does not report them.
+	*/
+	static bool getVideoMemory(size_t& freeBytes, size_t& totalBytes);
+
+	/**
+	*	@brief Records a GPU buffer of the given size under the current tag. Buffers which were already recorded keep their tag.
+	*/
+	void registerBuffer(const GLuint id, const size_t bytes);
+
+	/**
+	*	@brief Forgets a GPU buffer. Unknown identifiers are ignored.
+	*/
+	void releaseBuffer(const GLuint id);
+
+	/**
+	*	@brief Records the size of a host container. A zero size forgets it.
+	*	@param owner Address of the container, which identifies it in later updates.
+	*/
+	void setHostAllocation(const void* owner, const std::string& tag, const size_t bytes);
+
+	/**
+	*	@brief Writes the usage as the body of a JSON object, every line starting with the given indentation.
+	*/
+	void writeJSON(std::ostream& stream, const std::string& indentation) const;
+};
+
@@ -0,0 +1,322 @@
+#include "stdafx.h"
+#include "Profiler.h"
+
+#include <iomanip>
+
+// [Static members initialization]
+
+const unsigned Profiler::MAX_FRAMES = 8;
+const uint64_t Profiler::NO_FRAME = UINT64_MAX;
+
+std::atomic<bool> Profiler::_enabled(false);
+thread_local Profiler::Timeline* Profiler::_threadTimeline = nullptr;
+thread_local std::string Profiler::_threadName;
+
+/// [Public methods]
+
+Profiler::ScopedZone::ScopedZone(const char* name) :
+	_name(name), _start(0), _active(Profiler::isEnabled())
+{
+	if (_active)
+	{
+		Profiler* profiler = Profiler::getInstance();
+
+		++profiler->getTimeline()->_depth;
+		_start = profiler->now();
+	}
+}
+
+Profiler::ScopedZone::~ScopedZone()
+{
+	if (_active)
+	{
+		Profiler* profiler = Profiler::getInstance();
+		const uint64_t end = profiler->now();
+		Timeline* timeline = profiler->getTimeline();
+
+		--timeline->_depth;
+		profiler->record(timeline, Zone{ _name, _start, end, timeline->_index, timeline->_depth });
+	}
+}
+
+Profiler::GPUZone::GPUZone(const char* name) :
+	_name(name), _query{ 0, 0 }, _depth(0), _active(Profiler::isEnabled())
+{
+	if (_active)
+	{
+		Profiler* profiler = Profiler::getInstance();
+
+		for (GLuint& query : _query)
+		{
+			if (profiler->_freeQuery.empty())
+			{
+				glGenQueries(1, &query);
+			}
+			else
+			{
+				query = profiler->_freeQuery.back();
+				profiler->_freeQuery.pop_back();
+			}
+		}
+
+		_depth = profiler->_gpuDepth++;
+		glQueryCounter(_query[0], GL_TIMESTAMP);
+	}
+}
+
+Profiler::GPUZone::~GPUZone()
+{
+	if (_active)
+	{
+		Profiler* profiler = Profiler::getInstance();
+
+		glQueryCounter(_query[1], GL_TIMESTAMP);
+		--profiler->_gpuDepth;
+		profiler->_pendingQuery.push_back(GPUQuery{ _name, { _query[0], _query[1] }, _depth, profiler->now() });
+	}
+}
+
+Profiler::~Profiler()
+{
+	// Query objects are not deleted, as the context is usually destroyed before the profiler
+}
+
+void Profiler::beginFrame()
+{
+	const uint64_t time = this->now();
+
+	if (!_pendingQuery.empty() || Profiler::isEnabled()) this->calibrateGPUClock();
+	this->resolveGPUZones(false);
+
+	if (!Profiler::isEnabled())
+	{
+		_frame.clear();
+		_frameStart = NO_FRAME;
+		if (!_recording) this->trim(time);
+
+		return;
+	}
+
+	if (_frameStart != NO_FRAME) _frame.push_back(Frame{ _frameStart, time });
+	_frameStart = time;
+
+	// Zones are closed in order, so every zone of a frame which finished before the oldest pending query has been resolved
+	const uint64_t resolvedTime = _pendingQuery.empty() ? time : _pendingQuery.front()._issued;
+	auto resolvedFrame = std::find_if(_frame.rbegin(), _frame.rend(), [resolvedTime](const Frame& frame) { return frame._end <= resolvedTime; });
+
+	if (resolvedFrame != _frame.rend())
+	{
+		const Frame frame = *resolvedFrame;
+		std::vector<Zone> zones;
+
+		{
+			std::lock_guard<std::mutex> lock(_timelineMutex);
+
+			for (std::unique_ptr<Timeline>& timeline : _timeline)
+			{
+				std::lock_guard<std::mutex> timelineLock(timeline->_mutex);
+
+				for (const Zone& zone : timeline->_zones)
+				{
+					if (zone._end > frame._start && zone._start < frame._end) zones.push_back(zone);
+				}
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(_lastFrameMutex);
+			_lastFrameZones.swap(zones);
+			_lastFrame = frame;
+		}
+
+		_frame.erase(_frame.begin(), resolvedFrame.base());
+	}
+
+	while (_frame.size() > MAX_FRAMES) _frame.pop_front();
+
+	if (!_recording) this->trim(_frame.empty() ? _frameStart : _frame.front()._start);
+}
+
+std::pair<uint64_t, uint64_t> Profiler::getLastFrame(std::vector<Zone>& zones, std::vector<std::string>& timelineName)
+{
+	{
+		std::lock_guard<std::mutex> lock(_timelineMutex);
+
+		timelineName.clear();
+		for (std::unique_ptr<Timeline>& timeline : _timeline) timelineName.push_back(timeline->_name);
+	}
+
+	std::lock_guard<std::mutex> lock(_lastFrameMutex);
+	zones = _lastFrameZones;
+
+	return std::make_pair(_lastFrame._start, _lastFrame._end);
+}
+
+void Profiler::setEnabled(const bool enabled)
+{
+	Profiler::getInstance();								// Created from the calling thread rather than from the first zone
+	_enabled.store(enabled);
+}
+
+void Profiler::setThreadName(const std::string& name)
+{
+	_threadName = name;
+
+	if (_threadTimeline)
+	{
+		Profiler* profiler = Profiler::getInstance();
+
+		std::lock_guard<std::mutex> lock(profiler->_timelineMutex);
+		_threadTimeline->_name = name;
+	}
+}
+
+void Profiler::startRecording()
+{
+	Profiler::setEnabled(true);
+
+	_recordingStart = this->now();
+	_recording = true;
+}
+
+bool Profiler::stopRecording(const std::string& filename)
+{
+	if (!_recording)
+	{
+		return false;
+	}
+
+	if (!_pendingQuery.empty())
+	{
+		this->calibrateGPUClock();
+		this->resolveGPUZones(true);
+	}
+
+	_recording = false;
+
+	std::ofstream file(filename);
+	if (!file.is_open())
+	{
+		std::cout << "Trace " << filename << " could not be written!" << std::endl;
+		return false;
+	}
+
+	// Complete events with microsecond timestamps, every timeline being a thread of the same process
+	file << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+
+	{
+		std::lock_guard<std::mutex> lock(_timelineMutex);
+		bool firstEvent = true;
+
+		for (std::unique_ptr<Timeline>& timeline : _timeline)
+		{
+			std::lock_guard<std::mutex> timelineLock(timeline->_mutex);
+			const char* category = timeline->_index == 0 ? "gpu" : "cpu";
+
+			file << (firstEvent ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << timeline->_index << ",\"args\":{\"name\":\"" << timeline->_name << "\"}}";
+			firstEvent = false;
+
+			for (const Zone& zone : timeline->_zones)
+			{
+				if (zone._end < _recordingStart) continue;
+
+				file << ",\n{\"name\":\"" << zone._name << "\",\"cat\":\"" << category << "\",\"ph\":\"X\",\"ts\":" << zone._start / 1000.0 << ",\"dur\":" << (zone._end - zone._start) / 1000.0
+					<< ",\"pid\":0,\"tid\":" << timeline->_index << "}";
+			}
+		}
+	}
+
+	file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+	file.close();
+
+	if (!Profiler::isEnabled()) this->trim(this->now());
+
+	return !file.fail();
+}
+
+/// [Protected methods]
+
+Profiler::Profiler() :
+	_epoch(std::chrono::steady_clock::now()), _gpuDepth(0), _gpuOffset(0), _frameStart(NO_FRAME), _lastFrame{ 0, 0 }, _recording(false), _recordingStart(0)
+{
+	// GPU zones are kept in the first timeline
+	_timeline.push_back(std::make_unique<Timeline>());
+	_timeline[0]->_index = 0;
+	_timeline[0]->_name = "GPU";
+	_timeline[0]->_depth = 0;
+}
+
+void Profiler::calibrateGPUClock()
+{
+	GLint64 gpuTime;
+	glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+
+	_gpuOffset = int64_t(this->now()) - int64_t(gpuTime);
+}
+
+Profiler::Timeline* Profiler::getTimeline()
+{
+	if (!_threadTimeline)
+	{
+		std::lock_guard<std::mutex> lock(_timelineMutex);
+
+		_timeline.push_back(std::make_unique<Timeline>());
+		_threadTimeline = _timeline.back().get();
+		_threadTimeline->_index = unsigned(_timeline.size() - 1);
+		_threadTimeline->_name = _threadName.empty() ? "Thread " + std::to_string(_threadTimeline->_index) : _threadName;
+		_threadTimeline->_depth = 0;
+	}
+
+	return _threadTimeline;
+}
+
+void Profiler::record(Timeline* timeline, const Zone& zone)
+{
+	std::lock_guard<std::mutex> lock(timeline->_mutex);
+	timeline->_zones.push_back(zone);
+}
+
+void Profiler::resolveGPUZones(const bool wait)
+{
+	Timeline* gpuTimeline = _timeline[0].get();
+
+	while (!_pendingQuery.empty())
+	{
+		const GPUQuery& query = _pendingQuery.front();
+
+		if (!wait)
+		{
+			GLint available = 0;
+			glGetQueryObjectiv(query._query[1], GL_QUERY_RESULT_AVAILABLE, &available);
+
+			if (!available) break;
+		}
+
+		GLuint64 gpuStart, gpuEnd;
+		glGetQueryObjectui64v(query._query[0], GL_QUERY_RESULT, &gpuStart);
+		glGetQueryObjectui64v(query._query[1], GL_QUERY_RESULT, &gpuEnd);
+
+		const uint64_t start = uint64_t((std::max)(int64_t(gpuStart) + _gpuOffset, int64_t(0)));
+		const uint64_t end = uint64_t((std::max)(int64_t(gpuEnd) + _gpuOffset, int64_t(start)));
+
+		this->record(gpuTimeline, Zone{ query._name, start, end, 0, query._depth });
+
+		_freeQuery.push_back(query._query[0]);
+		_freeQuery.push_back(query._query[1]);
+		_pendingQuery.pop_front();
+	}
+}
+
+void Profiler::trim(const uint64_t time)
+{
+	std::lock_guard<std::mutex> lock(_timelineMutex);
+
+	for (std::unique_ptr<Timeline>& timeline : _timeline)
+	{
+		std::lock_guard<std::mutex> timelineLock(timeline->_mutex);
+
+		// Zones of a timeline are closed in order, so those which finished earlier are at the front
+		auto firstKept = std::find_if(timeline->_zones.begin(), timeline->_zones.end(), [time](const Zone& zone) { return zone._end >= time; });
+		timeline->_zones.erase(timeline->_zones.begin(), firstKept);
+	}
+}
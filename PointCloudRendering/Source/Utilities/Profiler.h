@@ -0,0 +1,220 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+
+#include "Utilities/Singleton.h"
+
+/**
+*	@file Profiler.h
+*	@authors Alfonso Lpez Ruiz (alr00048@red.ujaen.es)
+*	@date 19/10/2026
+*/
+
+/**
+*	@brief Hierarchical profiler of CPU and GPU work. Zones are scoped objects which nest on the timeline of the thread which opens them,
+*	and GPU zones are measured with timestamp queries which are resolved a few frames later, without stalling the pipeline. When the profiler
+*	is disabled, opening a zone only reads a flag. Completed frames feed the live view of the interface, and recordings are written as
+*	Chrome trace files, which can be opened with chrome://tracing or Perfetto.
+*/
+class Profiler: public Singleton<Profiler>
+{
+	friend class Singleton<Profiler>;
+
+public:
+	struct Zone
+	{
+		const char*		_name;												//!< Static string which names the zone
+		uint64_t		_start, _end;										//!< Nanoseconds since the profiler was created
+		unsigned		_timelineIdx;										//!< Thread, or GPU, where the zone was measured
+		unsigned		_depth;												//!< Number of enclosing zones
+	};
+
+	/**
+	*	@brief CPU zone which lasts until the end of its scope.
+	*/
+	class ScopedZone
+	{
+	protected:
+		const char*		_name;												//!< Static string which names the zone
+		uint64_t		_start;												//!< Opening time
+		bool			_active;											//!< The profiler was enabled when the zone was opened
+
+	public:
+		/**
+		*	@brief Opens a zone in the timeline of the calling thread.
+		*	@param name String which must outlive the profiler, usually a literal.
+		*/
+		ScopedZone(const char* name);
+
+		/**
+		*	@brief Closes the zone.
+		*/
+		virtual ~ScopedZone();
+	};
+
+	/**
+	*	@brief GPU zone which measures the commands issued until the end of its scope. Must be used from the thread which owns the context.
+	*/
+	class GPUZone
+	{
+	protected:
+		const char*		_name;												//!< Static string which names the zone
+		GLuint			_query[2];											//!< Timestamp queries of the opening and closing commands
+		unsigned		_depth;												//!< Number of enclosing GPU zones
+		bool			_active;											//!< The profiler was enabled when the zone was opened
+
+	public:
+		/**
+		*	@brief Opens a zone in the GPU timeline.
+		*	@param name String which must outlive the profiler, usually a literal.
+		*/
+		GPUZone(const char* name);
+
+		/**
+		*	@brief Closes the zone.
+		*/
+		virtual ~GPUZone();
+	};
+
+protected:
+	const static unsigned	MAX_FRAMES;										//!< Frames kept while their GPU zones are resolved
+	const static uint64_t	NO_FRAME;										//!< Start of the current frame before the first one
+
+protected:
+	struct Timeline
+	{
+		unsigned			_index;											//!< Position in the list of timelines
+		std::string			_name;											//!< Name of the thread
+		std::vector<Zone>	_zones;											//!< Closed zones, in closing order
+		std::mutex			_mutex;											//!< Guards the zones against readers of other threads
+		unsigned			_depth;											//!< Zones which are open, only accessed by the owner thread
+	};
+
+	struct GPUQuery
+	{
+		const char*		_name;												//!< Static string which names the zone
+		GLuint			_query[2];											//!< Timestamp queries of the opening and closing commands
+		unsigned		_depth;												//!< Number of enclosing GPU zones
+		uint64_t		_issued;											//!< CPU time when the zone was closed
+	};
+
+	struct Frame
+	{
+		uint64_t		_start, _end;										//!< Interval of the frame in the CPU clock
+	};
+
+protected:
+	static std::atomic<bool>		_enabled;								//!< Zones are only measured while enabled
+	static thread_local Timeline*	_threadTimeline;						//!< Timeline of the calling thread, if it has recorded any zone
+	static thread_local std::string	_threadName;							//!< Name given to the timeline of the calling thread
+
+	std::chrono::steady_clock::time_point	_epoch;							//!< Origin of every timestamp
+	std::vector<std::unique_ptr<Timeline>>	_timeline;						//!< Timeline of every thread which has recorded zones, and the GPU one
+	std::mutex								_timelineMutex;					//!< Guards the list of timelines
+
+	std::deque<GPUQuery>					_pendingQuery;					//!< Closed GPU zones whose timestamps are not available yet
+	std::vector<GLuint>						_freeQuery;						//!< Query objects which can be reused
+	unsigned								_gpuDepth;						//!< Open GPU zones
+	int64_t									_gpuOffset;						//!< Difference between the CPU and GPU clocks
+
+	std::deque<Frame>						_frame;							//!< Recent frames, the oldest first
+	uint64_t								_frameStart;					//!< Start of the current frame
+	std::vector<Zone>						_lastFrameZones;				//!< Zones of the newest frame whose GPU zones are resolved
+	Frame									_lastFrame;						//!< Interval of that frame
+	std::mutex								_lastFrameMutex;				//!< Guards the published frame
+
+	bool									_recording;						//!< Zones are kept until the trace is written
+	uint64_t								_recordingStart;				//!< Start of the recording
+
+protected:
+	/**
+	*	@brief Constructor.
+	*/
+	Profiler();
+
+	/**
+	*	@brief Estimates the offset between the CPU and GPU clocks.
+	*/
+	void calibrateGPUClock();
+
+	/**
+	*	@return Timeline of the calling thread, which is created on its first zone.
+	*/
+	Timeline* getTimeline();
+
+	/**
+	*	@brief Appends a closed zone to a timeline.
+	*/
+	void record(Timeline* timeline, const Zone& zone);
+
+	/**
+	*	@brief Moves the GPU zones whose timestamps are available into the GPU timeline.
+	*	@param wait Waits for every pending query.
+	*/
+	void resolveGPUZones(const bool wait);
+
+	/**
+	*	@brief Removes the zones which finished before the given time.
+	*/
+	void trim(const uint64_t time);
+
+public:
+	/**
+	*	@brief Destructor.
+	*/
+	virtual ~Profiler();
+
+	/**
+	*	@brief Marks the start of a frame, publishing the newest complete frame whose GPU zones are available. Must be called from the
+	*	thread which owns the context.
+	*/
+	void beginFrame();
+
+	/**
+	*	@brief Copies the zones of the newest published frame.
+	*	@param timelineName Name of every timeline, indexed by the zones.
+	*	@return Interval of the frame, empty if there is none yet.
+	*/
+	std::pair<uint64_t, uint64_t> getLastFrame(std::vector<Zone>& zones, std::vector<std::string>& timelineName);
+
+	/**
+	*	@return True if zones are being measured.
+	*/
+	static bool isEnabled() { return _enabled.load(std::memory_order_relaxed); }
+
+	/**
+	*	@return True if a recording has been started and not saved yet.
+	*/
+	bool isRecording() const { return _recording; }
+
+	/**
+	*	@return Nanoseconds since the profiler was created.
+	*/
+	uint64_t now() const { return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _epoch).count()); }
+
+	/**
+	*	@brief Enables or disables the measurement of zones.
+	*/
+	static void setEnabled(const bool enabled);
+
+	/**
+	*	@brief Names the timeline of the calling thread. Does not create the profiler, so it can be called from any thread at any moment.
+	*/
+	static void setThreadName(const std::string& name);
+
+	/**
+	*	@brief Enables the profiler and keeps every zone closed from now on.
+	*/
+	void startRecording();
+
+	/**
+	*	@brief Writes the zones closed since the recording started as a Chrome trace file and stops the recording. Must be called from the
+	*	thread which owns the context if GPU zones were recorded.
+	*	@return False if the file could not be written.
+	*/
+	bool stopRecording(const std::string& filename);
+};
+
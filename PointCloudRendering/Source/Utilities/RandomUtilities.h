@@ -24,6 +24,18 @@ namespace RandomUtilities
 		DoubleUniformDistribution	_uniformDistribution;
 	}
 
+	/**
+	*	@return Four random words from the Philox4x32-10 counter-based generator. The same counter and key always produce the same words, so
+	*	every element of a parallel loop can draw its own values from its index, without sharing any state, and obtain the same sequence
+	*	whatever the number of threads.
+	*/
+	uvec4 getCounterBasedRandom(uvec4 counter, uvec2 key);
+
+	/**
+	*	@return Four uniform values in [0, 1) from the counter-based generator.
+	*/
+	vec4 getCounterBasedUniform(const uvec4& counter, const uvec2& key);
+
 	/**
 	*	@return New random value retrieved from a random uniform distribution.
 	*/
@@ -35,6 +47,24 @@ namespace RandomUtilities
 	void initializeUniformDistribution(const float min, const float max);
 }
 
+inline uvec4 RandomUtilities::getCounterBasedRandom(uvec4 counter, uvec2 key)
+{
+	for (int round = 0; round < 10; ++round)
+	{
+		const uint64_t product0 = uint64_t(0xD2511F53u) * counter.x, product1 = uint64_t(0xCD9E8D57u) * counter.z;
+
+		counter = uvec4(uint32_t(product1 >> 32) ^ counter.y ^ key.x, uint32_t(product1), uint32_t(product0 >> 32) ^ counter.w ^ key.y, uint32_t(product0));
+		key += uvec2(0x9E3779B9u, 0xBB67AE85u);
+	}
+
+	return counter;
+}
+
+inline vec4 RandomUtilities::getCounterBasedUniform(const uvec4& counter, const uvec2& key)
+{
+	return vec4(getCounterBasedRandom(counter, key) >> 8u) * (1.0f / float(1 << 24));
+}
+
 inline double RandomUtilities::getUniformRandomValue()
 {
 	return _uniformDistribution(_randomNumberGenerator);
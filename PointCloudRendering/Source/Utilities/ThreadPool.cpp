@@ -0,0 +1,230 @@
+#include "stdafx.h"
+#include "ThreadPool.h"
+
+#include "Utilities/Profiler.h"
+
+// [Static members initialization]
+
+const unsigned ThreadPool::NOT_WORKER = UINT_MAX;
+
+thread_local unsigned ThreadPool::_workerIdx = ThreadPool::NOT_WORKER;
+
+/// [Public methods]
+
+ThreadPool::TaskGroup::TaskGroup() :
+	_numPending(0), _numQueued(0), _sleeping(false)
+{
+}
+
+ThreadPool::TaskGroup::~TaskGroup()
+{
+	try
+	{
+		this->wait();
+	}
+	catch (...)
+	{
+	}
+}
+
+void ThreadPool::TaskGroup::wait()
+{
+	ThreadPool* pool = ThreadPool::getInstance();
+	Task task;
+
+	while (_numPending.load() > 0)
+	{
+		if (pool->pop(task, this))
+		{
+			task();
+			task = nullptr;
+
+			continue;
+		}
+
+		// The counters are checked while holding the sleep mutex, which both push() and notifyGroupFinished() take before waking anyone
+		std::unique_lock<std::mutex> lock(pool->_sleepMutex);
+		_sleeping = true;
+		pool->_sleepCondition.wait(lock, [this]() { return !_numPending.load() || _numQueued.load() > 0; });
+		_sleeping = false;
+	}
+
+	std::exception_ptr exception;
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		std::swap(exception, _exception);
+	}
+
+	if (exception) std::rethrow_exception(exception);
+}
+
+ThreadPool::~ThreadPool()
+{
+	this->stop();
+}
+
+void ThreadPool::setNumThreads(unsigned numThreads)
+{
+	if (!numThreads) numThreads = (std::max)(std::thread::hardware_concurrency(), 1u);
+
+	if (_workerIdx != NOT_WORKER)
+	{
+		std::cout << "The number of threads cannot be changed from a task!" << std::endl;
+		return;
+	}
+
+	if (numThreads == this->getNumThreads()) return;
+
+	this->stop();
+	this->start(numThreads);
+}
+
+/// [Protected methods]
+
+ThreadPool::ThreadPool() :
+	_numQueued(0), _nextQueue(0), _stop(false)
+{
+	this->start((std::max)(std::thread::hardware_concurrency(), 1u));
+}
+
+void ThreadPool::notifyGroupFinished()
+{
+	{
+		std::lock_guard<std::mutex> lock(_sleepMutex);
+	}
+
+	_sleepCondition.notify_all();
+}
+
+bool ThreadPool::pop(Task& task, TaskGroup* group)
+{
+	if (!(group ? group->_numQueued.load() : _numQueued.load())) return false;
+
+	const unsigned numQueues = unsigned(_queue.size());
+
+	// Removes the task at the given position, keeping the counters up to date
+	auto take = [&](std::deque<QueuedTask>& tasks, std::deque<QueuedTask>::iterator it)
+		{
+			task = std::move(it->_task);
+			if (it->_group) --it->_group->_numQueued;
+			tasks.erase(it);
+			--_numQueued;
+		};
+
+	if (_workerIdx < numQueues)
+	{
+		WorkerQueue& queue = *_queue[_workerIdx];
+		std::lock_guard<std::mutex> lock(queue._mutex);
+
+		for (auto it = queue._tasks.rbegin(); it != queue._tasks.rend(); ++it)
+		{
+			if (group && it->_group != group) continue;
+
+			take(queue._tasks, std::prev(it.base()));
+			return true;
+		}
+	}
+
+	// Stealing the oldest tasks takes the largest pieces of work, as they are usually split further by whoever runs them
+	const unsigned firstQueue = _workerIdx < numQueues ? _workerIdx + 1 : _nextQueue.load();
+
+	for (unsigned queueOffset = 0; queueOffset < numQueues; ++queueOffset)
+	{
+		WorkerQueue& queue = *_queue[(firstQueue + queueOffset) % numQueues];
+		std::lock_guard<std::mutex> lock(queue._mutex);
+
+		for (auto it = queue._tasks.begin(); it != queue._tasks.end(); ++it)
+		{
+			if (group && it->_group != group) continue;
+
+			take(queue._tasks, it);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void ThreadPool::push(Task&& task, TaskGroup* group)
+{
+	const unsigned numQueues = unsigned(_queue.size());
+	const unsigned queueIdx = _workerIdx < numQueues ? _workerIdx : _nextQueue.fetch_add(1) % numQueues;
+
+	bool wakeWaiter = false;
+
+	// Counted before being visible, so that a worker which finds the task never decrements below zero
+	{
+		std::lock_guard<std::mutex> lock(_sleepMutex);
+		++_numQueued;
+
+		if (group)
+		{
+			++group->_numQueued;
+			wakeWaiter = group->_sleeping;
+		}
+	}
+
+	{
+		WorkerQueue& queue = *_queue[queueIdx];
+		std::lock_guard<std::mutex> lock(queue._mutex);
+		queue._tasks.push_back(QueuedTask{ std::move(task), group });
+	}
+
+	// A sleeping waiter of the group must be woken as well, and notifying a single thread may only wake a worker
+	if (wakeWaiter) _sleepCondition.notify_all();
+	else _sleepCondition.notify_one();
+}
+
+void ThreadPool::start(const unsigned numThreads)
+{
+	_stop = false;
+
+	for (unsigned workerIdx = 0; workerIdx < numThreads; ++workerIdx)
+	{
+		_queue.push_back(std::make_unique<WorkerQueue>());
+	}
+
+	for (unsigned workerIdx = 0; workerIdx < numThreads; ++workerIdx)
+	{
+		_worker.push_back(std::thread(&ThreadPool::work, this, workerIdx));
+	}
+}
+
+void ThreadPool::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(_sleepMutex);
+		_stop = true;
+	}
+
+	_sleepCondition.notify_all();
+	for (std::thread& worker : _worker) worker.join();
+
+	_worker.clear();
+	_queue.clear();
+}
+
+void ThreadPool::work(const unsigned workerIdx)
+{
+	_workerIdx = workerIdx;
+	Profiler::setThreadName("Worker " + std::to_string(workerIdx));
+
+	Task task;
+
+	while (true)
+	{
+		if (this->pop(task))
+		{
+			task();
+			task = nullptr;
+
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(_sleepMutex);
+		_sleepCondition.wait(lock, [this]() { return _stop || _numQueued.load() > 0; });
+
+		if (_stop && !_numQueued.load()) return;
+	}
+}
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+
+#include "Utilities/Singleton.h"
+
+/**
+*	@file ThreadPool.h
+*	@authors Alfonso Lpez Ruiz (alr00048@red.ujaen.es)
+*	@date 19/10/2026
+*/
+
+/**
+*	@brief Work-stealing scheduler shared by every CPU task of the application, so that the number of threads stays bounded whatever the
+*	number of subsystems running at once. Every worker owns a queue where it pushes the tasks it spawns and from which it takes the newest
+*	one, while idle workers steal the oldest tasks of the others. Threads waiting for a group of tasks execute the pending tasks of that group
+*	meanwhile, so that groups can be nested inside tasks without deadlocks, and sleep once there is nothing left to take. Tasks enqueued with
+*	submit() belong to no group and are therefore only run by workers, so that waiting for a parallel loop never runs, e.g., a file export.
+*/
+class ThreadPool: public Singleton<ThreadPool>
+{
+	friend class Singleton<ThreadPool>;
+
+public:
+	typedef std::function<void()> Task;
+
+	/**
+	*	@brief Set of tasks which are waited for as a whole. The first exception thrown by any of them is rethrown by wait().
+	*/
+	class TaskGroup
+	{
+		friend class ThreadPool;
+
+	protected:
+		std::atomic<unsigned>	_numPending;								//!< Tasks which have not finished yet
+		std::atomic<unsigned>	_numQueued;									//!< Tasks which have not been taken from the queues yet
+		std::exception_ptr		_exception;									//!< First exception thrown by a task
+		std::mutex				_mutex;										//!< Guards the exception
+		bool					_sleeping;									//!< The waiter is sleeping, guarded by the sleep mutex of the pool
+
+	public:
+		/**
+		*	@brief Constructor.
+		*/
+		TaskGroup();
+
+		/**
+		*	@brief Destructor. Waits for the pending tasks, discarding their exceptions.
+		*/
+		virtual ~TaskGroup();
+
+		/**
+		*	@brief Enqueues a task of the group.
+		*/
+		template<typename Function>
+		void run(Function&& function);
+
+		/**
+		*	@brief Executes pending tasks of the group until every one of them has finished. If none is queued, the remaining tasks are
+		*	running in other threads, so it sleeps until the group is finished or a new task of the group is enqueued.
+		*/
+		void wait();
+	};
+
+protected:
+	const static unsigned NOT_WORKER;										//!< Index of threads which do not belong to the pool
+
+protected:
+	struct QueuedTask
+	{
+		Task				_task;											//!< Function to be executed
+		TaskGroup*			_group;											//!< Group of the task, null for tasks enqueued with submit()
+	};
+
+	struct WorkerQueue
+	{
+		std::deque<QueuedTask>	_tasks;										//!< Tasks spawned by the worker, the newest at the back
+		std::mutex				_mutex;										//!< Guards the tasks against thieves
+	};
+
+protected:
+	static thread_local unsigned _workerIdx;								//!< Worker running in the current thread, if any
+
+	std::vector<std::unique_ptr<WorkerQueue>>	_queue;						//!< Queue of every worker
+	std::vector<std::thread>					_worker;					//!< Threads of the pool
+	std::atomic<unsigned>						_numQueued;					//!< Tasks waiting in any queue, workers sleep while there are none
+	std::atomic<unsigned>						_nextQueue;					//!< Round-robin queue of tasks enqueued by other threads
+	std::mutex									_sleepMutex;				//!< Guards the sleep of workers
+	std::condition_variable						_sleepCondition;			//!< Wakes workers when a task is enqueued
+	bool										_stop;						//!< Asks the workers to finish once the queues are empty
+
+protected:
+	/**
+	*	@brief Constructor. Launches as many workers as hardware threads.
+	*/
+	ThreadPool();
+
+	/**
+	*	@brief Wakes the threads waiting for a group once its last task has finished. Workers are woken as well, but they go back to sleep
+	*	if there is nothing to do.
+	*/
+	void notifyGroupFinished();
+
+	/**
+	*	@brief Takes the newest task of the worker running in this thread or, if there is none, the oldest task of any other queue.
+	*	@param group Only tasks of this group are taken if not null.
+	*	@return False if there is no such task.
+	*/
+	bool pop(Task& task, TaskGroup* group = nullptr);
+
+	/**
+	*	@brief Enqueues a task in the queue of the current worker. Other threads distribute their tasks among every queue.
+	*/
+	void push(Task&& task, TaskGroup* group = nullptr);
+
+	/**
+	*	@brief Launches the workers.
+	*/
+	void start(const unsigned numThreads);
+
+	/**
+	*	@brief Waits for the workers to empty the queues and joins them.
+	*/
+	void stop();
+
+	/**
+	*	@brief Executes tasks until the pool is stopped.
+	*/
+	void work(const unsigned workerIdx);
+
+public:
+	/**
+	*	@brief Destructor. Tasks which are still queued are completed before the workers are released.
+	*/
+	virtual ~ThreadPool();
+
+	/**
+	*	@return Number of workers.
+	*/
+	unsigned getNumThreads() const { return unsigned(_worker.size()); }
+
+	/**
+	*	@brief Calls a function for every index of [begin, end), split into chunks executed by the pool and the calling thread.
+	*	@param grainSize Indices of every chunk. Zero splits the range into several chunks per worker.
+	*/
+	template<typename Function>
+	void parallelFor(const size_t begin, const size_t end, const Function& function, size_t grainSize = 0);
+
+	/**
+	*	@brief Replaces the workers once the pending tasks are finished. Must not be called from a task.
+	*	@param numThreads Number of workers, zero for as many as hardware threads.
+	*/
+	void setNumThreads(unsigned numThreads);
+
+	/**
+	*	@brief Enqueues a task whose result, or exception, is given by the returned future. Tasks should not block on futures of other
+	*	tasks, as they would hold a worker meanwhile; task groups are preferred for nested tasks.
+	*/
+	template<typename Function>
+	auto submit(Function&& function) -> std::future<std::invoke_result_t<std::decay_t<Function>>>;
+};
+
+/// [Public methods]
+
+template<typename Function>
+void ThreadPool::TaskGroup::run(Function&& function)
+{
+	++_numPending;
+
+	ThreadPool::getInstance()->push([this, function = std::forward<Function>(function)]() mutable
+		{
+			try
+			{
+				function();
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				if (!_exception) _exception = std::current_exception();
+			}
+
+			// The group may be destroyed by its waiter as soon as the counter reaches zero, so it is not accessed afterwards
+			if (--_numPending == 0) ThreadPool::getInstance()->notifyGroupFinished();
+		}, this);
+}
+
+template<typename Function>
+void ThreadPool::parallelFor(const size_t begin, const size_t end, const Function& function, size_t grainSize)
+{
+	if (begin >= end) return;
+	if (!grainSize) grainSize = (std::max)(size_t(1), (end - begin) / (size_t(this->getNumThreads()) * 8));
+
+	TaskGroup group;
+	size_t chunkBegin = begin;
+
+	for (; end - chunkBegin > grainSize; chunkBegin += grainSize)
+	{
+		group.run([&function, chunkBegin, chunkEnd = chunkBegin + grainSize]()
+			{
+				for (size_t index = chunkBegin; index < chunkEnd; ++index) function(index);
+			});
+	}
+
+	// The calling thread takes the last chunk instead of just waiting
+	for (size_t index = chunkBegin; index < end; ++index) function(index);
+
+	group.wait();
+}
+
+template<typename Function>
+auto ThreadPool::submit(Function&& function) -> std::future<std::invoke_result_t<std::decay_t<Function>>>
+{
+	typedef std::invoke_result_t<std::decay_t<Function>> Result;
+
+	auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Function>(function));
+	std::future<Result> future = task->get_future();
+
+	this->push([task]() { (*task)(); });
+
+	return future;
+}
+
@@ -1,11 +1,16 @@
 #include "stdafx.h"
+#include "Interface/HeadlessRenderer.h"
 #include "Interface/Window.h"
+#include "Utilities/Profiler.h"
+
+#ifdef _WIN32
 #include <windows.h>						// DWORD is undefined otherwise
 
 // Laptop support. Use NVIDIA graphic card instead of Intel
 extern "C" {
 	_declspec(dllexport) DWORD NvOptimusEnablement = 0x00000001;
 }
+#endif
 
 static void glfw_error_callback(int error, const char* description)
 {
@@ -16,6 +21,15 @@ static void glfw_error_callback(int error, const char* description)
 int main(int argc, char *argv[])
 {
 	srand(time(nullptr));
+	Profiler::setThreadName("Main");
+
+	if (HeadlessRenderer::isRequested(argc, argv))			// Batch rendering from the command line, without window
+	{
+		HeadlessRenderer::Settings settings;
+		if (!HeadlessRenderer::parseArguments(argc, argv, settings)) return 1;
+
+		return HeadlessRenderer::run(settings);
+	}
 	
 	std::cout << "__ Starting Point Cloud Renderer __" << std::endl;
 
@@ -36,7 +50,9 @@ int main(int argc, char *argv[])
 		}
 	}
 
+#ifdef _WIN32
 	system("pause");
+#endif
 
 	return 0;
 }